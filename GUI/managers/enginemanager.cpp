@@ -375,6 +375,12 @@ void EngineManager::on_generateGridPushButton_clicked() {
 void EngineManager::on_distanceSpinBox_valueChanged(double arg1) {
     if (g!=nullptr){
         g->setKernelDistance(arg1);
+        if (d!=nullptr && g->isKernelFrozen()){ //only the weights of the points entering or leaving the kernel are updated
+            std::set<const Dcel::Face*> flippedFaces, savedFaces;
+            Engine::getFlippedFaces(flippedFaces, savedFaces, *d, g->getTarget(), (double)ui->toleranceSlider->value()/100, ui->areaToleranceSpinBox->value());
+            g->updateWeightsAndFreezeKernel(*d, arg1, ui->heightfieldsCheckBox->isChecked(), savedFaces);
+            e = Energy(*g);
+        }
         mainWindow.canvas.update();
     }
 }
@@ -410,9 +416,11 @@ void EngineManager::on_freezeKernelPushButton_clicked() {
         g->setTarget(XYZ[ui->targetComboBox->currentIndex()]);
         std::set<const Dcel::Face*> flippedFaces, savedFaces;
         Engine::getFlippedFaces(flippedFaces, savedFaces, *d, XYZ[ui->targetComboBox->currentIndex()], (double)ui->toleranceSlider->value()/100, ui->areaToleranceSpinBox->value());
-        g->calculateWeightsAndFreezeKernel(*d, value, ui->heightfieldsCheckBox->isChecked(), savedFaces);
+        if (!g->updateWeightsAndFreezeKernel(*d, value, ui->heightfieldsCheckBox->isChecked(), savedFaces)){
+            e = Energy(*g);
+            e.calculateFullBoxValues(*g);
+        }
         e = Energy(*g);
-        e.calculateFullBoxValues(*g);
         mainWindow.canvas.update();
     }
 
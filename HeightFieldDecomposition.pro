@@ -40,6 +40,36 @@ CONVERTER_MODE {
     DEFINES += CONVERTER_MODE
 }
 
+#uncomment next line to use the old Sympy generated integral of the tricubic interpolation
+#CONFIG += SYMPY_INTEGRAL
+SYMPY_INTEGRAL {
+    DEFINES += SYMPY_INTEGRAL
+}
+
+#uncomment next line to compute the distance field with the old AABB tree inside test and CGAL distances
+#CONFIG += AABB_DISTANCE_FIELD
+AABB_DISTANCE_FIELD {
+    DEFINES += AABB_DISTANCE_FIELD
+}
+
+#uncomment next line to store the grids on sparse tiles (large models)
+#CONFIG += TILED_GRID
+TILED_GRID {
+    DEFINES += TILED_GRID
+}
+
+#uncomment next line to compute coefficients and summed tables of the grids only where they are used
+#CONFIG += LAZY_GRID
+LAZY_GRID {
+    DEFINES += LAZY_GRID
+}
+
+#uncomment next line to keep the grids on disk, in bricks cached in memory (grids larger than the RAM)
+#CONFIG += OUT_OF_CORE_GRID
+OUT_OF_CORE_GRID {
+    DEFINES += OUT_OF_CORE_GRID
+}
+
 message(Included modules: $$MODULES)
 FINAL_RELEASE {
     message(Final Release!)
@@ -64,6 +94,12 @@ HEADERS += \
     GUI/managers/enginemanager.h \
     engine/tricubic.h \
     engine/energy.h \
+    engine/basintable.h \
+    engine/setcover.h \
+    engine/coveragematrix.h \
+    engine/setcoverpresolve.h \
+    engine/triangleindex.h \
+    engine/boxindex.h \
     engine/box.h \
     engine/boxlist.h \
     engine/engine.h \
@@ -72,9 +108,18 @@ HEADERS += \
     engine/splitting.h \
     engine/reconstruction.h \
     lib/grid/grid.h \
+    lib/grid/distancefield.h \
+    lib/grid/gridfamily.h \
+    lib/grid/tiledarray.h \
+    lib/grid/tiledgrid.h \
+    lib/grid/lazygrid.h \
+    lib/grid/outofcoregrid.h \
+    lib/grid/gridcache.h \
+    lib/grid/gridpyramid.h \
     lib/packing/binpack2d.h \
     lib/graph/undirectednode.h \
     lib/graph/directedgraph.h \
+    lib/bitmap/bitmapset.h \
     engine/tinyfeaturedetection.h
 
 SOURCES += \
@@ -83,6 +128,12 @@ SOURCES += \
     GUI/managers/enginemanager.cpp \
     engine/tricubic.cpp \
     engine/energy.cpp \
+    engine/basintable.cpp \
+    engine/setcover.cpp \
+    engine/coveragematrix.cpp \
+    engine/setcoverpresolve.cpp \
+    engine/triangleindex.cpp \
+    engine/boxindex.cpp \
     engine/box.cpp \
     engine/boxlist.cpp \
     engine/engine.cpp \
@@ -91,7 +142,15 @@ SOURCES += \
     engine/splitting.cpp \
     engine/reconstruction.cpp \
     lib/grid/grid.cpp \
+    lib/grid/distancefield.cpp \
+    lib/grid/gridfamily.cpp \
+    lib/grid/tiledgrid.cpp \
+    lib/grid/lazygrid.cpp \
+    lib/grid/outofcoregrid.cpp \
+    lib/grid/gridcache.cpp \
+    lib/grid/gridpyramid.cpp \
     lib/grid/drawablegrid.cpp \
+    lib/bitmap/bitmapset.cpp \
     engine/tinyfeaturedetection.cpp \
     engine/tinyfeaturedetection2.cpp
 
@@ -0,0 +1,128 @@
+#include "basintable.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace cg3;
+
+/**
+ * @brief BasinTable::BasinTable
+ * @param snap: size of the cells used to snap the coordinates of the boxes (usually the unit of the grid)
+ */
+BasinTable::BasinTable(double snap) : snap(snap), nCompleted(0), nEarlyStops(0), completedEvaluations(0), earlyStopEvaluations(0) {
+    for (unsigned int i = 0; i < BASIN_TABLE_SHARDS; i++)
+        omp_init_lock(&locks[i]);
+}
+
+BasinTable::~BasinTable() {
+    for (unsigned int i = 0; i < BASIN_TABLE_SHARDS; i++)
+        omp_destroy_lock(&locks[i]);
+}
+
+/**
+ * @brief BasinTable::find
+ *
+ * If a box matching min-max with the same target has already been produced, returns true and
+ * its coordinates in foundMin and foundMax. Along every axis, the bucket of the min corner and
+ * the neighbouring buckets within BASIN_TOLERANCE*snap are probed.
+ */
+bool BasinTable::find(const Pointd& min, const Pointd& max, const Vec3& target, Pointd& foundMin, Pointd& foundMax) {
+    Key k = getKey(min, target);
+    long int lo[3], hi[3];
+    for (unsigned int i = 0; i < 3; i++){
+        double f = min[i] / snap - k[i];
+        lo[i] = f <= BASIN_TOLERANCE ? -1 : 0;
+        hi[i] = f >= 1 - BASIN_TOLERANCE ? 1 : 0;
+    }
+    Key kn = k;
+    for (long int x = lo[0]; x <= hi[0]; x++){
+        for (long int y = lo[1]; y <= hi[1]; y++){
+            for (long int z = lo[2]; z <= hi[2]; z++){
+                kn[0] = k[0] + x; kn[1] = k[1] + y; kn[2] = k[2] + z;
+                if (findInBucket(kn, min, max, foundMin, foundMax))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief BasinTable::insert
+ *
+ * Inserts a produced box. If a matching box is already in its bucket, the first one is kept.
+ */
+void BasinTable::insert(const Pointd& min, const Pointd& max, const Vec3& target) {
+    Key k = getKey(min, target);
+    size_t s = KeyHasher()(k) % BASIN_TABLE_SHARDS;
+    omp_set_lock(&locks[s]);
+    Bucket& bucket = shards[s][k];
+    bool found = false;
+    for (unsigned int i = 0; i < bucket.size() && !found; i++)
+        found = isMatching(min, max, bucket[i].first, bucket[i].second);
+    if (!found)
+        bucket.push_back(std::make_pair(min, max));
+    omp_unset_lock(&locks[s]);
+}
+
+void BasinTable::addCompletedRun(unsigned int nEvaluations) {
+    #pragma omp atomic
+    nCompleted++;
+    #pragma omp atomic
+    completedEvaluations += nEvaluations;
+}
+
+void BasinTable::addEarlyStop(unsigned int nEvaluations) {
+    #pragma omp atomic
+    nEarlyStops++;
+    #pragma omp atomic
+    earlyStopEvaluations += nEvaluations;
+}
+
+/**
+ * @brief BasinTable::getEstimatedSavedEvaluations
+ *
+ * Energy evaluations saved by the early stops, estimated with the average number
+ * of evaluations of the completed runs.
+ */
+long int BasinTable::getEstimatedSavedEvaluations() const {
+    if (nCompleted == 0)
+        return 0;
+    double average = (double)completedEvaluations / nCompleted;
+    return std::max(0l, (long int)std::round(average * nEarlyStops) - earlyStopEvaluations);
+}
+
+BasinTable::Key BasinTable::getKey(const Pointd& min, const Vec3& target) const {
+    Key k;
+    for (unsigned int i = 0; i < 3; i++){
+        k[i] = (long int)std::floor(min[i] / snap);
+        k[i+3] = std::lround(target[i]);
+    }
+    return k;
+}
+
+bool BasinTable::findInBucket(const Key& k, const Pointd& min, const Pointd& max, Pointd& foundMin, Pointd& foundMax) {
+    size_t s = KeyHasher()(k) % BASIN_TABLE_SHARDS;
+    bool found = false;
+    omp_set_lock(&locks[s]);
+    std::unordered_map<Key, Bucket, KeyHasher>::const_iterator it = shards[s].find(k);
+    if (it != shards[s].end()){
+        for (unsigned int i = 0; i < it->second.size() && !found; i++){
+            if (isMatching(min, max, it->second[i].first, it->second[i].second)){
+                foundMin = it->second[i].first;
+                foundMax = it->second[i].second;
+                found = true;
+            }
+        }
+    }
+    omp_unset_lock(&locks[s]);
+    return found;
+}
+
+bool BasinTable::isMatching(const Pointd& min1, const Pointd& max1, const Pointd& min2, const Pointd& max2) const {
+    double tolerance = BASIN_TOLERANCE * snap;
+    for (unsigned int i = 0; i < 3; i++)
+        if (std::abs(min1[i] - min2[i]) > tolerance || std::abs(max1[i] - max2[i]) > tolerance)
+            return false;
+    return true;
+}
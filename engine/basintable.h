@@ -0,0 +1,77 @@
+#ifndef BASINTABLE_H
+#define BASINTABLE_H
+
+#include <unordered_map>
+#include <array>
+#include <vector>
+#include <omp.h>
+#include <cg3/geometry/point.h>
+
+#define BASIN_TABLE_SHARDS 64
+#define BASIN_PROBE_ITERATIONS 5 //a BFGS run probes the table every BASIN_PROBE_ITERATIONS iterations
+#define BASIN_TOLERANCE 0.5 //two boxes match if their coordinates differ at most BASIN_TOLERANCE*snap
+
+/**
+ * @brief The BasinTable class
+ *
+ * Concurrent hash table of the boxes produced by the BFGS runs of a box expansion, bucketed on the
+ * min corner of the box snapped on a grid and on the target.
+ * A run whose trajectory lands within BASIN_TOLERANCE*snap of an already produced box (on all the
+ * coordinates) can stop early and take that box. Since a matching box may lie in a neighbouring
+ * bucket, the buckets around the min corner are probed too.
+ * The table is split in shards, each one protected by its own lock.
+ */
+class BasinTable {
+    public:
+        BasinTable(double snap);
+        ~BasinTable();
+
+        bool find(const cg3::Pointd& min, const cg3::Pointd& max, const cg3::Vec3& target, cg3::Pointd& foundMin, cg3::Pointd& foundMax);
+        void insert(const cg3::Pointd& min, const cg3::Pointd& max, const cg3::Vec3& target);
+
+        void addCompletedRun(unsigned int nEvaluations);
+        void addEarlyStop(unsigned int nEvaluations);
+        unsigned int getNumberEarlyStops() const;
+        unsigned int getNumberCompletedRuns() const;
+        long int getEstimatedSavedEvaluations() const;
+
+    private:
+        typedef std::array<long int, 6> Key;
+        typedef std::vector<std::pair<cg3::Pointd, cg3::Pointd> > Bucket;
+
+        struct KeyHasher {
+            size_t operator()(const Key& k) const;
+        };
+
+        Key getKey(const cg3::Pointd& min, const cg3::Vec3& target) const;
+        bool findInBucket(const Key& k, const cg3::Pointd& min, const cg3::Pointd& max, cg3::Pointd& foundMin, cg3::Pointd& foundMax);
+        bool isMatching(const cg3::Pointd& min1, const cg3::Pointd& max1, const cg3::Pointd& min2, const cg3::Pointd& max2) const;
+
+        BasinTable(const BasinTable&);
+        BasinTable& operator=(const BasinTable&);
+
+        double snap;
+        std::unordered_map<Key, Bucket, KeyHasher> shards[BASIN_TABLE_SHARDS];
+        omp_lock_t locks[BASIN_TABLE_SHARDS];
+
+        //statistics
+        unsigned int nCompleted, nEarlyStops;
+        long int completedEvaluations, earlyStopEvaluations;
+};
+
+inline unsigned int BasinTable::getNumberEarlyStops() const {
+    return nEarlyStops;
+}
+
+inline unsigned int BasinTable::getNumberCompletedRuns() const {
+    return nCompleted;
+}
+
+inline size_t BasinTable::KeyHasher::operator()(const Key& k) const {
+    size_t h = 0;
+    for (long int v : k)
+        h = h * 1000003 ^ std::hash<long int>()(v);
+    return h;
+}
+
+#endif // BASINTABLE_H
@@ -349,12 +349,15 @@ double Box3D::sceneRadius() const {
 
 void Box3D::serialize(std::ofstream& binaryFile) const {
     BoundingBox::serialize(binaryFile);
-    serializeObjectAttributes("box", binaryFile, c1, c2, c3, color, visible, target, rotation, id, piece, trianglesCovered);
+    std::set<unsigned int> tc(trianglesCovered.begin(), trianglesCovered.end());
+    serializeObjectAttributes("box", binaryFile, c1, c2, c3, color, visible, target, rotation, id, piece, tc);
 }
 
 void Box3D::deserialize(std::ifstream& binaryFile) {
     BoundingBox::deserialize(binaryFile);
-    deserializeObjectAttributes("box", binaryFile, c1, c2, c3, color, visible, target, rotation, id, piece, trianglesCovered);
+    std::set<unsigned int> tc;
+    deserializeObjectAttributes("box", binaryFile, c1, c2, c3, color, visible, target, rotation, id, piece, tc);
+    trianglesCovered = BitmapSet(tc.begin(), tc.end());
 }
 
 const Vec3& Box3D::getTarget() const {
@@ -478,16 +481,16 @@ Box3D::Split Box3D::getSplit(const Box& other) {
     return split;
 }
 
-const std::set<unsigned int>& Box3D::getTrianglesCovered() const {
+const BitmapSet& Box3D::getTrianglesCovered() const {
     return trianglesCovered;
 }
 
-void Box3D::setTrianglesCovered(const std::set<unsigned int>& value) {
+void Box3D::setTrianglesCovered(const BitmapSet& value) {
     trianglesCovered = value;
 }
 
-void Box3D::addTrianglesCovered(const std::set<unsigned int>& value) {
-    trianglesCovered.insert(value.begin(), value.end());
+void Box3D::addTrianglesCovered(const BitmapSet& value) {
+    trianglesCovered = union_(trianglesCovered, value);
 }
 
 double Box3D::getBaseLevel() const {
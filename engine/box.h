@@ -6,6 +6,7 @@
 #include <cg3/viewer/opengl_objects/opengl_objects.h>
 #include <cg3/meshes/eigenmesh/eigenmesh.h>
 #include <cg3/utilities/color.h>
+#include "lib/bitmap/bitmapset.h"
 
 class Box3D : public cg3::BoundingBox, public cg3::DrawableObject{
     public:
@@ -88,9 +89,9 @@ class Box3D : public cg3::BoundingBox, public cg3::DrawableObject{
         static std::string typeSplitToString(const Split& s);
         Split getSplit(const cg3::Box& other);
 
-        const std::set<unsigned int>& getTrianglesCovered() const;
-        void setTrianglesCovered(const std::set<unsigned int>& value);
-        void addTrianglesCovered(const std::set<unsigned int>& value);
+        const BitmapSet& getTrianglesCovered() const;
+        void setTrianglesCovered(const BitmapSet& value);
+        void addTrianglesCovered(const BitmapSet& value);
 
         double getBaseLevel() const;
         void setBaseLevel(double newBase);
@@ -105,7 +106,7 @@ class Box3D : public cg3::BoundingBox, public cg3::DrawableObject{
         int id;
         cg3::SimpleEigenMesh piece;
         bool splitted;
-        std::set<unsigned int> trianglesCovered;
+        BitmapSet trianglesCovered;
 
         void drawLine(const cg3::Pointd& a, const cg3::Pointd& b, const cg3::Color& c) const;
         void drawCube() const;
@@ -0,0 +1,118 @@
+#include "boxindex.h"
+
+#include <unordered_set>
+
+using namespace cg3;
+
+BoxIndex::BoxIndex(const BoxList& bl) : bl(bl), cellSize(1) {
+    n[0] = n[1] = n[2] = 0;
+    int nb = bl.getNumberBoxes();
+    if (nb == 0)
+        return;
+    Pointd bbmin = bl.getBox(0).getMin(), bbmax = bl.getBox(0).getMax();
+    double side = 0;
+    for (int i = 0; i < nb; i++){
+        const Box3D& b = bl.getBox(i);
+        bbmin = bbmin.min(b.getMin());
+        bbmax = bbmax.max(b.getMax());
+        for (unsigned int c = 0; c < 3; c++)
+            side += b.getMax()[c] - b.getMin()[c];
+    }
+    cellSize = side / (3*nb);
+    for (unsigned int c = 0; c < 3; c++)
+        cellSize = std::max(cellSize, (bbmax[c] - bbmin[c]) / BOX_INDEX_MAX_CELLS);
+    if (cellSize <= 0)
+        cellSize = 1;
+    origin = bbmin;
+    for (unsigned int c = 0; c < 3; c++)
+        n[c] = std::min((int)((bbmax[c] - bbmin[c]) / cellSize) + 1, BOX_INDEX_MAX_CELLS);
+    cells.resize(n[0]*n[1]*n[2]);
+    for (int i = 0; i < nb; i++){
+        const Box3D& b = bl.getBox(i);
+        int lo[3], hi[3];
+        for (unsigned int c = 0; c < 3; c++){
+            lo[c] = getCellIndex(b.getMin()[c], c);
+            hi[c] = getCellIndex(b.getMax()[c], c);
+        }
+        for (int x = lo[0]; x <= hi[0]; x++)
+            for (int y = lo[1]; y <= hi[1]; y++)
+                for (int z = lo[2]; z <= hi[2]; z++)
+                    cells[(x*n[1] + y)*n[2] + z].push_back(i);
+    }
+}
+
+/**
+ * @brief BoxIndex::getNearest
+ *
+ * Puts in nearest the indices of the k boxes nearest to p (or of all the boxes, if they are less
+ * than k), sorted by distance. The cells are visited in rings of increasing distance from the cell
+ * of p, stopping when the k-th distance found is not greater than the distance from p of the cells
+ * not yet visited.
+ */
+void BoxIndex::getNearest(std::vector<int>& nearest, const Pointd& p, unsigned int k) const {
+    nearest.clear();
+    if (cells.empty() || k == 0)
+        return;
+    int center[3];
+    for (unsigned int c = 0; c < 3; c++)
+        center[c] = getCellIndex(p[c], c);
+    int maxRing = std::max(std::max(std::max(center[0], n[0]-1-center[0]), std::max(center[1], n[1]-1-center[1])),
+                           std::max(center[2], n[2]-1-center[2]));
+
+    std::vector<std::pair<double, int> > found;
+    std::unordered_set<int> visited;
+    for (int r = 0; r <= maxRing; r++){
+        int lo[3], hi[3];
+        for (unsigned int c = 0; c < 3; c++){
+            lo[c] = std::max(center[c] - r, 0);
+            hi[c] = std::min(center[c] + r, n[c]-1);
+        }
+        for (int x = lo[0]; x <= hi[0]; x++){
+            for (int y = lo[1]; y <= hi[1]; y++){
+                //only the cells on the border of the ring
+                bool border = std::abs(x - center[0]) == r || std::abs(y - center[1]) == r;
+                int step = border ? 1 : std::max(hi[2] - lo[2], 1);
+                for (int z = lo[2]; z <= hi[2]; z += step){
+                    if (!border && std::abs(z - center[2]) != r)
+                        continue;
+                    for (int b : cells[(x*n[1] + y)*n[2] + z])
+                        if (visited.insert(b).second)
+                            found.push_back(std::make_pair(squaredDistance(b, p), b));
+                }
+            }
+        }
+        if (found.size() >= k){
+            std::nth_element(found.begin(), found.begin() + (k-1), found.end());
+            //distance from p of the cells outside the visited block
+            double bound = std::numeric_limits<double>::max();
+            for (unsigned int c = 0; c < 3; c++){
+                if (center[c] - r > 0)
+                    bound = std::min(bound, p[c] - (origin[c] + (center[c] - r) * cellSize));
+                if (center[c] + r < n[c]-1)
+                    bound = std::min(bound, origin[c] + (center[c] + r + 1) * cellSize - p[c]);
+            }
+            bound = std::max(bound, 0.0);
+            if (found[k-1].first <= bound*bound)
+                break;
+        }
+    }
+    unsigned int m = std::min((unsigned int)found.size(), k);
+    std::partial_sort(found.begin(), found.begin() + m, found.end());
+    for (unsigned int i = 0; i < m; i++)
+        nearest.push_back(found[i].second);
+}
+
+int BoxIndex::getCellIndex(double v, unsigned int c) const {
+    int i = (int)std::floor((v - origin[c]) / cellSize);
+    return std::min(std::max(i, 0), n[c]-1);
+}
+
+double BoxIndex::squaredDistance(int b, const Pointd& p) const {
+    const Box3D& box = bl.getBox(b);
+    double dist = 0;
+    for (unsigned int c = 0; c < 3; c++){
+        double dc = std::max(std::max(box.getMin()[c] - p[c], p[c] - box.getMax()[c]), 0.0);
+        dist += dc*dc;
+    }
+    return dist;
+}
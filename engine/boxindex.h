@@ -0,0 +1,32 @@
+#ifndef BOXINDEX_H
+#define BOXINDEX_H
+
+#include "boxlist.h"
+
+#define BOX_INDEX_MAX_CELLS 64 //maximum number of cells of the index per axis
+
+/**
+ * @brief The BoxIndex class
+ *
+ * Uniform grid over the bounding box of a list of boxes: every cell stores the indices of the boxes
+ * overlapping it. The cell side is the average side of the boxes. Used to find the boxes nearest to
+ * a point visiting only the cells around it.
+ */
+class BoxIndex {
+    public:
+        BoxIndex(const BoxList& bl);
+
+        void getNearest(std::vector<int>& nearest, const cg3::Pointd& p, unsigned int k) const;
+
+    private:
+        int getCellIndex(double v, unsigned int c) const;
+        double squaredDistance(int b, const cg3::Pointd& p) const;
+
+        const BoxList& bl;
+        cg3::Pointd origin;
+        double cellSize;
+        int n[3];
+        std::vector<std::vector<int> > cells; //for every cell, the indices of the boxes overlapping it
+};
+
+#endif // BOXINDEX_H
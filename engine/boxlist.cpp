@@ -184,7 +184,7 @@ void BoxList::calculateTrianglesCovered(const cgal::AABBTree& tree) {
     for (unsigned int i = 0; i < boxes.size(); i++){
         std::list<unsigned int> ids;
         tree.getCompletelyContainedDcelFaces(ids, boxes[i]);
-        boxes[i].setTrianglesCovered(std::set<unsigned int>(ids.begin(), ids.end()));
+        boxes[i].setTrianglesCovered(BitmapSet(ids.begin(), ids.end()));
     }
 }
 
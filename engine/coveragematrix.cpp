@@ -0,0 +1,84 @@
+#include "coveragematrix.h"
+
+#include <algorithm>
+
+using namespace cg3;
+
+CoverageMatrix::CoverageMatrix(unsigned int nTris) : nTris(nTris) {
+    rowStart.push_back(0);
+}
+
+CoverageMatrix::CoverageMatrix(const BoxList& boxList, const cgal::AABBTree& aabb, unsigned int nTris) : CoverageMatrix(nTris) {
+    addBoxes(boxList, aabb);
+}
+
+/**
+ * @brief CoverageMatrix::addBoxes
+ *
+ * Adds a row for every box of boxList, with the triangles completely contained by the box.
+ * The contained triangles of the boxes are computed in parallel, then copied in the matrix.
+ */
+void CoverageMatrix::addBoxes(const BoxList& boxList, const cgal::AABBTree& aabb) {
+    unsigned int nBoxes = boxList.getNumberBoxes();
+    std::vector<std::vector<unsigned int> > rows(nBoxes);
+    #pragma omp parallel for schedule(dynamic)
+    for (unsigned int i = 0; i < nBoxes; i++){
+        std::list<unsigned int> ids;
+        aabb.getCompletelyContainedDcelFaces(ids, boxList.getBox(i));
+        rows[i].assign(ids.begin(), ids.end());
+        std::sort(rows[i].begin(), rows[i].end());
+    }
+
+    unsigned long nnz = triangles.size();
+    rowStart.reserve(rowStart.size() + nBoxes);
+    for (unsigned int i = 0; i < nBoxes; i++){
+        nnz += rows[i].size();
+        rowStart.push_back(nnz);
+    }
+    triangles.resize(nnz);
+    unsigned int first = rowStart.size()-1-nBoxes;
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < nBoxes; i++){
+        std::copy(rows[i].begin(), rows[i].end(), triangles.begin() + rowStart[first+i]);
+        std::vector<unsigned int>().swap(rows[i]);
+    }
+}
+
+/**
+ * @brief CoverageMatrix::addRow
+ * @return the index of the new row, with the given (sorted) triangles
+ */
+unsigned int CoverageMatrix::addRow(const std::vector<unsigned int>& triangles) {
+    this->triangles.insert(this->triangles.end(), triangles.begin(), triangles.end());
+    rowStart.push_back(this->triangles.size());
+    return rowStart.size()-2;
+}
+
+/**
+ * @brief CoverageMatrix::getCoverageCounts
+ * @return for every triangle, the number of rows containing it
+ */
+std::vector<unsigned int> CoverageMatrix::getCoverageCounts() const {
+    std::vector<unsigned int> counts(nTris, 0);
+    for (unsigned int t : triangles)
+        counts[t]++;
+    return counts;
+}
+
+/**
+ * @brief CoverageMatrix::getTransposed
+ * @return the triangle x row matrix: the row j contains the (sorted) rows containing the triangle j
+ */
+CoverageMatrix CoverageMatrix::getTransposed() const {
+    CoverageMatrix t(getNumberRows());
+    std::vector<unsigned int> counts = getCoverageCounts();
+    t.rowStart.resize(nTris+1);
+    for (unsigned int j = 0; j < nTris; j++)
+        t.rowStart[j+1] = t.rowStart[j] + counts[j];
+    t.triangles.resize(triangles.size());
+    std::vector<unsigned long> next(t.rowStart.begin(), t.rowStart.end()-1);
+    for (unsigned int i = 0; i < getNumberRows(); i++)
+        for (unsigned long p = rowStart[i]; p < rowStart[i+1]; p++)
+            t.triangles[next[triangles[p]]++] = i;
+    return t;
+}
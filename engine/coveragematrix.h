@@ -0,0 +1,60 @@
+#ifndef COVERAGEMATRIX_H
+#define COVERAGEMATRIX_H
+
+#include <vector>
+#include <cg3/cgal/aabbtree.h>
+#include "boxlist.h"
+
+/**
+ * @brief The CoverageMatrix class
+ *
+ * Sparse box x triangle incidence matrix used by the covering stage, stored in compressed sparse
+ * row format: the triangles completely contained by the box i are the sorted ids
+ * getTriangles(i)[0 .. getNumberTriangles(i)-1].
+ * The memory used is proportional to the number of nonzeros, not to the number of boxes times the
+ * number of triangles.
+ */
+class CoverageMatrix {
+    public:
+        CoverageMatrix(unsigned int nTris);
+        CoverageMatrix(const BoxList& boxList, const cg3::cgal::AABBTree& aabb, unsigned int nTris);
+
+        void addBoxes(const BoxList& boxList, const cg3::cgal::AABBTree& aabb);
+        unsigned int addRow(const std::vector<unsigned int>& triangles);
+
+        unsigned int getNumberRows() const;
+        unsigned int getNumberTriangles() const;
+        unsigned long getNumberNonZeros() const;
+        const unsigned int* getTriangles(unsigned int i) const;
+        unsigned int getNumberTriangles(unsigned int i) const;
+
+        std::vector<unsigned int> getCoverageCounts() const;
+        CoverageMatrix getTransposed() const;
+
+    private:
+        unsigned int nTris;
+        std::vector<unsigned long> rowStart;
+        std::vector<unsigned int> triangles;
+};
+
+inline unsigned int CoverageMatrix::getNumberRows() const {
+    return rowStart.size()-1;
+}
+
+inline unsigned int CoverageMatrix::getNumberTriangles() const {
+    return nTris;
+}
+
+inline unsigned long CoverageMatrix::getNumberNonZeros() const {
+    return triangles.size();
+}
+
+inline const unsigned int* CoverageMatrix::getTriangles(unsigned int i) const {
+    return triangles.data() + rowStart[i];
+}
+
+inline unsigned int CoverageMatrix::getNumberTriangles(unsigned int i) const {
+    return rowStart[i+1] - rowStart[i];
+}
+
+#endif // COVERAGEMATRIX_H
@@ -5,14 +5,38 @@
 
 using namespace cg3;
 
-Energy::Energy() {
+#ifdef SYMPY_INTEGRAL
+#define DEFAULT_INTEGRAL integralTricubicInterpolation
+#else
+#define DEFAULT_INTEGRAL integralTricubicInterpolationSeparable
+#endif
+
+Energy::Energy() : integral(DEFAULT_INTEGRAL), volumeScale(1), faceScale(1) {
+}
+
+Energy::Energy(const Grid& g) : g(&g), integral(DEFAULT_INTEGRAL), volumeScale(1), faceScale(1) {
 }
 
-Energy::Energy(const Grid& g) : g(&g){
+/**
+ * @brief Energy::Energy
+ *
+ * Energy on the level of a GridPyramid: the volume and face integrals on the level are scaled
+ * to the scale of the level 0, so that they are consistent with the barriers.
+ */
+Energy::Energy(const GridPyramid& p, unsigned int level) :
+        g(&p.getLevel(level)), integral(DEFAULT_INTEGRAL), volumeScale(p.getVolumeScale(level)), faceScale(p.getFaceScale(level)) {
 }
 
 void Energy::calculateFullBoxValues(Grid &g) const {
-    g.calculateFullBoxValues(integralTricubicInterpolation);
+    g.calculateFullBoxValues(integral);
+}
+
+void Energy::calculateFullBoxValues(GridFamily& f) const {
+    f.calculateFullBoxValues(integral);
+}
+
+void Energy::calculateFullBoxValues(GridPyramid& p) const {
+    p.calculateFullBoxValues(integral);
 }
 
 bool Energy::wolfeConditions(const Eigen::VectorXd &x, double alfa, const Eigen::VectorXd &direction, const Pointd &c1, const Pointd &c2, const Pointd &c3, double cos2) const {
@@ -51,22 +75,19 @@ int Energy::gradientDiscend(Box3D& b, BoxList& iterations, bool saveIt) const {
     Pointd c1 = b.getConstraint1();
     Pointd c2 = b.getConstraint2();
     Pointd c3 = b.getConstraint3();
-    Eigen::VectorXd x(6);
+    Vector6d x;
     x << b.getMin().x(), b.getMin().y(), b.getMin().z(), b.getMax().x(), b.getMax().y(), b.getMax().z();
-    Eigen::VectorXd new_x(6);
-    Eigen::VectorXd gradient(6);
-    Eigen::VectorXd newGradient(6);
-    objValue = energy(x, c1, c2, c3);
-    gradientEnergy(gradient, x, c1, c2, c3);
+    Vector6d new_x, gradient, newGradient;
+    objValue = energyAndGradient(gradient, x, c1, c2, c3);
     alfa = 1 / gradient.norm();
     do{
         new_x = x - alfa * gradient;
-        newObjValue = energy(new_x, c1, c2, c3);
-        gradientEnergy(newGradient, new_x, c1, c2, c3);
+        newObjValue = energyValue(new_x, c1, c2, c3);
         //if (wolfeConditions(objValue, newObjValue, -gradient, gradient, newGradient, alfa)) {
         if (newObjValue < objValue) {
             nIterations++;
             x = new_x;
+            newObjValue = energyAndGradient(newGradient, new_x, c1, c2, c3);
 
             objValue = newObjValue;
             gradient = newGradient;
@@ -92,24 +113,59 @@ int Energy::gradientDiscend(Box3D& b, BoxList& iterations, bool saveIt) const {
     return nIterations;
 }
 
+int Energy::BFGS(Box3D& b) const {
+    return BFGSCore<false>(b, Pointd(), nullptr, nullptr);
+}
+
+int Energy::BFGS(Box3D& b, const Pointd& limits) const {
+    return BFGSCore<true>(b, limits, nullptr, nullptr);
+}
+
 int Energy::BFGS(Box3D& b, BoxList& iterations, bool saveIt) const {
+    return BFGSCore<false>(b, Pointd(), saveIt ? &iterations : nullptr, nullptr);
+}
+
+int Energy::BFGS(Box3D& b, const Pointd& limits, BoxList& iterations, bool saveIt) const {
+    return BFGSCore<true>(b, limits, saveIt ? &iterations : nullptr, nullptr);
+}
+
+int Energy::BFGS(Box3D& b, BasinTable& basins) const {
+    return BFGSCore<false>(b, Pointd(), nullptr, &basins);
+}
+
+int Energy::BFGS(Box3D& b, const Pointd& limits, BasinTable& basins) const {
+    return BFGSCore<true>(b, limits, nullptr, &basins);
+}
+
+/**
+ * @brief Energy::BFGSCore
+ *
+ * Optimizer core shared by all the BFGS overloads. LIMITS enables the barrier on the size
+ * of the box. Every vector and matrix has fixed size, so no heap allocation is done during
+ * the iterations; boxes are recorded only if iterations is not null.
+ * If basins is not null, every BASIN_PROBE_ITERATIONS iterations the current box is looked up in the
+ * table of the boxes already produced: if it lands on one of them, and that box contains the
+ * constraints of b, the run stops and takes it. Otherwise the produced box is inserted in the table.
+ */
+template <bool LIMITS>
+int Energy::BFGSCore(Box3D& b, const Pointd& limits, BoxList* iterations, BasinTable* basins) const {
     int nIterations = 0;
+    unsigned int nEvaluations = 1;
+    bool earlyStop = false;
+    const int maxIterations = LIMITS ? 100 : MAX_BFGS_ITERATIONS;
     double alfa = 1;
     double ro;
     Pointd c1 = b.getConstraint1();
     Pointd c2 = b.getConstraint2();
     Pointd c3 = b.getConstraint3();
-    Eigen::VectorXd x(6);
+    Vector6d x;
     x << b.getMin().x(), b.getMin().y(), b.getMin().z(), b.getMax().x(), b.getMax().y(), b.getMax().z();
-    Eigen::VectorXd new_x(6), gradient(6), newGradient(6), direction(6);
-    Eigen::MatrixXd I = Eigen::MatrixXd::Identity(6,6);
-    Eigen::MatrixXd Binv = I;
-    Eigen::VectorXd s(6), y(6);
-    double objValue = energy(x, c1, c2, c3), newObjValue;
+    Vector6d new_x, gradient, newGradient, direction, s, y, Hy;
+    Matrix6d Binv = Matrix6d::Identity();
+    g->prefetch(b.getMin(), b.getMax());
+    double objValue = LIMITS ? energyAndGradient(gradient, x, c1, c2, c3, limits) : energyAndGradient(gradient, x, c1, c2, c3), newObjValue;
 
-    gradientEnergy(gradient, x, c1, c2, c3);
-
-    direction = -Binv*gradient;
+    direction.noalias() = -Binv*gradient;
 
     do{
         new_x = x +alfa * direction;
@@ -118,116 +174,302 @@ int Energy::BFGS(Box3D& b, BoxList& iterations, bool saveIt) const {
             new_x = x +alfa * direction;
         }
 
-        newObjValue = energy(new_x, c1, c2, c3);
+        //backtracking on the energy only, the gradient is computed for the accepted step
+        newObjValue = LIMITS ? energyValue(new_x, c1, c2, c3, limits) : energyValue(new_x, c1, c2, c3);
+        nEvaluations++;
 
         while (newObjValue >= objValue && alfa > 1e-10){
             alfa/= 2;
             new_x = x +alfa * direction;
 
-            newObjValue = energy(new_x, c1, c2, c3);
+            newObjValue = LIMITS ? energyValue(new_x, c1, c2, c3, limits) : energyValue(new_x, c1, c2, c3);
+            nEvaluations++;
         }
 
         if (alfa > 1e-10){
-            gradientEnergy(newGradient, new_x, c1, c2, c3);
-
-            new_x = x +alfa * direction;
-
+            newObjValue = LIMITS ? energyAndGradient(newGradient, new_x, c1, c2, c3, limits) : energyAndGradient(newGradient, new_x, c1, c2, c3);
             s = new_x - x;
             y = newGradient - gradient;
             double tmp = (y.transpose()*s);
             ro = 1.0 / tmp;
-            Binv = (I - ro*s*y.transpose())*Binv*(I - ro*y*s.transpose()) + ro*s*s.transpose();
-            if (saveIt){
+            //(I - ro*s*y^T)*Binv*(I - ro*y*s^T) + ro*s*s^T, expanded as a rank 2 update (Binv is symmetric)
+            Hy.noalias() = Binv*y;
+            double yHy = y.dot(Hy);
+            Binv.noalias() += (ro*ro*yHy + ro) * s * s.transpose();
+            Binv.noalias() -= ro * (Hy * s.transpose() + s * Hy.transpose());
+            if (iterations != nullptr){
                 b.setMin(Pointd(x(0), x(1), x(2)));
                 b.setMax(Pointd(x(3), x(4), x(5)));
-                iterations.addBox(b);
+                iterations->addBox(b);
             }
             x = new_x;
             objValue = newObjValue;
             nIterations++;
             gradient = newGradient;
-            direction = -Binv*gradient;
+            direction.noalias() = -Binv*gradient;
             double dot = gradient.dot(direction);
             if (dot >= 0) {
-                Binv = I;
+                Binv.setIdentity();
                 direction = -gradient;
             }
             alfa *= 2;
+            if (basins != nullptr && nIterations % BASIN_PROBE_ITERATIONS == 0){
+                Pointd min, max;
+                if (basins->find(Pointd(x(0), x(1), x(2)), Pointd(x(3), x(4), x(5)), b.getTarget(), min, max) &&
+                        containsConstraints(min, max, c1, c2, c3)){
+                    x << min.x(), min.y(), min.z(), max.x(), max.y(), max.z();
+                    earlyStop = true;
+                }
+            }
         }
-    }while (alfa > 1e-6 && gradient.norm() > 1e-7 && nIterations < MAX_BFGS_ITERATIONS);
+    }while (!earlyStop && alfa > 1e-6 && gradient.norm() > 1e-7 && nIterations < maxIterations);
     b.setMin(Pointd(x(0), x(1), x(2)));
     b.setMax(Pointd(x(3), x(4), x(5)));
-    if (saveIt) iterations.addBox(b);
+    if (iterations != nullptr) iterations->addBox(b);
+    if (basins != nullptr){
+        if (earlyStop)
+            basins->addEarlyStop(nEvaluations);
+        else {
+            basins->insert(b.getMin(), b.getMax(), b.getTarget());
+            basins->addCompletedRun(nEvaluations);
+        }
+    }
 
     return nIterations;
 }
 
-int Energy::BFGS(Box3D& b, const Pointd& limits, BoxList& iterations, bool saveIt) const {
-    int nIterations = 0;
-    double alfa = 1;
-    double ro;
-    Pointd c1 = b.getConstraint1();
-    Pointd c2 = b.getConstraint2();
-    Pointd c3 = b.getConstraint3();
-    Eigen::VectorXd x(6);
-    x << b.getMin().x(), b.getMin().y(), b.getMin().z(), b.getMax().x(), b.getMax().y(), b.getMax().z();
-    Eigen::VectorXd new_x(6), gradient(6), newGradient(6), direction(6);
-    Eigen::MatrixXd I = Eigen::MatrixXd::Identity(6,6);
-    Eigen::MatrixXd Binv = I;
-    Eigen::VectorXd s(6), y(6);
-    double objValue = energy(x, c1, c2, c3, limits), newObjValue;
+int Energy::LBFGSB(Box3D& b) const {
+    return LBFGSBCore<false>(b, Pointd(), nullptr);
+}
 
-    gradientEnergy(gradient, x, c1, c2, c3, limits);
+int Energy::LBFGSB(Box3D& b, const Pointd& limits) const {
+    return LBFGSBCore<true>(b, limits, nullptr);
+}
 
-    direction = -Binv*gradient;
+int Energy::LBFGSB(Box3D& b, BoxList& iterations, bool saveIt) const {
+    return LBFGSBCore<false>(b, Pointd(), saveIt ? &iterations : nullptr);
+}
 
-    do{
-        new_x = x +alfa * direction;
-        while ((! g->getBoundingBox().isIntern(new_x(0), new_x(1), new_x(2)) || ! g->getBoundingBox().isIntern(new_x(3), new_x(4), new_x(5))) && alfa != 0){
-            alfa /= 2;
-            new_x = x +alfa * direction;
-        }
+int Energy::LBFGSB(Box3D& b, const Pointd& limits, BoxList& iterations, bool saveIt) const {
+    return LBFGSBCore<true>(b, limits, saveIt ? &iterations : nullptr);
+}
 
-        newObjValue = energy(new_x, c1, c2, c3, limits);
+/**
+ * @brief Energy::boxConstrainedEnergyAndGradient
+ *
+ * Energy minimized by LBFGSB: the integral of the tricubic interpolation, plus the barrier on
+ * the size of the box if LIMITS. The constraints given by the seed triangle and the grid are
+ * bounds on the variables, so they do not need a barrier.
+ */
+template <bool LIMITS>
+double Energy::boxConstrainedEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const Pointd& limits) const {
+    double energy = integralTricubicInterpolationEnergyAndGradient(gradient, x);
+    if (LIMITS)
+        energy += barrierLimitsEnergyAndGradient(gradient, x, limits);
+    return energy;
+}
 
-        while (newObjValue >= objValue && alfa > 1e-10){
-            alfa/= 2;
-            new_x = x +alfa * direction;
+/**
+ * @brief Energy::lineSearch
+ *
+ * Line search along x + alfa*direction, alfa in (0, alfaMax], returning a step that satisfies the
+ * strong Wolfe conditions (or alfaMax, if the energy still decreases there).
+ * The initial step alfa is expanded until an interval containing acceptable steps is bracketed,
+ * and the interval is then reduced with safeguarded cubic interpolation (Nocedal & Wright, alg. 3.5-3.6).
+ * value and derivative are the energy and its directional derivative in x; the energy and the gradient
+ * in the new point are returned in newValue and newGradient. Returns 0 if no step has been found.
+ */
+template <bool LIMITS>
+double Energy::lineSearch(const Vector6d& x, const Vector6d& direction, double alfa, double alfaMax, double value, double derivative, const Pointd& limits, Vector6d& newX, double& newValue, Vector6d& newGradient) const {
+    const double c1 = 1e-4, c2 = 0.9;
+    const unsigned int maxEvaluations = 30;
+    double alfaLo = 0, valueLo = value, derivativeLo = derivative;
+    double alfaHi = 0, valueHi = value, derivativeHi = derivative;
+    Vector6d gradientLo, gradient;
+    bool bracketed = false;
+    unsigned int nEvaluations = 0;
+    alfa = std::min(alfa, alfaMax);
+
+    //bracketing phase
+    while (!bracketed && nEvaluations < maxEvaluations){
+        Vector6d t = x + alfa * direction;
+        double v = boxConstrainedEnergyAndGradient<LIMITS>(gradient, t, limits), d = gradient.dot(direction);
+        nEvaluations++;
+        if (v > value + c1*alfa*derivative || (alfaLo > 0 && v >= valueLo)){
+            alfaHi = alfa; valueHi = v; derivativeHi = d;
+            bracketed = true;
+        }
+        else if (std::abs(d) <= -c2*derivative){
+            newX = t; newValue = v; newGradient = gradient;
+            return alfa;
+        }
+        else if (d >= 0){
+            alfaHi = alfaLo; valueHi = valueLo; derivativeHi = derivativeLo;
+            alfaLo = alfa; valueLo = v; derivativeLo = d; gradientLo = gradient;
+            bracketed = true;
+        }
+        else {
+            alfaLo = alfa; valueLo = v; derivativeLo = d; gradientLo = gradient;
+            if (alfa >= alfaMax){ //the energy decreases until the bound
+                newX = t; newValue = v; newGradient = gradient;
+                return alfa;
+            }
+            alfa = std::min(2*alfa, alfaMax);
+        }
+    }
 
-            newObjValue = energy(new_x, c1, c2, c3, limits);
+    //zoom phase
+    while (bracketed && nEvaluations < maxEvaluations){
+        //minimizer of the cubic interpolating the values and the derivatives in alfaLo and alfaHi
+        double d1 = derivativeLo + derivativeHi - 3*(valueLo - valueHi)/(alfaLo - alfaHi);
+        double d2 = d1*d1 - derivativeLo*derivativeHi;
+        double a = std::min(alfaLo, alfaHi), b = std::max(alfaLo, alfaHi), w = b - a;
+        alfa = (a + b) / 2;
+        if (d2 >= 0 && std::isfinite(d1)){
+            d2 = (alfaHi > alfaLo ? 1 : -1) * std::sqrt(d2);
+            double c = alfaHi - (alfaHi - alfaLo) * (derivativeHi + d2 - d1) / (derivativeHi - derivativeLo + 2*d2);
+            if (std::isfinite(c) && c >= a + 0.1*w && c <= b - 0.1*w)
+                alfa = c;
+        }
+        if (w <= 1e-12 * b)
+            break;
+        Vector6d t = x + alfa * direction;
+        double v = boxConstrainedEnergyAndGradient<LIMITS>(gradient, t, limits), d = gradient.dot(direction);
+        nEvaluations++;
+        if (v > value + c1*alfa*derivative || v >= valueLo){
+            alfaHi = alfa; valueHi = v; derivativeHi = d;
         }
+        else {
+            if (std::abs(d) <= -c2*derivative){
+                newX = t; newValue = v; newGradient = gradient;
+                return alfa;
+            }
+            if (d*(alfaHi - alfaLo) >= 0){
+                alfaHi = alfaLo; valueHi = valueLo; derivativeHi = derivativeLo;
+            }
+            alfaLo = alfa; valueLo = v; derivativeLo = d; gradientLo = gradient;
+        }
+    }
 
-        if (alfa > 1e-10){
-            gradientEnergy(newGradient, new_x, c1, c2, c3, limits);
+    //no strong Wolfe step found: best step with sufficient decrease, if any
+    if (alfaLo > 0){
+        newX = x + alfaLo * direction; newValue = valueLo; newGradient = gradientLo;
+    }
+    return alfaLo;
+}
+
+/**
+ * @brief Energy::LBFGSBCore
+ *
+ * Projected L-BFGS with bound constraints. The minimum of the box must contain the seed triangle
+ * constraints c1, c2, c3 and the box must lie in the grid: these are bounds on the 6 variables.
+ * At every iteration the variables on a bound with the gradient pushing outside are fixed, the
+ * direction is computed on the free variables with the two-loop recursion, and the step is found
+ * with a strong Wolfe line search limited to the feasible segment.
+ * LIMITS adds the barrier on the size of the box.
+ */
+template <bool LIMITS>
+int Energy::LBFGSBCore(Box3D& b, const Pointd& limits, BoxList* iterations) const {
+    const unsigned int m = 5; //number of correction pairs
+    const int maxIterations = LIMITS ? 100 : MAX_BFGS_ITERATIONS;
+    const BoundingBox& bb = g->getBoundingBox();
+    Pointd c1 = b.getConstraint1(), c2 = b.getConstraint2(), c3 = b.getConstraint3();
+    Vector6d lower, upper;
+    for (unsigned int i = 0; i < 3; i++){
+        lower(i) = bb.getMin()[i];
+        upper(i) = std::min(c1[i], std::min(c2[i], c3[i]));
+        lower(i+3) = std::max(c1[i], std::max(c2[i], c3[i]));
+        upper(i+3) = bb.getMax()[i];
+    }
+    upper = upper.cwiseMax(lower);
 
-            new_x = x +alfa * direction;
+    Vector6d x, newX, gradient, newGradient, direction, q;
+    Vector6d S[m], Y[m];
+    double ro[m], a[m];
+    unsigned int nPairs = 0, last = 0;
+    int nIterations = 0;
+    x << b.getMin().x(), b.getMin().y(), b.getMin().z(), b.getMax().x(), b.getMax().y(), b.getMax().z();
+    x = x.cwiseMax(lower).cwiseMin(upper);
+    g->prefetch(b.getMin(), b.getMax());
+    double value = boxConstrainedEnergyAndGradient<LIMITS>(gradient, x, limits), newValue;
+
+    while (nIterations < maxIterations){
+        //projected gradient
+        if (((x - gradient).cwiseMax(lower).cwiseMin(upper) - x).norm() <= 1e-7)
+            break;
+
+        //variables fixed on their bounds
+        bool fixed[6];
+        for (unsigned int i = 0; i < 6; i++)
+            fixed[i] = (x(i) <= lower(i) && gradient(i) > 0) || (x(i) >= upper(i) && gradient(i) < 0);
+
+        //two-loop recursion on the free variables
+        q = gradient;
+        for (unsigned int i = 0; i < 6; i++)
+            if (fixed[i]) q(i) = 0;
+        for (unsigned int k = 0; k < nPairs; k++){
+            unsigned int j = (last + m - 1 - k) % m;
+            a[j] = ro[j] * S[j].dot(q);
+            q -= a[j] * Y[j];
+        }
+        if (nPairs > 0)
+            q *= S[(last + m - 1) % m].dot(Y[(last + m - 1) % m]) / Y[(last + m - 1) % m].squaredNorm();
+        for (unsigned int k = nPairs; k > 0; k--){
+            unsigned int j = (last + m - k) % m;
+            double beta = ro[j] * Y[j].dot(q);
+            q += (a[j] - beta) * S[j];
+        }
+        direction = -q;
+        for (unsigned int i = 0; i < 6; i++)
+            if (fixed[i] || (x(i) <= lower(i) && direction(i) < 0) || (x(i) >= upper(i) && direction(i) > 0)) direction(i) = 0;
+        double derivative = gradient.dot(direction);
+        if (derivative >= 0){ //not a descent direction: restart from the projected gradient
+            nPairs = 0;
+            direction = -gradient;
+            for (unsigned int i = 0; i < 6; i++)
+                if ((x(i) <= lower(i) && direction(i) < 0) || (x(i) >= upper(i) && direction(i) > 0)) direction(i) = 0;
+            derivative = gradient.dot(direction);
+            if (derivative >= 0)
+                break;
+        }
 
-            s = new_x - x;
-            y = newGradient - gradient;
-            double tmp = (y.transpose()*s);
-            ro = 1.0 / tmp;
-            Binv = (I - ro*s*y.transpose())*Binv*(I - ro*y*s.transpose()) + ro*s*s.transpose();
-            if (saveIt){
-                b.setMin(Pointd(x(0), x(1), x(2)));
-                b.setMax(Pointd(x(3), x(4), x(5)));
-                iterations.addBox(b);
-            }
-            x = new_x;
-            objValue = newObjValue;
-            nIterations++;
-            gradient = newGradient;
-            direction = -Binv*gradient;
-            double dot = gradient.dot(direction);
-            if (dot >= 0) {
-                Binv = I;
-                direction = -gradient;
-            }
-            alfa *= 2;
+        //longest feasible step
+        double alfaMax = std::numeric_limits<double>::max();
+        for (unsigned int i = 0; i < 6; i++){
+            if (direction(i) > 0) alfaMax = std::min(alfaMax, (upper(i) - x(i)) / direction(i));
+            else if (direction(i) < 0) alfaMax = std::min(alfaMax, (lower(i) - x(i)) / direction(i));
+        }
+        if (alfaMax <= 0)
+            break;
+        double alfa = nPairs == 0 ? 1 / direction.norm() : 1;
+        alfa = lineSearch<LIMITS>(x, direction, alfa, alfaMax, value, derivative, limits, newX, newValue, newGradient);
+        if (alfa == 0)
+            break;
+        newX = newX.cwiseMax(lower).cwiseMin(upper);
+
+        if (iterations != nullptr){
+            b.setMin(Pointd(x(0), x(1), x(2)));
+            b.setMax(Pointd(x(3), x(4), x(5)));
+            iterations->addBox(b);
+        }
+        Vector6d s = newX - x, y = newGradient - gradient;
+        double ys = y.dot(s);
+        if (ys > 1e-10 * y.squaredNorm()){ //curvature condition, otherwise the pair is skipped
+            S[last] = s; Y[last] = y; ro[last] = 1.0 / ys;
+            last = (last + 1) % m;
+            if (nPairs < m) nPairs++;
         }
-    }while (alfa > 1e-6 && gradient.norm() > 1e-7 && nIterations < 100);
+        nIterations++;
+        bool stalled = value - newValue <= 1e-12 * std::max(1.0, std::abs(value));
+        x = newX;
+        value = newValue;
+        gradient = newGradient;
+        if (stalled)
+            break;
+    }
     b.setMin(Pointd(x(0), x(1), x(2)));
     b.setMax(Pointd(x(3), x(4), x(5)));
-    if (saveIt) iterations.addBox(b);
+    if (iterations != nullptr) iterations->addBox(b);
 
     return nIterations;
 }
@@ -274,813 +516,67 @@ void Energy::gradientBarrierLimits(Eigen::VectorXd& gBarrier, const BoundingBox&
             -derivateFi(l.z()-b.maxZ()+b.minZ(),s);
 }
 
-double Energy::gradientXMinComponent(const gridreal*& a, double u1, double v1, double w1, double v2, double w2) {
-    double u12 = u1*u1; double u13 = u12*u1;
-    double v12 = v1*v1; double v13 = v12*v1; double v14 = v13*v1;
-    double w12 = w1*w1; double w13 = w12*w1; double w14 = w13*w1;
-    double v22 = v2*v2; double v23 = v22*v2; double v24 = v23*v2;
-    double w22 = w2*w2; double w23 = w22*w2; double w24 = w23*w2;
-    double G_result;
-    G_result =
-            -w14 *
-            ((1.0L/4.0L)*a[48]*v1 - 1.0L/4.0L*a[48]*v2 + (1.0L/4.0L)*a[49]*u1*v1 - 1.0L/4.0L*a[49]*u1*v2 +
-            (1.0L/4.0L)*a[50]*u12*v1 - 1.0L/4.0L*a[50]*u12*v2 + (1.0L/4.0L)*a[51]*u13*v1 - 1.0L/4.0L*a[51]*u13*v2 +
-            (1.0L/8.0L)*a[52]*v12 - 1.0L/8.0L*a[52]*v22 + (1.0L/8.0L)*a[53]*u1*v12 - 1.0L/8.0L*a[53]*u1*v22 +
-            (1.0L/8.0L)*a[54]*u12*v12 - 1.0L/8.0L*a[54]*u12*v22 + (1.0L/8.0L)*a[55]*u13*v12 - 1.0L/8.0L*a[55]*u13*v22 +
-            (1.0L/12.0L)*a[56]*v13 - 1.0L/12.0L*a[56]*v23 + (1.0L/12.0L)*a[57]*u1*v13 - 1.0L/12.0L*a[57]*u1*v23 +
-            (1.0L/12.0L)*a[58]*u12*v13 - 1.0L/12.0L*a[58]*u12*v23 + (1.0L/12.0L)*a[59]*u13*v13 - 1.0L/12.0L*a[59]*u13*v23 +
-            (1.0L/16.0L)*a[60]*v14 - 1.0L/16.0L*a[60]*v24 + (1.0L/16.0L)*a[61]*u1*v14 - 1.0L/16.0L*a[61]*u1*v24 +
-            (1.0L/16.0L)*a[62]*u12*v14 - 1.0L/16.0L*a[62]*u12*v24 + (1.0L/16.0L)*a[63]*u13*v14 - 1.0L/16.0L*a[63]*u13*v24)
-            - w13 *
-            ((1.0L/3.0L)*a[32]*v1 - 1.0L/3.0L*a[32]*v2 + (1.0L/3.0L)*a[33]*u1*v1 - 1.0L/3.0L*a[33]*u1*v2 +
-            (1.0L/3.0L)*a[34]*u12*v1 - 1.0L/3.0L*a[34]*u12*v2 + (1.0L/3.0L)*a[35]*u13*v1 - 1.0L/3.0L*a[35]*u13*v2 +
-            (1.0L/6.0L)*a[36]*v12 - 1.0L/6.0L*a[36]*v22 + (1.0L/6.0L)*a[37]*u1*v12 - 1.0L/6.0L*a[37]*u1*v22 +
-            (1.0L/6.0L)*a[38]*u12*v12 - 1.0L/6.0L*a[38]*u12*v22 + (1.0L/6.0L)*a[39]*u13*v12 - 1.0L/6.0L*a[39]*u13*v22 +
-            (1.0L/9.0L)*a[40]*v13 - 1.0L/9.0L*a[40]*v23 + (1.0L/9.0L)*a[41]*u1*v13 - 1.0L/9.0L*a[41]*u1*v23 +
-            (1.0L/9.0L)*a[42]*u12*v13 - 1.0L/9.0L*a[42]*u12*v23 + (1.0L/9.0L)*a[43]*u13*v13 - 1.0L/9.0L*a[43]*u13*v23 +
-            (1.0L/12.0L)*a[44]*v14 - 1.0L/12.0L*a[44]*v24 + (1.0L/12.0L)*a[45]*u1*v14 - 1.0L/12.0L*a[45]*u1*v24 +
-            (1.0L/12.0L)*a[46]*u12*v14 - 1.0L/12.0L*a[46]*u12*v24 + (1.0L/12.0L)*a[47]*u13*v14 - 1.0L/12.0L*a[47]*u13*v24)
-            - w12 *
-            ((1.0L/2.0L)*a[16]*v1 - 1.0L/2.0L*a[16]*v2 + (1.0L/2.0L)*a[17]*u1*v1 - 1.0L/2.0L*a[17]*u1*v2 +
-            (1.0L/2.0L)*a[18]*u12*v1 - 1.0L/2.0L*a[18]*u12*v2 + (1.0L/2.0L)*a[19]*u13*v1 - 1.0L/2.0L*a[19]*u13*v2 +
-            (1.0L/4.0L)*a[20]*v12 - 1.0L/4.0L*a[20]*v22 + (1.0L/4.0L)*a[21]*u1*v12 - 1.0L/4.0L*a[21]*u1*v22 +
-            (1.0L/4.0L)*a[22]*u12*v12 - 1.0L/4.0L*a[22]*u12*v22 + (1.0L/4.0L)*a[23]*u13*v12 - 1.0L/4.0L*a[23]*u13*v22 +
-            (1.0L/6.0L)*a[24]*v13 - 1.0L/6.0L*a[24]*v23 + (1.0L/6.0L)*a[25]*u1*v13 - 1.0L/6.0L*a[25]*u1*v23 +
-            (1.0L/6.0L)*a[26]*u12*v13 - 1.0L/6.0L*a[26]*u12*v23 + (1.0L/6.0L)*a[27]*u13*v13 - 1.0L/6.0L*a[27]*u13*v23 +
-            (1.0L/8.0L)*a[28]*v14 - 1.0L/8.0L*a[28]*v24 + (1.0L/8.0L)*a[29]*u1*v14 - 1.0L/8.0L*a[29]*u1*v24 +
-            (1.0L/8.0L)*a[30]*u12*v14 - 1.0L/8.0L*a[30]*u12*v24 + (1.0L/8.0L)*a[31]*u13*v14 - 1.0L/8.0L*a[31]*u13*v24)
-            - w1 *
-            (a[0]*v1 - a[0]*v2 + a[1]*u1*v1 - a[1]*u1*v2 +
-            (1.0L/3.0L)*a[10]*u12*v13 - 1.0L/3.0L*a[10]*u12*v23 + (1.0L/3.0L)*a[11]*u13*v13 - 1.0L/3.0L*a[11]*u13*v23 +
-            (1.0L/4.0L)*a[12]*v14 - 1.0L/4.0L*a[12]*v24 + (1.0L/4.0L)*a[13]*u1*v14 - 1.0L/4.0L*a[13]*u1*v24 +
-            (1.0L/4.0L)*a[14]*u12*v14 - 1.0L/4.0L*a[14]*u12*v24 + (1.0L/4.0L)*a[15]*u13*v14 - 1.0L/4.0L*a[15]*u13*v24 +
-            a[2]*u12*v1 - a[2]*u12*v2 + a[3]*u13*v1 - a[3]*u13*v2 +
-            (1.0L/2.0L)*a[4]*v12 - 1.0L/2.0L*a[4]*v22 + (1.0L/2.0L)*a[5]*u1*v12 - 1.0L/2.0L*a[5]*u1*v22 +
-            (1.0L/2.0L)*a[6]*u12*v12 - 1.0L/2.0L*a[6]*u12*v22 + (1.0L/2.0L)*a[7]*u13*v12 - 1.0L/2.0L*a[7]*u13*v22 +
-            (1.0L/3.0L)*a[8]*v13 - 1.0L/3.0L*a[8]*v23 + (1.0L/3.0L)*a[9]*u1*v13 - 1.0L/3.0L*a[9]*u1*v23)
-            + w24 *
-            ((1.0L/4.0L)*a[48]*v1 - 1.0L/4.0L*a[48]*v2 + (1.0L/4.0L)*a[49]*u1*v1 - 1.0L/4.0L*a[49]*u1*v2 +
-            (1.0L/4.0L)*a[50]*u12*v1 - 1.0L/4.0L*a[50]*u12*v2 + (1.0L/4.0L)*a[51]*u13*v1 - 1.0L/4.0L*a[51]*u13*v2 +
-            (1.0L/8.0L)*a[52]*v12 - 1.0L/8.0L*a[52]*v22 + (1.0L/8.0L)*a[53]*u1*v12 - 1.0L/8.0L*a[53]*u1*v22 +
-            (1.0L/8.0L)*a[54]*u12*v12 - 1.0L/8.0L*a[54]*u12*v22 + (1.0L/8.0L)*a[55]*u13*v12 - 1.0L/8.0L*a[55]*u13*v22 +
-            (1.0L/12.0L)*a[56]*v13 - 1.0L/12.0L*a[56]*v23 + (1.0L/12.0L)*a[57]*u1*v13 - 1.0L/12.0L*a[57]*u1*v23 +
-            (1.0L/12.0L)*a[58]*u12*v13 - 1.0L/12.0L*a[58]*u12*v23 + (1.0L/12.0L)*a[59]*u13*v13 - 1.0L/12.0L*a[59]*u13*v23 +
-            (1.0L/16.0L)*a[60]*v14 - 1.0L/16.0L*a[60]*v24 + (1.0L/16.0L)*a[61]*u1*v14 - 1.0L/16.0L*a[61]*u1*v24 +
-            (1.0L/16.0L)*a[62]*u12*v14 - 1.0L/16.0L*a[62]*u12*v24 + (1.0L/16.0L)*a[63]*u13*v14 - 1.0L/16.0L*a[63]*u13*v24)
-            + w23 *
-            ((1.0L/3.0L)*a[32]*v1 - 1.0L/3.0L*a[32]*v2 + (1.0L/3.0L)*a[33]*u1*v1 - 1.0L/3.0L*a[33]*u1*v2 +
-            (1.0L/3.0L)*a[34]*u12*v1 - 1.0L/3.0L*a[34]*u12*v2 + (1.0L/3.0L)*a[35]*u13*v1 - 1.0L/3.0L*a[35]*u13*v2 +
-            (1.0L/6.0L)*a[36]*v12 - 1.0L/6.0L*a[36]*v22 + (1.0L/6.0L)*a[37]*u1*v12 - 1.0L/6.0L*a[37]*u1*v22 +
-            (1.0L/6.0L)*a[38]*u12*v12 - 1.0L/6.0L*a[38]*u12*v22 + (1.0L/6.0L)*a[39]*u13*v12 - 1.0L/6.0L*a[39]*u13*v22 +
-            (1.0L/9.0L)*a[40]*v13 - 1.0L/9.0L*a[40]*v23 + (1.0L/9.0L)*a[41]*u1*v13 - 1.0L/9.0L*a[41]*u1*v23 +
-            (1.0L/9.0L)*a[42]*u12*v13 - 1.0L/9.0L*a[42]*u12*v23 + (1.0L/9.0L)*a[43]*u13*v13 - 1.0L/9.0L*a[43]*u13*v23 +
-            (1.0L/12.0L)*a[44]*v14 - 1.0L/12.0L*a[44]*v24 + (1.0L/12.0L)*a[45]*u1*v14 - 1.0L/12.0L*a[45]*u1*v24 +
-            (1.0L/12.0L)*a[46]*u12*v14 - 1.0L/12.0L*a[46]*u12*v24 + (1.0L/12.0L)*a[47]*u13*v14 - 1.0L/12.0L*a[47]*u13*v24)
-            + w22 *
-            ((1.0L/2.0L)*a[16]*v1 - 1.0L/2.0L*a[16]*v2 + (1.0L/2.0L)*a[17]*u1*v1 - 1.0L/2.0L*a[17]*u1*v2 +
-            (1.0L/2.0L)*a[18]*u12*v1 - 1.0L/2.0L*a[18]*u12*v2 + (1.0L/2.0L)*a[19]*u13*v1 - 1.0L/2.0L*a[19]*u13*v2 +
-            (1.0L/4.0L)*a[20]*v12 - 1.0L/4.0L*a[20]*v22 + (1.0L/4.0L)*a[21]*u1*v12 - 1.0L/4.0L*a[21]*u1*v22 +
-            (1.0L/4.0L)*a[22]*u12*v12 - 1.0L/4.0L*a[22]*u12*v22 + (1.0L/4.0L)*a[23]*u13*v12 - 1.0L/4.0L*a[23]*u13*v22 +
-            (1.0L/6.0L)*a[24]*v13 - 1.0L/6.0L*a[24]*v23 + (1.0L/6.0L)*a[25]*u1*v13 - 1.0L/6.0L*a[25]*u1*v23 +
-            (1.0L/6.0L)*a[26]*u12*v13 - 1.0L/6.0L*a[26]*u12*v23 + (1.0L/6.0L)*a[27]*u13*v13 - 1.0L/6.0L*a[27]*u13*v23 +
-            (1.0L/8.0L)*a[28]*v14 - 1.0L/8.0L*a[28]*v24 + (1.0L/8.0L)*a[29]*u1*v14 - 1.0L/8.0L*a[29]*u1*v24 +
-            (1.0L/8.0L)*a[30]*u12*v14 - 1.0L/8.0L*a[30]*u12*v24 + (1.0L/8.0L)*a[31]*u13*v14 - 1.0L/8.0L*a[31]*u13*v24)
-            + w2 *
-            (a[0]*v1 - a[0]*v2 + a[1]*u1*v1 - a[1]*u1*v2 +
-            (1.0L/3.0L)*a[10]*u12*v13 - 1.0L/3.0L*a[10]*u12*v23 + (1.0L/3.0L)*a[11]*u13*v13 - 1.0L/3.0L*a[11]*u13*v23 +
-            (1.0L/4.0L)*a[12]*v14 - 1.0L/4.0L*a[12]*v24 + (1.0L/4.0L)*a[13]*u1*v14 - 1.0L/4.0L*a[13]*u1*v24 +
-            (1.0L/4.0L)*a[14]*u12*v14 - 1.0L/4.0L*a[14]*u12*v24 + (1.0L/4.0L)*a[15]*u13*v14 - 1.0L/4.0L*a[15]*u13*v24 +
-            a[2]*u12*v1 - a[2]*u12*v2 + a[3]*u13*v1 - a[3]*u13*v2 +
-            (1.0L/2.0L)*a[4]*v12 - 1.0L/2.0L*a[4]*v22 + (1.0L/2.0L)*a[5]*u1*v12 - 1.0L/2.0L*a[5]*u1*v22 +
-            (1.0L/2.0L)*a[6]*u12*v12 - 1.0L/2.0L*a[6]*u12*v22 + (1.0L/2.0L)*a[7]*u13*v12 - 1.0L/2.0L*a[7]*u13*v22 +
-            (1.0L/3.0L)*a[8]*v13 - 1.0L/3.0L*a[8]*v23 + (1.0L/3.0L)*a[9]*u1*v13 - 1.0L/3.0L*a[9]*u1*v23);
-    return G_result;
-}
-
-double Energy::gradientYMinComponent(const gridreal*& a, double u1, double v1, double w1, double u2, double w2) {
-    double u12 = u1*u1; double u13 = u12*u1; double u14 = u13*u1;
-    double v12 = v1*v1; double v13 = v12*v1;
-    double w12 = w1*w1; double w13 = w12*w1; double w14 = w13*w1;
-    double u22 = u2*u2; double u23 = u22*u2; double u24 = u23*u2;
-    double w22 = w2*w2; double w23 = w22*w2; double w24 = w23*w2;
-    double G_result;
-    G_result =
-            -w14 *
-            ((1.0L/4.0L)*a[48]*u1 - 1.0L/4.0L*a[48]*u2 + (1.0L/8.0L)*a[49]*u12 - 1.0L/8.0L*a[49]*u22 +
-            (1.0L/12.0L)*a[50]*u13 - 1.0L/12.0L*a[50]*u23 + (1.0L/16.0L)*a[51]*u14 - 1.0L/16.0L*a[51]*u24 +
-            (1.0L/4.0L)*a[52]*u1*v1 - 1.0L/4.0L*a[52]*u2*v1 + (1.0L/8.0L)*a[53]*u12*v1 - 1.0L/8.0L*a[53]*u22*v1 +
-            (1.0L/12.0L)*a[54]*u13*v1 - 1.0L/12.0L*a[54]*u23*v1 + (1.0L/16.0L)*a[55]*u14*v1 - 1.0L/16.0L*a[55]*u24*v1 +
-            (1.0L/4.0L)*a[56]*u1*v12 - 1.0L/4.0L*a[56]*u2*v12 + (1.0L/8.0L)*a[57]*u12*v12 - 1.0L/8.0L*a[57]*u22*v12 +
-            (1.0L/12.0L)*a[58]*u13*v12 - 1.0L/12.0L*a[58]*u23*v12 + (1.0L/16.0L)*a[59]*u14*v12 - 1.0L/16.0L*a[59]*u24*v12 +
-            (1.0L/4.0L)*a[60]*u1*v13 - 1.0L/4.0L*a[60]*u2*v13 + (1.0L/8.0L)*a[61]*u12*v13 - 1.0L/8.0L*a[61]*u22*v13 +
-            (1.0L/12.0L)*a[62]*u13*v13 - 1.0L/12.0L*a[62]*u23*v13 + (1.0L/16.0L)*a[63]*u14*v13 - 1.0L/16.0L*a[63]*u24*v13)
-            - w13 *
-            ((1.0L/3.0L)*a[32]*u1 - 1.0L/3.0L*a[32]*u2 + (1.0L/6.0L)*a[33]*u12 - 1.0L/6.0L*a[33]*u22 +
-            (1.0L/9.0L)*a[34]*u13 - 1.0L/9.0L*a[34]*u23 + (1.0L/12.0L)*a[35]*u14 - 1.0L/12.0L*a[35]*u24 +
-            (1.0L/3.0L)*a[36]*u1*v1 - 1.0L/3.0L*a[36]*u2*v1 + (1.0L/6.0L)*a[37]*u12*v1 - 1.0L/6.0L*a[37]*u22*v1 +
-            (1.0L/9.0L)*a[38]*u13*v1 - 1.0L/9.0L*a[38]*u23*v1 + (1.0L/12.0L)*a[39]*u14*v1 - 1.0L/12.0L*a[39]*u24*v1 +
-            (1.0L/3.0L)*a[40]*u1*v12 - 1.0L/3.0L*a[40]*u2*v12 + (1.0L/6.0L)*a[41]*u12*v12 - 1.0L/6.0L*a[41]*u22*v12 +
-            (1.0L/9.0L)*a[42]*u13*v12 - 1.0L/9.0L*a[42]*u23*v12 + (1.0L/12.0L)*a[43]*u14*v12 - 1.0L/12.0L*a[43]*u24*v12 +
-            (1.0L/3.0L)*a[44]*u1*v13 - 1.0L/3.0L*a[44]*u2*v13 + (1.0L/6.0L)*a[45]*u12*v13 - 1.0L/6.0L*a[45]*u22*v13 +
-            (1.0L/9.0L)*a[46]*u13*v13 - 1.0L/9.0L*a[46]*u23*v13 + (1.0L/12.0L)*a[47]*u14*v13 - 1.0L/12.0L*a[47]*u24*v13)
-            - w12 *
-            ((1.0L/2.0L)*a[16]*u1 - 1.0L/2.0L*a[16]*u2 + (1.0L/4.0L)*a[17]*u12 - 1.0L/4.0L*a[17]*u22 +
-            (1.0L/6.0L)*a[18]*u13 - 1.0L/6.0L*a[18]*u23 + (1.0L/8.0L)*a[19]*u14 - 1.0L/8.0L*a[19]*u24 +
-            (1.0L/2.0L)*a[20]*u1*v1 - 1.0L/2.0L*a[20]*u2*v1 + (1.0L/4.0L)*a[21]*u12*v1 - 1.0L/4.0L*a[21]*u22*v1 +
-            (1.0L/6.0L)*a[22]*u13*v1 - 1.0L/6.0L*a[22]*u23*v1 + (1.0L/8.0L)*a[23]*u14*v1 - 1.0L/8.0L*a[23]*u24*v1 +
-            (1.0L/2.0L)*a[24]*u1*v12 - 1.0L/2.0L*a[24]*u2*v12 + (1.0L/4.0L)*a[25]*u12*v12 - 1.0L/4.0L*a[25]*u22*v12 +
-            (1.0L/6.0L)*a[26]*u13*v12 - 1.0L/6.0L*a[26]*u23*v12 + (1.0L/8.0L)*a[27]*u14*v12 - 1.0L/8.0L*a[27]*u24*v12 +
-            (1.0L/2.0L)*a[28]*u1*v13 - 1.0L/2.0L*a[28]*u2*v13 + (1.0L/4.0L)*a[29]*u12*v13 - 1.0L/4.0L*a[29]*u22*v13 +
-            (1.0L/6.0L)*a[30]*u13*v13 - 1.0L/6.0L*a[30]*u23*v13 + (1.0L/8.0L)*a[31]*u14*v13 - 1.0L/8.0L*a[31]*u24*v13)
-            - w1 *
-            (a[0]*u1 - a[0]*u2 + (1.0L/2.0L)*a[1]*u12 - 1.0L/2.0L*a[1]*u22 +
-            (1.0L/3.0L)*a[10]*u13*v12 - 1.0L/3.0L*a[10]*u23*v12 + (1.0L/4.0L)*a[11]*u14*v12 - 1.0L/4.0L*a[11]*u24*v12 +
-            a[12]*u1*v13 - a[12]*u2*v13 + (1.0L/2.0L)*a[13]*u12*v13 - 1.0L/2.0L*a[13]*u22*v13 +
-            (1.0L/3.0L)*a[14]*u13*v13 - 1.0L/3.0L*a[14]*u23*v13 + (1.0L/4.0L)*a[15]*u14*v13 - 1.0L/4.0L*a[15]*u24*v13 +
-            (1.0L/3.0L)*a[2]*u13 - 1.0L/3.0L*a[2]*u23 + (1.0L/4.0L)*a[3]*u14 - 1.0L/4.0L*a[3]*u24 +
-            a[4]*u1*v1 - a[4]*u2*v1 + (1.0L/2.0L)*a[5]*u12*v1 - 1.0L/2.0L*a[5]*u22*v1 +
-            (1.0L/3.0L)*a[6]*u13*v1 - 1.0L/3.0L*a[6]*u23*v1 + (1.0L/4.0L)*a[7]*u14*v1 - 1.0L/4.0L*a[7]*u24*v1 +
-            a[8]*u1*v12 - a[8]*u2*v12 + (1.0L/2.0L)*a[9]*u12*v12 - 1.0L/2.0L*a[9]*u22*v12)
-            + w24 *
-            ((1.0L/4.0L)*a[48]*u1 - 1.0L/4.0L*a[48]*u2 + (1.0L/8.0L)*a[49]*u12 - 1.0L/8.0L*a[49]*u22 +
-            (1.0L/12.0L)*a[50]*u13 - 1.0L/12.0L*a[50]*u23 + (1.0L/16.0L)*a[51]*u14 - 1.0L/16.0L*a[51]*u24 +
-            (1.0L/4.0L)*a[52]*u1*v1 - 1.0L/4.0L*a[52]*u2*v1 + (1.0L/8.0L)*a[53]*u12*v1 - 1.0L/8.0L*a[53]*u22*v1 +
-            (1.0L/12.0L)*a[54]*u13*v1 - 1.0L/12.0L*a[54]*u23*v1 + (1.0L/16.0L)*a[55]*u14*v1 - 1.0L/16.0L*a[55]*u24*v1 +
-            (1.0L/4.0L)*a[56]*u1*v12 - 1.0L/4.0L*a[56]*u2*v12 + (1.0L/8.0L)*a[57]*u12*v12 - 1.0L/8.0L*a[57]*u22*v12 +
-            (1.0L/12.0L)*a[58]*u13*v12 - 1.0L/12.0L*a[58]*u23*v12 + (1.0L/16.0L)*a[59]*u14*v12 - 1.0L/16.0L*a[59]*u24*v12 +
-            (1.0L/4.0L)*a[60]*u1*v13 - 1.0L/4.0L*a[60]*u2*v13 + (1.0L/8.0L)*a[61]*u12*v13 - 1.0L/8.0L*a[61]*u22*v13 +
-            (1.0L/12.0L)*a[62]*u13*v13 - 1.0L/12.0L*a[62]*u23*v13 + (1.0L/16.0L)*a[63]*u14*v13 - 1.0L/16.0L*a[63]*u24*v13)
-            + w23 *
-            ((1.0L/3.0L)*a[32]*u1 - 1.0L/3.0L*a[32]*u2 + (1.0L/6.0L)*a[33]*u12 - 1.0L/6.0L*a[33]*u22 +
-            (1.0L/9.0L)*a[34]*u13 - 1.0L/9.0L*a[34]*u23 + (1.0L/12.0L)*a[35]*u14 - 1.0L/12.0L*a[35]*u24 +
-            (1.0L/3.0L)*a[36]*u1*v1 - 1.0L/3.0L*a[36]*u2*v1 + (1.0L/6.0L)*a[37]*u12*v1 - 1.0L/6.0L*a[37]*u22*v1 +
-            (1.0L/9.0L)*a[38]*u13*v1 - 1.0L/9.0L*a[38]*u23*v1 + (1.0L/12.0L)*a[39]*u14*v1 - 1.0L/12.0L*a[39]*u24*v1 +
-            (1.0L/3.0L)*a[40]*u1*v12 - 1.0L/3.0L*a[40]*u2*v12 + (1.0L/6.0L)*a[41]*u12*v12 - 1.0L/6.0L*a[41]*u22*v12 +
-            (1.0L/9.0L)*a[42]*u13*v12 - 1.0L/9.0L*a[42]*u23*v12 + (1.0L/12.0L)*a[43]*u14*v12 - 1.0L/12.0L*a[43]*u24*v12 +
-            (1.0L/3.0L)*a[44]*u1*v13 - 1.0L/3.0L*a[44]*u2*v13 + (1.0L/6.0L)*a[45]*u12*v13 - 1.0L/6.0L*a[45]*u22*v13 +
-            (1.0L/9.0L)*a[46]*u13*v13 - 1.0L/9.0L*a[46]*u23*v13 + (1.0L/12.0L)*a[47]*u14*v13 - 1.0L/12.0L*a[47]*u24*v13)
-            + w22 *
-            ((1.0L/2.0L)*a[16]*u1 - 1.0L/2.0L*a[16]*u2 + (1.0L/4.0L)*a[17]*u12 - 1.0L/4.0L*a[17]*u22 +
-            (1.0L/6.0L)*a[18]*u13 - 1.0L/6.0L*a[18]*u23 + (1.0L/8.0L)*a[19]*u14 - 1.0L/8.0L*a[19]*u24 +
-            (1.0L/2.0L)*a[20]*u1*v1 - 1.0L/2.0L*a[20]*u2*v1 + (1.0L/4.0L)*a[21]*u12*v1 - 1.0L/4.0L*a[21]*u22*v1 +
-            (1.0L/6.0L)*a[22]*u13*v1 - 1.0L/6.0L*a[22]*u23*v1 + (1.0L/8.0L)*a[23]*u14*v1 - 1.0L/8.0L*a[23]*u24*v1 +
-            (1.0L/2.0L)*a[24]*u1*v12 - 1.0L/2.0L*a[24]*u2*v12 + (1.0L/4.0L)*a[25]*u12*v12 - 1.0L/4.0L*a[25]*u22*v12 +
-            (1.0L/6.0L)*a[26]*u13*v12 - 1.0L/6.0L*a[26]*u23*v12 + (1.0L/8.0L)*a[27]*u14*v12 - 1.0L/8.0L*a[27]*u24*v12 +
-            (1.0L/2.0L)*a[28]*u1*v13 - 1.0L/2.0L*a[28]*u2*v13 + (1.0L/4.0L)*a[29]*u12*v13 - 1.0L/4.0L*a[29]*u22*v13 +
-            (1.0L/6.0L)*a[30]*u13*v13 - 1.0L/6.0L*a[30]*u23*v13 + (1.0L/8.0L)*a[31]*u14*v13 - 1.0L/8.0L*a[31]*u24*v13)
-            + w2 *
-            (a[0]*u1 - a[0]*u2 + (1.0L/2.0L)*a[1]*u12 - 1.0L/2.0L*a[1]*u22 +
-            (1.0L/3.0L)*a[10]*u13*v12 - 1.0L/3.0L*a[10]*u23*v12 + (1.0L/4.0L)*a[11]*u14*v12 - 1.0L/4.0L*a[11]*u24*v12 +
-            a[12]*u1*v13 - a[12]*u2*v13 + (1.0L/2.0L)*a[13]*u12*v13 - 1.0L/2.0L*a[13]*u22*v13 +
-            (1.0L/3.0L)*a[14]*u13*v13 - 1.0L/3.0L*a[14]*u23*v13 + (1.0L/4.0L)*a[15]*u14*v13 - 1.0L/4.0L*a[15]*u24*v13 +
-            (1.0L/3.0L)*a[2]*u13 - 1.0L/3.0L*a[2]*u23 + (1.0L/4.0L)*a[3]*u14 - 1.0L/4.0L*a[3]*u24 +
-            a[4]*u1*v1 - a[4]*u2*v1 + (1.0L/2.0L)*a[5]*u12*v1 - 1.0L/2.0L*a[5]*u22*v1 +
-            (1.0L/3.0L)*a[6]*u13*v1 - 1.0L/3.0L*a[6]*u23*v1 + (1.0L/4.0L)*a[7]*u14*v1 - 1.0L/4.0L*a[7]*u24*v1 +
-            a[8]*u1*v12 - a[8]*u2*v12 + (1.0L/2.0L)*a[9]*u12*v12 - 1.0L/2.0L*a[9]*u22*v12);
-    return G_result;
-}
-
-double Energy::gradientZMinComponent(const gridreal*& a, double u1, double v1, double w1, double u2, double v2) {
-    double u12 = u1*u1; double u13 = u12*u1; double u14 = u13*u1;
-    double v12 = v1*v1; double v13 = v12*v1; double v14 = v13*v1;
-    double w12 = w1*w1; double w13 = w12*w1;
-    double u22 = u2*u2; double u23 = u22*u2; double u24 = u23*u2;
-    double v22 = v2*v2; double v23 = v22*v2; double v24 = v23*v2;
-    double G_result;
-    G_result =
-            -a[0]*u1*v1 + a[0]*u1*v2 + a[0]*u2*v1 - a[0]*u2*v2
-            - 1.0L/2.0L*a[1]*u12*v1 +  (1.0L/2.0L)*a[1]*u12*v2 + (1.0L/2.0L)*a[1]*u22*v1 - 1.0L/2.0L*a[1]*u22*v2
-            - 1.0L/9.0L*a[10]*u13*v13 + (1.0L/9.0L)*a[10]*u13*v23 + (1.0L/9.0L)*a[10]*u23*v13 - 1.0L/9.0L*a[10]*u23*v23
-            - 1.0L/12.0L*a[11]*u14*v13 + (1.0L/12.0L)*a[11]*u14*v23 + (1.0L/12.0L)*a[11]*u24*v13 - 1.0L/12.0L*a[11]*u24*v23
-            - 1.0L/4.0L*a[12]*u1*v14 + (1.0L/4.0L)*a[12]*u1*v24 + (1.0L/4.0L)*a[12]*u2*v14 - 1.0L/4.0L*a[12]*u2*v24
-            - 1.0L/8.0L*a[13]*u12*v14 + (1.0L/8.0L)*a[13]*u12*v24 + (1.0L/8.0L)*a[13]*u22*v14 - 1.0L/8.0L*a[13]*u22*v24
-            - 1.0L/12.0L*a[14]*u13*v14 + (1.0L/12.0L)*a[14]*u13*v24 + (1.0L/12.0L)*a[14]*u23*v14 - 1.0L/12.0L*a[14]*u23*v24
-            - 1.0L/16.0L*a[15]*u14*v14 + (1.0L/16.0L)*a[15]*u14*v24 + (1.0L/16.0L)*a[15]*u24*v14 - 1.0L/16.0L*a[15]*u24*v24
-            - 1.0L/3.0L*a[2]*u13*v1 + (1.0L/3.0L)*a[2]*u13*v2 + (1.0L/3.0L)*a[2]*u23*v1 - 1.0L/3.0L*a[2]*u23*v2
-            - 1.0L/4.0L*a[3]*u14*v1 + (1.0L/4.0L)*a[3]*u14*v2 + (1.0L/4.0L)*a[3]*u24*v1 - 1.0L/4.0L*a[3]*u24*v2
-            - 1.0L/2.0L*a[4]*u1*v12 + (1.0L/2.0L)*a[4]*u1*v22 + (1.0L/2.0L)*a[4]*u2*v12 - 1.0L/2.0L*a[4]*u2*v22
-            - 1.0L/4.0L*a[5]*u12*v12 + (1.0L/4.0L)*a[5]*u12*v22 + (1.0L/4.0L)*a[5]*u22*v12 - 1.0L/4.0L*a[5]*u22*v22
-            - 1.0L/6.0L*a[6]*u13*v12 + (1.0L/6.0L)*a[6]*u13*v22 + (1.0L/6.0L)*a[6]*u23*v12 - 1.0L/6.0L*a[6]*u23*v22
-            - 1.0L/8.0L*a[7]*u14*v12 + (1.0L/8.0L)*a[7]*u14*v22 + (1.0L/8.0L)*a[7]*u24*v12 - 1.0L/8.0L*a[7]*u24*v22
-            - 1.0L/3.0L*a[8]*u1*v13 + (1.0L/3.0L)*a[8]*u1*v23 + (1.0L/3.0L)*a[8]*u2*v13 - 1.0L/3.0L*a[8]*u2*v23
-            - 1.0L/6.0L*a[9]*u12*v13 + (1.0L/6.0L)*a[9]*u12*v23 + (1.0L/6.0L)*a[9]*u22*v13 - 1.0L/6.0L*a[9]*u22*v23
-            - 4*w13 *
-            ((1.0L/4.0L)*a[48]*u1*v1 - 1.0L/4.0L*a[48]*u1*v2 - 1.0L/4.0L*a[48]*u2*v1 + (1.0L/4.0L)*a[48]*u2*v2 +
-            (1.0L/8.0L)*a[49]*u12*v1 - 1.0L/8.0L*a[49]*u12*v2 - 1.0L/8.0L*a[49]*u22*v1 + (1.0L/8.0L)*a[49]*u22*v2 +
-            (1.0L/12.0L)*a[50]*u13*v1 - 1.0L/12.0L*a[50]*u13*v2 - 1.0L/12.0L*a[50]*u23*v1 + (1.0L/12.0L)*a[50]*u23*v2 +
-            (1.0L/16.0L)*a[51]*u14*v1 - 1.0L/16.0L*a[51]*u14*v2 - 1.0L/16.0L*a[51]*u24*v1 + (1.0L/16.0L)*a[51]*u24*v2 +
-            (1.0L/8.0L)*a[52]*u1*v12 - 1.0L/8.0L*a[52]*u1*v22 - 1.0L/8.0L*a[52]*u2*v12 + (1.0L/8.0L)*a[52]*u2*v22 +
-            (1.0L/16.0L)*a[53]*u12*v12 - 1.0L/16.0L*a[53]*u12*v22 - 1.0L/16.0L*a[53]*u22*v12 + (1.0L/16.0L)*a[53]*u22*v22 +
-            (1.0L/24.0L)*a[54]*u13*v12 - 1.0L/24.0L*a[54]*u13*v22 - 1.0L/24.0L*a[54]*u23*v12 + (1.0L/24.0L)*a[54]*u23*v22 +
-            (1.0L/32.0L)*a[55]*u14*v12 - 1.0L/32.0L*a[55]*u14*v22 - 1.0L/32.0L*a[55]*u24*v12 + (1.0L/32.0L)*a[55]*u24*v22 +
-            (1.0L/12.0L)*a[56]*u1*v13 - 1.0L/12.0L*a[56]*u1*v23 - 1.0L/12.0L*a[56]*u2*v13 + (1.0L/12.0L)*a[56]*u2*v23 +
-            (1.0L/24.0L)*a[57]*u12*v13 - 1.0L/24.0L*a[57]*u12*v23 - 1.0L/24.0L*a[57]*u22*v13 + (1.0L/24.0L)*a[57]*u22*v23 +
-            (1.0L/36.0L)*a[58]*u13*v13 - 1.0L/36.0L*a[58]*u13*v23 - 1.0L/36.0L*a[58]*u23*v13 + (1.0L/36.0L)*a[58]*u23*v23 +
-            (1.0L/48.0L)*a[59]*u14*v13 - 1.0L/48.0L*a[59]*u14*v23 - 1.0L/48.0L*a[59]*u24*v13 + (1.0L/48.0L)*a[59]*u24*v23 +
-            (1.0L/16.0L)*a[60]*u1*v14 - 1.0L/16.0L*a[60]*u1*v24 - 1.0L/16.0L*a[60]*u2*v14 + (1.0L/16.0L)*a[60]*u2*v24 +
-            (1.0L/32.0L)*a[61]*u12*v14 - 1.0L/32.0L*a[61]*u12*v24 - 1.0L/32.0L*a[61]*u22*v14 + (1.0L/32.0L)*a[61]*u22*v24 +
-            (1.0L/48.0L)*a[62]*u13*v14 - 1.0L/48.0L*a[62]*u13*v24 - 1.0L/48.0L*a[62]*u23*v14 + (1.0L/48.0L)*a[62]*u23*v24 +
-            (1.0L/64.0L)*a[63]*u14*v14 - 1.0L/64.0L*a[63]*u14*v24 - 1.0L/64.0L*a[63]*u24*v14 + (1.0L/64.0L)*a[63]*u24*v24)
-            - 3*w12 *
-            ((1.0L/3.0L)*a[32]*u1*v1 - 1.0L/3.0L*a[32]*u1*v2 - 1.0L/3.0L*a[32]*u2*v1 + (1.0L/3.0L)*a[32]*u2*v2 +
-            (1.0L/6.0L)*a[33]*u12*v1 - 1.0L/6.0L*a[33]*u12*v2 - 1.0L/6.0L*a[33]*u22*v1 + (1.0L/6.0L)*a[33]*u22*v2 +
-            (1.0L/9.0L)*a[34]*u13*v1 - 1.0L/9.0L*a[34]*u13*v2 - 1.0L/9.0L*a[34]*u23*v1 + (1.0L/9.0L)*a[34]*u23*v2 +
-            (1.0L/12.0L)*a[35]*u14*v1 - 1.0L/12.0L*a[35]*u14*v2 - 1.0L/12.0L*a[35]*u24*v1 + (1.0L/12.0L)*a[35]*u24*v2 +
-            (1.0L/6.0L)*a[36]*u1*v12 - 1.0L/6.0L*a[36]*u1*v22 - 1.0L/6.0L*a[36]*u2*v12 + (1.0L/6.0L)*a[36]*u2*v22 +
-            (1.0L/12.0L)*a[37]*u12*v12 - 1.0L/12.0L*a[37]*u12*v22 - 1.0L/12.0L*a[37]*u22*v12 + (1.0L/12.0L)*a[37]*u22*v22 +
-            (1.0L/18.0L)*a[38]*u13*v12 - 1.0L/18.0L*a[38]*u13*v22 - 1.0L/18.0L*a[38]*u23*v12 + (1.0L/18.0L)*a[38]*u23*v22 +
-            (1.0L/24.0L)*a[39]*u14*v12 - 1.0L/24.0L*a[39]*u14*v22 - 1.0L/24.0L*a[39]*u24*v12 + (1.0L/24.0L)*a[39]*u24*v22 +
-            (1.0L/9.0L)*a[40]*u1*v13 - 1.0L/9.0L*a[40]*u1*v23 - 1.0L/9.0L*a[40]*u2*v13 + (1.0L/9.0L)*a[40]*u2*v23 +
-            (1.0L/18.0L)*a[41]*u12*v13 - 1.0L/18.0L*a[41]*u12*v23 - 1.0L/18.0L*a[41]*u22*v13 + (1.0L/18.0L)*a[41]*u22*v23 +
-            (1.0L/27.0L)*a[42]*u13*v13 - 1.0L/27.0L*a[42]*u13*v23 - 1.0L/27.0L*a[42]*u23*v13 + (1.0L/27.0L)*a[42]*u23*v23 +
-            (1.0L/36.0L)*a[43]*u14*v13 - 1.0L/36.0L*a[43]*u14*v23 - 1.0L/36.0L*a[43]*u24*v13 + (1.0L/36.0L)*a[43]*u24*v23 +
-            (1.0L/12.0L)*a[44]*u1*v14 - 1.0L/12.0L*a[44]*u1*v24 - 1.0L/12.0L*a[44]*u2*v14 + (1.0L/12.0L)*a[44]*u2*v24 +
-            (1.0L/24.0L)*a[45]*u12*v14 - 1.0L/24.0L*a[45]*u12*v24 - 1.0L/24.0L*a[45]*u22*v14 + (1.0L/24.0L)*a[45]*u22*v24 +
-            (1.0L/36.0L)*a[46]*u13*v14 - 1.0L/36.0L*a[46]*u13*v24 - 1.0L/36.0L*a[46]*u23*v14 + (1.0L/36.0L)*a[46]*u23*v24 +
-            (1.0L/48.0L)*a[47]*u14*v14 - 1.0L/48.0L*a[47]*u14*v24 - 1.0L/48.0L*a[47]*u24*v14 + (1.0L/48.0L)*a[47]*u24*v24)
-            - 2*w1 *
-            ((1.0L/2.0L)*a[16]*u1*v1 - 1.0L/2.0L*a[16]*u1*v2 - 1.0L/2.0L*a[16]*u2*v1 + (1.0L/2.0L)*a[16]*u2*v2 +
-            (1.0L/4.0L)*a[17]*u12*v1 - 1.0L/4.0L*a[17]*u12*v2 - 1.0L/4.0L*a[17]*u22*v1 + (1.0L/4.0L)*a[17]*u22*v2 +
-            (1.0L/6.0L)*a[18]*u13*v1 - 1.0L/6.0L*a[18]*u13*v2 - 1.0L/6.0L*a[18]*u23*v1 + (1.0L/6.0L)*a[18]*u23*v2 +
-            (1.0L/8.0L)*a[19]*u14*v1 - 1.0L/8.0L*a[19]*u14*v2 - 1.0L/8.0L*a[19]*u24*v1 + (1.0L/8.0L)*a[19]*u24*v2 +
-            (1.0L/4.0L)*a[20]*u1*v12 - 1.0L/4.0L*a[20]*u1*v22 - 1.0L/4.0L*a[20]*u2*v12 + (1.0L/4.0L)*a[20]*u2*v22 +
-            (1.0L/8.0L)*a[21]*u12*v12 - 1.0L/8.0L*a[21]*u12*v22 - 1.0L/8.0L*a[21]*u22*v12 + (1.0L/8.0L)*a[21]*u22*v22 +
-            (1.0L/12.0L)*a[22]*u13*v12 - 1.0L/12.0L*a[22]*u13*v22 - 1.0L/12.0L*a[22]*u23*v12 + (1.0L/12.0L)*a[22]*u23*v22 +
-            (1.0L/16.0L)*a[23]*u14*v12 - 1.0L/16.0L*a[23]*u14*v22 - 1.0L/16.0L*a[23]*u24*v12 + (1.0L/16.0L)*a[23]*u24*v22 +
-            (1.0L/6.0L)*a[24]*u1*v13 - 1.0L/6.0L*a[24]*u1*v23 - 1.0L/6.0L*a[24]*u2*v13 + (1.0L/6.0L)*a[24]*u2*v23 +
-            (1.0L/12.0L)*a[25]*u12*v13 - 1.0L/12.0L*a[25]*u12*v23 - 1.0L/12.0L*a[25]*u22*v13 + (1.0L/12.0L)*a[25]*u22*v23 +
-            (1.0L/18.0L)*a[26]*u13*v13 - 1.0L/18.0L*a[26]*u13*v23 - 1.0L/18.0L*a[26]*u23*v13 + (1.0L/18.0L)*a[26]*u23*v23 +
-            (1.0L/24.0L)*a[27]*u14*v13 - 1.0L/24.0L*a[27]*u14*v23 - 1.0L/24.0L*a[27]*u24*v13 + (1.0L/24.0L)*a[27]*u24*v23 +
-            (1.0L/8.0L)*a[28]*u1*v14 - 1.0L/8.0L*a[28]*u1*v24 - 1.0L/8.0L*a[28]*u2*v14 + (1.0L/8.0L)*a[28]*u2*v24 +
-            (1.0L/16.0L)*a[29]*u12*v14 - 1.0L/16.0L*a[29]*u12*v24 - 1.0L/16.0L*a[29]*u22*v14 + (1.0L/16.0L)*a[29]*u22*v24 +
-            (1.0L/24.0L)*a[30]*u13*v14 - 1.0L/24.0L*a[30]*u13*v24 - 1.0L/24.0L*a[30]*u23*v14 + (1.0L/24.0L)*a[30]*u23*v24 +
-            (1.0L/32.0L)*a[31]*u14*v14 - 1.0L/32.0L*a[31]*u14*v24 - 1.0L/32.0L*a[31]*u24*v14 + (1.0L/32.0L)*a[31]*u24*v24);
-    return G_result;
-
-}
-
-double Energy::gradientXMaxComponent(const gridreal*& a, double v1, double w1, double u2, double v2, double w2) {
-    double v12 = v1*v1; double v13 = v12*v1; double v14 = v13*v1;
-    double w12 = w1*w1; double w13 = w12*w1; double w14 = w13*w1;
-    double u22 = u2*u2; double u23 = u22*u2;
-    double v22 = v2*v2; double v23 = v22*v2; double v24 = v23*v2;
-    double w22 = w2*w2; double w23 = w22*w2; double w24 = w23*w2;
-    double G_result;
-    G_result =
-            -w14 *
-            (-1.0L/4.0L*a[48]*v1 + (1.0L/4.0L)*a[48]*v2 - 1.0L/4.0L*a[49]*u2*v1 + (1.0L/4.0L)*a[49]*u2*v2 -
-            1.0L/4.0L*a[50]*u22*v1 + (1.0L/4.0L)*a[50]*u22*v2 - 1.0L/4.0L*a[51]*u23*v1 + (1.0L/4.0L)*a[51]*u23*v2 -
-            1.0L/8.0L*a[52]*v12 + (1.0L/8.0L)*a[52]*v22 - 1.0L/8.0L*a[53]*u2*v12 + (1.0L/8.0L)*a[53]*u2*v22 -
-            1.0L/8.0L*a[54]*u22*v12 + (1.0L/8.0L)*a[54]*u22*v22 - 1.0L/8.0L*a[55]*u23*v12 + (1.0L/8.0L)*a[55]*u23*v22 -
-            1.0L/12.0L*a[56]*v13 + (1.0L/12.0L)*a[56]*v23 - 1.0L/12.0L*a[57]*u2*v13 + (1.0L/12.0L)*a[57]*u2*v23 -
-            1.0L/12.0L*a[58]*u22*v13 + (1.0L/12.0L)*a[58]*u22*v23 - 1.0L/12.0L*a[59]*u23*v13 + (1.0L/12.0L)*a[59]*u23*v23 -
-            1.0L/16.0L*a[60]*v14 + (1.0L/16.0L)*a[60]*v24 - 1.0L/16.0L*a[61]*u2*v14 + (1.0L/16.0L)*a[61]*u2*v24 -
-            1.0L/16.0L*a[62]*u22*v14 + (1.0L/16.0L)*a[62]*u22*v24 - 1.0L/16.0L*a[63]*u23*v14 + (1.0L/16.0L)*a[63]*u23*v24)
-            - w13 *
-            (-1.0L/3.0L*a[32]*v1 + (1.0L/3.0L)*a[32]*v2 - 1.0L/3.0L*a[33]*u2*v1 + (1.0L/3.0L)*a[33]*u2*v2 -
-            1.0L/3.0L*a[34]*u22*v1 + (1.0L/3.0L)*a[34]*u22*v2 - 1.0L/3.0L*a[35]*u23*v1 + (1.0L/3.0L)*a[35]*u23*v2 -
-            1.0L/6.0L*a[36]*v12 + (1.0L/6.0L)*a[36]*v22 - 1.0L/6.0L*a[37]*u2*v12 + (1.0L/6.0L)*a[37]*u2*v22 -
-            1.0L/6.0L*a[38]*u22*v12 + (1.0L/6.0L)*a[38]*u22*v22 - 1.0L/6.0L*a[39]*u23*v12 + (1.0L/6.0L)*a[39]*u23*v22 -
-            1.0L/9.0L*a[40]*v13 + (1.0L/9.0L)*a[40]*v23 - 1.0L/9.0L*a[41]*u2*v13 + (1.0L/9.0L)*a[41]*u2*v23 -
-            1.0L/9.0L*a[42]*u22*v13 + (1.0L/9.0L)*a[42]*u22*v23 - 1.0L/9.0L*a[43]*u23*v13 + (1.0L/9.0L)*a[43]*u23*v23 -
-            1.0L/12.0L*a[44]*v14 + (1.0L/12.0L)*a[44]*v24 - 1.0L/12.0L*a[45]*u2*v14 + (1.0L/12.0L)*a[45]*u2*v24 -
-            1.0L/12.0L*a[46]*u22*v14 + (1.0L/12.0L)*a[46]*u22*v24 - 1.0L/12.0L*a[47]*u23*v14 + (1.0L/12.0L)*a[47]*u23*v24)
-            - w12 *
-            (-1.0L/2.0L*a[16]*v1 + (1.0L/2.0L)*a[16]*v2 - 1.0L/2.0L*a[17]*u2*v1 + (1.0L/2.0L)*a[17]*u2*v2 -
-            1.0L/2.0L*a[18]*u22*v1 + (1.0L/2.0L)*a[18]*u22*v2 - 1.0L/2.0L*a[19]*u23*v1 + (1.0L/2.0L)*a[19]*u23*v2 -
-            1.0L/4.0L*a[20]*v12 + (1.0L/4.0L)*a[20]*v22 - 1.0L/4.0L*a[21]*u2*v12 + (1.0L/4.0L)*a[21]*u2*v22 -
-            1.0L/4.0L*a[22]*u22*v12 + (1.0L/4.0L)*a[22]*u22*v22 - 1.0L/4.0L*a[23]*u23*v12 + (1.0L/4.0L)*a[23]*u23*v22 -
-            1.0L/6.0L*a[24]*v13 + (1.0L/6.0L)*a[24]*v23 - 1.0L/6.0L*a[25]*u2*v13 + (1.0L/6.0L)*a[25]*u2*v23 -
-            1.0L/6.0L*a[26]*u22*v13 + (1.0L/6.0L)*a[26]*u22*v23 - 1.0L/6.0L*a[27]*u23*v13 + (1.0L/6.0L)*a[27]*u23*v23 -
-            1.0L/8.0L*a[28]*v14 + (1.0L/8.0L)*a[28]*v24 - 1.0L/8.0L*a[29]*u2*v14 + (1.0L/8.0L)*a[29]*u2*v24 -
-            1.0L/8.0L*a[30]*u22*v14 + (1.0L/8.0L)*a[30]*u22*v24 - 1.0L/8.0L*a[31]*u23*v14 + (1.0L/8.0L)*a[31]*u23*v24)
-            - w1 *
-            (-a[0]*v1 + a[0]*v2 - a[1]*u2*v1 + a[1]*u2*v2 -
-            1.0L/3.0L*a[10]*u22*v13 + (1.0L/3.0L)*a[10]*u22*v23 - 1.0L/3.0L*a[11]*u23*v13 + (1.0L/3.0L)*a[11]*u23*v23 -
-            1.0L/4.0L*a[12]*v14 + (1.0L/4.0L)*a[12]*v24 - 1.0L/4.0L*a[13]*u2*v14 + (1.0L/4.0L)*a[13]*u2*v24 -
-            1.0L/4.0L*a[14]*u22*v14 + (1.0L/4.0L)*a[14]*u22*v24 - 1.0L/4.0L*a[15]*u23*v14 + (1.0L/4.0L)*a[15]*u23*v24 -
-            a[2]*u22*v1 + a[2]*u22*v2 - a[3]*u23*v1 + a[3]*u23*v2 -
-            1.0L/2.0L*a[4]*v12 + (1.0L/2.0L)*a[4]*v22 - 1.0L/2.0L*a[5]*u2*v12 + (1.0L/2.0L)*a[5]*u2*v22 -
-            1.0L/2.0L*a[6]*u22*v12 + (1.0L/2.0L)*a[6]*u22*v22 - 1.0L/2.0L*a[7]*u23*v12 + (1.0L/2.0L)*a[7]*u23*v22 -
-            1.0L/3.0L*a[8]*v13 + (1.0L/3.0L)*a[8]*v23 - 1.0L/3.0L*a[9]*u2*v13 + (1.0L/3.0L)*a[9]*u2*v23)
-            + w24 *
-            (-1.0L/4.0L*a[48]*v1 + (1.0L/4.0L)*a[48]*v2 - 1.0L/4.0L*a[49]*u2*v1 + (1.0L/4.0L)*a[49]*u2*v2 -
-            1.0L/4.0L*a[50]*u22*v1 + (1.0L/4.0L)*a[50]*u22*v2 - 1.0L/4.0L*a[51]*u23*v1 + (1.0L/4.0L)*a[51]*u23*v2 -
-            1.0L/8.0L*a[52]*v12 + (1.0L/8.0L)*a[52]*v22 - 1.0L/8.0L*a[53]*u2*v12 + (1.0L/8.0L)*a[53]*u2*v22 -
-            1.0L/8.0L*a[54]*u22*v12 + (1.0L/8.0L)*a[54]*u22*v22 - 1.0L/8.0L*a[55]*u23*v12 + (1.0L/8.0L)*a[55]*u23*v22 -
-            1.0L/12.0L*a[56]*v13 + (1.0L/12.0L)*a[56]*v23 - 1.0L/12.0L*a[57]*u2*v13 + (1.0L/12.0L)*a[57]*u2*v23 -
-            1.0L/12.0L*a[58]*u22*v13 + (1.0L/12.0L)*a[58]*u22*v23 - 1.0L/12.0L*a[59]*u23*v13 + (1.0L/12.0L)*a[59]*u23*v23 -
-            1.0L/16.0L*a[60]*v14 + (1.0L/16.0L)*a[60]*v24 - 1.0L/16.0L*a[61]*u2*v14 + (1.0L/16.0L)*a[61]*u2*v24 -
-            1.0L/16.0L*a[62]*u22*v14 + (1.0L/16.0L)*a[62]*u22*v24 - 1.0L/16.0L*a[63]*u23*v14 + (1.0L/16.0L)*a[63]*u23*v24)
-            + w23 *
-            (-1.0L/3.0L*a[32]*v1 + (1.0L/3.0L)*a[32]*v2 - 1.0L/3.0L*a[33]*u2*v1 + (1.0L/3.0L)*a[33]*u2*v2 -
-            1.0L/3.0L*a[34]*u22*v1 + (1.0L/3.0L)*a[34]*u22*v2 - 1.0L/3.0L*a[35]*u23*v1 + (1.0L/3.0L)*a[35]*u23*v2 -
-            1.0L/6.0L*a[36]*v12 + (1.0L/6.0L)*a[36]*v22 - 1.0L/6.0L*a[37]*u2*v12 + (1.0L/6.0L)*a[37]*u2*v22 -
-            1.0L/6.0L*a[38]*u22*v12 + (1.0L/6.0L)*a[38]*u22*v22 - 1.0L/6.0L*a[39]*u23*v12 + (1.0L/6.0L)*a[39]*u23*v22 -
-            1.0L/9.0L*a[40]*v13 + (1.0L/9.0L)*a[40]*v23 - 1.0L/9.0L*a[41]*u2*v13 + (1.0L/9.0L)*a[41]*u2*v23 -
-            1.0L/9.0L*a[42]*u22*v13 + (1.0L/9.0L)*a[42]*u22*v23 - 1.0L/9.0L*a[43]*u23*v13 + (1.0L/9.0L)*a[43]*u23*v23 -
-            1.0L/12.0L*a[44]*v14 + (1.0L/12.0L)*a[44]*v24 - 1.0L/12.0L*a[45]*u2*v14 + (1.0L/12.0L)*a[45]*u2*v24 -
-            1.0L/12.0L*a[46]*u22*v14 + (1.0L/12.0L)*a[46]*u22*v24 - 1.0L/12.0L*a[47]*u23*v14 + (1.0L/12.0L)*a[47]*u23*v24)
-            + w22 *
-            (-1.0L/2.0L*a[16]*v1 + (1.0L/2.0L)*a[16]*v2 - 1.0L/2.0L*a[17]*u2*v1 + (1.0L/2.0L)*a[17]*u2*v2 -
-            1.0L/2.0L*a[18]*u22*v1 + (1.0L/2.0L)*a[18]*u22*v2 - 1.0L/2.0L*a[19]*u23*v1 + (1.0L/2.0L)*a[19]*u23*v2 -
-            1.0L/4.0L*a[20]*v12 + (1.0L/4.0L)*a[20]*v22 - 1.0L/4.0L*a[21]*u2*v12 + (1.0L/4.0L)*a[21]*u2*v22 -
-            1.0L/4.0L*a[22]*u22*v12 + (1.0L/4.0L)*a[22]*u22*v22 - 1.0L/4.0L*a[23]*u23*v12 + (1.0L/4.0L)*a[23]*u23*v22 -
-            1.0L/6.0L*a[24]*v13 + (1.0L/6.0L)*a[24]*v23 - 1.0L/6.0L*a[25]*u2*v13 + (1.0L/6.0L)*a[25]*u2*v23 -
-            1.0L/6.0L*a[26]*u22*v13 + (1.0L/6.0L)*a[26]*u22*v23 - 1.0L/6.0L*a[27]*u23*v13 + (1.0L/6.0L)*a[27]*u23*v23 -
-            1.0L/8.0L*a[28]*v14 + (1.0L/8.0L)*a[28]*v24 - 1.0L/8.0L*a[29]*u2*v14 + (1.0L/8.0L)*a[29]*u2*v24 -
-            1.0L/8.0L*a[30]*u22*v14 + (1.0L/8.0L)*a[30]*u22*v24 - 1.0L/8.0L*a[31]*u23*v14 + (1.0L/8.0L)*a[31]*u23*v24)
-            + w2 *
-            (-a[0]*v1 + a[0]*v2 - a[1]*u2*v1 + a[1]*u2*v2 -
-            1.0L/3.0L*a[10]*u22*v13 + (1.0L/3.0L)*a[10]*u22*v23 - 1.0L/3.0L*a[11]*u23*v13 + (1.0L/3.0L)*a[11]*u23*v23 -
-            1.0L/4.0L*a[12]*v14 + (1.0L/4.0L)*a[12]*v24 - 1.0L/4.0L*a[13]*u2*v14 + (1.0L/4.0L)*a[13]*u2*v24 -
-            1.0L/4.0L*a[14]*u22*v14 + (1.0L/4.0L)*a[14]*u22*v24 - 1.0L/4.0L*a[15]*u23*v14 + (1.0L/4.0L)*a[15]*u23*v24 -
-            a[2]*u22*v1 + a[2]*u22*v2 - a[3]*u23*v1 + a[3]*u23*v2 -
-            1.0L/2.0L*a[4]*v12 + (1.0L/2.0L)*a[4]*v22 - 1.0L/2.0L*a[5]*u2*v12 + (1.0L/2.0L)*a[5]*u2*v22 -
-            1.0L/2.0L*a[6]*u22*v12 + (1.0L/2.0L)*a[6]*u22*v22 - 1.0L/2.0L*a[7]*u23*v12 + (1.0L/2.0L)*a[7]*u23*v22 -
-            1.0L/3.0L*a[8]*v13 + (1.0L/3.0L)*a[8]*v23 - 1.0L/3.0L*a[9]*u2*v13 + (1.0L/3.0L)*a[9]*u2*v23);
-    return G_result;
-}
-
-double Energy::gradientYMaxComponent(const gridreal*& a, double u1, double w1, double u2, double v2, double w2) {
-    double u12 = u1*u1; double u13 = u12*u1; double u14 = u13*u1;
-    double w12 = w1*w1; double w13 = w12*w1; double w14 = w13*w1;
-    double u22 = u2*u2; double u23 = u22*u2; double u24 = u23*u2;
-    double v22 = v2*v2; double v23 = v22*v2;
-    double w22 = w2*w2; double w23 = w22*w2; double w24 = w23*w2;
-    double G_result;
-    G_result =
-            -w14 *
-            (-1.0L/4.0L*a[48]*u1 + (1.0L/4.0L)*a[48]*u2 - 1.0L/8.0L*a[49]*u12 + (1.0L/8.0L)*a[49]*u22 -
-            1.0L/12.0L*a[50]*u13 + (1.0L/12.0L)*a[50]*u23 - 1.0L/16.0L*a[51]*u14 + (1.0L/16.0L)*a[51]*u24 -
-            1.0L/4.0L*a[52]*u1*v2 + (1.0L/4.0L)*a[52]*u2*v2 - 1.0L/8.0L*a[53]*u12*v2 + (1.0L/8.0L)*a[53]*u22*v2 -
-            1.0L/12.0L*a[54]*u13*v2 + (1.0L/12.0L)*a[54]*u23*v2 - 1.0L/16.0L*a[55]*u14*v2 + (1.0L/16.0L)*a[55]*u24*v2 -
-            1.0L/4.0L*a[56]*u1*v22 + (1.0L/4.0L)*a[56]*u2*v22 - 1.0L/8.0L*a[57]*u12*v22 + (1.0L/8.0L)*a[57]*u22*v22 -
-            1.0L/12.0L*a[58]*u13*v22 + (1.0L/12.0L)*a[58]*u23*v22 - 1.0L/16.0L*a[59]*u14*v22 + (1.0L/16.0L)*a[59]*u24*v22 -
-            1.0L/4.0L*a[60]*u1*v23 + (1.0L/4.0L)*a[60]*u2*v23 - 1.0L/8.0L*a[61]*u12*v23 + (1.0L/8.0L)*a[61]*u22*v23 -
-            1.0L/12.0L*a[62]*u13*v23 + (1.0L/12.0L)*a[62]*u23*v23 - 1.0L/16.0L*a[63]*u14*v23 + (1.0L/16.0L)*a[63]*u24*v23)
-            - w13 *
-            (-1.0L/3.0L*a[32]*u1 + (1.0L/3.0L)*a[32]*u2 - 1.0L/6.0L*a[33]*u12 + (1.0L/6.0L)*a[33]*u22 -
-            1.0L/9.0L*a[34]*u13 + (1.0L/9.0L)*a[34]*u23 - 1.0L/12.0L*a[35]*u14 + (1.0L/12.0L)*a[35]*u24 -
-            1.0L/3.0L*a[36]*u1*v2 + (1.0L/3.0L)*a[36]*u2*v2 - 1.0L/6.0L*a[37]*u12*v2 + (1.0L/6.0L)*a[37]*u22*v2 -
-            1.0L/9.0L*a[38]*u13*v2 + (1.0L/9.0L)*a[38]*u23*v2 - 1.0L/12.0L*a[39]*u14*v2 + (1.0L/12.0L)*a[39]*u24*v2 -
-            1.0L/3.0L*a[40]*u1*v22 + (1.0L/3.0L)*a[40]*u2*v22 - 1.0L/6.0L*a[41]*u12*v22 + (1.0L/6.0L)*a[41]*u22*v22 -
-            1.0L/9.0L*a[42]*u13*v22 + (1.0L/9.0L)*a[42]*u23*v22 - 1.0L/12.0L*a[43]*u14*v22 + (1.0L/12.0L)*a[43]*u24*v22 -
-            1.0L/3.0L*a[44]*u1*v23 + (1.0L/3.0L)*a[44]*u2*v23 - 1.0L/6.0L*a[45]*u12*v23 + (1.0L/6.0L)*a[45]*u22*v23 -
-            1.0L/9.0L*a[46]*u13*v23 + (1.0L/9.0L)*a[46]*u23*v23 - 1.0L/12.0L*a[47]*u14*v23 + (1.0L/12.0L)*a[47]*u24*v23)
-            - w12 *
-            (-1.0L/2.0L*a[16]*u1 + (1.0L/2.0L)*a[16]*u2 - 1.0L/4.0L*a[17]*u12 + (1.0L/4.0L)*a[17]*u22 -
-            1.0L/6.0L*a[18]*u13 + (1.0L/6.0L)*a[18]*u23 - 1.0L/8.0L*a[19]*u14 + (1.0L/8.0L)*a[19]*u24 -
-            1.0L/2.0L*a[20]*u1*v2 + (1.0L/2.0L)*a[20]*u2*v2 - 1.0L/4.0L*a[21]*u12*v2 + (1.0L/4.0L)*a[21]*u22*v2 -
-            1.0L/6.0L*a[22]*u13*v2 + (1.0L/6.0L)*a[22]*u23*v2 - 1.0L/8.0L*a[23]*u14*v2 + (1.0L/8.0L)*a[23]*u24*v2 -
-            1.0L/2.0L*a[24]*u1*v22 + (1.0L/2.0L)*a[24]*u2*v22 - 1.0L/4.0L*a[25]*u12*v22 + (1.0L/4.0L)*a[25]*u22*v22 -
-            1.0L/6.0L*a[26]*u13*v22 + (1.0L/6.0L)*a[26]*u23*v22 - 1.0L/8.0L*a[27]*u14*v22 + (1.0L/8.0L)*a[27]*u24*v22 -
-            1.0L/2.0L*a[28]*u1*v23 + (1.0L/2.0L)*a[28]*u2*v23 - 1.0L/4.0L*a[29]*u12*v23 + (1.0L/4.0L)*a[29]*u22*v23 -
-            1.0L/6.0L*a[30]*u13*v23 + (1.0L/6.0L)*a[30]*u23*v23 - 1.0L/8.0L*a[31]*u14*v23 + (1.0L/8.0L)*a[31]*u24*v23)
-            - w1 *
-            (-a[0]*u1 + a[0]*u2 - 1.0L/2.0L*a[1]*u12 + (1.0L/2.0L)*a[1]*u22 -
-            1.0L/3.0L*a[10]*u13*v22 + (1.0L/3.0L)*a[10]*u23*v22 - 1.0L/4.0L*a[11]*u14*v22 + (1.0L/4.0L)*a[11]*u24*v22 -
-            a[12]*u1*v23 + a[12]*u2*v23 - 1.0L/2.0L*a[13]*u12*v23 + (1.0L/2.0L)*a[13]*u22*v23 -
-            1.0L/3.0L*a[14]*u13*v23 + (1.0L/3.0L)*a[14]*u23*v23 - 1.0L/4.0L*a[15]*u14*v23 + (1.0L/4.0L)*a[15]*u24*v23 -
-            1.0L/3.0L*a[2]*u13 + (1.0L/3.0L)*a[2]*u23 - 1.0L/4.0L*a[3]*u14 + (1.0L/4.0L)*a[3]*u24 -
-            a[4]*u1*v2 + a[4]*u2*v2 -  1.0L/2.0L*a[5]*u12*v2 + (1.0L/2.0L)*a[5]*u22*v2 -
-            1.0L/3.0L*a[6]*u13*v2 + (1.0L/3.0L)*a[6]*u23*v2 - 1.0L/4.0L*a[7]*u14*v2 + (1.0L/4.0L)*a[7]*u24*v2 -
-            a[8]*u1*v22 + a[8]*u2*v22 - 1.0L/2.0L*a[9]*u12*v22 + (1.0L/2.0L)*a[9]*u22*v22)
-            + w24 *
-            (-1.0L/4.0L*a[48]*u1 + (1.0L/4.0L)*a[48]*u2 - 1.0L/8.0L*a[49]*u12 + (1.0L/8.0L)*a[49]*u22 -
-            1.0L/12.0L*a[50]*u13 + (1.0L/12.0L)*a[50]*u23 - 1.0L/16.0L*a[51]*u14 + (1.0L/16.0L)*a[51]*u24 -
-            1.0L/4.0L*a[52]*u1*v2 + (1.0L/4.0L)*a[52]*u2*v2 - 1.0L/8.0L*a[53]*u12*v2 + (1.0L/8.0L)*a[53]*u22*v2 -
-            1.0L/12.0L*a[54]*u13*v2 + (1.0L/12.0L)*a[54]*u23*v2 - 1.0L/16.0L*a[55]*u14*v2 + (1.0L/16.0L)*a[55]*u24*v2 -
-            1.0L/4.0L*a[56]*u1*v22 + (1.0L/4.0L)*a[56]*u2*v22 - 1.0L/8.0L*a[57]*u12*v22 + (1.0L/8.0L)*a[57]*u22*v22 -
-            1.0L/12.0L*a[58]*u13*v22 + (1.0L/12.0L)*a[58]*u23*v22 - 1.0L/16.0L*a[59]*u14*v22 + (1.0L/16.0L)*a[59]*u24*v22 -
-            1.0L/4.0L*a[60]*u1*v23 + (1.0L/4.0L)*a[60]*u2*v23 - 1.0L/8.0L*a[61]*u12*v23 + (1.0L/8.0L)*a[61]*u22*v23 -
-            1.0L/12.0L*a[62]*u13*v23 + (1.0L/12.0L)*a[62]*u23*v23 - 1.0L/16.0L*a[63]*u14*v23 + (1.0L/16.0L)*a[63]*u24*v23)
-            + w23 *
-            (-1.0L/3.0L*a[32]*u1 + (1.0L/3.0L)*a[32]*u2 - 1.0L/6.0L*a[33]*u12 + (1.0L/6.0L)*a[33]*u22 -
-            1.0L/9.0L*a[34]*u13 + (1.0L/9.0L)*a[34]*u23 - 1.0L/12.0L*a[35]*u14 + (1.0L/12.0L)*a[35]*u24 -
-            1.0L/3.0L*a[36]*u1*v2 + (1.0L/3.0L)*a[36]*u2*v2 - 1.0L/6.0L*a[37]*u12*v2 + (1.0L/6.0L)*a[37]*u22*v2 -
-            1.0L/9.0L*a[38]*u13*v2 + (1.0L/9.0L)*a[38]*u23*v2 - 1.0L/12.0L*a[39]*u14*v2 + (1.0L/12.0L)*a[39]*u24*v2 -
-            1.0L/3.0L*a[40]*u1*v22 + (1.0L/3.0L)*a[40]*u2*v22 - 1.0L/6.0L*a[41]*u12*v22 + (1.0L/6.0L)*a[41]*u22*v22 -
-            1.0L/9.0L*a[42]*u13*v22 + (1.0L/9.0L)*a[42]*u23*v22 - 1.0L/12.0L*a[43]*u14*v22 + (1.0L/12.0L)*a[43]*u24*v22 -
-            1.0L/3.0L*a[44]*u1*v23 + (1.0L/3.0L)*a[44]*u2*v23 - 1.0L/6.0L*a[45]*u12*v23 + (1.0L/6.0L)*a[45]*u22*v23 -
-            1.0L/9.0L*a[46]*u13*v23 + (1.0L/9.0L)*a[46]*u23*v23 - 1.0L/12.0L*a[47]*u14*v23 + (1.0L/12.0L)*a[47]*u24*v23)
-            + w22 *
-            (-1.0L/2.0L*a[16]*u1 + (1.0L/2.0L)*a[16]*u2 - 1.0L/4.0L*a[17]*u12 + (1.0L/4.0L)*a[17]*u22 -
-            1.0L/6.0L*a[18]*u13 + (1.0L/6.0L)*a[18]*u23 - 1.0L/8.0L*a[19]*u14 + (1.0L/8.0L)*a[19]*u24 -
-            1.0L/2.0L*a[20]*u1*v2 + (1.0L/2.0L)*a[20]*u2*v2 - 1.0L/4.0L*a[21]*u12*v2 + (1.0L/4.0L)*a[21]*u22*v2 -
-            1.0L/6.0L*a[22]*u13*v2 + (1.0L/6.0L)*a[22]*u23*v2 - 1.0L/8.0L*a[23]*u14*v2 + (1.0L/8.0L)*a[23]*u24*v2 -
-            1.0L/2.0L*a[24]*u1*v22 + (1.0L/2.0L)*a[24]*u2*v22 - 1.0L/4.0L*a[25]*u12*v22 + (1.0L/4.0L)*a[25]*u22*v22 -
-            1.0L/6.0L*a[26]*u13*v22 + (1.0L/6.0L)*a[26]*u23*v22 - 1.0L/8.0L*a[27]*u14*v22 + (1.0L/8.0L)*a[27]*u24*v22 -
-            1.0L/2.0L*a[28]*u1*v23 + (1.0L/2.0L)*a[28]*u2*v23 - 1.0L/4.0L*a[29]*u12*v23 + (1.0L/4.0L)*a[29]*u22*v23 -
-            1.0L/6.0L*a[30]*u13*v23 + (1.0L/6.0L)*a[30]*u23*v23 - 1.0L/8.0L*a[31]*u14*v23 + (1.0L/8.0L)*a[31]*u24*v23)
-            + w2 *
-            (-a[0]*u1 + a[0]*u2 - 1.0L/2.0L*a[1]*u12 + (1.0L/2.0L)*a[1]*u22 -
-            1.0L/3.0L*a[10]*u13*v22 + (1.0L/3.0L)*a[10]*u23*v22 - 1.0L/4.0L*a[11]*u14*v22 + (1.0L/4.0L)*a[11]*u24*v22 -
-            a[12]*u1*v23 + a[12]*u2*v23 - 1.0L/2.0L*a[13]*u12*v23 + (1.0L/2.0L)*a[13]*u22*v23 -
-            1.0L/3.0L*a[14]*u13*v23 + (1.0L/3.0L)*a[14]*u23*v23 - 1.0L/4.0L*a[15]*u14*v23 + (1.0L/4.0L)*a[15]*u24*v23 -
-            1.0L/3.0L*a[2]*u13 + (1.0L/3.0L)*a[2]*u23 - 1.0L/4.0L*a[3]*u14 + (1.0L/4.0L)*a[3]*u24
-            - a[4]*u1*v2 + a[4]*u2*v2 - 1.0L/2.0L*a[5]*u12*v2 + (1.0L/2.0L)*a[5]*u22*v2 -
-            1.0L/3.0L*a[6]*u13*v2 + (1.0L/3.0L)*a[6]*u23*v2 - 1.0L/4.0L*a[7]*u14*v2 + (1.0L/4.0L)*a[7]*u24*v2 -
-            a[8]*u1*v22 + a[8]*u2*v22 - 1.0L/2.0L*a[9]*u12*v22 + (1.0L/2.0L)*a[9]*u22*v22);
-    return G_result;
-}
-
-double Energy::gradientZMaxComponent(const gridreal*& a, double u1, double v1, double u2, double v2, double w2) {
-    double u12 = u1*u1; double u13 = u12*u1; double u14 = u13*u1;
-    double v12 = v1*v1; double v13 = v12*v1; double v14 = v13*v1;
-    double u22 = u2*u2; double u23 = u22*u2; double u24 = u23*u2;
-    double v22 = v2*v2; double v23 = v22*v2; double v24 = v23*v2;
-    double w22 = w2*w2; double w23 = w22*w2;
-    double G_result;
-    G_result =
-            a[0]*u1*v1 - a[0]*u1*v2 - a[0]*u2*v1 + a[0]*u2*v2 +
-            (1.0L/2.0L)*a[1]*u12*v1 - 1.0L/2.0L*a[1]*u12*v2 - 1.0L/2.0L*a[1]*u22*v1 + (1.0L/2.0L)*a[1]*u22*v2 +
-            (1.0L/9.0L)*a[10]*u13*v13 - 1.0L/9.0L*a[10]*u13*v23 - 1.0L/9.0L*a[10]*u23*v13 + (1.0L/9.0L)*a[10]*u23*v23 +
-            (1.0L/12.0L)*a[11]*u14*v13 - 1.0L/12.0L*a[11]*u14*v23 - 1.0L/12.0L*a[11]*u24*v13 + (1.0L/12.0L)*a[11]*u24*v23 +
-            (1.0L/4.0L)*a[12]*u1*v14 - 1.0L/4.0L*a[12]*u1*v24 - 1.0L/4.0L*a[12]*u2*v14 + (1.0L/4.0L)*a[12]*u2*v24 +
-            (1.0L/8.0L)*a[13]*u12*v14 - 1.0L/8.0L*a[13]*u12*v24 - 1.0L/8.0L*a[13]*u22*v14 + (1.0L/8.0L)*a[13]*u22*v24 +
-            (1.0L/12.0L)*a[14]*u13*v14 - 1.0L/12.0L*a[14]*u13*v24 - 1.0L/12.0L*a[14]*u23*v14 + (1.0L/12.0L)*a[14]*u23*v24 +
-            (1.0L/16.0L)*a[15]*u14*v14 - 1.0L/16.0L*a[15]*u14*v24 - 1.0L/16.0L*a[15]*u24*v14 + (1.0L/16.0L)*a[15]*u24*v24 +
-            (1.0L/3.0L)*a[2]*u13*v1 - 1.0L/3.0L*a[2]*u13*v2 - 1.0L/3.0L*a[2]*u23*v1 + (1.0L/3.0L)*a[2]*u23*v2 +
-            (1.0L/4.0L)*a[3]*u14*v1 - 1.0L/4.0L*a[3]*u14*v2 - 1.0L/4.0L*a[3]*u24*v1 + (1.0L/4.0L)*a[3]*u24*v2 +
-            (1.0L/2.0L)*a[4]*u1*v12 - 1.0L/2.0L*a[4]*u1*v22 - 1.0L/2.0L*a[4]*u2*v12 + (1.0L/2.0L)*a[4]*u2*v22 +
-            (1.0L/4.0L)*a[5]*u12*v12 - 1.0L/4.0L*a[5]*u12*v22 - 1.0L/4.0L*a[5]*u22*v12 + (1.0L/4.0L)*a[5]*u22*v22 +
-            (1.0L/6.0L)*a[6]*u13*v12 - 1.0L/6.0L*a[6]*u13*v22 - 1.0L/6.0L*a[6]*u23*v12 + (1.0L/6.0L)*a[6]*u23*v22 +
-            (1.0L/8.0L)*a[7]*u14*v12 - 1.0L/8.0L*a[7]*u14*v22 - 1.0L/8.0L*a[7]*u24*v12 + (1.0L/8.0L)*a[7]*u24*v22 +
-            (1.0L/3.0L)*a[8]*u1*v13 - 1.0L/3.0L*a[8]*u1*v23 - 1.0L/3.0L*a[8]*u2*v13 + (1.0L/3.0L)*a[8]*u2*v23 +
-            (1.0L/6.0L)*a[9]*u12*v13 - 1.0L/6.0L*a[9]*u12*v23 - 1.0L/6.0L*a[9]*u22*v13 + (1.0L/6.0L)*a[9]*u22*v23 +
-            4*w23 *
-            ((1.0L/4.0L)*a[48]*u1*v1 - 1.0L/4.0L*a[48]*u1*v2 - 1.0L/4.0L*a[48]*u2*v1 + (1.0L/4.0L)*a[48]*u2*v2 +
-            (1.0L/8.0L)*a[49]*u12*v1 - 1.0L/8.0L*a[49]*u12*v2 - 1.0L/8.0L*a[49]*u22*v1 + (1.0L/8.0L)*a[49]*u22*v2 +
-            (1.0L/12.0L)*a[50]*u13*v1 - 1.0L/12.0L*a[50]*u13*v2 - 1.0L/12.0L*a[50]*u23*v1 + (1.0L/12.0L)*a[50]*u23*v2 +
-            (1.0L/16.0L)*a[51]*u14*v1 - 1.0L/16.0L*a[51]*u14*v2 - 1.0L/16.0L*a[51]*u24*v1 + (1.0L/16.0L)*a[51]*u24*v2 +
-            (1.0L/8.0L)*a[52]*u1*v12 - 1.0L/8.0L*a[52]*u1*v22 - 1.0L/8.0L*a[52]*u2*v12 + (1.0L/8.0L)*a[52]*u2*v22 +
-            (1.0L/16.0L)*a[53]*u12*v12 - 1.0L/16.0L*a[53]*u12*v22 - 1.0L/16.0L*a[53]*u22*v12 + (1.0L/16.0L)*a[53]*u22*v22 +
-            (1.0L/24.0L)*a[54]*u13*v12 - 1.0L/24.0L*a[54]*u13*v22 - 1.0L/24.0L*a[54]*u23*v12 + (1.0L/24.0L)*a[54]*u23*v22 +
-            (1.0L/32.0L)*a[55]*u14*v12 - 1.0L/32.0L*a[55]*u14*v22 - 1.0L/32.0L*a[55]*u24*v12 + (1.0L/32.0L)*a[55]*u24*v22 +
-            (1.0L/12.0L)*a[56]*u1*v13 - 1.0L/12.0L*a[56]*u1*v23 - 1.0L/12.0L*a[56]*u2*v13 + (1.0L/12.0L)*a[56]*u2*v23 +
-            (1.0L/24.0L)*a[57]*u12*v13 - 1.0L/24.0L*a[57]*u12*v23 - 1.0L/24.0L*a[57]*u22*v13 + (1.0L/24.0L)*a[57]*u22*v23 +
-            (1.0L/36.0L)*a[58]*u13*v13 - 1.0L/36.0L*a[58]*u13*v23 - 1.0L/36.0L*a[58]*u23*v13 + (1.0L/36.0L)*a[58]*u23*v23 +
-            (1.0L/48.0L)*a[59]*u14*v13 - 1.0L/48.0L*a[59]*u14*v23 - 1.0L/48.0L*a[59]*u24*v13 + (1.0L/48.0L)*a[59]*u24*v23 +
-            (1.0L/16.0L)*a[60]*u1*v14 - 1.0L/16.0L*a[60]*u1*v24 - 1.0L/16.0L*a[60]*u2*v14 + (1.0L/16.0L)*a[60]*u2*v24 +
-            (1.0L/32.0L)*a[61]*u12*v14 - 1.0L/32.0L*a[61]*u12*v24 - 1.0L/32.0L*a[61]*u22*v14 + (1.0L/32.0L)*a[61]*u22*v24 +
-            (1.0L/48.0L)*a[62]*u13*v14 - 1.0L/48.0L*a[62]*u13*v24 - 1.0L/48.0L*a[62]*u23*v14 + (1.0L/48.0L)*a[62]*u23*v24 +
-            (1.0L/64.0L)*a[63]*u14*v14 - 1.0L/64.0L*a[63]*u14*v24 - 1.0L/64.0L*a[63]*u24*v14 + (1.0L/64.0L)*a[63]*u24*v24)
-            + 3*w22 *
-            ((1.0L/3.0L)*a[32]*u1*v1 - 1.0L/3.0L*a[32]*u1*v2 - 1.0L/3.0L*a[32]*u2*v1 + (1.0L/3.0L)*a[32]*u2*v2 +
-            (1.0L/6.0L)*a[33]*u12*v1 - 1.0L/6.0L*a[33]*u12*v2 - 1.0L/6.0L*a[33]*u22*v1 + (1.0L/6.0L)*a[33]*u22*v2 +
-            (1.0L/9.0L)*a[34]*u13*v1 - 1.0L/9.0L*a[34]*u13*v2 - 1.0L/9.0L*a[34]*u23*v1 + (1.0L/9.0L)*a[34]*u23*v2 +
-            (1.0L/12.0L)*a[35]*u14*v1 - 1.0L/12.0L*a[35]*u14*v2 - 1.0L/12.0L*a[35]*u24*v1 + (1.0L/12.0L)*a[35]*u24*v2 +
-            (1.0L/6.0L)*a[36]*u1*v12 - 1.0L/6.0L*a[36]*u1*v22 - 1.0L/6.0L*a[36]*u2*v12 + (1.0L/6.0L)*a[36]*u2*v22 +
-            (1.0L/12.0L)*a[37]*u12*v12 - 1.0L/12.0L*a[37]*u12*v22 - 1.0L/12.0L*a[37]*u22*v12 + (1.0L/12.0L)*a[37]*u22*v22 +
-            (1.0L/18.0L)*a[38]*u13*v12 - 1.0L/18.0L*a[38]*u13*v22 - 1.0L/18.0L*a[38]*u23*v12 + (1.0L/18.0L)*a[38]*u23*v22 +
-            (1.0L/24.0L)*a[39]*u14*v12 - 1.0L/24.0L*a[39]*u14*v22 - 1.0L/24.0L*a[39]*u24*v12 + (1.0L/24.0L)*a[39]*u24*v22 +
-            (1.0L/9.0L)*a[40]*u1*v13 - 1.0L/9.0L*a[40]*u1*v23 - 1.0L/9.0L*a[40]*u2*v13 + (1.0L/9.0L)*a[40]*u2*v23 +
-            (1.0L/18.0L)*a[41]*u12*v13 - 1.0L/18.0L*a[41]*u12*v23 - 1.0L/18.0L*a[41]*u22*v13 + (1.0L/18.0L)*a[41]*u22*v23 +
-            (1.0L/27.0L)*a[42]*u13*v13 - 1.0L/27.0L*a[42]*u13*v23 - 1.0L/27.0L*a[42]*u23*v13 + (1.0L/27.0L)*a[42]*u23*v23 +
-            (1.0L/36.0L)*a[43]*u14*v13 - 1.0L/36.0L*a[43]*u14*v23 - 1.0L/36.0L*a[43]*u24*v13 + (1.0L/36.0L)*a[43]*u24*v23 +
-            (1.0L/12.0L)*a[44]*u1*v14 - 1.0L/12.0L*a[44]*u1*v24 - 1.0L/12.0L*a[44]*u2*v14 + (1.0L/12.0L)*a[44]*u2*v24 +
-            (1.0L/24.0L)*a[45]*u12*v14 - 1.0L/24.0L*a[45]*u12*v24 - 1.0L/24.0L*a[45]*u22*v14 + (1.0L/24.0L)*a[45]*u22*v24 +
-            (1.0L/36.0L)*a[46]*u13*v14 - 1.0L/36.0L*a[46]*u13*v24 - 1.0L/36.0L*a[46]*u23*v14 + (1.0L/36.0L)*a[46]*u23*v24 +
-            (1.0L/48.0L)*a[47]*u14*v14 - 1.0L/48.0L*a[47]*u14*v24 - 1.0L/48.0L*a[47]*u24*v14 + (1.0L/48.0L)*a[47]*u24*v24)
-            + 2*w2 *
-            ((1.0L/2.0L)*a[16]*u1*v1 - 1.0L/2.0L*a[16]*u1*v2 - 1.0L/2.0L*a[16]*u2*v1 + (1.0L/2.0L)*a[16]*u2*v2 +
-            (1.0L/4.0L)*a[17]*u12*v1 - 1.0L/4.0L*a[17]*u12*v2 - 1.0L/4.0L*a[17]*u22*v1 + (1.0L/4.0L)*a[17]*u22*v2 +
-            (1.0L/6.0L)*a[18]*u13*v1 - 1.0L/6.0L*a[18]*u13*v2 - 1.0L/6.0L*a[18]*u23*v1 + (1.0L/6.0L)*a[18]*u23*v2 +
-            (1.0L/8.0L)*a[19]*u14*v1 - 1.0L/8.0L*a[19]*u14*v2 - 1.0L/8.0L*a[19]*u24*v1 + (1.0L/8.0L)*a[19]*u24*v2 +
-            (1.0L/4.0L)*a[20]*u1*v12 - 1.0L/4.0L*a[20]*u1*v22 - 1.0L/4.0L*a[20]*u2*v12 + (1.0L/4.0L)*a[20]*u2*v22 +
-            (1.0L/8.0L)*a[21]*u12*v12 - 1.0L/8.0L*a[21]*u12*v22 - 1.0L/8.0L*a[21]*u22*v12 + (1.0L/8.0L)*a[21]*u22*v22 +
-            (1.0L/12.0L)*a[22]*u13*v12 - 1.0L/12.0L*a[22]*u13*v22 - 1.0L/12.0L*a[22]*u23*v12 + (1.0L/12.0L)*a[22]*u23*v22 +
-            (1.0L/16.0L)*a[23]*u14*v12 - 1.0L/16.0L*a[23]*u14*v22 - 1.0L/16.0L*a[23]*u24*v12 + (1.0L/16.0L)*a[23]*u24*v22 +
-            (1.0L/6.0L)*a[24]*u1*v13 - 1.0L/6.0L*a[24]*u1*v23 - 1.0L/6.0L*a[24]*u2*v13 + (1.0L/6.0L)*a[24]*u2*v23 +
-            (1.0L/12.0L)*a[25]*u12*v13 - 1.0L/12.0L*a[25]*u12*v23 - 1.0L/12.0L*a[25]*u22*v13 + (1.0L/12.0L)*a[25]*u22*v23 +
-            (1.0L/18.0L)*a[26]*u13*v13 - 1.0L/18.0L*a[26]*u13*v23 - 1.0L/18.0L*a[26]*u23*v13 + (1.0L/18.0L)*a[26]*u23*v23 +
-            (1.0L/24.0L)*a[27]*u14*v13 - 1.0L/24.0L*a[27]*u14*v23 - 1.0L/24.0L*a[27]*u24*v13 + (1.0L/24.0L)*a[27]*u24*v23 +
-            (1.0L/8.0L)*a[28]*u1*v14 - 1.0L/8.0L*a[28]*u1*v24 - 1.0L/8.0L*a[28]*u2*v14 + (1.0L/8.0L)*a[28]*u2*v24 +
-            (1.0L/16.0L)*a[29]*u12*v14 - 1.0L/16.0L*a[29]*u12*v24 - 1.0L/16.0L*a[29]*u22*v14 + (1.0L/16.0L)*a[29]*u22*v24 +
-            (1.0L/24.0L)*a[30]*u13*v14 - 1.0L/24.0L*a[30]*u13*v24 - 1.0L/24.0L*a[30]*u23*v14 + (1.0L/24.0L)*a[30]*u23*v24 +
-            (1.0L/32.0L)*a[31]*u14*v14 - 1.0L/32.0L*a[31]*u14*v24 - 1.0L/32.0L*a[31]*u24*v14 + (1.0L/32.0L)*a[31]*u24*v24);
-    return G_result;
-}
-
-double Energy::gradientEvaluateXMinComponent(const Eigen::VectorXd &x) const {
-    double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstX = min.x()-unit, firstY = min.y()-unit, firstZ = min.z()-unit, lastY = max.y()+unit, lastZ = max.z()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-    //fissare x1
-    x1 = firstX;
-    while (x1 <= minbx){
-        x1+=unit;
-    }
-    double x2 = x1;
-    x1-=unit;
-    for (y1 = firstY; y1 <= lastY; y1+=unit){
-        double y2 = y1 + unit;
-        for (z1 = firstZ; z1<=lastZ; z1+=unit){
-            double z2 = z1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                maxby <= y1 || minby >= y2 ||
-                maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-
-                double u1 = minbx < x1 ? x1 : minbx;
-                double v1 = minby < y1 ? y1 : minby;
-                double w1 = minbz < z1 ? z1 : minbz;
-                double v2 = maxby > y2 ? y2 : maxby;
-                double w2 = maxbz > z2 ? z2 : maxbz;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u1 = (u1-x1)/unit;
-                v1 = (v1-y1)/unit;
-                v2 = (v2-y1)/unit;
-                w1 = (w1-z1)/unit;
-                w2 = (w2-z1)/unit;
-                energy += gradientXMinComponent(coeffs, u1,v1,w1,v2,w2);
-            }
-
-        }
-    }
-
-    return energy;
-}
-
-double Energy::gradientEvaluateYMinComponent(const Eigen::VectorXd &x) const {
+/**
+ * @brief Energy::faceIntegral
+ *
+ * Integral of the tricubic interpolation on the min (or max) face of the box orthogonal to axis.
+ * The cells of the slab completely covered by the face are summed with a query on the summed area
+ * tables of the grid; only the cells on the border of the face are explicitly integrated.
+ */
+double Energy::faceIntegral(const Eigen::VectorXd& x, unsigned int axis, bool maxFace) const {
     double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstX = min.x()-unit, firstY = min.y()-unit, firstZ = min.z()-unit, lastX = max.x()+unit, lastZ = max.z()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-
-    //fissare y1
-    y1 = firstY;
-    while (y1 <= minby){
-        y1+=unit;
+    Pointd o = g->getBoundingBox().getMin();
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+
+    //cell of the slab containing the face
+    double t = maxFace ? x(axis+3) : x(axis);
+    int c = maxFace ? std::ceil((t - o[axis]) / unit) - 1 : std::floor((t - o[axis]) / unit);
+    double t1 = o[axis] + c*unit;
+    if ((maxFace && x(axis) >= t1 + unit) || (!maxFace && x(axis+3) <= t1)) // not contained
+        return 0;
+    double u = (t - t1) / unit;
+    double mu[4] = {1, u, u*u, u*u*u};
+
+    //lo-hi: cells intersected by the face, flo-fhi: cells completely covered
+    unsigned int axes[2] = {p, q};
+    int lo[2], hi[2], flo[2], fhi[2];
+    for (unsigned int i = 0; i < 2; i++){
+        double a = (x(axes[i]) - o[axes[i]]) / unit, b = (x(axes[i]+3) - o[axes[i]]) / unit;
+        lo[i] = std::floor(a);
+        hi[i] = std::ceil(b) - 1;
+        flo[i] = std::ceil(a);
+        fhi[i] = std::floor(b) - 1;
     }
-    double y2 = y1;
-    y1-=unit;
-
-    for (x1 = firstX; x1 <= lastX; x1+=unit){
-        double x2 = x1 + unit;
-        for (z1 = firstZ; z1<=lastZ; z1+=unit){
-            double z2 = z1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                    maxby <= y1 || minby >= y2 ||
-                    maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
 
-                double u1 = minbx < x1 ? x1 : minbx;
-                double v1 = minby < y1 ? y1 : minby;
-                double w1 = minbz < z1 ? z1 : minbz;
-                double u2 = maxbx > x2 ? x2 : maxbx;
-                double w2 = maxbz > z2 ? z2 : maxbz;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u1 = (u1-x1)/unit;
-                u2 = (u2-x1)/unit;
-                v1 = (v1-y1)/unit;
-                w1 = (w1-z1)/unit;
-                w2 = (w2-z1)/unit;
-                energy += gradientYMinComponent(coeffs, u1,v1,w1,u2,w2);
+    double f[4];
+    g->getFullFacesValue(f, axis, c, flo[0], flo[1], fhi[0], fhi[1]);
+    double result = mu[0]*f[0] + mu[1]*f[1] + mu[2]*f[2] + mu[3]*f[3];
+
+    const double* m[3];
+    m[axis] = mu;
+    for (int ip = lo[0]; ip <= hi[0]; ip++){
+        double p1 = o[p] + ip*unit;
+        bool fullP = ip >= flo[0] && ip <= fhi[0];
+        double mp[4];
+        integralMoments(mp, (std::max(x(p), p1)-p1)/unit, (std::min(x(p+3), p1+unit)-p1)/unit);
+        m[p] = mp;
+        for (int iq = lo[1]; iq <= hi[1]; iq++){
+            if (fullP && iq >= flo[1] && iq <= fhi[1]){ //completely covered, already summed
+                iq = fhi[1];
+                continue;
             }
+            double q1 = o[q] + iq*unit;
+            double mq[4];
+            integralMoments(mq, (std::max(x(q), q1)-q1)/unit, (std::min(x(q+3), q1+unit)-q1)/unit);
+            m[q] = mq;
+            int id[3];
+            id[axis] = c; id[p] = ip; id[q] = iq;
+            const gridreal* coeffs;
+            g->getCellCoefficients(coeffs, id[0], id[1], id[2]);
+            result += TricubicInterpolator::getSeparableValue(coeffs, m[0], m[1], m[2]);
         }
     }
-
-    return energy;
-}
-
-double Energy::gradientEvaluateZMinComponent(const Eigen::VectorXd& x) const {
-    double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstX = min.x()-unit, firstY = min.y()-unit, firstZ = min.z()-unit, lastX = max.x()+unit, lastY = max.y()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-
-    //fissare z1
-    z1 = firstZ;
-    while (z1 <= minbz){
-        z1+=unit;
-    }
-    double z2 = z1;
-    z1-=unit;
-
-    for (x1 = firstX; x1 <= lastX; x1+=unit){
-        double x2 = x1 + unit;
-        for (y1 = firstY; y1<=lastY; y1+=unit){
-            double y2 = y1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                    maxby <= y1 || minby >= y2 ||
-                    maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-
-                double u1 = minbx < x1 ? x1 : minbx;
-                double v1 = minby < y1 ? y1 : minby;
-                double w1 = minbz < z1 ? z1 : minbz;
-                double u2 = maxbx > x2 ? x2 : maxbx;
-                double v2 = maxby > y2 ? y2 : maxby;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u1 = (u1-x1)/unit;
-                u2 = (u2-x1)/unit;
-                v1 = (v1-y1)/unit;
-                v2 = (v2-y1)/unit;
-                w1 = (w1-z1)/unit;
-                energy += gradientZMinComponent(coeffs, u1,v1,w1,u2,v2);
-            }
-        }
-    }
-
-    return energy;
-}
-
-double Energy::gradientEvaluateXMaxComponent(const Eigen::VectorXd &x) const {
-    double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstY = min.y()-unit, firstZ = min.z()-unit, lastX = max.x()+unit, lastY = max.y()+unit, lastZ = max.z()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-    //fissare x1
-    x1 = lastX;
-    while (x1 >= maxbx){
-        x1-=unit;
-    }
-    double x2 = x1+unit;
-
-    for (y1 = firstY; y1 <= lastY; y1+=unit){
-        double y2 = y1 + unit;
-        for (z1 = firstZ; z1<=lastZ; z1+=unit){
-            double z2 = z1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                maxby <= y1 || minby >= y2 ||
-                maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-
-                double v1 = minby < y1 ? y1 : minby;
-                double w1 = minbz < z1 ? z1 : minbz;
-                double u2 = maxbx > x2 ? x2 : maxbx;
-                double v2 = maxby > y2 ? y2 : maxby;
-                double w2 = maxbz > z2 ? z2 : maxbz;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u2 = (u2-x1)/unit;
-                v1 = (v1-y1)/unit;
-                v2 = (v2-y1)/unit;
-                w1 = (w1-z1)/unit;
-                w2 = (w2-z1)/unit;
-                energy += gradientXMaxComponent(coeffs,v1,w1,u2,v2,w2);
-            }
-
-        }
-    }
-
-    return energy;
-}
-
-double Energy::gradientEvaluateYMaxComponent(const Eigen::VectorXd& x) const {
-    double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstX = min.x()-unit, firstZ = min.z()-unit, lastX = max.x()+unit, lastY = max.y()+unit, lastZ = max.z()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-
-    //fissare y1
-    y1 = lastY;
-    while (y1 >= maxby){
-        y1-=unit;
-    }
-    double y2 = y1+unit;
-
-    for (x1 = firstX; x1 <= lastX; x1+=unit){
-        double x2 = x1 + unit;
-        for (z1 = firstZ; z1<=lastZ; z1+=unit){
-            double z2 = z1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                    maxby <= y1 || minby >= y2 ||
-                    maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-
-                double u1 = minbx < x1 ? x1 : minbx;
-                double w1 = minbz < z1 ? z1 : minbz;
-                double u2 = maxbx > x2 ? x2 : maxbx;
-                double v2 = maxby > y2 ? y2 : maxby;
-                double w2 = maxbz > z2 ? z2 : maxbz;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u1 = (u1-x1)/unit;
-                u2 = (u2-x1)/unit;
-                v2 = (v2-y1)/unit;
-                w1 = (w1-z1)/unit;
-                w2 = (w2-z1)/unit;
-                energy += gradientYMaxComponent(coeffs, u1,w1,u2,v2,w2);
-            }
-        }
-    }
-
-    return energy;
-}
-
-double Energy::gradientEvaluateZMaxComponent(const Eigen::VectorXd &x) const {
-    double unit = g->getUnit();
-
-    Pointd min, max;
-    initializeMinMax(min, max, x);
-
-    double firstX = min.x()-unit, firstY = min.y()-unit, lastX = max.x()+unit, lastY = max.y()+unit, lastZ = max.z()+unit;
-
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-
-    //fissare z1
-    z1 = lastZ;
-    while (z1 >= maxbz){
-        z1-=unit;
-    }
-    double z2 = z1+unit;
-
-    for (x1 = firstX; x1 <= lastX; x1+=unit){
-        double x2 = x1 + unit;
-        for (y1 = firstY; y1<=lastY; y1+=unit){
-            double y2 = y1 + unit;
-
-            if (maxbx <= x1 || minbx >= x2 ||
-                    maxby <= y1 || minby >= y2 ||
-                    maxbz <= z1 || minbz >= z2 ) // not contained
-                energy += 0;
-            else {
-                const gridreal* coeffs;
-                g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-
-                double u1 = minbx < x1 ? x1 : minbx;
-                double v1 = minby < y1 ? y1 : minby;
-                double u2 = maxbx > x2 ? x2 : maxbx;
-                double v2 = maxby > y2 ? y2 : maxby;
-                double w2 = maxbz > z2 ? z2 : maxbz;
-                //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                u1 = (u1-x1)/unit;
-                u2 = (u2-x1)/unit;
-                v1 = (v1-y1)/unit;
-                v2 = (v2-y1)/unit;
-                w2 = (w2-z1)/unit;
-                energy += gradientZMaxComponent(coeffs, u1,v1,u2,v2,w2);
-            }
-        }
-    }
-
-    return energy;
+    return faceScale*result;
 }
 
 void Energy::gradientEnergy(Eigen::VectorXd& gradient, const Eigen::VectorXd& x, const Pointd& c1, const Pointd& c2, const Pointd& c3) const {
@@ -1101,6 +597,67 @@ void Energy::gradientEnergy(Eigen::VectorXd& gradient, const Eigen::VectorXd& x,
     gradient += gBarrier;
 }
 
+/**
+ * @brief Energy::energyAndGradient
+ *
+ * Total energy of the box x and its gradient, computed in a single pass on the grid.
+ */
+double Energy::energyAndGradient(Vector6d& gradient, const Vector6d& x, const Pointd& c1, const Pointd& c2, const Pointd& c3) const {
+    double energy = integralTricubicInterpolationEnergyAndGradient(gradient, x);
+    return energy + barrierEnergyAndGradient(gradient, x, c1, c2, c3);
+}
+
+double Energy::energyAndGradient(Vector6d& gradient, const Vector6d& x, const Pointd& c1, const Pointd& c2, const Pointd& c3, const Pointd& l) const {
+    double energy = integralTricubicInterpolationEnergyAndGradient(gradient, x);
+    energy += barrierEnergyAndGradient(gradient, x, c1, c2, c3);
+    return energy + barrierLimitsEnergyAndGradient(gradient, x, l);
+}
+
+/**
+ * @brief Energy::energyValue
+ *
+ * Same value of energyAndGradient, without computing the gradient (used to test the trial
+ * steps of the line searches).
+ */
+double Energy::energyValue(const Vector6d& x, const Pointd& c1, const Pointd& c2, const Pointd& c3) const {
+    Pointd min(x(0), x(1), x(2)), max(x(3), x(4), x(5));
+    const double s = S_BARRIER;
+    return integralTricubicInterpolationEnergy(x) + lowConstraint(min, c1, s) + lowConstraint(min, c2, s) + lowConstraint(min, c3, s) +
+            highConstraint(max, c1, s) + highConstraint(max, c2, s) + highConstraint(max, c3, s);
+}
+
+double Energy::energyValue(const Vector6d& x, const Pointd& c1, const Pointd& c2, const Pointd& c3, const Pointd& l) const {
+    return energyValue(x, c1, c2, c3) + lowConstraint(Pointd(x(3)-x(0), x(4)-x(1), x(5)-x(2)), l, S_BARRIER);
+}
+
+/**
+ * @brief Energy::barrierEnergyAndGradient
+ *
+ * Same value of barrierEnergy; the gradient of the barrier (see gradientBarrier) is added to gradient.
+ */
+double Energy::barrierEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const Pointd& c1, const Pointd& c2, const Pointd& c3, double s) const {
+    Pointd min(x(0), x(1), x(2)), max(x(3), x(4), x(5));
+    for (unsigned int i = 0; i < 3; i++){
+        gradient(i) -= derivateFi(c1[i]-x(i),s) + derivateFi(c2[i]-x(i),s) + derivateFi(c3[i]-x(i),s);
+        gradient(i+3) += derivateFi(x(i+3)-c1[i],s) + derivateFi(x(i+3)-c2[i],s) + derivateFi(x(i+3)-c3[i],s);
+    }
+    return lowConstraint(min, c1, s) + lowConstraint(min, c2, s) + lowConstraint(min, c3, s) + highConstraint(max, c1, s) + highConstraint(max, c2, s) + highConstraint(max, c3, s);
+}
+
+/**
+ * @brief Energy::barrierLimitsEnergyAndGradient
+ *
+ * Same value of barrierLimitsEnergy; the gradient of the barrier (see gradientBarrierLimits) is added to gradient.
+ */
+double Energy::barrierLimitsEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const Pointd& l, double s) const {
+    for (unsigned int i = 0; i < 3; i++){
+        double d = derivateFi(l[i]-x(i+3)+x(i),s);
+        gradient(i) += d;
+        gradient(i+3) -= d;
+    }
+    return lowConstraint(Pointd(x(3)-x(0), x(4)-x(1), x(5)-x(2)), l, s);
+}
+
 void Energy::gradientEnergyFiniteDifference(Eigen::VectorXd& gradient, const Box3D b) const {
     Eigen::VectorXd x(6);
     x << b.getMin().x(), b.getMin().y(), b.getMin().z(), b.getMax().x(), b.getMax().y(), b.getMax().z();
@@ -1267,84 +824,188 @@ double Energy::integralTricubicInterpolation(const gridreal*& a, double u1, doub
     return C_result;
 }
 
+/**
+ * @brief Energy::integralTricubicInterpolationSeparable
+ *
+ * Same integral of integralTricubicInterpolation, computed exploiting the tensor-product
+ * structure of the tricubic: a[i + 4j + 16k] multiplies u^i v^j w^k, hence the integral
+ * is the contraction of the coefficients with the 1D moments of [u1,u2], [v1,v2] and [w1,w2].
+ * Both the coefficients and the sub-box must be in the interval 0-1.
+ */
+double Energy::integralTricubicInterpolationSeparable(const gridreal*& a, double u1, double v1, double w1, double u2, double v2, double w2) {
+    double mu[4], mv[4], mw[4];
+    integralMoments(mu, u1, u2);
+    integralMoments(mv, v1, v2);
+    integralMoments(mw, w1, w2);
+    return TricubicInterpolator::getSeparableValue(a, mu, mv, mw);
+}
+
 double Energy::integralTricubicInterpolationEnergy(const Pointd& bmin, const Pointd& bmax) const {
-    Eigen::VectorXd x(6);
+    Vector6d x;
     x << bmin.x(), bmin.y(), bmin.z(), bmax.x(), bmax.y(), bmax.z();
     return integralTricubicInterpolationEnergy(x);
 
 }
 
-double Energy::integralTricubicInterpolationEnergy(const Eigen::VectorXd& x) const {
-    //g->deleteCubes();
+/**
+ * @brief Energy::integralTricubicInterpolationEnergy
+ *
+ * The cells completely contained in the box are summed with a single query on the
+ * summed volume table of the grid; only the shell of partially contained cells is
+ * explicitly integrated. Cost grows with the surface of the box, not with its volume.
+ * With the separable integral the moments of a row of cells are computed once.
+ */
+double Energy::integralTricubicInterpolationEnergy(const Vector6d& x) const {
     double unit = g->getUnit();
+    Pointd o = g->getBoundingBox().getMin();
+    bool separable = isSeparableIntegral();
+    double mx[4], my[4], mz[4];
+
+    //lo-hi: cells intersected by the box, flo-fhi: cells completely contained
+    int lo[3], hi[3], flo[3], fhi[3];
+    for (unsigned int c = 0; c < 3; c++){
+        double a = (x(c) - o[c]) / unit, b = (x(c+3) - o[c]) / unit;
+        lo[c] = std::floor(a);
+        hi[c] = std::ceil(b) - 1;
+        flo[c] = std::ceil(a);
+        fhi[c] = std::floor(b) - 1;
+    }
 
-    Pointd min, max;
-    initializeMinMax(min, max, x);
+    double minbx = x(0), minby = x(1), minbz = x(2);
+    double maxbx = x(3), maxby = x(4), maxbz = x(5);
+
+    double energy = g->getFullBoxesValue(flo[0], flo[1], flo[2], fhi[0], fhi[1], fhi[2]);
+
+    for (int i = lo[0]; i <= hi[0]; i++){
+        double x1 = o.x() + i*unit, x2 = x1 + unit;
+        bool fullX = i >= flo[0] && i <= fhi[0];
+        double u1 = minbx < x1 ? x1 : minbx;
+        double u2 = maxbx > x2 ? x2 : maxbx;
+        u1 = (u1-x1)/unit;
+        u2 = (u2-x1)/unit;
+        if (separable)
+            integralMoments(mx, u1, u2);
+        for (int j = lo[1]; j <= hi[1]; j++){
+            double y1 = o.y() + j*unit, y2 = y1 + unit;
+            bool fullXY = fullX && j >= flo[1] && j <= fhi[1];
+            double v1 = minby < y1 ? y1 : minby;
+            double v2 = maxby > y2 ? y2 : maxby;
+            v1 = (v1-y1)/unit;
+            v2 = (v2-y1)/unit;
+            if (separable)
+                integralMoments(my, v1, v2);
+            for (int k = lo[2]; k <= hi[2]; k++){
+                if (fullXY && k >= flo[2] && k <= fhi[2]){ //completely contained, already summed
+                    k = fhi[2];
+                    continue;
+                }
+                double z1 = o.z() + k*unit, z2 = z1 + unit;
+                double w1 = minbz < z1 ? z1 : minbz;
+                double w2 = maxbz > z2 ? z2 : maxbz;
+                w1 = (w1-z1)/unit;
+                w2 = (w2-z1)/unit;
+                const gridreal* coeffs;
+                g->getCellCoefficients(coeffs, i, j, k);
+                if (separable){
+                    integralMoments(mz, w1, w2);
+                    energy += TricubicInterpolator::getSeparableValue(coeffs, mx, my, mz);
+                }
+                else
+                    energy += integral(coeffs, u1,v1,w1,u2,v2,w2);
+            }
+        }
+    }
 
-    /*
-    const Pointd &c = bb.getMin();
-    Pointd d = c-Pointd(x(0), x(1), x(2));
-    Pointd nu = d / g->getUnit();
-    Pointi ni = Pointi(nu.x(), nu.y(), nu.z());
-    Pointi di = ni * g->getUnit();
-    Pointd min = c - Pointd(di.x(), di.y(), di.z());
-    d = c-Pointd(x(3), x(4), x(5));
-    nu = d / g->getUnit();
-    ni = Pointi(nu.x(), nu.y(), nu.z());
-    di = ni * g->getUnit();
-    Pointd max = c - Pointd(di.x(), di.y(), di.z());*/
+    return volumeScale*energy;
+}
 
+/**
+ * @brief Energy::integralTricubicInterpolationEnergyAndGradient
+ *
+ * Fused computation of integralTricubicInterpolationEnergy and gradientTricubicInterpolationEnergy:
+ * the shell of partially contained cells is visited only once, and the coefficients of every
+ * cell are used both for the volume integral and for the integrals on the faces of the box
+ * that cross the cell. Completely covered cells and faces are taken from the summed tables of the grid.
+ */
+double Energy::integralTricubicInterpolationEnergyAndGradient(Vector6d& gradient, const Vector6d& x) const {
+    double unit = g->getUnit();
+    Pointd o = g->getBoundingBox().getMin();
+    bool separable = isSeparableIntegral();
+
+    //lo-hi: cells intersected by the box, flo-fhi: cells completely contained
+    //pmin-pmax: powers of the coordinates of the faces in the cells lo and hi
+    int lo[3], hi[3], flo[3], fhi[3];
+    double pmin[3][4], pmax[3][4];
+    for (unsigned int c = 0; c < 3; c++){
+        double a = (x(c) - o[c]) / unit, b = (x(c+3) - o[c]) / unit;
+        lo[c] = std::floor(a);
+        hi[c] = std::ceil(b) - 1;
+        flo[c] = std::ceil(a);
+        fhi[c] = std::floor(b) - 1;
+        double u1 = a - lo[c], u2 = b - hi[c];
+        pmin[c][0] = 1; pmin[c][1] = u1; pmin[c][2] = u1*u1; pmin[c][3] = u1*u1*u1;
+        pmax[c][0] = 1; pmax[c][1] = u2; pmax[c][2] = u2*u2; pmax[c][3] = u2*u2*u2;
+    }
 
-    double firstX = min.x()-unit, firstY = min.y()-unit, firstZ = min.z()-unit, lastX = max.x()+unit, lastY = max.y()+unit, lastZ = max.z()+unit;
+    double energy = g->getFullBoxesValue(flo[0], flo[1], flo[2], fhi[0], fhi[1], fhi[2]);
+
+    //completely covered cells of the faces
+    for (unsigned int c = 0; c < 3; c++){
+        gradient(c) = gradient(c+3) = 0;
+        if (lo[c] > hi[c]) continue;
+        unsigned int p = c == 0 ? 1 : 0, q = c == 2 ? 1 : 2;
+        double f[4];
+        g->getFullFacesValue(f, c, lo[c], flo[p], flo[q], fhi[p], fhi[q]);
+        gradient(c) -= pmin[c][0]*f[0] + pmin[c][1]*f[1] + pmin[c][2]*f[2] + pmin[c][3]*f[3];
+        g->getFullFacesValue(f, c, hi[c], flo[p], flo[q], fhi[p], fhi[q]);
+        gradient(c+3) += pmax[c][0]*f[0] + pmax[c][1]*f[1] + pmax[c][2]*f[2] + pmax[c][3]*f[3];
+    }
 
-    double minbx = x(0), minby = x(1), minbz = x(2);
-    double maxbx = x(3), maxby = x(4), maxbz = x(5);
-    double energy = 0;
-
-    double x1, y1, z1;
-    for (x1 = firstX; x1 <= lastX; x1+=unit){
-        double x2 = x1 + unit;
-        for (y1 = firstY; y1 <= lastY; y1+=unit){
-            double y2 = y1 + unit;
-            for (z1 = firstZ; z1<=lastZ; z1+=unit){
-                double z2 = z1 + unit;
-
-                if (maxbx <= x1 || minbx >= x2 ||
-                    maxby <= y1 || minby >= y2 ||
-                    maxbz <= z1 || minbz >= z2 ) // not contained
-                    energy += 0;
-                else {
-                    const gridreal* coeffs;
-                    //g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-                    if (minbx <= x1 && maxbx >= x2 &&
-                        minby <= y1 && maxby >= y2 &&
-                        minbz <= z1 && maxbz >= z2 ) { // completly contained
-                        energy += g->getFullBoxValue(Pointd(x1,y1,z1));
-                        //energy += integralTricubicInterpolation(coeffs, 0,0,0,1,1,1);
-                        //g->addCube(BoundingBox(Pointd(x1,y1,z1), Pointd(x2,y2,z2)));
+    double mx[4], my[4], mz[4];
+    const double* m[3] = {mx, my, mz};
+    for (int i = lo[0]; i <= hi[0]; i++){
+        double x1 = o.x() + i*unit;
+        bool fullX = i >= flo[0] && i <= fhi[0];
+        double u1 = (std::max(x(0), x1)-x1)/unit, u2 = (std::min(x(3), x1+unit)-x1)/unit;
+        integralMoments(mx, u1, u2);
+        for (int j = lo[1]; j <= hi[1]; j++){
+            double y1 = o.y() + j*unit;
+            bool fullY = j >= flo[1] && j <= fhi[1];
+            double v1 = (std::max(x(1), y1)-y1)/unit, v2 = (std::min(x(4), y1+unit)-y1)/unit;
+            integralMoments(my, v1, v2);
+            for (int k = lo[2]; k <= hi[2]; k++){
+                bool fullZ = k >= flo[2] && k <= fhi[2];
+                if (fullX && fullY && fullZ){ //completely contained, already summed
+                    k = fhi[2];
+                    continue;
+                }
+                double z1 = o.z() + k*unit;
+                double w1 = (std::max(x(2), z1)-z1)/unit, w2 = (std::min(x(5), z1+unit)-z1)/unit;
+                integralMoments(mz, w1, w2);
+                const gridreal* coeffs;
+                g->getCellCoefficients(coeffs, i, j, k);
+                energy += separable ? TricubicInterpolator::getSeparableValue(coeffs, mx, my, mz) : integral(coeffs, u1,v1,w1,u2,v2,w2);
+
+                //faces of the box crossing the cell, not already summed
+                int id[3] = {i, j, k};
+                bool ring[3] = {!(fullY && fullZ), !(fullX && fullZ), !(fullX && fullY)};
+                for (unsigned int c = 0; c < 3; c++){
+                    if (!ring[c]) continue;
+                    const double* tmp = m[c];
+                    if (id[c] == lo[c]){
+                        m[c] = pmin[c];
+                        gradient(c) -= TricubicInterpolator::getSeparableValue(coeffs, m[0], m[1], m[2]);
                     }
-                    else { //partially contained
-                        g->getCoefficients(coeffs, Pointd(x1,y1,z1));
-                        double u1 = minbx < x1 ? x1 : minbx;
-                        double v1 = minby < y1 ? y1 : minby;
-                        double w1 = minbz < z1 ? z1 : minbz;
-                        double u2 = maxbx > x2 ? x2 : maxbx;
-                        double v2 = maxby > y2 ? y2 : maxby;
-                        double w2 = maxbz > z2 ? z2 : maxbz;
-                        //g->addCube(BoundingBox(Pointd(u1,v1,w1), Pointd(u2,v2,w2)));
-                        u1 = (u1-x1)/unit;
-                        u2 = (u2-x1)/unit;
-                        v1 = (v1-y1)/unit;
-                        v2 = (v2-y1)/unit;
-                        w1 = (w1-z1)/unit;
-                        w2 = (w2-z1)/unit;
-                        energy += integralTricubicInterpolation(coeffs, u1,v1,w1,u2,v2,w2);
+                    if (id[c] == hi[c]){
+                        m[c] = pmax[c];
+                        gradient(c+3) += TricubicInterpolator::getSeparableValue(coeffs, m[0], m[1], m[2]);
                     }
+                    m[c] = tmp;
                 }
-
             }
         }
     }
 
-    return energy;
+    gradient *= faceScale;
+    return volumeScale*energy;
 }
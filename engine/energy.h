@@ -2,18 +2,28 @@
 #define ENERGY_H
 
 #include "lib/grid/drawablegrid.h"
+#include "lib/grid/gridfamily.h"
+#include "lib/grid/gridpyramid.h"
 #include "boxlist.h"
+#include "basintable.h"
 
 #define EPSILON_GRAD 1e-8
 #define S_BARRIER 0.2
 
 class Energy{
     public:
+        typedef double (*IntegralFunction)(const gridreal*&, double, double, double, double, double, double);
+        typedef Eigen::Matrix<double, 6, 1> Vector6d;
+        typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+
         Energy();
         Energy(const Grid& g);
+        Energy(const GridPyramid& p, unsigned int level);
 
         bool isInside(const Eigen::VectorXd &x) const;
         void calculateFullBoxValues(Grid& g) const;
+        void calculateFullBoxValues(GridFamily& f) const;
+        void calculateFullBoxValues(GridPyramid& p) const;
 
         // Gradient Discend
 
@@ -28,6 +38,13 @@ class Energy{
         int BFGS(Box3D &b, const cg3::Pointd &limits) const;
         int BFGS(Box3D &b, BoxList& iterations, bool saveIt = true) const;
         int BFGS(Box3D &b, const cg3::Pointd& limits, BoxList& iterations, bool saveIt = true) const;
+        int BFGS(Box3D &b, BasinTable& basins) const;
+        int BFGS(Box3D &b, const cg3::Pointd& limits, BasinTable& basins) const;
+
+        int LBFGSB(Box3D &b) const;
+        int LBFGSB(Box3D &b, const cg3::Pointd &limits) const;
+        int LBFGSB(Box3D &b, BoxList& iterations, bool saveIt = true) const;
+        int LBFGSB(Box3D &b, const cg3::Pointd& limits, BoxList& iterations, bool saveIt = true) const;
 
         //Gradient Barrier
         double derivateGBarrier(double x, double s) const;
@@ -38,13 +55,6 @@ class Energy{
         void gradientBarrierLimits(Eigen::VectorXd& gBarrier, const cg3::BoundingBox& b, const cg3::Pointd& l, double s = S_BARRIER) const;
 
         // Gradient
-        static double gradientXMinComponent(const gridreal*& a, double u1, double v1, double w1, double v2, double w2);
-        static double gradientYMinComponent(const gridreal* &a, double u1, double v1, double w1, double u2, double w2);
-        static double gradientZMinComponent(const gridreal*& a, double u1, double v1, double w1, double u2, double v2);
-        static double gradientXMaxComponent(const gridreal* &a, double v1, double w1, double u2, double v2, double w2);
-        static double gradientYMaxComponent(const gridreal*& a, double u1, double w1, double u2, double v2, double w2);
-        static double gradientZMaxComponent(const gridreal* &a, double u1, double v1, double u2, double v2, double w2);
-
         double gradientEvaluateXMinComponent(const Eigen::VectorXd& x) const;
         double gradientEvaluateYMinComponent(const Eigen::VectorXd& x) const;
         double gradientEvaluateZMinComponent(const Eigen::VectorXd &x) const;
@@ -70,8 +80,13 @@ class Energy{
 
         // Integral
         static double integralTricubicInterpolation(const gridreal*& a, double u1, double v1, double w1, double u2, double v2, double w2);
+        static double integralTricubicInterpolationSeparable(const gridreal*& a, double u1, double v1, double w1, double u2, double v2, double w2);
+        void setSeparableIntegral(bool b);
+        bool isSeparableIntegral() const;
+        IntegralFunction getIntegral() const;
         double integralTricubicInterpolationEnergy(const cg3::Pointd& min, const cg3::Pointd& max) const;
-        double integralTricubicInterpolationEnergy(const Eigen::VectorXd &x) const;
+        double integralTricubicInterpolationEnergy(const Vector6d &x) const;
+        double integralTricubicInterpolationEnergyAndGradient(Vector6d &gradient, const Vector6d &x) const;
 
         // Total Energy
         double energy(const Box3D& b) const;
@@ -80,12 +95,31 @@ class Energy{
         double energy(const Box3D& b, const cg3::Pointd &limits) const;
         double energy(const Eigen::VectorXd& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3, const cg3::Pointd &limits) const;
         double energy(double minx, double miny, double minz, double maxx, double maxy, double maxz, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3, const cg3::Pointd &limits) const;
+        double energyAndGradient(Vector6d &gradient, const Vector6d& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3) const;
+        double energyAndGradient(Vector6d &gradient, const Vector6d& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3, const cg3::Pointd &limits) const;
+        double energyValue(const Vector6d& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3) const;
+        double energyValue(const Vector6d& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3, const cg3::Pointd &limits) const;
 
     private:
         void initializeMinMax(cg3::Pointd& min, cg3::Pointd& max, const Eigen::VectorXd &x) const;
+        double faceIntegral(const Eigen::VectorXd &x, unsigned int axis, bool maxFace) const;
         double volumeOfBox(const Eigen::VectorXd &x) const;
+        double barrierEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3, double s = S_BARRIER) const;
+        double barrierLimitsEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const cg3::Pointd& l, double s = S_BARRIER) const;
+        template <bool LIMITS>
+        int BFGSCore(Box3D& b, const cg3::Pointd& limits, BoxList* iterations, BasinTable* basins) const;
+        static bool containsConstraints(const cg3::Pointd& min, const cg3::Pointd& max, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3);
+        template <bool LIMITS>
+        double boxConstrainedEnergyAndGradient(Vector6d& gradient, const Vector6d& x, const cg3::Pointd& limits) const;
+        template <bool LIMITS>
+        double lineSearch(const Vector6d& x, const Vector6d& direction, double alfa, double alfaMax, double value, double derivative, const cg3::Pointd& limits, Vector6d& newX, double& newValue, Vector6d& newGradient) const;
+        template <bool LIMITS>
+        int LBFGSBCore(Box3D& b, const cg3::Pointd& limits, BoxList* iterations) const;
+        static void integralMoments(double m[4], double t1, double t2);
 
         const Grid* g;
+        IntegralFunction integral;
+        double volumeScale, faceScale; //of the integrals on g (see GridPyramid::getVolumeScale)
 
 };
 
@@ -98,14 +132,28 @@ inline int Energy::gradientDiscend(Box3D& b) const {
     return gradientDiscend(b, dummy, false);
 }
 
-inline int Energy::BFGS(Box3D& b) const {
-    BoxList dummy;
-    return BFGS(b, dummy, false);
+inline double Energy::gradientEvaluateXMinComponent(const Eigen::VectorXd& x) const {
+    return -faceIntegral(x, 0, false);
 }
 
-inline int Energy::BFGS(Box3D& b, const cg3::Pointd& limits) const {
-    BoxList dummy;
-    return BFGS(b, limits, dummy, false);
+inline double Energy::gradientEvaluateYMinComponent(const Eigen::VectorXd& x) const {
+    return -faceIntegral(x, 1, false);
+}
+
+inline double Energy::gradientEvaluateZMinComponent(const Eigen::VectorXd& x) const {
+    return -faceIntegral(x, 2, false);
+}
+
+inline double Energy::gradientEvaluateXMaxComponent(const Eigen::VectorXd& x) const {
+    return faceIntegral(x, 0, true);
+}
+
+inline double Energy::gradientEvaluateYMaxComponent(const Eigen::VectorXd& x) const {
+    return faceIntegral(x, 1, true);
+}
+
+inline double Energy::gradientEvaluateZMaxComponent(const Eigen::VectorXd& x) const {
+    return faceIntegral(x, 2, true);
 }
 
 inline void Energy::gradientTricubicInterpolationEnergy(Eigen::VectorXd& gradient, const cg3::Pointd& min, const cg3::Pointd& max) const {
@@ -129,6 +177,18 @@ inline void Energy::gradientTricubicInterpolationEnergy(Eigen::VectorXd& gradien
     gradient(5) = gradientEvaluateZMaxComponent(x);
 }
 
+inline void Energy::setSeparableIntegral(bool b) {
+    integral = b ? integralTricubicInterpolationSeparable : integralTricubicInterpolation;
+}
+
+inline bool Energy::isSeparableIntegral() const {
+    return integral == integralTricubicInterpolationSeparable;
+}
+
+inline Energy::IntegralFunction Energy::getIntegral() const {
+    return integral;
+}
+
 inline double Energy::derivateGBarrier(double x, double s) const {
     return (3/(s*s*s))*(x*x) - (6/(s*s))*x + 3/s;
 }
@@ -234,4 +294,33 @@ inline double Energy::volumeOfBox(const Eigen::VectorXd& x) const {
 
 }
 
+/**
+ * @brief Energy::containsConstraints
+ *
+ * True if c1, c2 and c3 are strictly inside the box min-max.
+ */
+inline bool Energy::containsConstraints(const cg3::Pointd& min, const cg3::Pointd& max, const cg3::Pointd& c1, const cg3::Pointd& c2, const cg3::Pointd& c3) {
+    for (unsigned int i = 0; i < 3; i++){
+        if (c1[i] <= min[i] || c2[i] <= min[i] || c3[i] <= min[i] || c1[i] >= max[i] || c2[i] >= max[i] || c3[i] >= max[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Energy::integralMoments
+ *
+ * m[i] = integral of t^i in [t1, t2], for i = 0..3
+ */
+inline void Energy::integralMoments(double m[4], double t1, double t2) {
+    double p1 = t1, p2 = t2;
+    m[0] = p2 - p1;
+    p1 *= t1; p2 *= t2;
+    m[1] = (p2 - p1) / 2;
+    p1 *= t1; p2 *= t2;
+    m[2] = (p2 - p1) / 3;
+    p1 *= t1; p2 *= t2;
+    m[3] = (p2 - p1) / 4;
+}
+
 #endif // ENERGY_H
@@ -19,7 +19,11 @@
 #include <CGAL/property_map.h>
 
 #include "splitting.h"
+#include "setcover.h"
+#include "setcoverpresolve.h"
+#include "boxindex.h"
 #include "reconstruction.h"
+#include "lib/grid/distancefield.h"
 #include <cg3/algorithms/global_optimal_rotation_matrix.h>
 
 using namespace cg3;
@@ -144,7 +148,13 @@ void Engine::getFlippedFaces(std::set<const Dcel::Face*> &flippedFaces, std::set
     }
 }
 
-void Engine::generateGridAndDistanceField(Array3D<Pointd> &grid, Array3D<gridreal> &distanceField, const SimpleEigenMesh &m, bool generateDistanceField, double gridUnit, bool integer){
+/**
+ * @brief getGridBox
+ *
+ * Minimum (as integer coordinates, the ones of the first point of the grid) and number of points
+ * on every axis of the grid of m, with a border of 5 units around the bounding box of m.
+ */
+static void getGridBox(Eigen::RowVector3d& nGmin, unsigned int size[3], const SimpleEigenMesh& m, double& gridUnit, bool integer) {
     assert(gridUnit > 0);
     // Bounding Box
     Eigen::RowVector3d Vmin, Vmax;
@@ -152,7 +162,6 @@ void Engine::generateGridAndDistanceField(Array3D<Pointd> &grid, Array3D<gridrea
 
     // create grid GV
     Eigen::RowVector3d border((int)gridUnit*5, (int)gridUnit*5, (int)gridUnit*5);
-    Eigen::RowVector3d nGmin;
     Eigen::RowVector3d nGmax;
     if (integer) {
         Eigen::RowVector3i Gmini = (Vmin).cast<int>() - border.cast<int>();
@@ -167,20 +176,90 @@ void Engine::generateGridAndDistanceField(Array3D<Pointd> &grid, Array3D<gridrea
         nGmax = Vmax + border; //bounding box of the Grid
     }
     Eigen::RowVector3i res = (nGmax.cast<int>() - nGmin.cast<int>())/2;
-    unsigned int sizeX = res(0)+1, sizeY = res(1)+1, sizeZ = res(2)+1;
+    size[0] = res(0)+1; size[1] = res(1)+1; size[2] = res(2)+1;
+}
+
+/**
+ * @brief calculateDistanceField
+ *
+ * Signed distance field of m on the sizeX x sizeY x sizeZ points of a grid with distance gridUnit
+ * between two points, where point(i,j,k) gives the coordinates of the point (i,j,k).
+ */
+template <class F>
+static void calculateDistanceField(Array3D<gridreal>& distanceField, const SimpleEigenMesh& m, double gridUnit, unsigned int sizeX, unsigned int sizeY, unsigned int sizeZ, F point) {
+    distanceField.resize(sizeX, sizeY, sizeZ);
+    distanceField.fill(1);
+    #ifndef AABB_DISTANCE_FIELD
+    DistanceField::signedDistanceField(distanceField, m, point(0,0,0), gridUnit, sizeX, sizeY, sizeZ);
+    //only the inside distances are used: outside points keep value 1
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < sizeX; i++){
+        for (unsigned int j = 0; j < sizeY; j++){
+            for (unsigned int k = 0; k < sizeZ; k++){
+                if (distanceField(i,j,k) >= 0)
+                    distanceField(i,j,k) = 1;
+            }
+        }
+    }
+    #else
     std::vector<double> distances;
     Array3D<int> mapping(sizeX, sizeY, sizeZ, -1);
     std::vector<Pointd> insidePoints;
     int inside = 0;
-
-    grid.resize(sizeX, sizeY, sizeZ);
-    if (generateDistanceField){
-        distanceField.resize(sizeX, sizeY, sizeZ);
-        distanceField.fill(1);
-    }
     cgal::AABBTree tree(m, true);
     Array3D<unsigned char> isInside(sizeX, sizeY, sizeZ);
     isInside.fill(false);
+    unsigned int rr =  sizeX * sizeY * sizeZ;
+    #pragma omp parallel for
+    for (unsigned int n = 0; n < rr; n++){
+        unsigned int k = (n % (sizeY*sizeZ))%sizeZ;
+        unsigned int j = ((n-k)/sizeZ)%sizeY;
+        unsigned int i = ((n-k)/sizeZ - j)/sizeY;
+        ///
+        isInside(i,j,k) = tree.isInside(point(i,j,k), 3);
+        //isInside(i,j,k) = tree.isInsidePseudoRandom(point(i,j,k), 3);
+        ///
+    }
+
+    for (unsigned int i = 0; i < sizeX; i++){
+        for (unsigned int j = 0; j < sizeY; j++){
+            for (unsigned int k = 0; k < sizeZ; k++){
+                if (isInside(i,j,k)){
+                    insidePoints.push_back(point(i,j,k));
+                    mapping(i,j,k) = inside;
+                    inside++;
+                }
+            }
+        }
+    }
+
+
+    // compute values
+    //Eigen::VectorXd S = m.getSignedDistance(GV);
+
+
+
+    distances = cgal::getUnsignedDistances(insidePoints, tree);
+
+    for (unsigned int i = 0; i < sizeX; i++){
+        for (unsigned int j = 0; j < sizeY; j++){
+            for (unsigned int k = 0; k < sizeZ; k++){
+                if (isInside(i,j,k)){
+                    assert(mapping(i,j,k) >= 0);
+                    distanceField(i,j,k) = -distances[mapping(i,j,k)];
+                }
+            }
+        }
+    }
+    #endif
+}
+
+void Engine::generateGridAndDistanceField(Array3D<Pointd> &grid, Array3D<gridreal> &distanceField, const SimpleEigenMesh &m, bool generateDistanceField, double gridUnit, bool integer){
+    Eigen::RowVector3d nGmin;
+    unsigned int size[3];
+    getGridBox(nGmin, size, m, gridUnit, integer);
+    unsigned int sizeX = size[0], sizeY = size[1], sizeZ = size[2];
+    grid.resize(sizeX, sizeY, sizeZ);
 
     int xi = nGmin(0), yi = nGmin(1), zi = nGmin(2);
     for (unsigned int i = 0; i < sizeX; ++i){
@@ -196,51 +275,26 @@ void Engine::generateGridAndDistanceField(Array3D<Pointd> &grid, Array3D<gridrea
         xi += gridUnit;
     }
 
-    if (generateDistanceField){
-        unsigned int rr =  sizeX * sizeY * sizeZ;
-
-        #pragma omp parallel for
-        for (unsigned int n = 0; n < rr; n++){
-            unsigned int k = (n % (sizeY*sizeZ))%sizeZ;
-            unsigned int j = ((n-k)/sizeZ)%sizeY;
-            unsigned int i = ((n-k)/sizeZ - j)/sizeY;
-            ///
-            isInside(i,j,k) = tree.isInside(grid(i,j,k), 3);
-            //isInside(i,j,k) = tree.isInsidePseudoRandom(grid(i,j,k), 3);
-            ///
-        }
-
-        for (unsigned int i = 0; i < sizeX; i++){
-            for (unsigned int j = 0; j < sizeY; j++){
-                for (unsigned int k = 0; k < sizeZ; k++){
-                    if (isInside(i,j,k)){
-                        insidePoints.push_back(grid(i,j,k));
-                        mapping(i,j,k) = inside;
-                        inside++;
-                    }
-                }
-            }
-        }
-
-
-        // compute values
-        //Eigen::VectorXd S = m.getSignedDistance(GV);
-
-
-
-        distances = cgal::getUnsignedDistances(insidePoints, tree);
+    if (generateDistanceField)
+        calculateDistanceField(distanceField, m, gridUnit, sizeX, sizeY, sizeZ, [&grid](unsigned int i, unsigned int j, unsigned int k){ return grid(i,j,k); });
+}
 
-        for (unsigned int i = 0; i < sizeX; i++){
-            for (unsigned int j = 0; j < sizeY; j++){
-                for (unsigned int k = 0; k < sizeZ; k++){
-                    if (isInside(i,j,k)){
-                        assert(mapping(i,j,k) >= 0);
-                        distanceField(i,j,k) = -distances[mapping(i,j,k)];
-                    }
-                }
-            }
-        }
-    }
+/**
+ * @brief Engine::generateDistanceField
+ *
+ * Same distance field of generateGridAndDistanceField (with integer coordinates), without the array of
+ * the coordinates of the points: gMin is the first point of the grid and unit the distance between
+ * two points, the point (i,j,k) is gMin + (i,j,k)*unit.
+ */
+void Engine::generateDistanceField(Array3D<gridreal>& distanceField, Pointd& gMin, double& unit, const SimpleEigenMesh& m, double gridUnit, bool integer) {
+    Eigen::RowVector3d nGmin;
+    unsigned int size[3];
+    getGridBox(nGmin, size, m, gridUnit, integer);
+    gMin = Pointd((int)nGmin(0), (int)nGmin(1), (int)nGmin(2));
+    unit = gridUnit;
+    calculateDistanceField(distanceField, m, gridUnit, size[0], size[1], size[2], [&gMin, unit](unsigned int i, unsigned int j, unsigned int k){
+        return Pointd(gMin.x() + i*unit, gMin.y() + j*unit, gMin.z() + k*unit);
+    });
 }
 
 void Engine::calculateGridWeights(Grid& g, const Array3D<Pointd> &grid, const Array3D<gridreal> &distanceField, const Dcel& d, double kernelDistance, bool tolerance, const Vec3 &target, std::set<const Dcel::Face*>& savedFaces){
@@ -254,6 +308,27 @@ void Engine::calculateGridWeights(Grid& g, const Array3D<Pointd> &grid, const Ar
     e.calculateFullBoxValues(g);
 }
 
+/**
+ * @brief Engine::calculateGridWeights
+ *
+ * Weights and coefficients of the grids of all the targets, sharing the data common to all of them.
+ */
+void Engine::calculateGridWeights(GridFamily& f, const Array3D<Pointd>& grid, const Array3D<gridreal>& distanceField, const Dcel& d, double kernelDistance, bool tolerance, const std::vector<Vec3>& targets, const std::vector<std::set<const Dcel::Face*> >& savedFaces) {
+    calculateGridWeights(f, grid(0,0,0), grid(1,0,0).x() - grid(0,0,0).x(), distanceField, d, kernelDistance, tolerance, targets, savedFaces);
+}
+
+/**
+ * @brief Engine::calculateGridWeights
+ *
+ * Same of the previous one, on the grid from gMin with distance unit between two points (see generateDistanceField).
+ */
+void Engine::calculateGridWeights(GridFamily& f, const Pointd& gMin, double unit, const Array3D<gridreal>& distanceField, const Dcel& d, double kernelDistance, bool tolerance, const std::vector<Vec3>& targets, const std::vector<std::set<const Dcel::Face*> >& savedFaces) {
+    f = GridFamily(gMin, unit, distanceField);
+    f.calculateWeightsAndFreezeKernel(d, kernelDistance, tolerance, targets, savedFaces);
+    Energy e;
+    e.calculateFullBoxValues(f);
+}
+
 Array3D<gridreal> Engine::generateGrid(Grid& g, const Dcel& d, double kernelDistance, bool tolerance, const Vec3 &target, std::set<const Dcel::Face*>& savedFaces) {
     SimpleEigenMesh m(d);
     Array3D<Pointd> grid;
@@ -356,12 +431,114 @@ void Engine::calculateInitialBoxes(BoxList& boxList, const Dcel& d, const Eigen:
     }
 }
 
-void Engine::expandBoxes(BoxList& boxList, const Grid& g, bool limit, const Pointd& limits, bool printTimes) {
-    Energy e(g);
+static bool boundConstrainedBoxGrowth = false;
+static bool warmStartedBoxGrowth = false;
+static bool basinDetection = false;
+static bool multiresolutionBoxGrowth = false;
+static bool gurobiSetCover = false;
+
+/**
+ * @brief Engine::setBoundConstrainedBoxGrowth
+ *
+ * If true, expandBoxes grows the boxes with the projected L-BFGS-B of Energy, where the seed
+ * triangle and the grid are bound constraints, instead of the BFGS with barriers.
+ */
+void Engine::setBoundConstrainedBoxGrowth(bool b) {
+    boundConstrainedBoxGrowth = b;
+}
+
+bool Engine::isBoundConstrainedBoxGrowth() {
+    return boundConstrainedBoxGrowth;
+}
+
+/**
+ * @brief Engine::setWarmStartedBoxGrowth
+ *
+ * If true, optimize initializes the seed boxes of every decimation round with the boxes
+ * already converged in the previous rounds (see warmStartBoxes).
+ */
+void Engine::setWarmStartedBoxGrowth(bool b) {
+    warmStartedBoxGrowth = b;
+}
+
+bool Engine::isWarmStartedBoxGrowth() {
+    return warmStartedBoxGrowth;
+}
+
+/**
+ * @brief Engine::setBasinDetection
+ *
+ * If true, the BFGS runs of expandBoxes share a BasinTable and stop early when they land on
+ * a box already produced by another run. Used only by the scalar BFGS path.
+ */
+void Engine::setBasinDetection(bool b) {
+    basinDetection = b;
+}
+
+bool Engine::isBasinDetection() {
+    return basinDetection;
+}
+
+/**
+ * @brief Engine::setMultiresolutionBoxGrowth
+ *
+ * If true, optimize grows the boxes coarse to fine on a GridPyramid of GRID_PYRAMID_LEVELS levels
+ * of every grid, instead of on the grid only.
+ */
+void Engine::setMultiresolutionBoxGrowth(bool b) {
+    multiresolutionBoxGrowth = b;
+}
+
+bool Engine::isMultiresolutionBoxGrowth() {
+    return multiresolutionBoxGrowth;
+}
+
+/**
+ * @brief Engine::setGurobiSetCover
+ *
+ * If true (and Gurobi is available), minimalCovering and secondMinimalCovering solve the set cover
+ * with Gurobi instead of the built-in SetCover solver.
+ */
+void Engine::setGurobiSetCover(bool b) {
+    gurobiSetCover = b;
+}
+
+bool Engine::isGurobiSetCover() {
+    return gurobiSetCover;
+}
+
+/**
+ * @brief getBoxLimits
+ *
+ * Limits on the size of the box b: limits.z() on the axis of the target, limits.x() on the others.
+ */
+static Pointd getBoxLimits(const Box3D& b, const Pointd& limits) {
+    Pointd actualLimits(limits.x(), limits.x(), limits.x());
+    bool find = false;
+    for (unsigned int i = 0; i < 3 && !find; i++){
+        if (XYZ[i] == b.getTarget() || XYZ[i+3] == b.getTarget()){
+            actualLimits[i] = limits.z();
+            find = true;
+        }
+    }
+    assert(find);
+    return actualLimits;
+}
+
+/**
+ * @brief expandBoxes
+ *
+ * Expands the boxes of boxList minimizing the energy e, defined on the grid g.
+ */
+static int expandBoxes(BoxList& boxList, const Energy& e, const Grid& g, bool limit, const Pointd& limits, bool printTimes) {
     Timer total("Boxlist expanding");
     int np = boxList.getNumberBoxes();
+    int nIterations = 0;
+    std::unique_ptr<BasinTable> basins;
+    if (basinDetection && !boundConstrainedBoxGrowth)
+        basins.reset(new BasinTable(g.getUnit()));
     Timer t("");
-    #pragma omp parallel for schedule(dynamic, 2)
+    #pragma omp parallel for schedule(dynamic, 2) reduction(+:nIterations)
     for (int i = 0; i < np; i++){
         Box3D b = boxList.getBox(i);
         if (printTimes){
@@ -369,19 +546,23 @@ void Engine::expandBoxes(BoxList& boxList, const Grid& g, bool limit, const Poin
             t = Timer("");
         }
         //e.gradientDiscend(b);
-        if (!limit)
-            e.BFGS(b);
-        else{
-            Pointd actualLimits(limits.x(), limits.x(), limits.x());
-            bool find = false;
-            for (unsigned int i = 0; i < 3 && !find; i++){
-                if (XYZ[i] == b.getTarget() || XYZ[i+3] == b.getTarget()){
-                    actualLimits[i] = limits.z();
-                    find = true;
-                }
-            }
-            assert(find);
-            e.BFGS(b,actualLimits);
+        if (boundConstrainedBoxGrowth){
+            if (!limit)
+                nIterations += e.LBFGSB(b);
+            else
+                nIterations += e.LBFGSB(b, getBoxLimits(b, limits));
+        }
+        else if (basinDetection){
+            if (!limit)
+                nIterations += e.BFGS(b, *basins);
+            else
+                nIterations += e.BFGS(b, getBoxLimits(b, limits), *basins);
+        }
+        else {
+            if (!limit)
+                nIterations += e.BFGS(b);
+            else
+                nIterations += e.BFGS(b, getBoxLimits(b, limits));
         }
         if (printTimes){
             t.stop();
@@ -392,49 +573,119 @@ void Engine::expandBoxes(BoxList& boxList, const Grid& g, bool limit, const Poin
     }
     total.stopAndPrint();
     std::cerr << "Number Boxes: " << np << "\n";
+    if (basins)
+        std::cerr << "Early stops: " << basins->getNumberEarlyStops() << "; Estimated saved evaluations: " << basins->getEstimatedSavedEvaluations() << "\n";
+    return nIterations;
 }
 
-void Engine::createVectorTriples(std::vector< std::tuple<int, Box3D, std::vector<bool> > > &vectorTriples, const BoxList& boxList, const Dcel& d) {
-    cgal::AABBTree t(d);
-
-
-    // creating vector of pairs
+int Engine::expandBoxes(BoxList& boxList, const Grid& g, bool limit, const Pointd& limits, bool printTimes) {
+    return ::expandBoxes(boxList, Energy(g), g, limit, limits, printTimes);
+}
 
-    vectorTriples.reserve(boxList.getNumberBoxes());
-    for (unsigned int i = 0; i < boxList.getNumberBoxes(); ++i){
-        Box3D b = boxList.getBox(i);
-        std::list<const Dcel::Face*> covered;
-        t.getContainedDcelFaces(covered, b);
+/**
+ * @brief Engine::expandBoxes
+ *
+ * Coarse to fine box growth: the boxes are grown on the coarsest level of the pyramid, and on every
+ * finer level starting from the boxes converged on the level above, so that most of the iterations
+ * (the large moves) are done on the cheaper coarse grids.
+ * Returns the number of iterations on the finest level; the iterations of the other levels are printed.
+ */
+int Engine::expandBoxes(BoxList& boxList, const GridPyramid& p, bool limit, const Pointd& limits, bool printTimes) {
+    for (unsigned int l = p.getNumberLevels()-1; l > 0; l--){
+        int nIterations = ::expandBoxes(boxList, Energy(p, l), p.getLevel(l), limit, limits, printTimes);
+        std::cerr << "Level " << l << " (unit " << p.getLevel(l).getUnit() << "): " << nIterations << " iterations\n";
+    }
+    return expandBoxes(boxList, p.getLevel(0), limit, limits, printTimes);
+}
 
-        std::list<const Dcel::Face*>::iterator it = covered.begin();
-        while (it != covered.end()) {
-            const Dcel::Face* f = *it;
-            Pointd p1 = f->getVertex1()->getCoordinate(), p2 = f->getVertex2()->getCoordinate(), p3 = f->getVertex3()->getCoordinate();
+/**
+ * @brief growBoxes
+ *
+ * expandBoxes on g, or on a GridPyramid of g with the multiresolution box growth.
+ * The pyramid is built for the growth of the current target only and released when it ends,
+ * so that at most one set of coarse levels is in memory.
+ */
+static int growBoxes(BoxList& boxList, const Grid& g, bool limit, const Pointd& limits) {
+    if (!multiresolutionBoxGrowth)
+        return Engine::expandBoxes(boxList, g, limit, limits);
+    GridPyramid p(g, GRID_PYRAMID_LEVELS);
+    Energy e;
+    e.calculateFullBoxValues(p);
+    return Engine::expandBoxes(boxList, p, limit, limits);
+}
 
-            if (!b.isIntern(p1) || !b.isIntern(p2) || !b.isIntern(p3)) {
-                it =covered.erase(it);
+/**
+ * @brief Engine::warmStartBoxes
+ *
+ * Initializes the boxes of boxList (seed boxes of a triangle) using the boxes already converged
+ * in the previous rounds for the same target. Among the WARM_START_CANDIDATES converged boxes nearest
+ * to the seed triangle (found with a BoxIndex), the union of the converged box and the seed box with
+ * the lowest energy is taken as starting box, if its energy is lower than the energy of the seed box.
+ * Returns the number of warm started boxes.
+ */
+unsigned int Engine::warmStartBoxes(BoxList& boxList, const BoxList& converged, const Grid& g, bool limit, const Pointd& limits) {
+    if (converged.getNumberBoxes() == 0)
+        return 0;
+    Energy e(g);
+    BoxIndex index(converged);
+    int np = boxList.getNumberBoxes();
+    unsigned int nWarm = 0;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:nWarm)
+    for (int i = 0; i < np; i++){
+        Box3D& b = boxList[i];
+        Pointd barycenter = (b.getConstraint1() + b.getConstraint2() + b.getConstraint3()) / 3;
+        std::vector<int> nearest;
+        index.getNearest(nearest, barycenter, WARM_START_CANDIDATES);
+
+        Pointd actualLimits = limit ? getBoxLimits(b, limits) : Pointd();
+        double best = limit ? e.energy(b, actualLimits) : e.energy(b);
+        bool warm = false;
+        for (int k : nearest){
+            const Box3D& cb = converged.getBox(k);
+            Box3D w = b;
+            w.setMin(cb.getMin().min(b.getMin()));
+            w.setMax(cb.getMax().max(b.getMax()));
+            double value = limit ? e.energy(w, actualLimits) : e.energy(w);
+            if (value < best){
+                best = value;
+                b.setMin(w.getMin());
+                b.setMax(w.getMax());
+                warm = true;
             }
-            else ++it;
         }
+        if (warm)
+            nWarm++;
+    }
+    return nWarm;
+}
 
-        std::vector<bool> v;
-        int n = covered.size();
-        v.resize(d.getNumberFaces(), false);
-        for (std::list<const Dcel::Face*>::iterator it = covered.begin(); it != covered.end(); ++it){
-            const Dcel::Face* f = *it;
-            v[f->getId()] = true;
-        }
-        std::tuple<int, Box3D, std::vector<bool> > triple (n, boxList.getBox(i), v);
+/**
+ * @brief Engine::createVectorTriples
+ *
+ * For every box of boxList, creates a triple with the number of triangles completely contained
+ * by the box, the box and the (sorted) ids of these triangles.
+ */
+void Engine::createVectorTriples(std::vector< std::tuple<int, Box3D, std::vector<unsigned int> > > &vectorTriples, const BoxList& boxList, const Dcel& d) {
+    cgal::AABBTree t(d);
+    CoverageMatrix B(boxList, t, d.getNumberFaces());
+
+    // creating vector of pairs
+
+    vectorTriples.reserve(boxList.getNumberBoxes());
+    for (unsigned int i = 0; i < boxList.getNumberBoxes(); ++i){
+        std::vector<unsigned int> v(B.getTriangles(i), B.getTriangles(i) + B.getNumberTriangles(i));
+        int n = v.size();
+        std::tuple<int, Box3D, std::vector<unsigned int> > triple (n, boxList.getBox(i), v);
         vectorTriples.push_back(triple);
     }
 }
 
 
-int Engine::minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<int, Box3D, std::vector<bool> > > &vectorTriples, unsigned int numberFaces){
+int Engine::minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<int, Box3D, std::vector<unsigned int> > > &vectorTriples, unsigned int numberFaces){
 
     //ordering vector of triples
     struct triplesOrdering {
-        bool operator ()(const std::tuple<int, Box3D, std::vector<bool> >& a, const std::tuple<int, Box3D, std::vector<bool> >& b) {
+        bool operator ()(const std::tuple<int, Box3D, std::vector<unsigned int> >& a, const std::tuple<int, Box3D, std::vector<unsigned int> >& b) {
             if (std::get<0>(a) < std::get<0>(b))
                 return true;
             if (std::get<0>(a) == std::get<0>(b))
@@ -443,7 +694,7 @@ int Engine::minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<
         }
     };
 
-    std::vector<std::tuple<int, Box3D, std::vector<bool> > > vectorTriples0;
+    std::vector<std::tuple<int, Box3D, std::vector<unsigned int> > > vectorTriples0;
     for (unsigned int i = 0; i < vectorTriples.size(); i++){
         Box3D b = std::get<1>(vectorTriples[i]);
         if (b.getRotationMatrix() == Eigen::Matrix3d::Identity()){
@@ -459,31 +710,25 @@ int Engine::minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<
 
     vectorTriples.insert(vectorTriples.end(), vectorTriples0.begin(), vectorTriples0.end());
 
-    //create m
-    std::vector<std::vector<bool> > m;
-    m.reserve(boxList.getNumberBoxes());
-    for (unsigned int i = 0; i < boxList.getNumberBoxes(); i++)
-        m.push_back(std::get<2>(vectorTriples[i]));
-
     //create sums
     std::vector<unsigned int> sums;
     sums.resize(numberFaces, 0);
-    for (unsigned j = 0; j < numberFaces; j++){
-        for (unsigned int i = 0; i < boxList.getNumberBoxes(); i++){
-            sums[j] += m[i][j];
-        }
+    for (unsigned int i = 0; i < boxList.getNumberBoxes(); i++){
+        for (unsigned int j : std::get<2>(vectorTriples[i]))
+            sums[j]++;
     }
 
     //calculating erasable elements
     std::vector<unsigned int> eliminate;
     for (unsigned int i = 0; i < boxList.getNumberBoxes(); i++){
+        const std::vector<unsigned int>& m = std::get<2>(vectorTriples[i]);
         bool b = true;
-        for (unsigned int j = 0; j < numberFaces; j++)
-            if (sums[j]-m[i][j] < 1 && sums[j]!=0)
+        for (unsigned int k = 0; k < m.size() && b; k++)
+            if (sums[m[k]] < 2)
                 b = false;
         if (b){
-            for (unsigned int j = 0; j < numberFaces; j++)
-                sums[j]-=m[i][j];
+            for (unsigned int j : m)
+                sums[j]--;
             eliminate.push_back(i);
         }
     }
@@ -536,7 +781,7 @@ int Engine::minimalCoveringNonOptimal(BoxList& boxList, const Dcel& d) {
     CGALInterface::AABBTree t3(scaled3);
     #endif
 
-    std::vector< std::tuple<int, Box3D, std::vector<bool> > > vectorTriples;
+    std::vector< std::tuple<int, Box3D, std::vector<unsigned int> > > vectorTriples;
 
     vectorTriples.reserve(boxList.getNumberBoxes());
     for (unsigned int i = 0; i < boxList.getNumberBoxes(); ++i){
@@ -565,14 +810,15 @@ int Engine::minimalCoveringNonOptimal(BoxList& boxList, const Dcel& d) {
             else ++it;
         }
 
-        std::vector<bool> v;
+        std::vector<unsigned int> v;
         int n = covered.size();
-        v.resize(d.getNumberFaces(), false);
+        v.reserve(n);
         for (std::list<const Dcel::Face*>::iterator it = covered.begin(); it != covered.end(); ++it){
             const Dcel::Face* f = *it;
-            v[f->getId()] = true;
+            v.push_back(f->getId());
         }
-        std::tuple<int, Box3D, std::vector<bool> > triple (n, boxList.getBox(i), v);
+        std::sort(v.begin(), v.end());
+        std::tuple<int, Box3D, std::vector<unsigned int> > triple (n, boxList.getBox(i), v);
         vectorTriples.push_back(triple);
     }
 
@@ -580,48 +826,51 @@ int Engine::minimalCoveringNonOptimal(BoxList& boxList, const Dcel& d) {
 }
 
 
-bool Engine::minimalCovering(BoxList& boxList, const Dcel& d) {
-    #ifdef GUROBI_DEFINED
-    unsigned int nBoxes = boxList.getNumberBoxes();
-    unsigned int nTris = d.getNumberFaces();
-    Array2D<int> B(nBoxes+1, nTris, 0);
-    cgal::AABBTree aabb(d);
-    for (unsigned int i = 0; i < nBoxes; i++){
-        std::list<const Dcel::Face*> containedFaces = aabb.getCompletelyContainedDcelFaces(boxList.getBox(i));
-        for (const Dcel::Face* f : containedFaces){
-            B(i,f->getId()) = 1;
-        }
-    }
-
-    //this piece of code allows to find a solution also if there are uncovered triangles.
-    //it creates a "dummy box" for every uncovered triangles
-    bool bb = false;
-    for (unsigned int j = 0; j < B.getSizeY(); j++){
-        int sum = 0;
-        for (unsigned int i = 0; i < B.getSizeX() && sum == 0; i++){
-            sum += B(i,j);
-        }
-        if (sum == 0){
-            bb = true;
-            B(nBoxes, j) = 1;
-        }
-    }
-    if (bb)
-        std::cerr << "Warning: Uncovered triangles by best boxes.\n";
+/**
+ * @brief solveSetCover
+ *
+ * Minimum set cover of the triangles with the boxes of B (the row i of B contains the triangles
+ * covered by the box i), computed with the built-in SetCover solver.
+ * selected[i] is set to 1 if the box i is in the cover.
+ */
+static void solveSetCover(const CoverageMatrix& B, std::vector<char>& selected) {
+    SetCover setCover(B.getNumberTriangles());
+    for (unsigned int i = 0; i < B.getNumberRows(); i++)
+        setCover.addColumn(B.getTriangles(i), B.getTriangles(i) + B.getNumberTriangles(i));
+    Timer tSetCover("tSetCover");
+    bool optimal = setCover.solve();
+    tSetCover.stopAndPrint();
+    std::cerr << "Set cover: " << setCover.getNumberSelected() << " boxes, lower bound: " << setCover.getLowerBound()
+              << ", gap: " << setCover.getGap()*100 << "%" << (optimal ? " (optimal)" : "") << "\n";
+
+    for (unsigned int i = 0; i < B.getNumberRows(); i++)
+        selected[i] = setCover.isSelected(i);
+}
 
+#ifdef GUROBI_DEFINED
+/**
+ * @brief solveSetCoverGurobi
+ *
+ * Same of solveSetCover, with the set cover solved by Gurobi.
+ */
+static void solveSetCoverGurobi(const CoverageMatrix& B, std::vector<char>& selected) {
+    unsigned int nBoxes = B.getNumberRows();
+    unsigned int nTris = B.getNumberTriangles();
+    CoverageMatrix boxesOfTriangles = B.getTransposed();
     try {
         GRBEnv env;
         GRBModel model(env);
 
         //x
         GRBVar* x = nullptr;
-        x = model.addVars(nBoxes+1, GRB_BINARY);
+        x = model.addVars(nBoxes, GRB_BINARY);
 
         //constraints
         for (unsigned int j = 0; j < nTris; j++){
             GRBLinExpr line = 0;
-            for (unsigned int i = 0; i < B.getSizeX(); i++){
-                line += B(i,j) * x[i];
+            const unsigned int* boxes = boxesOfTriangles.getTriangles(j);
+            for (unsigned int k = 0; k < boxesOfTriangles.getNumberTriangles(j); k++){
+                line += x[boxes[k]];
             }
             model.addConstr(line >= 1);
         }
@@ -635,15 +884,8 @@ bool Engine::minimalCovering(BoxList& boxList, const Dcel& d) {
         model.optimize();
         tGurobi.stopAndPrint();
 
-        unsigned int deleted = 0;
-        for (int i = nBoxes-1; i >= 0; i--){
-            if (x[i].get(GRB_DoubleAttr_X) == 0){
-                boxList.removeBox(i);
-                deleted++;
-            }
-        }
-        std::cerr << "N survived boxes: " << nBoxes - deleted << "\n";
-        return bb;
+        for (unsigned int i = 0; i < nBoxes; i++)
+            selected[i] = x[i].get(GRB_DoubleAttr_X) != 0;
     }
     catch (GRBException e) {
         std::cerr << "Gurobi Exception\n" << e.getErrorCode() << " : " << e.getMessage() << std::endl;
@@ -653,97 +895,114 @@ bool Engine::minimalCovering(BoxList& boxList, const Dcel& d) {
         std::cerr << "Unknown Gurobi Optimization error!" << std::endl;
         throw std::runtime_error("Optimization failed.");
     }
-    #else
-    return deleteBoxesNonOptimal(boxList, d);
-    #endif
 }
+#endif
 
-bool Engine::secondMinimalCovering(BoxList& bestList, BoxList& boxList, const Dcel& d) {
-    #ifdef GUROBI_DEFINED
+/**
+ * @brief minimumCover
+ *
+ * Removes from boxList the boxes not chosen by the minimum set cover of the triangles. The row i of B
+ * contains the triangles covered by the box i; the row nBoxes of B is a fixed box (triangles already
+ * covered), which is not counted.
+ * The problem is reduced by SetCoverPresolve, then solved by Gurobi (if setGurobiSetCover) or by
+ * the built-in SetCover solver.
+ * @return the number of removed boxes
+ */
+static unsigned int minimumCover(BoxList& boxList, const CoverageMatrix& B) {
     unsigned int nBoxes = boxList.getNumberBoxes();
-    unsigned int nTris = d.getNumberFaces();
-    Array2D<int> B(nBoxes+1, nTris, 0);
-    cgal::AABBTree aabb(d);
-    for (unsigned int i = 0; i < bestList.size(); i++){
-        std::list<const Dcel::Face*> containedFaces = aabb.getCompletelyContainedDcelFaces(bestList.getBox(i));
-        for (const Dcel::Face* f : containedFaces){
-            B(nBoxes,f->getId()) = 1;
-        }
+    Timer tPresolve("tPresolve");
+    SetCoverPresolve presolve(B, nBoxes);
+    tPresolve.stopAndPrint();
+    const CoverageMatrix& reduced = presolve.getReduced();
+    std::vector<char> selected(reduced.getNumberRows(), 0);
+    if (reduced.getNumberTriangles() > 0){
+        #ifdef GUROBI_DEFINED
+        if (gurobiSetCover)
+            solveSetCoverGurobi(reduced, selected);
+        else
+            solveSetCover(reduced, selected);
+        #else
+        solveSetCover(reduced, selected);
+        #endif
     }
-    for (unsigned int i = 0; i < nBoxes; i++){
-        std::list<const Dcel::Face*> containedFaces = aabb.getCompletelyContainedDcelFaces(boxList.getBox(i));
-        for (const Dcel::Face* f : containedFaces){
-            B(i,f->getId()) = 1;
+
+    std::vector<char> keep(nBoxes, 0);
+    for (unsigned int i : presolve.getForcedBoxes())
+        keep[i] = 1;
+    for (unsigned int i = 0; i < reduced.getNumberRows(); i++)
+        if (selected[i])
+            keep[presolve.getOriginalBox(i)] = 1;
+    unsigned int deleted = 0;
+    for (int i = nBoxes-1; i >= 0; i--){
+        if (!keep[i]){
+            boxList.removeBox(i);
+            deleted++;
         }
     }
+    return deleted;
+}
 
+bool Engine::minimalCovering(BoxList& boxList, const Dcel& d) {
+    unsigned int nBoxes = boxList.getNumberBoxes();
+    unsigned int nTris = d.getNumberFaces();
+    cgal::AABBTree aabb(d);
+    CoverageMatrix B(boxList, aabb, nTris);
 
     //this piece of code allows to find a solution also if there are uncovered triangles.
     //it creates a "dummy box" for every uncovered triangles
     bool bb = false;
-    for (unsigned int j = 0; j < B.getSizeY(); j++){
-        int sum = 0;
-
-        if (B(nBoxes, j) != 1) {
-            for (unsigned int i = 0; i < B.getSizeX() && sum == 0; i++){
-                sum += B(i,j);
-            }
-            if (sum == 0){
-                bb = true;
-                B(nBoxes, j) = 1;
-            }
+    std::vector<unsigned int> counts = B.getCoverageCounts();
+    std::vector<unsigned int> dummy;
+    for (unsigned int j = 0; j < nTris; j++){
+        if (counts[j] == 0){
+            bb = true;
+            dummy.push_back(j);
         }
     }
+    B.addRow(dummy);
     if (bb)
-        std::cerr << "WARNING: Uncovered triangles.\n";
-
-    try {
-        GRBEnv env;
-        GRBModel model(env);
-
-        //x
-        GRBVar* x = nullptr;
-        x = model.addVars(nBoxes+1, GRB_BINARY);
+        std::cerr << "Warning: Uncovered triangles by best boxes.\n";
+    std::cerr << "Coverage matrix: " << B.getNumberNonZeros() << " nonzeros\n";
 
-        //constraints
-        for (unsigned int j = 0; j < nTris; j++){
-            GRBLinExpr line = 0;
-            for (unsigned int i = 0; i < B.getSizeX(); i++){
-                line += B(i,j) * x[i];
-            }
-            model.addConstr(line >= 1);
-        }
+    unsigned int deleted = minimumCover(boxList, B);
+    std::cerr << "N survived boxes: " << nBoxes - deleted << "\n";
+    return bb;
+}
 
-        //obj
-        GRBLinExpr obj = 0;
-        for (unsigned int i = 0; i < nBoxes; i++)
-            obj += x[i];
-        model.setObjective(obj, GRB_MINIMIZE);
-        Timer tGurobi("tGurobi");
-        model.optimize();
-        tGurobi.stopAndPrint();
+bool Engine::secondMinimalCovering(BoxList& bestList, BoxList& boxList, const Dcel& d) {
+    unsigned int nBoxes = boxList.getNumberBoxes();
+    unsigned int nTris = d.getNumberFaces();
+    cgal::AABBTree aabb(d);
+    CoverageMatrix B(boxList, aabb, nTris);
+    std::vector<char> fixed(nTris, 0);
+    {
+        CoverageMatrix best(bestList, aabb, nTris);
+        for (unsigned int i = 0; i < best.getNumberRows(); i++)
+            for (unsigned int k = 0; k < best.getNumberTriangles(i); k++)
+                fixed[best.getTriangles(i)[k]] = 1;
+    }
 
-        unsigned int deleted = 0;
-        for (int i = nBoxes-1; i >= 0; i--){
-            if (x[i].get(GRB_DoubleAttr_X) == 0){
-                boxList.removeBox(i);
-                deleted++;
-            }
+    //this piece of code allows to find a solution also if there are uncovered triangles.
+    //it creates a "dummy box" for every uncovered triangles
+    bool bb = false;
+    std::vector<unsigned int> counts = B.getCoverageCounts();
+    std::vector<unsigned int> dummy;
+    for (unsigned int j = 0; j < nTris; j++){
+        if (!fixed[j] && counts[j] == 0){
+            bb = true;
+            fixed[j] = 1;
         }
-        std::cerr << "N survived boxes: " << nBoxes - deleted << "\n";
-        return bb;
-    }
-    catch (GRBException e) {
-        std::cerr << "Gurobi Exception\n" << e.getErrorCode() << " : " << e.getMessage() << std::endl;
-        throw std::runtime_error("Optimization failed.");
-    }
-    catch (...) {
-        std::cerr << "Unknown Gurobi Optimization error!" << std::endl;
-        throw std::runtime_error("Optimization failed.");
+        if (fixed[j])
+            dummy.push_back(j);
     }
-    #else
-    return deleteBoxesNonOptimal(boxList, d);
-    #endif
+    B.addRow(dummy);
+    if (bb)
+        std::cerr << "WARNING: Uncovered triangles.\n";
+    std::cerr << "Coverage matrix: " << B.getNumberNonZeros() << " nonzeros\n";
+
+    unsigned int deleted = minimumCover(boxList, B);
+    std::cerr << "N survived boxes: " << nBoxes - deleted << "\n";
+    return bb;
 }
 
 
@@ -757,13 +1016,9 @@ int Engine::deleteBoxesGSC(BoxList& boxList, const Dcel& d) {
         W.insert(i);
 
     cgal::AABBTree aabb(d);
+    CoverageMatrix B(boxList, aabb, d.getNumberFaces());
     for (unsigned int i = 0; i < nBoxes; i++){
-        std::list<const Dcel::Face*> containedFaces = aabb.getCompletelyContainedDcelFaces(boxList.getBox(i));
-        std::set<int> s;
-        for (const Dcel::Face* f : containedFaces){
-            s.insert(f->getId());
-        }
-        F[i] = s;
+        F[i] = std::set<int>(B.getTriangles(i), B.getTriangles(i) + B.getNumberTriangles(i));
     }
     Timer t("AAA");
     while (W.size() > 0){
@@ -811,7 +1066,7 @@ double Engine::optimize(BoxList& solutions, Dcel& d, double kernelDistance, bool
         Engine::setTrianglesTargets(scaled);
     #endif
 
-    Grid g[ORIENTATIONS][TARGETS];
+    GridFamily families[ORIENTATIONS];
     BoxList bl[ORIENTATIONS][TARGETS];
     std::set<int> coveredFaces;
     int factor = 1024;
@@ -825,72 +1080,70 @@ double Engine::optimize(BoxList& solutions, Dcel& d, double kernelDistance, bool
     cgal::AABBTree aabb[ORIENTATIONS];
     for (unsigned int i = 0; i < ORIENTATIONS; i++)
         aabb[i] = cgal::AABBTree(scaled[i]);
+    //with file, the grids are in the persistent GridCache
+    uint64_t gridKeys[ORIENTATIONS][TARGETS];
+    if (file){
+        uint64_t meshHash = GridCache::getMeshHash(d);
+        for (unsigned int i = 0; i < ORIENTATIONS; ++i)
+            for (unsigned int j = 0; j < TARGETS; ++j)
+                gridKeys[i][j] = GridCache::getKey(meshHash, i, XYZ[j], kernelDistance, tolerance, areaTolerance, angleTolerance);
+    }
     for (unsigned int i = 0; i < ORIENTATIONS; ++i){
-        bool first = true;
-        if (file) {
-            double totalTimeGG = 0;
-            Array3D<Pointd> grid;
-            Array3D<gridreal> distanceField;
-            for (unsigned int j = 0; j < TARGETS; ++j) {
-                #ifdef USE_2D_ONLY
-                if (j != 1 && j != 4){
-                #endif
-                    std::set<const Dcel::Face*> flippedFaces, savedFaces;
-                    Engine::getFlippedFaces(flippedFaces, savedFaces, scaled[i], XYZ[j], angleTolerance, areaTolerance);
-                    Grid g;
-                    Timer gg("Generating Grid");
-                    //distanceField = Engine::generateGrid(g, scaled[i], kernelDistance, tolerance, XYZ[j], savedFaces);
-                    if (first) {
-                        SimpleEigenMesh m(scaled[i]);
-                        Engine::generateGridAndDistanceField(grid, distanceField, m);
-                        calculateGridWeights(g, grid, distanceField, d, kernelDistance, tolerance, XYZ[j], savedFaces);
-                        first = false;
-                    }
-                    else {
-                        Engine::calculateGridWeights(g, grid, distanceField, d, kernelDistance, tolerance, XYZ[j], savedFaces);
-                    }
-                    gg.stopAndPrint();
-                    totalTimeGG += gg.delay();
-                    g.resetSignedDistances();
-                    std::stringstream ss ;
-                    ss << "grid" << i << "_" << j << ".bin";
-                    std::ofstream myfile;
-                    myfile.open (ss.str(), std::ios::out | std::ios::binary);
-                    g.serialize(myfile);
-                    myfile.close();
-                    std::cerr << "Generated grid or " << i << " t " << j << "\n";
+        if (file){
+            bool cached = true;
+            for (unsigned int j = 0; j < TARGETS && cached; ++j) {
                 #ifdef USE_2D_ONLY
-                }
+                if (j != 1 && j != 4)
                 #endif
+                    cached = GridCache::contains(gridKeys[i][j]);
+            }
+            if (cached){
+                std::cerr << "Grids of orientation " << i << " found in cache.\n";
+                continue;
             }
-            std::cerr << "Total time generating Grids: " << totalTimeGG << "\n";
         }
-        else {
-            Array3D<Pointd> grid;
-            Array3D<gridreal> distanceField;
-            SimpleEigenMesh m(scaled[i]);
-            Engine::generateGridAndDistanceField(grid, distanceField, m);
-            # pragma omp parallel for
-            for (unsigned int j = 0; j < TARGETS; ++j) {
-                #ifdef USE_2D_ONLY
-                if (j != 1 && j != 4){
-                #endif
-                    std::set<const Dcel::Face*> flippedFaces, savedFaces;
-                    Engine::getFlippedFaces(flippedFaces, savedFaces, scaled[i], XYZ[j], angleTolerance, areaTolerance);
-                    Engine::calculateGridWeights(g[i][j], grid, distanceField, d, kernelDistance, tolerance, XYZ[j], savedFaces);
-                    g[i][j].resetSignedDistances();
-                    std::cerr << "Generated grid or " << i << " t " << j << "\n";
-                #ifdef USE_2D_ONLY
+        Timer gg("Generating Grids");
+        Array3D<gridreal> distanceField;
+        Pointd gMin;
+        double unit;
+        SimpleEigenMesh m(scaled[i]);
+        Engine::generateDistanceField(distanceField, gMin, unit, m); //without the coordinates of the points
+        std::vector<Vec3> targets(XYZ.begin(), XYZ.begin() + TARGETS);
+        std::vector<std::set<const Dcel::Face*> > savedFaces(TARGETS);
+        for (unsigned int j = 0; j < TARGETS; ++j) {
+            std::set<const Dcel::Face*> flippedFaces;
+            Engine::getFlippedFaces(flippedFaces, savedFaces[j], scaled[i], XYZ[j], angleTolerance, areaTolerance);
+        }
+        Engine::calculateGridWeights(families[i], gMin, unit, distanceField, d, kernelDistance, tolerance, targets, savedFaces);
+        families[i].resetSignedDistances();
+        gg.stopAndPrint();
+        for (unsigned int j = 0; j < TARGETS; ++j) {
+            #ifdef USE_2D_ONLY
+            if (j != 1 && j != 4){
+            #endif
+                std::cerr << "Generated grid or " << i << " t " << j << "; overridden points: " << families[i].getNumberOverriddenPoints(j) << "; overridden cells: " << families[i].getNumberOverriddenCells(j) << "\n";
+                if (file) {
+                    Grid g;
+                    families[i].getGrid(g, j);
+                    GridCache::save(g, gridKeys[i][j]);
                 }
-                #endif
+            #ifdef USE_2D_ONLY
             }
+            #endif
         }
+        std::cerr << "Coefficients: " << families[i].getNumberCoefficients() << "\n";
+        if (file)
+            families[i] = GridFamily();
     }
     bool end = false;
 
     double totalTbg = 0;
+    unsigned int totalSeeds = 0, totalWarm = 0;
+    long int totalIterations = 0;
     while (coveredFaces.size() < scaled[0].getNumberFaces() && !end){
         BoxList tmp[ORIENTATIONS][TARGETS];
+        unsigned int roundSeeds = 0, roundWarm = 0;
+        long int roundIterations = 0;
         Eigen::VectorXi faces[ORIENTATIONS];
         for (unsigned int i = 0; i < ORIENTATIONS; i++){
             EigenMesh m(scaled[i]);
@@ -914,25 +1167,45 @@ double Engine::optimize(BoxList& solutions, Dcel& d, double kernelDistance, bool
 
                         if (file) {
                             Grid g;
-                            std::stringstream ss ;
-                            ss << "grid" << i << "_" << j << ".bin";
-                            std::ifstream myfile;
-                            myfile.open (ss.str(), std::ios::in | std::ios::binary);
-                            g.deserialize(myfile);
-                            myfile.close();
+                            if (!GridCache::load(g, gridKeys[i][j], Energy().getIntegral())){
+                                std::cerr << "ERROR: grid " << GridCache::getFilename(gridKeys[i][j]) << " not found.\n";
+                                tmp[i][j].clearBoxes();
+                                continue;
+                            }
+                            roundSeeds += tmp[i][j].getNumberBoxes();
+                            if (warmStartedBoxGrowth)
+                                roundWarm += Engine::warmStartBoxes(tmp[i][j], bl[i][j], g, limit, limits);
                             std::cerr << "Starting boxes growth\n";
                             Timer tt("Boxes Growth");
-                            Engine::expandBoxes(tmp[i][j], g, limit, limits);
+                            roundIterations += growBoxes(tmp[i][j], g, limit, limits);
                             tt.stop();
                             totalTbg += tt.delay();
+                            if (g.hasReadError()){
+                                std::cerr << "ERROR: grid " << GridCache::getFilename(gridKeys[i][j]) << " cannot be read, boxes discarded.\n";
+                                tmp[i][j].clearBoxes();
+                                continue;
+                            }
                             std::cerr << "Orientation: " << i << " Target: " << j << " completed.\n";
                         }
                         else {
+                            const Grid& g = families[i].getGrid(j);
+                            roundSeeds += tmp[i][j].getNumberBoxes();
+                            if (warmStartedBoxGrowth)
+                                roundWarm += Engine::warmStartBoxes(tmp[i][j], bl[i][j], g, limit, limits);
                             std::cerr << "Starting boxes growth\n";
                             Timer tt("Boxes Growth");
-                            Engine::expandBoxes(tmp[i][j], g[i][j], limit, limits);
+                            roundIterations += growBoxes(tmp[i][j], g, limit, limits);
                             tt.stop();
                             totalTbg += tt.delay();
+                            if (g.hasReadError()){
+                                std::cerr << "ERROR: the bricks of the grid cannot be read, boxes discarded.\n";
+                                tmp[i][j].clearBoxes();
+                                continue;
+                            }
+                            if (Grid::isOutOfCoreStorage())
+                                std::cerr << "Bricks read: " << OutOfCoreGrid::getNumberReads() << ", cached: " << OutOfCoreGrid::getCachedBytes()/(1 << 20) << " MB\n";
+                            else if (Grid::isLazyStorage())
+                                std::cerr << "Touched grid: " << g.getTouchedFraction()*100 << "%\n";
                             std::cerr << "Orientation: " << i << " Target: " << j << " completed.\n";
                         }
                     }
@@ -975,6 +1248,11 @@ double Engine::optimize(BoxList& solutions, Dcel& d, double kernelDistance, bool
             }
         }
 
+        std::cerr << "Seeds: " << roundSeeds << "; Warm started: " << roundWarm << "; Iterations: " << roundIterations;
+        if (roundSeeds > 0)
+            std::cerr << " (" << (double)roundIterations / roundSeeds << " per box)";
+        std::cerr << "\n";
+        totalSeeds += roundSeeds; totalWarm += roundWarm; totalIterations += roundIterations;
         std::cerr << "Starting Number Faces: " << numberFaces << "; Total Covered Faces: " << coveredFaces.size() << "\n";
         std::cerr << "Target: " << scaled[0].getNumberFaces() << "\n";
         if (numberFaces == scaled[0].getNumberFaces()) {
@@ -995,22 +1273,8 @@ double Engine::optimize(BoxList& solutions, Dcel& d, double kernelDistance, bool
             numberFaces = scaled[0].getNumberFaces();
     }
     std::cerr << "Total time Boxes Growth: " << totalTbg << "\n";
+    std::cerr << "Total Seeds: " << totalSeeds << "; Warm started: " << totalWarm << "; Iterations: " << totalIterations << "\n";
 
-    if (file){
-        for (unsigned int i = 0; i < ORIENTATIONS; ++i){
-            for (unsigned int j = 0; j < TARGETS; ++j){
-                #ifdef USE_2D_ONLY
-                if (j != 1 && j != 4){
-                #endif
-                    std::stringstream ss ;
-                    ss << "grid" << i << "_" << j << ".bin";
-                    std::remove(ss.str().c_str());
-                #ifdef USE_2D_ONLY
-                }
-                #endif
-            }
-        }
-    }
     for (unsigned int i = 0; i < ORIENTATIONS; i++){
         for (unsigned int j = 0; j < TARGETS; ++j){
             #ifdef USE_2D_ONLY
@@ -1132,7 +1396,8 @@ std::vector<Box3D> Engine::splitBoxWithMoreThanOneConnectedComponent(const Box3D
 bool checkNewBox(const Box3D& tmp, Box3D& b2, std::vector<unsigned int>& trianglesCovered, const cgal::AABBTree& tree){
     std::list<unsigned int> newTriangles;
     tree.getCompletelyContainedDcelFaces(newTriangles, tmp);
-    std::set<unsigned int> uncovered = cg3::difference(b2.getTrianglesCovered(), std::set<unsigned int>(newTriangles.begin(), newTriangles.end()));
+    BitmapSet newCovered(newTriangles.begin(), newTriangles.end());
+    BitmapSet uncovered = difference(b2.getTrianglesCovered(), newCovered);
     bool shrink = true;
     for (unsigned int t : uncovered){
         if (trianglesCovered[t] == 1)
@@ -1140,7 +1405,7 @@ bool checkNewBox(const Box3D& tmp, Box3D& b2, std::vector<unsigned int>& triangl
     }
     if (shrink){
         b2 = tmp;
-        b2.setTrianglesCovered(std::set<unsigned int>(newTriangles.begin(), newTriangles.end()));
+        b2.setTrianglesCovered(newCovered);
         for (unsigned int t : uncovered){
             trianglesCovered[t]--;
         }
@@ -1257,7 +1522,7 @@ void Engine::smartSnapping(const Dcel& d, BoxList& solutions) {
     solutions.calculateTrianglesCovered(tree);
     std::vector<unsigned int> trianglesCovered(d.getNumberFaces(), 0);
     for (unsigned int i = 0; i < solutions.getNumberBoxes(); i++){
-        const std::set<unsigned int>& s = solutions[i].getTrianglesCovered();
+        const BitmapSet& s = solutions[i].getTrianglesCovered();
         for (unsigned int j : s){
             trianglesCovered[j]++;
         }
@@ -1310,7 +1575,7 @@ void Engine::merging(const Dcel& d, BoxList& solutions) {
     cgal::AABBTree tree(d);
     std::vector<unsigned int> trianglesCovered(d.getNumberFaces(), 0);
     for (unsigned int i = 0; i < solutions.getNumberBoxes(); i++){
-        const std::set<unsigned int>& s = solutions[i].getTrianglesCovered();
+        const BitmapSet& s = solutions[i].getTrianglesCovered();
         for (unsigned int j : s){
             trianglesCovered[j]++;
         }
@@ -1334,8 +1599,8 @@ void Engine::merging(const Dcel& d, BoxList& solutions) {
                                 tmpa.setBaseLevel(baseB);
                                 std::list<unsigned int> newTrianglesA;
                                 tree.getCompletelyContainedDcelFaces(newTrianglesA, tmpa);
-                                std::set<unsigned int> nonCoveredTrianglesA(newTrianglesA.begin(), newTrianglesA.end());
-                                nonCoveredTrianglesA = cg3::difference(a.getTrianglesCovered(), nonCoveredTrianglesA);
+                                BitmapSet newCoveredA(newTrianglesA.begin(), newTrianglesA.end());
+                                BitmapSet nonCoveredTrianglesA = difference(a.getTrianglesCovered(), newCoveredA);
                                 bool shrink = true;
                                 for (unsigned int t : nonCoveredTrianglesA){
                                     if (trianglesCovered[t] == 1)
@@ -1346,12 +1611,12 @@ void Engine::merging(const Dcel& d, BoxList& solutions) {
                                         trianglesCovered[t]--;
                                     }
                                     a.setBaseLevel(baseB);
-                                    a.setTrianglesCovered(std::set<unsigned int>(newTrianglesA.begin(), newTrianglesA.end()));
+                                    a.setTrianglesCovered(newCoveredA);
                                     std::cerr << "Box " << i << " shrinked to level of Box " << j << "\n";
 
                                     SimpleEigenMesh u = libigl::union_(a.getEigenMesh(), b.getEigenMesh());
                                     a.setEigenMesh(u);
-                                    a.setTrianglesCovered(cg3::union_(a.getTrianglesCovered(), b.getTrianglesCovered()));
+                                    a.addTrianglesCovered(b.getTrianglesCovered());
                                     a.setMin(u.getBoundingBox().min());
                                     a.setMax(u.getBoundingBox().max());
                                     solutions[i].setSplitted(true);
@@ -1367,8 +1632,8 @@ void Engine::merging(const Dcel& d, BoxList& solutions) {
                                 tmpb.setBaseLevel(baseA);
                                 std::list<unsigned int> newTrianglesB;
                                 tree.getCompletelyContainedDcelFaces(newTrianglesB, tmpb);
-                                std::set<unsigned int> nonCoveredTrianglesB(newTrianglesB.begin(), newTrianglesB.end());
-                                nonCoveredTrianglesB = cg3::difference(b.getTrianglesCovered(), nonCoveredTrianglesB);
+                                BitmapSet newCoveredB(newTrianglesB.begin(), newTrianglesB.end());
+                                BitmapSet nonCoveredTrianglesB = difference(b.getTrianglesCovered(), newCoveredB);
                                 bool shrink = true;
                                 for (unsigned int t : nonCoveredTrianglesB){
                                     if (trianglesCovered[t] == 1)
@@ -1379,12 +1644,12 @@ void Engine::merging(const Dcel& d, BoxList& solutions) {
                                         trianglesCovered[t]--;
                                     }
                                     b.setBaseLevel(baseA);
-                                    b.setTrianglesCovered(std::set<unsigned int>(newTrianglesB.begin(), newTrianglesB.end()));
+                                    b.setTrianglesCovered(newCoveredB);
                                     std::cerr << "Box " << j << " shrinked to level of Box " << i << "\n";
 
                                     SimpleEigenMesh u = libigl::union_(a.getEigenMesh(), b.getEigenMesh());
                                     a.setEigenMesh(u);
-                                    a.setTrianglesCovered(cg3::union_(a.getTrianglesCovered(), b.getTrianglesCovered()));
+                                    a.addTrianglesCovered(b.getTrianglesCovered());
                                     a.setMin(u.getBoundingBox().min());
                                     a.setMax(u.getBoundingBox().max());
                                     solutions[i].setSplitted(true);
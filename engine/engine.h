@@ -10,6 +10,8 @@
 
 #include <cg3/meshes/dcel/dcel.h>
 #include "lib/grid/grid.h"
+#include "lib/grid/gridfamily.h"
+#include "lib/grid/gridcache.h"
 #include "energy.h"
 #include <cg3/cgal/cgal.h>
 #include "heightfieldslist.h"
@@ -17,6 +19,8 @@
 #define ORIENTATIONS 1
 #define TARGETS 6
 #define STARTING_NUMBER_FACES 600
+#define WARM_START_CANDIDATES 4
+#define GRID_PYRAMID_LEVELS 3
 
 #define BOOL_DEBUG
 
@@ -34,8 +38,11 @@ namespace Engine {
     void setTrianglesTargets(cg3::Dcel scaled[]);
 
     void generateGridAndDistanceField(cg3::Array3D<cg3::Pointd> &grid, cg3::Array3D<gridreal> &distanceField, const cg3::SimpleEigenMesh& m, bool generateDistanceField = true, double gridUnit = 2, bool integer = true);
+    void generateDistanceField(cg3::Array3D<gridreal>& distanceField, cg3::Pointd& gMin, double& unit, const cg3::SimpleEigenMesh& m, double gridUnit = 2, bool integer = true);
 
     void calculateGridWeights(Grid& g, const cg3::Array3D<cg3::Pointd> &grid, const cg3::Array3D<gridreal> &distanceField, const cg3::Dcel& d, double kernelDistance, bool tolerance, const cg3::Vec3 &target, std::set<const cg3::Dcel::Face*>& savedFaces);
+    void calculateGridWeights(GridFamily& f, const cg3::Array3D<cg3::Pointd>& grid, const cg3::Array3D<gridreal>& distanceField, const cg3::Dcel& d, double kernelDistance, bool tolerance, const std::vector<cg3::Vec3>& targets, const std::vector<std::set<const cg3::Dcel::Face*> >& savedFaces);
+    void calculateGridWeights(GridFamily& f, const cg3::Pointd& gMin, double unit, const cg3::Array3D<gridreal>& distanceField, const cg3::Dcel& d, double kernelDistance, bool tolerance, const std::vector<cg3::Vec3>& targets, const std::vector<std::set<const cg3::Dcel::Face*> >& savedFaces);
 
     static std::set<const cg3::Dcel::Face*> dummy;
     static cg3::Array3D<gridreal> ddf;
@@ -47,11 +54,34 @@ namespace Engine {
 
     void calculateInitialBoxes(BoxList &boxList, const cg3::Dcel &d, const Eigen::Matrix3d& rot = Eigen::Matrix3d::Identity(), bool onlyTarget = false, const cg3::Vec3& target = cg3::Vec3());
 
-    void expandBoxes(BoxList &boxList, const Grid &g, bool limit, const cg3::Pointd& limits, bool printTimes = false);
+    void setBoundConstrainedBoxGrowth(bool b);
 
-    void createVectorTriples(std::vector<std::tuple<int, Box3D, std::vector<bool> > >& vectorTriples, const BoxList& boxList, const cg3::Dcel &d);
+    bool isBoundConstrainedBoxGrowth();
 
-    int minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<int, Box3D, std::vector<bool> > > &vectorTriples, unsigned int numberFaces);
+    void setWarmStartedBoxGrowth(bool b);
+
+    bool isWarmStartedBoxGrowth();
+
+    void setBasinDetection(bool b);
+
+    bool isBasinDetection();
+
+    void setMultiresolutionBoxGrowth(bool b);
+
+    bool isMultiresolutionBoxGrowth();
+
+    void setGurobiSetCover(bool b);
+
+    bool isGurobiSetCover();
+
+    int expandBoxes(BoxList &boxList, const Grid &g, bool limit, const cg3::Pointd& limits, bool printTimes = false);
+    int expandBoxes(BoxList &boxList, const GridPyramid &p, bool limit, const cg3::Pointd& limits, bool printTimes = false);
+
+    unsigned int warmStartBoxes(BoxList& boxList, const BoxList& converged, const Grid& g, bool limit, const cg3::Pointd& limits);
+
+    void createVectorTriples(std::vector<std::tuple<int, Box3D, std::vector<unsigned int> > >& vectorTriples, const BoxList& boxList, const cg3::Dcel &d);
+
+    int minimalCoveringNonOptimal(BoxList& boxList, std::vector< std::tuple<int, Box3D, std::vector<unsigned int> > > &vectorTriples, unsigned int numberFaces);
 
     int minimalCoveringNonOptimal(BoxList& boxList, const cg3::Dcel &d);
 
@@ -0,0 +1,372 @@
+#include "setcover.h"
+
+#include <omp.h>
+#include <cmath>
+#include <queue>
+#include <algorithm>
+
+SetCover::SetCover(unsigned int nRows) : nRows(nRows), nActiveRows(0), bestValue(0), lowerBound(0), rng(0), startTime(0) {
+    columnStart.push_back(0);
+}
+
+/**
+ * @brief SetCover::addColumn
+ * @return the index of the new column, covering the given rows
+ */
+unsigned int SetCover::addColumn(const std::vector<unsigned int>& rows, bool fixed) {
+    return addColumn(rows.data(), rows.data() + rows.size(), fixed);
+}
+
+/**
+ * @brief SetCover::addColumn
+ * @return the index of the new column, covering the rows in [begin, end)
+ */
+unsigned int SetCover::addColumn(const unsigned int* begin, const unsigned int* end, bool fixed) {
+    columnRows.insert(columnRows.end(), begin, end);
+    columnStart.push_back(columnRows.size());
+    this->fixed.push_back(fixed);
+    return this->fixed.size()-1;
+}
+
+/**
+ * @brief SetCover::solve
+ *
+ * Greedy cover, then lagrangian lower bound and iterated local search until the cover is
+ * proven optimal or timeLimit seconds have passed.
+ * @return true if the cover found is optimal
+ */
+bool SetCover::solve(double timeLimit) {
+    startTime = omp_get_wtime();
+    buildRows();
+    unsigned int nColumns = fixed.size();
+    best.assign(nColumns, false);
+    bestValue = 0;
+    lowerBound = 0;
+    if (nActiveRows == 0)
+        return true;
+
+    std::vector<char> x(nColumns, false);
+    std::vector<unsigned int> cover(nActiveRows, 0);
+    unsigned int n = 0;
+    complete(x, cover, n, std::vector<double>(nColumns, 0));
+    std::vector<unsigned int> order;
+    for (unsigned int j = 0; j < nColumns; j++)
+        if (x[j]) order.push_back(j);
+    std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b){
+        return columnStart[a+1] - columnStart[a] < columnStart[b+1] - columnStart[b];
+    });
+    removeRedundant(x, cover, n, order);
+    bestValue = nColumns + 1;
+    updateBest(x, n);
+    lowerBound = 1;
+
+    if (!subgradient(timeLimit))
+        localSearch(timeLimit);
+    return bestValue <= lowerBound;
+}
+
+/**
+ * @brief SetCover::buildRows
+ *
+ * Reduced problem: the rows covered by a fixed column or by no column are removed, the other rows
+ * are renumbered and the columns of every row are listed. Fixed columns are left without rows.
+ */
+void SetCover::buildRows() {
+    unsigned int nColumns = fixed.size();
+    std::vector<char> covered(nRows, false), coverable(nRows, false);
+    for (unsigned int j = 0; j < nColumns; j++)
+        for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+            (fixed[j] ? covered : coverable)[columnRows[p]] = true;
+    activeRow.assign(nRows, (unsigned int)-1);
+    nActiveRows = 0;
+    for (unsigned int r = 0; r < nRows; r++)
+        if (coverable[r] && !covered[r])
+            activeRow[r] = nActiveRows++;
+
+    std::vector<unsigned int> start(1, 0), rows;
+    for (unsigned int j = 0; j < nColumns; j++){
+        if (!fixed[j]){
+            for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                if (activeRow[columnRows[p]] != (unsigned int)-1)
+                    rows.push_back(activeRow[columnRows[p]]);
+        }
+        start.push_back(rows.size());
+    }
+    columnStart.swap(start);
+    columnRows.swap(rows);
+
+    rowStart.assign(nActiveRows+1, 0);
+    for (unsigned int r : columnRows)
+        rowStart[r+1]++;
+    for (unsigned int r = 0; r < nActiveRows; r++)
+        rowStart[r+1] += rowStart[r];
+    rowColumns.resize(columnRows.size());
+    std::vector<unsigned int> next(rowStart.begin(), rowStart.end()-1);
+    for (unsigned int j = 0; j < nColumns; j++)
+        for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+            rowColumns[next[columnRows[p]]++] = j;
+}
+
+/**
+ * @brief SetCover::complete
+ *
+ * Completes the partial cover x (n columns, cover: number of chosen columns covering every row)
+ * choosing every time the column covering most uncovered rows; ties are broken by the highest
+ * tieBreak (values in (-0.5, 0.5)). If rows is not null, only its rows can be uncovered.
+ */
+void SetCover::complete(std::vector<char>& x, std::vector<unsigned int>& cover, unsigned int& n, const std::vector<double>& tieBreak, const std::vector<unsigned int>* rows) const {
+    std::vector<unsigned int> uncovered;
+    if (rows == nullptr){
+        for (unsigned int r = 0; r < nActiveRows; r++)
+            if (cover[r] == 0) uncovered.push_back(r);
+    }
+    else {
+        for (unsigned int r : *rows)
+            if (cover[r] == 0) uncovered.push_back(r);
+        std::sort(uncovered.begin(), uncovered.end());
+        uncovered.erase(std::unique(uncovered.begin(), uncovered.end()), uncovered.end());
+    }
+    if (uncovered.empty())
+        return;
+    std::vector<unsigned int> gain(x.size(), 0);
+    std::vector<unsigned int> candidates;
+    for (unsigned int r : uncovered){
+        for (unsigned int p = rowStart[r]; p < rowStart[r+1]; p++){
+            unsigned int j = rowColumns[p];
+            if (gain[j]++ == 0) candidates.push_back(j);
+        }
+    }
+    std::priority_queue<std::pair<double, unsigned int> > queue;
+    for (unsigned int j : candidates)
+        queue.push(std::make_pair(gain[j] + tieBreak[j], j));
+    unsigned int nUncovered = uncovered.size();
+    while (nUncovered > 0 && !queue.empty()){
+        unsigned int j = queue.top().second;
+        queue.pop();
+        unsigned int g = 0;
+        for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+            if (cover[columnRows[p]] == 0) g++;
+        if (g == 0)
+            continue;
+        double priority = g + tieBreak[j];
+        if (!queue.empty() && priority < queue.top().first){ //gain decreased, not the best anymore
+            queue.push(std::make_pair(priority, j));
+            continue;
+        }
+        x[j] = true;
+        n++;
+        nUncovered -= g;
+        for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+            cover[columnRows[p]]++;
+    }
+}
+
+/**
+ * @brief SetCover::removeRedundant
+ *
+ * Removes from the cover x, in the given order, the chosen columns whose rows are all covered also
+ * by other chosen columns.
+ */
+void SetCover::removeRedundant(std::vector<char>& x, std::vector<unsigned int>& cover, unsigned int& n, const std::vector<unsigned int>& order) const {
+    for (unsigned int j : order){
+        if (!x[j]) continue;
+        bool redundant = true;
+        for (unsigned int p = columnStart[j]; p < columnStart[j+1] && redundant; p++)
+            redundant = cover[columnRows[p]] > 1;
+        if (redundant){
+            x[j] = false;
+            n--;
+            for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                cover[columnRows[p]]--;
+        }
+    }
+}
+
+void SetCover::updateBest(const std::vector<char>& x, unsigned int n) {
+    if (n < bestValue){
+        best = x;
+        bestValue = n;
+    }
+}
+
+/**
+ * @brief SetCover::subgradient
+ *
+ * Subgradient optimization of the lagrangian relaxation of the covering constraints: with
+ * multipliers u, the relaxed problem chooses the columns with negative reduced cost 1 - sum(u) and
+ * its value is a lower bound. Every SET_COVER_HEURISTIC_PERIOD iterations the relaxed solution is
+ * completed into a cover, preferring the columns with lower reduced cost.
+ * @return true if the best cover is proven optimal
+ */
+bool SetCover::subgradient(double timeLimit) {
+    unsigned int nColumns = fixed.size();
+    std::vector<double> u(nActiveRows), reducedCost(nColumns), s(nActiveRows), tieBreak(nColumns);
+    std::vector<char> x(nColumns);
+    for (unsigned int r = 0; r < nActiveRows; r++){
+        u[r] = 1;
+        for (unsigned int p = rowStart[r]; p < rowStart[r+1]; p++){
+            unsigned int j = rowColumns[p];
+            u[r] = std::min(u[r], 1.0 / (columnStart[j+1] - columnStart[j]));
+        }
+    }
+    double lambda = 2, bestL = 0;
+    unsigned int stall = 0;
+    for (unsigned int it = 0; lambda > 0.005 && getElapsedTime() < timeLimit; it++){
+        double L = 0;
+        for (unsigned int r = 0; r < nActiveRows; r++)
+            L += u[r];
+        unsigned int n = 0;
+        for (unsigned int j = 0; j < nColumns; j++){
+            reducedCost[j] = 1;
+            for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                reducedCost[j] -= u[columnRows[p]];
+            x[j] = reducedCost[j] < 0 && columnStart[j+1] > columnStart[j];
+            if (x[j]){
+                L += reducedCost[j];
+                n++;
+            }
+        }
+        if (L > bestL + 1e-9){
+            bestL = L;
+            stall = 0;
+            lowerBound = std::max(lowerBound, (unsigned int)std::ceil(L - 1e-6));
+        }
+        else if (++stall >= SET_COVER_STALL_ITERATIONS){
+            lambda /= 2;
+            stall = 0;
+        }
+        if (bestValue <= lowerBound)
+            return true;
+
+        //subgradient of the covering constraints
+        double norm = 0;
+        std::fill(s.begin(), s.end(), 1);
+        for (unsigned int j = 0; j < nColumns; j++)
+            if (x[j])
+                for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                    s[columnRows[p]]--;
+        for (unsigned int r = 0; r < nActiveRows; r++){
+            if (u[r] <= 0 && s[r] < 0)
+                s[r] = 0;
+            norm += s[r]*s[r];
+        }
+
+        if (it % SET_COVER_HEURISTIC_PERIOD == 0 || norm == 0){
+            std::vector<unsigned int> cover(nActiveRows, 0), order;
+            for (unsigned int j = 0; j < nColumns; j++){
+                tieBreak[j] = 0.2 * (1 - std::max(-1.0, std::min(1.0, reducedCost[j])));
+                if (x[j]){
+                    order.push_back(j);
+                    for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                        cover[columnRows[p]]++;
+                }
+            }
+            std::vector<char> h = x;
+            unsigned int nh = n;
+            complete(h, cover, nh, tieBreak);
+            for (unsigned int j = 0; j < nColumns; j++)
+                if (h[j] && !x[j]) order.push_back(j);
+            std::sort(order.begin(), order.end(), [&reducedCost](unsigned int a, unsigned int b){
+                return reducedCost[a] > reducedCost[b];
+            });
+            removeRedundant(h, cover, nh, order);
+            updateBest(h, nh);
+            if (bestValue <= lowerBound)
+                return true;
+        }
+        if (norm == 0) //the relaxed solution is a cover
+            break;
+
+        double step = lambda * (bestValue - L) / norm;
+        for (unsigned int r = 0; r < nActiveRows; r++)
+            u[r] = std::max(0.0, u[r] + step * s[r]);
+    }
+    return bestValue <= lowerBound;
+}
+
+/**
+ * @brief SetCover::localSearch
+ *
+ * Iterated local search on the best cover: 1 to 3 random columns are removed, the cover is
+ * repaired greedily (random ties, the removed columns lose the ties) and the columns made redundant
+ * by the repair are removed. Covers that are not worse replace the current one.
+ */
+void SetCover::localSearch(double timeLimit) {
+    unsigned int nColumns = fixed.size();
+    std::vector<char> x = best, saved;
+    std::vector<unsigned int> cover(nActiveRows, 0);
+    unsigned int n = bestValue;
+    for (unsigned int j = 0; j < nColumns; j++)
+        if (x[j])
+            for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                cover[columnRows[p]]++;
+    std::vector<double> tieBreak(nColumns);
+    std::uniform_real_distribution<double> random(0, 0.4);
+    std::vector<unsigned int> selected, removed, rows, order;
+    unsigned int stall = 0;
+    while (stall < SET_COVER_ILS_ITERATIONS && bestValue > lowerBound && getElapsedTime() < timeLimit){
+        saved = x;
+        unsigned int m = n;
+        selected.clear();
+        for (unsigned int j = 0; j < nColumns; j++)
+            if (x[j]) selected.push_back(j);
+        for (unsigned int j = 0; j < nColumns; j++)
+            tieBreak[j] = random(rng);
+
+        //perturbation
+        unsigned int k = 1 + rng() % std::min((unsigned int)selected.size(), 3u);
+        removed.clear();
+        rows.clear();
+        for (unsigned int i = 0; i < k; i++){
+            std::swap(selected[i], selected[i + rng() % (selected.size() - i)]);
+            unsigned int j = selected[i];
+            removed.push_back(j);
+            x[j] = false;
+            m--;
+            tieBreak[j] = -0.4;
+            for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++){
+                cover[columnRows[p]]--;
+                rows.push_back(columnRows[p]);
+            }
+        }
+
+        //repair
+        complete(x, cover, m, tieBreak, &rows);
+        order.clear();
+        for (unsigned int j = 0; j < nColumns; j++){
+            if (x[j] && !saved[j]){ //added: the columns sharing a row with it may be redundant
+                for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++){
+                    unsigned int r = columnRows[p];
+                    for (unsigned int q = rowStart[r]; q < rowStart[r+1]; q++)
+                        if (x[rowColumns[q]] && rowColumns[q] != j) order.push_back(rowColumns[q]);
+                }
+            }
+        }
+        std::sort(order.begin(), order.end());
+        order.erase(std::unique(order.begin(), order.end()), order.end());
+        std::shuffle(order.begin(), order.end(), rng);
+        removeRedundant(x, cover, m, order);
+
+        if (m < bestValue){
+            updateBest(x, m);
+            stall = 0;
+        }
+        else
+            stall++;
+        if (m <= n)
+            n = m;
+        else { //rejected, back to the saved cover
+            for (unsigned int j = 0; j < nColumns; j++){
+                if (x[j] == saved[j]) continue;
+                int d = saved[j] ? 1 : -1;
+                for (unsigned int p = columnStart[j]; p < columnStart[j+1]; p++)
+                    cover[columnRows[p]] += d;
+            }
+            x = saved;
+        }
+    }
+}
+
+double SetCover::getElapsedTime() const {
+    return omp_get_wtime() - startTime;
+}
@@ -0,0 +1,82 @@
+#ifndef SETCOVER_H
+#define SETCOVER_H
+
+#include <vector>
+#include <random>
+
+#define SET_COVER_TIME_LIMIT 10 //seconds
+#define SET_COVER_HEURISTIC_PERIOD 10 //subgradient iterations between two runs of the lagrangian heuristic
+#define SET_COVER_STALL_ITERATIONS 20 //subgradient iterations without improvement before halving the step
+#define SET_COVER_ILS_ITERATIONS 20000 //local search iterations without improvement before stopping
+
+/**
+ * @brief The SetCover class
+ *
+ * Unicost set cover: chooses the minimum number of columns (boxes) such that every row (triangle)
+ * is covered by at least one chosen column. Fixed columns are always chosen and do not count.
+ *
+ * The solver builds a greedy solution, computes a lower bound with the subgradient optimization
+ * of the lagrangian relaxation of the covering constraints (every few iterations the lagrangian
+ * solution is completed greedily into a cover), and improves the best cover with an iterated local
+ * search: some columns are removed, the cover is repaired greedily and the redundant columns are
+ * removed. It stops when the cover is proven optimal or when the time limit expires.
+ * Rows not covered by any column are ignored.
+ */
+class SetCover {
+    public:
+        SetCover(unsigned int nRows);
+
+        unsigned int addColumn(const std::vector<unsigned int>& rows, bool fixed = false);
+        unsigned int addColumn(const unsigned int* begin, const unsigned int* end, bool fixed = false);
+        bool solve(double timeLimit = SET_COVER_TIME_LIMIT);
+
+        bool isSelected(unsigned int c) const;
+        unsigned int getNumberSelected() const;
+        unsigned int getLowerBound() const;
+        double getGap() const;
+
+    private:
+        void buildRows();
+        void complete(std::vector<char>& x, std::vector<unsigned int>& cover, unsigned int& n, const std::vector<double>& tieBreak, const std::vector<unsigned int>* rows = nullptr) const;
+        void removeRedundant(std::vector<char>& x, std::vector<unsigned int>& cover, unsigned int& n, const std::vector<unsigned int>& order) const;
+        void updateBest(const std::vector<char>& x, unsigned int n);
+        bool subgradient(double timeLimit);
+        void localSearch(double timeLimit);
+        double getElapsedTime() const;
+
+        unsigned int nRows;
+        std::vector<unsigned int> columnStart, columnRows; //rows of every column
+        std::vector<char> fixed;
+
+        //reduced problem: rows not covered by fixed columns, free columns
+        std::vector<unsigned int> rowStart, rowColumns; //columns of every row
+        std::vector<unsigned int> activeRow; //for every row, its index in the reduced problem, or -1
+        unsigned int nActiveRows;
+
+        std::vector<char> best;
+        unsigned int bestValue, lowerBound;
+        std::mt19937 rng;
+        double startTime;
+};
+
+inline bool SetCover::isSelected(unsigned int c) const {
+    return fixed[c] || best[c];
+}
+
+inline unsigned int SetCover::getNumberSelected() const {
+    return bestValue;
+}
+
+inline unsigned int SetCover::getLowerBound() const {
+    return lowerBound;
+}
+
+/**
+ * @brief SetCover::getGap
+ * @return the relative gap between the best cover and the lower bound (0 if optimal)
+ */
+inline double SetCover::getGap() const {
+    return bestValue == 0 ? 0 : (double)(bestValue - lowerBound) / bestValue;
+}
+
+#endif // SETCOVER_H
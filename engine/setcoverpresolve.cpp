@@ -0,0 +1,230 @@
+#include "setcoverpresolve.h"
+
+#include <iostream>
+#include <unordered_map>
+
+static inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+SetCoverPresolve::SetCoverPresolve(const CoverageMatrix& B, unsigned int nBoxes) :
+        B(B), T(B.getTransposed()), activeBox(nBoxes, 1), activeTriangle(B.getNumberTriangles(), 1),
+        nCovered(nBoxes, 0), nCovering(B.getNumberTriangles(), 0), reduced(0) {
+    unsigned int nTris = B.getNumberTriangles();
+
+    //triangles covered by the fixed boxes
+    for (unsigned int i = nBoxes; i < B.getNumberRows(); i++)
+        for (unsigned int k = 0; k < B.getNumberTriangles(i); k++)
+            activeTriangle[B.getTriangles(i)[k]] = 0;
+    for (unsigned int j = 0; j < nTris; j++){
+        if (activeTriangle[j]){
+            const unsigned int* boxes = T.getTriangles(j);
+            unsigned int n = 0;
+            while (n < T.getNumberTriangles(j) && boxes[n] < nBoxes)
+                n++;
+            nCovering[j] = n;
+            if (n == 0) //not coverable, ignored
+                activeTriangle[j] = 0;
+        }
+    }
+    for (unsigned int i = 0; i < nBoxes; i++)
+        for (unsigned int k = 0; k < B.getNumberTriangles(i); k++)
+            nCovered[i] += activeTriangle[B.getTriangles(i)[k]];
+
+    bool changed = true;
+    while (changed){
+        changed = forceBoxes();
+        changed = collapseTriangles() || changed;
+        changed = removeDominatedBoxes() || changed;
+    }
+
+    //reduced problem
+    std::vector<unsigned int> newTriangle(nTris);
+    unsigned int nReducedTris = 0;
+    for (unsigned int j = 0; j < nTris; j++)
+        newTriangle[j] = activeTriangle[j] ? nReducedTris++ : 0;
+    reduced = CoverageMatrix(nReducedTris);
+    std::vector<unsigned int> row;
+    for (unsigned int i = 0; i < nBoxes; i++){
+        if (activeBox[i]){
+            row.clear();
+            for (unsigned int k = 0; k < B.getNumberTriangles(i); k++){
+                unsigned int j = B.getTriangles(i)[k];
+                if (activeTriangle[j])
+                    row.push_back(newTriangle[j]);
+            }
+            reduced.addRow(row);
+            originalBoxes.push_back(i);
+        }
+    }
+    std::cerr << "Set cover presolve: " << forced.size() << " forced boxes, removed " << nBoxes - reduced.getNumberRows()
+              << " of " << nBoxes << " boxes and " << nTris - nReducedTris << " of " << nTris << " triangles\n";
+}
+
+/**
+ * @brief SetCoverPresolve::forceBoxes
+ *
+ * Forces the boxes that are the only ones covering a triangle.
+ * @return true if at least a box has been forced
+ */
+bool SetCoverPresolve::forceBoxes() {
+    bool changed = false;
+    for (unsigned int j = 0; j < activeTriangle.size(); j++){
+        if (activeTriangle[j] && nCovering[j] == 1){
+            const unsigned int* boxes = T.getTriangles(j);
+            unsigned int k = 0;
+            while (boxes[k] >= activeBox.size() || !activeBox[boxes[k]])
+                k++;
+            forceBox(boxes[k]);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief SetCoverPresolve::collapseTriangles
+ *
+ * Keeps only one of the triangles covered by the same set of boxes.
+ * @return true if at least a triangle has been removed
+ */
+bool SetCoverPresolve::collapseTriangles() {
+    bool changed = false;
+    std::unordered_map<uint64_t, std::vector<unsigned int> > signatures;
+    std::vector<unsigned int> boxes1, boxes2;
+    for (unsigned int j = 0; j < activeTriangle.size(); j++){
+        if (!activeTriangle[j])
+            continue;
+        uint64_t h = nCovering[j];
+        const unsigned int* boxes = T.getTriangles(j);
+        for (unsigned int k = 0; k < T.getNumberTriangles(j); k++)
+            if (boxes[k] < activeBox.size() && activeBox[boxes[k]])
+                h = mix(h ^ (boxes[k] + 0x9e3779b97f4a7c15ULL));
+        std::vector<unsigned int>& same = signatures[h];
+        bool duplicate = false;
+        for (unsigned int l = 0; l < same.size() && !duplicate; l++){
+            unsigned int o = same[l];
+            if (nCovering[o] != nCovering[j])
+                continue;
+            boxes1.clear();
+            boxes2.clear();
+            for (unsigned int k = 0; k < T.getNumberTriangles(j); k++)
+                if (boxes[k] < activeBox.size() && activeBox[boxes[k]])
+                    boxes1.push_back(boxes[k]);
+            for (unsigned int k = 0; k < T.getNumberTriangles(o); k++)
+                if (T.getTriangles(o)[k] < activeBox.size() && activeBox[T.getTriangles(o)[k]])
+                    boxes2.push_back(T.getTriangles(o)[k]);
+            duplicate = boxes1 == boxes2;
+        }
+        if (duplicate){
+            removeTriangle(j);
+            changed = true;
+        }
+        else
+            same.push_back(j);
+    }
+    return changed;
+}
+
+/**
+ * @brief SetCoverPresolve::removeDominatedBoxes
+ *
+ * Removes the boxes whose triangles are covered also by another single box. The candidates are the
+ * boxes covering the triangle of the box covered by the fewest boxes, filtered with a 64 bit
+ * signature of the triangles of every box.
+ * @return true if at least a box has been removed
+ */
+bool SetCoverPresolve::removeDominatedBoxes() {
+    bool changed = false;
+    std::vector<uint64_t> signature(activeBox.size(), 0);
+    for (unsigned int i = 0; i < activeBox.size(); i++){
+        if (activeBox[i]){
+            for (unsigned int k = 0; k < B.getNumberTriangles(i); k++){
+                unsigned int j = B.getTriangles(i)[k];
+                if (activeTriangle[j])
+                    signature[i] |= 1ULL << (mix(j) & 63);
+            }
+        }
+    }
+    for (unsigned int i = 0; i < activeBox.size(); i++){
+        if (!activeBox[i])
+            continue;
+        if (nCovered[i] == 0){
+            removeBox(i);
+            changed = true;
+            continue;
+        }
+        unsigned int rarest = 0;
+        bool found = false;
+        for (unsigned int k = 0; k < B.getNumberTriangles(i); k++){
+            unsigned int j = B.getTriangles(i)[k];
+            if (activeTriangle[j] && (!found || nCovering[j] < nCovering[rarest])){
+                rarest = j;
+                found = true;
+            }
+        }
+        const unsigned int* boxes = T.getTriangles(rarest);
+        bool dominated = false;
+        for (unsigned int k = 0; k < T.getNumberTriangles(rarest) && !dominated; k++){
+            unsigned int o = boxes[k];
+            if (o != i && o < activeBox.size() && activeBox[o] && nCovered[o] >= nCovered[i] &&
+                    (signature[i] & ~signature[o]) == 0)
+                dominated = isSubset(i, o);
+        }
+        if (dominated){
+            removeBox(i);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void SetCoverPresolve::forceBox(unsigned int i) {
+    forced.push_back(i);
+    for (unsigned int k = 0; k < B.getNumberTriangles(i); k++){
+        unsigned int j = B.getTriangles(i)[k];
+        if (activeTriangle[j])
+            removeTriangle(j);
+    }
+    removeBox(i);
+}
+
+void SetCoverPresolve::removeBox(unsigned int i) {
+    activeBox[i] = 0;
+    for (unsigned int k = 0; k < B.getNumberTriangles(i); k++){
+        unsigned int j = B.getTriangles(i)[k];
+        if (activeTriangle[j])
+            nCovering[j]--;
+    }
+}
+
+void SetCoverPresolve::removeTriangle(unsigned int j) {
+    activeTriangle[j] = 0;
+    const unsigned int* boxes = T.getTriangles(j);
+    for (unsigned int k = 0; k < T.getNumberTriangles(j); k++)
+        if (boxes[k] < activeBox.size() && activeBox[boxes[k]])
+            nCovered[boxes[k]]--;
+}
+
+/**
+ * @brief SetCoverPresolve::isSubset
+ * @return true if the active triangles of the box i1 are all covered by the box i2
+ */
+bool SetCoverPresolve::isSubset(unsigned int i1, unsigned int i2) const {
+    const unsigned int* t1 = B.getTriangles(i1);
+    const unsigned int* t2 = B.getTriangles(i2);
+    unsigned int n1 = B.getNumberTriangles(i1), n2 = B.getNumberTriangles(i2);
+    unsigned int k2 = 0;
+    for (unsigned int k1 = 0; k1 < n1; k1++){
+        if (!activeTriangle[t1[k1]])
+            continue;
+        while (k2 < n2 && t2[k2] < t1[k1])
+            k2++;
+        if (k2 == n2 || t2[k2] != t1[k1])
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef SETCOVERPRESOLVE_H
+#define SETCOVERPRESOLVE_H
+
+#include "coveragematrix.h"
+
+/**
+ * @brief The SetCoverPresolve class
+ *
+ * Reduces a unicost box x triangle set cover problem without changing its optimum, applying until
+ * nothing changes:
+ * - a triangle covered by a single box forces the box in the solution (its triangles are removed);
+ * - a box whose triangles are a subset of the triangles of another box is removed;
+ * - triangles covered by the same boxes are collapsed in a single triangle.
+ * Boxes and triangles are compared with hashed signatures before the exact comparison.
+ *
+ * The rows of the input matrix from nBoxes on are fixed boxes: their triangles are already covered.
+ * The reduced problem has the boxes and the triangles not removed, renumbered.
+ */
+class SetCoverPresolve {
+    public:
+        SetCoverPresolve(const CoverageMatrix& B, unsigned int nBoxes);
+
+        const CoverageMatrix& getReduced() const;
+        unsigned int getOriginalBox(unsigned int i) const;
+        const std::vector<unsigned int>& getForcedBoxes() const;
+
+    private:
+        bool forceBoxes();
+        bool collapseTriangles();
+        bool removeDominatedBoxes();
+        void forceBox(unsigned int i);
+        void removeBox(unsigned int i);
+        void removeTriangle(unsigned int j);
+        bool isSubset(unsigned int i1, unsigned int i2) const;
+
+        const CoverageMatrix& B; //box x triangle
+        CoverageMatrix T; //triangle x box
+        std::vector<char> activeBox, activeTriangle;
+        std::vector<unsigned int> nCovered; //active triangles of every box
+        std::vector<unsigned int> nCovering; //active boxes of every triangle
+
+        CoverageMatrix reduced;
+        std::vector<unsigned int> originalBoxes, forced;
+};
+
+inline const CoverageMatrix& SetCoverPresolve::getReduced() const {
+    return reduced;
+}
+
+/**
+ * @brief SetCoverPresolve::getOriginalBox
+ * @return the index in the input matrix of the box i of the reduced problem
+ */
+inline unsigned int SetCoverPresolve::getOriginalBox(unsigned int i) const {
+    return originalBoxes[i];
+}
+
+/**
+ * @brief SetCoverPresolve::getForcedBoxes
+ * @return the boxes (indices of the input matrix) that are in every optimal solution
+ */
+inline const std::vector<unsigned int>& SetCoverPresolve::getForcedBoxes() const {
+    return forced;
+}
+
+#endif // SETCOVERPRESOLVE_H
@@ -321,9 +321,9 @@ int Splitting::getMinTrianglesCoveredIfBoxesSplitted(const Box3D &b1, const Box3
 
     Box3D b3;
     getSplits(b1, b2, b3);
-    std::set<unsigned int> b3t = getTrianglesCovered(b3, tree);
+    BitmapSet b3t = getTrianglesCovered(b3, tree);
     b3t = intersection(b3t, b2.getTrianglesCovered());
-    std::set<unsigned int> b2t = difference(difference(b2.getTrianglesCovered(), b1.getTrianglesCovered()), b3t);
+    BitmapSet b2t = difference(difference(b2.getTrianglesCovered(), b1.getTrianglesCovered()), b3t);
 
     if (b3t.size() == 0){
         return b2t.size();
@@ -332,17 +332,18 @@ int Splitting::getMinTrianglesCoveredIfBoxesSplitted(const Box3D &b1, const Box3
     return min;
 }
 
-std::set<unsigned int> Splitting::getTrianglesCovered(const Box3D &b, const cgal::AABBTree& aabb, bool completely) {
-    std::set<unsigned int> trianglesCovered;
+BitmapSet Splitting::getTrianglesCovered(const Box3D &b, const cgal::AABBTree& aabb, bool completely) {
+    std::vector<unsigned int> trianglesCovered;
     std::list<const Dcel::Face*> list;
     if (completely)
         aabb.getCompletelyContainedDcelFaces(list, b);
     else
         aabb.getContainedDcelFaces(list, b);
+    trianglesCovered.reserve(list.size());
     for (const Dcel::Face* f : list){
-        trianglesCovered.insert(f->getId());
+        trianglesCovered.push_back(f->getId());
     }
-    return trianglesCovered;
+    return BitmapSet(trianglesCovered.begin(), trianglesCovered.end());
 }
 
 DirectedGraph Splitting::getGraph(const BoxList& bl, const cgal::AABBTree &tree){
@@ -439,42 +440,25 @@ std::pair<unsigned int, unsigned int> Splitting::getArcToRemove(const std::vecto
     return arcToRemove;
 }
 
-void Splitting::chooseBestSplit(Box3D &b1, Box3D &b2, const BoxList &bl, const cgal::AABBTree& tree, const std::set<unsigned int>& boxesToEliminate){
+void Splitting::chooseBestSplit(Box3D &b1, Box3D &b2, const cgal::AABBTree& tree, const TriangleIndex& index){
     Box3D bt3mp1, b3tmp2;
     getSplits(b2,b1,b3tmp2);
     //std::set<unsigned int> trianglesCoveredTmp2 = getTrianglesCovered(btmp2, tree, false);
-    std::set<unsigned int> trianglesCoveredB3Tmp2 = getTrianglesCovered(b3tmp2, tree);
+    BitmapSet trianglesCoveredB3Tmp2 = getTrianglesCovered(b3tmp2, tree);
     trianglesCoveredB3Tmp2 = difference(intersection(trianglesCoveredB3Tmp2, b1.getTrianglesCovered()), b2.getTrianglesCovered());
     if (trianglesCoveredB3Tmp2.size() == 0 || ((b3tmp2.min() == b3tmp2.max()) && (b3tmp2.min() == Pointd()))){
         std::swap(b1, b2);
     }
     else {
-        bool exit = false;
-
-        for (unsigned int i = 0; i < bl.getNumberBoxes() && !exit; i++){
-            if (boxesToEliminate.find(i) == boxesToEliminate.end() && (int)i != b1.getId()){
-                const std::set<unsigned int>& trianglesCoveredBi = bl[i].getTrianglesCovered();
-                if (isSubset(trianglesCoveredB3Tmp2, trianglesCoveredBi)){
-                    exit = true;
-                }
-            }
-        }
+        bool exit = index.isCoveredByOtherBox(trianglesCoveredB3Tmp2, b1.getId());
         if (exit)
             std::swap(b1, b2);
         else {
             getSplits(b1,b2,bt3mp1);
-            std::set<unsigned int> trianglesCoveredB3Tmp1 = getTrianglesCovered(bt3mp1, tree);
+            BitmapSet trianglesCoveredB3Tmp1 = getTrianglesCovered(bt3mp1, tree);
             trianglesCoveredB3Tmp1 = difference(intersection(trianglesCoveredB3Tmp1, b2.getTrianglesCovered()), b1.getTrianglesCovered());
             if ((bt3mp1.min() != Pointd() || bt3mp1.max() != Pointd()) && trianglesCoveredB3Tmp1.size() != 0){
-                bool exit = false;
-                for (unsigned int i = 0; i < bl.getNumberBoxes() && !exit; i++){
-                    if (boxesToEliminate.find(i) == boxesToEliminate.end() && (int)i != b2.getId()){
-                        const std::set<unsigned int>& trianglesCoveredBi = bl[i].getTrianglesCovered();
-                        if (isSubset(trianglesCoveredB3Tmp1, trianglesCoveredBi)){
-                            exit = true;
-                        }
-                    }
-                }
+                bool exit = index.isCoveredByOtherBox(trianglesCoveredB3Tmp1, b2.getId());
                 if (!exit){
                     if (trianglesCoveredB3Tmp2.size() > trianglesCoveredB3Tmp1.size())
                         std::swap(b1, b2);
@@ -484,34 +468,26 @@ void Splitting::chooseBestSplit(Box3D &b1, Box3D &b2, const BoxList &bl, const c
     }
 }
 
-bool Splitting::checkDeleteBox(const Box3D &b, const std::set<unsigned int>& boxesToEliminate,  const BoxList &bl){
+bool Splitting::checkDeleteBox(const Box3D &b, const TriangleIndex& index){
     bool bIsEliminated = false;
     if (b.getTrianglesCovered().size() == 0){
         bIsEliminated = true;
     }
     else {
-        for (unsigned int i = 0; i < bl.getNumberBoxes() && !bIsEliminated; i++){
-            if (boxesToEliminate.find(i) == boxesToEliminate.end() && (int)i != b.getId()){
-                const std::set<unsigned int>& trianglesCoveredBi = bl[i].getTrianglesCovered();
-
-                if (isSubset(b.getTrianglesCovered(), trianglesCoveredBi)){
-                    bIsEliminated = true;
-                }
-            }
-        }
+        bIsEliminated = index.isCoveredByOtherBox(b.getTrianglesCovered(), b.getId());
     }
     return bIsEliminated;
 }
 
-void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph& g, const cgal::AABBTree& tree, std::set<unsigned int> &boxesToEliminate, std::map<unsigned int, unsigned int> &mappingNewToOld, int& numberOfSplits, int& deletedBoxes, std::set<std::pair<unsigned int, unsigned int>, cmpUnorderedStdPair<unsigned int>> &impossibleArcs) {
+void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph& g, const cgal::AABBTree& tree, TriangleIndex& index, std::set<unsigned int> &boxesToEliminate, std::map<unsigned int, unsigned int> &mappingNewToOld, int& numberOfSplits, int& deletedBoxes, std::set<std::pair<unsigned int, unsigned int>, cmpUnorderedStdPair<unsigned int>> &impossibleArcs) {
     int lastId = bl[0].getId();
     for (unsigned int i = 1; i < bl.getNumberBoxes(); i++){
         if (bl[i].getId() > lastId)
             lastId = bl[i].getId();
     }
-    std::set<unsigned int> tcb1 = b1.getTrianglesCovered();
-    std::set<unsigned int> tcb2 = b2.getTrianglesCovered();
-    std::set<unsigned int> tcb23 = difference(tcb2, tcb1);
+    const BitmapSet& tcb1 = b1.getTrianglesCovered();
+    const BitmapSet& tcb2 = b2.getTrianglesCovered();
+    BitmapSet tcb23 = difference(tcb2, tcb1);
     Box3D b3;
     splitBox(b1, b2, b3);
     //splitBox(b1, b2, b3, d.getAverageHalfEdgesLength()*LENGTH_MULTIPLIER);
@@ -522,11 +498,12 @@ void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph&
         g.removeEdgeIfExists(b2.getId(), b1.getId());
         b3.setId(lastId+1);
         //std::set<unsigned int> tcb3 = Common::setIntersection(getTrianglesCovered(b3, tree, false), tcb23);
-        std::set<unsigned int> tcb3 = intersection(getTrianglesCovered(b3, tree), tcb23);
+        BitmapSet tcb3 = intersection(getTrianglesCovered(b3, tree), tcb23);
 
         /////gestione b2:
         b2.setTrianglesCovered(difference(tcb23, tcb3));
         bl.setBox(b2.getId(), b2);
+        index.updateBox(b2.getId(), b2.getTrianglesCovered());
         ///
         //b1.getEigenMesh().saveOnObj("b1.obj");
         //b2.getEigenMesh().saveOnObj("b2.obj");
@@ -538,10 +515,11 @@ void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph&
         g.deleteAllOutgoingNodes(b2.getId());
 
         //qualcuno copre già tutti i triangoli coperti da b2? se si, b2 viene aggiunta alle box da eliminare, e nessun arco punterà più ad essa
-        bool b2IsEliminated = Splitting::checkDeleteBox(b2, boxesToEliminate, bl);
+        bool b2IsEliminated = Splitting::checkDeleteBox(b2, index);
 
         if (b2IsEliminated){
             boxesToEliminate.insert(b2.getId());
+            index.removeBox(b2.getId());
             deletedBoxes++;
         }
         else{
@@ -571,13 +549,14 @@ void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph&
 
         //qualcuno copre già tutti i triangoli coperti da b3? se si, b3 non viene aggiunta alla box list
         b3.setTrianglesCovered(tcb3);
-        bool b3IsEliminated = Splitting::checkDeleteBox(b3, boxesToEliminate, bl);
+        bool b3IsEliminated = Splitting::checkDeleteBox(b3, index);
 
         if (b3IsEliminated){
             deletedBoxes++;
         }
         else {
             bl.addBox(b3);
+            index.addBox(b3.getId(), tcb3);
             bool cont = true;
             unsigned int idtmp = b2.getId();
             do {
@@ -619,6 +598,7 @@ void Splitting::splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph&
         g.removeEdgeIfExists(b2.getId(), b1.getId());
         b2.setTrianglesCovered(tcb23);
         bl.setBox(b2.getId(), b2);
+        index.updateBox(b2.getId(), b2.getTrianglesCovered());
     }
 }
 
@@ -634,6 +614,7 @@ Array2D<int> Splitting::getOrdering(BoxList& bl, const Dcel& d, std::map<unsigne
     std::set<std::pair<unsigned int, unsigned int>, cmpUnorderedStdPair<unsigned int>> impossibleArcs;
 
     DirectedGraph g = getGraph(bl, tree);
+    TriangleIndex index(bl); //triangles -> boxes not in boxesToEliminate
 
     for (const std::pair<unsigned int, unsigned int>& p : userArcs)
         g.addEdge(p.first, p.second);
@@ -658,7 +639,7 @@ Array2D<int> Splitting::getOrdering(BoxList& bl, const Dcel& d, std::map<unsigne
             for (unsigned int out : outgoing) {
                 Box3D b2 = bl.find(out);
                 std::cerr << b1.getId() << " will split " << b2.getId() << "\n";
-                splitB2(b1, b2, bl, g, tree, boxesToEliminate, mappingNewToOld, numberOfSplits, deletedBoxes, impossibleArcs);
+                splitB2(b1, b2, bl, g, tree, index, boxesToEliminate, mappingNewToOld, numberOfSplits, deletedBoxes, impossibleArcs);
             }
 
             /*for (unsigned int inc : incoming){
@@ -695,14 +676,14 @@ Array2D<int> Splitting::getOrdering(BoxList& bl, const Dcel& d, std::map<unsigne
             /// now I can choose which box split, b1 or b2
 
             if (std::find(userArcs.begin(), userArcs.end(), std::pair<unsigned int, unsigned int>(arcToRemove.second, arcToRemove.first)) == userArcs.end())
-                chooseBestSplit(b1, b2, bl, tree, boxesToEliminate);
+                chooseBestSplit(b1, b2, tree, index);
             //now b1 will split b2 in b2+b3
 
             ///
             ///
             ///
 
-            splitB2(b1, b2, bl, g, tree, boxesToEliminate, mappingNewToOld, numberOfSplits, deletedBoxes, impossibleArcs);
+            splitB2(b1, b2, bl, g, tree, index, boxesToEliminate, mappingNewToOld, numberOfSplits, deletedBoxes, impossibleArcs);
         }
     }while (loops.size() > 0);
 
@@ -3,6 +3,7 @@
 
 #include "heightfieldslist.h"
 #include "boxlist.h"
+#include "triangleindex.h"
 #include "cg3/cgal/aabbtree.h"
 #include "lib/graph/directedgraph.h"
 #include <cg3/utilities/comparators.h>
@@ -26,17 +27,17 @@ namespace Splitting {
 
     int getMinTrianglesCoveredIfBoxesSplitted(const Box3D &b1, const Box3D &b2, const cg3::cgal::AABBTree& tree);
 
-    std::set<unsigned int> getTrianglesCovered(const Box3D& b, const cg3::cgal::AABBTree &aabb, bool completely = true);
+    BitmapSet getTrianglesCovered(const Box3D& b, const cg3::cgal::AABBTree &aabb, bool completely = true);
 
     DirectedGraph getGraph(const BoxList& bl, const cg3::cgal::AABBTree &tree);
 
     std::pair<unsigned int, unsigned int> getArcToRemove(const std::vector<std::vector<unsigned int> > &loops, const BoxList& bl, const std::vector<std::pair<unsigned int, unsigned int> >& userArcs, const cg3::cgal::AABBTree& tree);
 
-    void chooseBestSplit(Box3D &b1, Box3D &b2, const BoxList &bl, const cg3::cgal::AABBTree& tree, const std::set<unsigned int>& boxToEliminate);
+    void chooseBestSplit(Box3D &b1, Box3D &b2, const cg3::cgal::AABBTree& tree, const TriangleIndex& index);
 
-    bool checkDeleteBox(const Box3D &b, const std::set<unsigned int>& boxesToEliminate,  const BoxList &bl);
+    bool checkDeleteBox(const Box3D &b, const TriangleIndex& index);
 
-    void splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph& g, const cg3::cgal::AABBTree& tree, std::set<unsigned int> &boxesToEliminate, std::map<unsigned int, unsigned int> &mappingNewToOld, int& numberOfSplits, int& deletedBoxes, std::set<std::pair<unsigned int, unsigned int>, cg3::cmpUnorderedStdPair<unsigned int> >& impossibleArcs);
+    void splitB2(const Box3D& b1, Box3D& b2, BoxList& bl, DirectedGraph& g, const cg3::cgal::AABBTree& tree, TriangleIndex& index, std::set<unsigned int> &boxesToEliminate, std::map<unsigned int, unsigned int> &mappingNewToOld, int& numberOfSplits, int& deletedBoxes, std::set<std::pair<unsigned int, unsigned int>, cg3::cmpUnorderedStdPair<unsigned int> >& impossibleArcs);
 
     cg3::Array2D<int> getOrdering(BoxList& bl, const cg3::Dcel &d, std::map<unsigned int, unsigned int>& mappingNewToOld, std::list<unsigned int>& priorityBoxes, const std::vector<std::pair<unsigned int, unsigned int> >& userArcs);
 }
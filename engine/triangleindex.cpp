@@ -0,0 +1,96 @@
+#include "triangleindex.h"
+
+TriangleIndex::TriangleIndex(const BoxList& bl) : nLive(0) {
+    for (unsigned int i = 0; i < bl.getNumberBoxes(); i++)
+        addBox(bl[i].getId(), bl[i].getTrianglesCovered());
+}
+
+void TriangleIndex::addBox(unsigned int id, const BitmapSet& triangles) {
+    if (id >= live.size()){
+        live.resize(id+1, 0);
+        boxTriangles.resize(id+1);
+    }
+    if (live[id])
+        removeBox(id);
+    live[id] = 1;
+    nLive++;
+    boxTriangles[id] = triangles;
+    addPostings(id, triangles);
+}
+
+/**
+ * @brief TriangleIndex::updateBox
+ *
+ * Sets the triangles covered by the live box id, updating only the postings of the triangles
+ * gained or lost by the box. Removed boxes are not updated.
+ */
+void TriangleIndex::updateBox(unsigned int id, const BitmapSet& triangles) {
+    if (id >= live.size() || !live[id])
+        return;
+    removePostings(id, difference(boxTriangles[id], triangles));
+    addPostings(id, difference(triangles, boxTriangles[id]));
+    boxTriangles[id] = triangles;
+}
+
+void TriangleIndex::removeBox(unsigned int id) {
+    if (id >= live.size() || !live[id])
+        return;
+    removePostings(id, boxTriangles[id]);
+    boxTriangles[id].clear();
+    live[id] = 0;
+    nLive--;
+}
+
+/**
+ * @brief TriangleIndex::isCoveredByOtherBox
+ *
+ * Intersects the posting lists of the triangles of s, starting from the rarest one.
+ * @return true if all the triangles of s are covered by a single live box different from id
+ * (id may be -1, or the id of a box not in the index)
+ */
+bool TriangleIndex::isCoveredByOtherBox(const BitmapSet& s, int id) const {
+    bool idIsLive = id >= 0 && (unsigned int)id < live.size() && live[id];
+    if (s.empty())
+        return nLive > (idIsLive ? 1 : 0);
+
+    unsigned int rarest = *s.begin();
+    for (unsigned int t : s){
+        if (t >= postings.size())
+            return false;
+        if (postings[t].size() < postings[rarest].size())
+            rarest = t;
+    }
+    std::vector<unsigned int> candidates;
+    for (unsigned int b : postings[rarest])
+        if ((int)b != id)
+            candidates.push_back(b);
+    for (BitmapSet::const_iterator it = s.begin(); it != s.end() && !candidates.empty(); ++it){
+        if (*it == rarest)
+            continue;
+        const std::vector<unsigned int>& p = postings[*it];
+        unsigned int n = 0;
+        for (unsigned int b : candidates)
+            if (std::binary_search(p.begin(), p.end(), b))
+                candidates[n++] = b;
+        candidates.resize(n);
+    }
+    return !candidates.empty();
+}
+
+void TriangleIndex::addPostings(unsigned int id, const BitmapSet& triangles) {
+    for (unsigned int t : triangles){
+        if (t >= postings.size())
+            postings.resize(t+1);
+        std::vector<unsigned int>& p = postings[t];
+        p.insert(std::lower_bound(p.begin(), p.end(), id), id);
+    }
+}
+
+void TriangleIndex::removePostings(unsigned int id, const BitmapSet& triangles) {
+    for (unsigned int t : triangles){
+        std::vector<unsigned int>& p = postings[t];
+        std::vector<unsigned int>::iterator it = std::lower_bound(p.begin(), p.end(), id);
+        if (it != p.end() && *it == id)
+            p.erase(it);
+    }
+}
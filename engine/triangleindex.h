@@ -0,0 +1,34 @@
+#ifndef TRIANGLEINDEX_H
+#define TRIANGLEINDEX_H
+
+#include "boxlist.h"
+
+/**
+ * @brief The TriangleIndex class
+ *
+ * Inverted index from the triangles to the live boxes covering them, used by the splitting to find
+ * whether a set of triangles is already covered by another single box without scanning all the
+ * boxes. Boxes are identified by their id; the index is updated when the triangles covered by a box
+ * change, when a box is added and when a box is removed.
+ */
+class TriangleIndex {
+    public:
+        TriangleIndex(const BoxList& bl);
+
+        void addBox(unsigned int id, const BitmapSet& triangles);
+        void updateBox(unsigned int id, const BitmapSet& triangles);
+        void removeBox(unsigned int id);
+
+        bool isCoveredByOtherBox(const BitmapSet& s, int id) const;
+
+    private:
+        void addPostings(unsigned int id, const BitmapSet& triangles);
+        void removePostings(unsigned int id, const BitmapSet& triangles);
+
+        std::vector<std::vector<unsigned int> > postings; //for every triangle, the sorted ids of the live boxes covering it
+        std::vector<BitmapSet> boxTriangles; //for every id, the triangles covered by the box
+        std::vector<char> live;
+        unsigned int nLive;
+};
+
+#endif // TRIANGLEINDEX_H
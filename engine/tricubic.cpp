@@ -1,229 +1,405 @@
 ﻿#include "tricubic.h"
 
+#include <unordered_map>
+#include <cstring>
+#include <omp.h>
+
 using namespace cg3;
 
+static gridreal temp[64][64] = {
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-3, 3, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 2,-2, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 9,-9,-9, 9, 0, 0, 0, 0, 6, 3,-6,-3, 0, 0, 0, 0, 6,-6, 3,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-6, 6, 6,-6, 0, 0, 0, 0,-3,-3, 3, 3, 0, 0, 0, 0,-4, 4,-2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-2,-1,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-6, 6, 6,-6, 0, 0, 0, 0,-4,-2, 4, 2, 0, 0, 0, 0,-3, 3,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 4,-4,-4, 4, 0, 0, 0, 0, 2, 2,-2,-2, 0, 0, 0, 0, 2,-2, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9,-9,-9, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 3,-6,-3, 0, 0, 0, 0, 6,-6, 3,-3, 0, 0, 0, 0, 4, 2, 2, 1, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3,-3, 3, 3, 0, 0, 0, 0,-4, 4,-2, 2, 0, 0, 0, 0,-2,-2,-1,-1, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4,-2, 4, 2, 0, 0, 0, 0,-3, 3,-3, 3, 0, 0, 0, 0,-2,-1,-2,-1, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,-4,-4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2,-2,-2, 0, 0, 0, 0, 2,-2, 2,-2, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0},
+    {-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 9,-9, 0, 0,-9, 9, 0, 0, 6, 3, 0, 0,-6,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6,-6, 0, 0, 3,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 2, 0, 0, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-6, 6, 0, 0, 6,-6, 0, 0,-3,-3, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 4, 0, 0,-2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-2, 0, 0,-1,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9,-9, 0, 0,-9, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 3, 0, 0,-6,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6,-6, 0, 0, 3,-3, 0, 0, 4, 2, 0, 0, 2, 1, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 0, 0, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3,-3, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 4, 0, 0,-2, 2, 0, 0,-2,-2, 0, 0,-1,-1, 0, 0},
+    { 9, 0,-9, 0,-9, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 3, 0,-6, 0,-3, 0, 6, 0,-6, 0, 3, 0,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 2, 0, 2, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 9, 0,-9, 0,-9, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 3, 0,-6, 0,-3, 0, 6, 0,-6, 0, 3, 0,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 2, 0, 2, 0, 1, 0},
+    {-27,27,27,-27,27,-27,-27,27,-18,-9,18, 9,18, 9,-18,-9,-18,18,-9, 9,18,-18, 9,-9,-18,18,18,-18,-9, 9, 9,-9,-12,-6,-6,-3,12, 6, 6, 3,-12,-6,12, 6,-6,-3, 6, 3,-12,12,-6, 6,-6, 6,-3, 3,-8,-4,-4,-2,-4,-2,-2,-1},
+    {18,-18,-18,18,-18,18,18,-18, 9, 9,-9,-9,-9,-9, 9, 9,12,-12, 6,-6,-12,12,-6, 6,12,-12,-12,12, 6,-6,-6, 6, 6, 6, 3, 3,-6,-6,-3,-3, 6, 6,-6,-6, 3, 3,-3,-3, 8,-8, 4,-4, 4,-4, 2,-2, 4, 4, 2, 2, 2, 2, 1, 1},
+    {-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0,-3, 0, 3, 0, 3, 0,-4, 0, 4, 0,-2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-2, 0,-1, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0,-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0,-3, 0, 3, 0, 3, 0,-4, 0, 4, 0,-2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-2, 0,-1, 0,-1, 0},
+    {18,-18,-18,18,-18,18,18,-18,12, 6,-12,-6,-12,-6,12, 6, 9,-9, 9,-9,-9, 9,-9, 9,12,-12,-12,12, 6,-6,-6, 6, 6, 3, 6, 3,-6,-3,-6,-3, 8, 4,-8,-4, 4, 2,-4,-2, 6,-6, 6,-6, 3,-3, 3,-3, 4, 2, 4, 2, 2, 1, 2, 1},
+    {-12,12,12,-12,12,-12,-12,12,-6,-6, 6, 6, 6, 6,-6,-6,-6, 6,-6, 6, 6,-6, 6,-6,-8, 8, 8,-8,-4, 4, 4,-4,-3,-3,-3,-3, 3, 3, 3, 3,-4,-4, 4, 4,-2,-2, 2, 2,-4, 4,-4, 4,-2, 2,-2, 2,-2,-2,-2,-2,-1,-1,-1,-1},
+    { 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {-6, 6, 0, 0, 6,-6, 0, 0,-4,-2, 0, 0, 4, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 4,-4, 0, 0,-4, 4, 0, 0, 2, 2, 0, 0,-2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 0, 0, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4,-2, 0, 0, 4, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0,-3, 3, 0, 0,-2,-1, 0, 0,-2,-1, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,-4, 0, 0,-4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0,-2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 2,-2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0},
+    {-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 0,-2, 0, 4, 0, 2, 0,-3, 0, 3, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0,-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 0,-2, 0, 4, 0, 2, 0,-3, 0, 3, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0,-2, 0,-1, 0},
+    {18,-18,-18,18,-18,18,18,-18,12, 6,-12,-6,-12,-6,12, 6,12,-12, 6,-6,-12,12,-6, 6, 9,-9,-9, 9, 9,-9,-9, 9, 8, 4, 4, 2,-8,-4,-4,-2, 6, 3,-6,-3, 6, 3,-6,-3, 6,-6, 3,-3, 6,-6, 3,-3, 4, 2, 2, 1, 4, 2, 2, 1},
+    {-12,12,12,-12,12,-12,-12,12,-6,-6, 6, 6, 6, 6,-6,-6,-8, 8,-4, 4, 8,-8, 4,-4,-6, 6, 6,-6,-6, 6, 6,-6,-4,-4,-2,-2, 4, 4, 2, 2,-3,-3, 3, 3,-3,-3, 3, 3,-4, 4,-2, 2,-4, 4,-2, 2,-2,-2,-1,-1,-2,-2,-1,-1},
+    { 4, 0,-4, 0,-4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0,-2, 0,-2, 0, 2, 0,-2, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    { 0, 0, 0, 0, 0, 0, 0, 0, 4, 0,-4, 0,-4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0,-2, 0,-2, 0, 2, 0,-2, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0},
+    {-12,12,12,-12,12,-12,-12,12,-8,-4, 8, 4, 8, 4,-8,-4,-6, 6,-6, 6, 6,-6, 6,-6,-6, 6, 6,-6,-6, 6, 6,-6,-4,-2,-4,-2, 4, 2, 4, 2,-4,-2, 4, 2,-4,-2, 4, 2,-3, 3,-3, 3,-3, 3,-3, 3,-2,-1,-2,-1,-2,-1,-2,-1},
+    { 8,-8,-8, 8,-8, 8, 8,-8, 4, 4,-4,-4,-4,-4, 4, 4, 4,-4, 4,-4,-4, 4,-4, 4, 4,-4,-4, 4, 4,-4,-4, 4, 2, 2, 2, 2,-2,-2,-2,-2, 2, 2,-2,-2, 2, 2,-2,-2, 2,-2, 2,-2, 2,-2, 2,-2, 1, 1, 1, 1, 1, 1, 1, 1}
+};
+
+static Eigen::Map<Eigen::Matrix<gridreal,64,64, Eigen::RowMajor>> C(&temp[0][0]);
+
+/**
+ * Hash of 64 values (FNV-1a on their bits). Zeros are normalized, so that 0 and -0 (equal values)
+ * have the same hash.
+ */
+struct CoefficientsHash {
+    size_t operator()(const std::array<gridreal, 64>& a) const {
+        uint64_t h = 14695981039346656037ULL;
+        for (gridreal v : a){
+            if (v == 0) v = 0;
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            h = (h ^ bits) * 1099511628211ULL;
+        }
+        return h;
+    }
+};
+
+typedef std::unordered_map<std::array<gridreal, 64>, int, CoefficientsHash> CoefficientsMap;
+
+static const unsigned int COEFFICIENTS_BLOCK = 1024;
+
+/**
+ * @brief getDerivatives
+ *
+ * Values and derivatives (finite differences) at the corners of a cell, computed from the weights of the
+ * 4x4x4 grid points around it: neighbourhood[(a+1) + 4(b+1) + 16(c+1)] is the weight of the
+ * point (xi+a, yi+b, zi+c) of the grid, with a, b, c in [-1, 2].
+ * The coefficients of the tricubic interpolant are C * x.
+ */
+static void getDerivatives(gridreal values[64], const gridreal neighbourhood[64]) {
+    auto w = [&neighbourhood](int a, int b, int c) {
+        return neighbourhood[(a+1) + 4*(b+1) + 16*(c+1)];
+    };
+    Eigen::Map<Eigen::Matrix<gridreal,64,1> > x(values);
+    x <<
+            // values of f(x,y,z) at each corner.
+            w(0,0,0),w(1,0,0),w(0,1,0),
+            w(1,1,0),w(0,0,1),w(1,0,1),
+            w(0,1,1),w(1,1,1),
+            // values of df/dx at each corner.
+            0.5*(w(1,0,0)-w(-1,0,0)),
+            0.5*(w(2,0,0)-w(0,0,0)),
+            0.5*(w(1,1,0)-w(-1,1,0)),
+            0.5*(w(2,1,0)-w(0,1,0)),
+            0.5*(w(1,0,1)-w(-1,0,1)),
+            0.5*(w(2,0,1)-w(0,0,1)),
+            0.5*(w(1,1,1)-w(-1,1,1)),
+            0.5*(w(2,1,1)-w(0,1,1)),
+            // values of df/dy at each corner.
+            0.5*(w(0,1,0)-w(0,-1,0)),
+            0.5*(w(1,1,0)-w(1,-1,0)),
+            0.5*(w(0,2,0)-w(0,0,0)),
+            0.5*(w(1,2,0)-w(1,0,0)),
+            0.5*(w(0,1,1)-w(0,-1,1)),
+            0.5*(w(1,1,1)-w(1,-1,1)),
+            0.5*(w(0,2,1)-w(0,0,1)),
+            0.5*(w(1,2,1)-w(1,0,1)),
+            // values of df/dz at each corner.
+            0.5*(w(0,0,1)-w(0,0,-1)),
+            0.5*(w(1,0,1)-w(1,0,-1)),
+            0.5*(w(0,1,1)-w(0,1,-1)),
+            0.5*(w(1,1,1)-w(1,1,-1)),
+            0.5*(w(0,0,2)-w(0,0,0)),
+            0.5*(w(1,0,2)-w(1,0,0)),
+            0.5*(w(0,1,2)-w(0,1,0)),
+            0.5*(w(1,1,2)-w(1,1,0)),
+            // values of d2f/dxdy at each corner.
+            0.25*(w(1,1,0)-w(-1,1,0)-w(1,-1,0)+w(-1,-1,0)),
+            0.25*(w(2,1,0)-w(0,1,0)-w(2,-1,0)+w(0,-1,0)),
+            0.25*(w(1,2,0)-w(-1,2,0)-w(1,0,0)+w(-1,0,0)),
+            0.25*(w(2,2,0)-w(0,2,0)-w(2,0,0)+w(0,0,0)),
+            0.25*(w(1,1,1)-w(-1,1,1)-w(1,-1,1)+w(-1,-1,1)),
+            0.25*(w(2,1,1)-w(0,1,1)-w(2,-1,1)+w(0,-1,1)),
+            0.25*(w(1,2,1)-w(-1,2,1)-w(1,0,1)+w(-1,0,1)),
+            0.25*(w(2,2,1)-w(0,2,1)-w(2,0,1)+w(0,0,1)),
+            // values of d2f/dxdz at each corner.
+            0.25*(w(1,0,1)-w(-1,0,1)-w(1,0,-1)+w(-1,0,-1)),
+            0.25*(w(2,0,1)-w(0,0,1)-w(2,0,-1)+w(0,0,-1)),
+            0.25*(w(1,1,1)-w(-1,1,1)-w(1,1,-1)+w(-1,1,-1)),
+            0.25*(w(2,1,1)-w(0,1,1)-w(2,1,-1)+w(0,1,-1)),
+            0.25*(w(1,0,2)-w(-1,0,2)-w(1,0,0)+w(-1,0,0)),
+            0.25*(w(2,0,2)-w(0,0,2)-w(2,0,0)+w(0,0,0)),
+            0.25*(w(1,1,2)-w(-1,1,2)-w(1,1,0)+w(-1,1,0)),
+            0.25*(w(2,1,2)-w(0,1,2)-w(2,1,0)+w(0,1,0)),
+            // values of d2f/dydz at each corner.
+            0.25*(w(0,1,1)-w(0,-1,1)-w(0,1,-1)+w(0,-1,-1)),
+            0.25*(w(1,1,1)-w(1,-1,1)-w(1,1,-1)+w(1,-1,-1)),
+            0.25*(w(0,2,1)-w(0,0,1)-w(0,2,-1)+w(0,0,-1)),
+            0.25*(w(1,2,1)-w(1,0,1)-w(1,2,-1)+w(1,0,-1)),
+            0.25*(w(0,1,2)-w(0,-1,2)-w(0,1,0)+w(0,-1,0)),
+            0.25*(w(1,1,2)-w(1,-1,2)-w(1,1,0)+w(1,-1,0)),
+            0.25*(w(0,2,2)-w(0,0,2)-w(0,2,0)+w(0,0,0)),
+            0.25*(w(1,2,2)-w(1,0,2)-w(1,2,0)+w(1,0,0)),
+            // values of d3f/dxdydz at each corner.
+            0.125*(w(1,1,1)-w(-1,1,1)-w(1,-1,1)+w(-1,-1,1)-w(1,1,-1)+w(-1,1,-1)+w(1,-1,-1)-w(-1,-1,-1)),
+            0.125*(w(2,1,1)-w(0,1,1)-w(2,-1,1)+w(0,-1,1)-w(2,1,-1)+w(0,1,-1)+w(2,-1,-1)-w(0,-1,-1)),
+            0.125*(w(1,2,1)-w(-1,2,1)-w(1,0,1)+w(-1,0,1)-w(1,2,-1)+w(-1,2,-1)+w(1,0,-1)-w(-1,0,-1)),
+            0.125*(w(2,2,1)-w(0,2,1)-w(2,0,1)+w(0,0,1)-w(2,2,-1)+w(0,2,-1)+w(2,0,-1)-w(0,0,-1)),
+            0.125*(w(1,1,2)-w(-1,1,2)-w(1,-1,2)+w(-1,-1,2)-w(1,1,0)+w(-1,1,0)+w(1,-1,0)-w(-1,-1,0)),
+            0.125*(w(2,1,2)-w(0,1,2)-w(2,-1,2)+w(0,-1,2)-w(2,1,0)+w(0,1,0)+w(2,-1,0)-w(0,-1,0)),
+            0.125*(w(1,2,2)-w(-1,2,2)-w(1,0,2)+w(-1,0,2)-w(1,2,0)+w(-1,2,0)+w(1,0,0)-w(-1,0,0)),
+            0.125*(w(2,2,2)-w(0,2,2)-w(2,0,2)+w(0,0,2)-w(2,2,0)+w(0,2,0)+w(2,0,0)-w(0,0,0))
+            ;
+}
+
+/**
+ * @brief TricubicInterpolator::getCoefficients
+ *
+ * Coefficients of the tricubic interpolant of a single cell, computed from the weights of the
+ * 4x4x4 grid points around it (see getDerivatives).
+ */
+void TricubicInterpolator::getCoefficients(std::array<gridreal, 64>& coeffs, const gridreal neighbourhood[64]) {
+    Eigen::Matrix<gridreal,64,1> x;
+    getDerivatives(x.data(), neighbourhood);
+    Eigen::Map<Eigen::Matrix<gridreal,64,1> > coefs(coeffs.data());
+    coefs.noalias() = C * x;
+}
+
+/**
+ * @brief getNeighbourhood
+ *
+ * Weights of the 4x4x4 grid points around the cell (xi, yi, zi), on a dense or on a tiled array.
+ */
+template <class A>
+static inline void getNeighbourhood(std::array<gridreal, 64>& neighbourhood, const A& weights, unsigned int xi, unsigned int yi, unsigned int zi) {
+    for (int c = 0; c < 4; c++)
+        for (int b = 0; b < 4; b++)
+            for (int a = 0; a < 4; a++)
+                neighbourhood[a + 4*b + 16*c] = weights(xi+a-1, yi+b-1, zi+c-1);
+}
+
+/**
+ * @brief mergeNeighbourhoods
+ *
+ * Second part of getCoefficients, given the distinct neighbourhoods collected by every thread
+ * (threadNeighbourhoods[t][l] is the neighbourhood with local id l of the thread t):
+ * - the maps of the threads are merged (in thread order, so ids do not depend on the scheduling);
+ * - the coefficients of the distinct neighbourhoods are computed in blocks, with a matrix product
+ *   C * X where X has the derivatives of a block of neighbourhoods as columns;
+ * - equal coefficients of different neighbourhoods are merged in the shared table coeffs, whose
+ *   first element is border (constant coefficients of the cells on the border).
+ * ids[t][l] is the id in coeffs of the neighbourhood with local id l of the thread t.
+ */
+static void mergeNeighbourhoods(std::vector< std::array<gridreal, 64> >& coeffs, std::vector< std::vector<int> >& ids, std::vector<CoefficientsMap>& threadMaps, std::vector< std::vector<const std::array<gridreal, 64>*> >& threadNeighbourhoods, const std::array<gridreal, 64>& border) {
+    unsigned int nThreads = threadMaps.size();
+
+    //merge in the map of the first thread
+    std::vector<const std::array<gridreal, 64>*>& neighbourhoods = threadNeighbourhoods[0];
+    std::vector< std::vector<int> > remap(nThreads);
+    for (unsigned int l = 0; l < neighbourhoods.size(); l++)
+        remap[0].push_back(l);
+    for (unsigned int t = 1; t < nThreads; t++){
+        for (const std::array<gridreal, 64>* n : threadNeighbourhoods[t]){
+            std::pair<CoefficientsMap::iterator, bool> r = threadMaps[0].emplace(*n, (int)neighbourhoods.size());
+            if (r.second)
+                neighbourhoods.push_back(&r.first->first);
+            remap[t].push_back(r.first->second);
+        }
+        threadNeighbourhoods[t].clear();
+        threadMaps[t].clear();
+    }
+
+    //coefficients of the distinct neighbourhoods, in blocks
+    std::vector<std::array<gridreal, 64> > neighbourhoodCoeffs(neighbourhoods.size());
+    unsigned int nBlocks = (neighbourhoods.size() + COEFFICIENTS_BLOCK - 1) / COEFFICIENTS_BLOCK;
+    #pragma omp parallel for schedule(dynamic)
+    for (unsigned int block = 0; block < nBlocks; block++){
+        unsigned int first = block * COEFFICIENTS_BLOCK;
+        unsigned int n = std::min(COEFFICIENTS_BLOCK, (unsigned int)neighbourhoods.size() - first);
+        Eigen::Matrix<gridreal, 64, Eigen::Dynamic> X(64, n), Y(64, n);
+        for (unsigned int c = 0; c < n; c++)
+            getDerivatives(X.col(c).data(), neighbourhoods[first+c]->data());
+        Y.noalias() = C * X;
+        for (unsigned int c = 0; c < n; c++)
+            std::memcpy(neighbourhoodCoeffs[first+c].data(), Y.col(c).data(), 64*sizeof(gridreal));
+    }
+    threadMaps.clear();
+
+    //shared table
+    CoefficientsMap mapping;
+    coeffs.clear();
+    mapping[border] = 0;
+    coeffs.push_back(border);
+    std::vector<int> merged(neighbourhoodCoeffs.size());
+    for (unsigned int u = 0; u < neighbourhoodCoeffs.size(); u++){
+        std::pair<CoefficientsMap::iterator, bool> r = mapping.emplace(neighbourhoodCoeffs[u], (int)coeffs.size());
+        if (r.second)
+            coeffs.push_back(neighbourhoodCoeffs[u]);
+        merged[u] = r.first->second;
+    }
+    ids.assign(nThreads, std::vector<int>());
+    for (unsigned int t = 0; t < nThreads; t++){
+        ids[t].resize(remap[t].size());
+        for (unsigned int l = 0; l < remap[t].size(); l++)
+            ids[t][l] = merged[remap[t][l]];
+    }
+}
+
+/**
+ * @brief TricubicInterpolator::getCoefficients
+ *
+ * Coefficients of all the cells of the grid, deduplicated: coeffs is the table of the distinct
+ * coefficients and mapCoeffs the id of the coefficients of every cell.
+ * Cells on the border have constant coefficients (id 0). For the other cells every thread collects
+ * the distinct 4x4x4 neighbourhoods of its slabs in a hash map, then the neighbourhoods of all
+ * the threads are merged and their coefficients computed once (see mergeNeighbourhoods).
+ */
 void TricubicInterpolator::getCoefficients(std::vector< std::array<gridreal, 64> >& coeffs, Array3D<int>& mapCoeffs, const Array3D<gridreal>& weights) {
     assert(mapCoeffs.getSizeX() == weights.getSizeX()-1);
     assert(mapCoeffs.getSizeY() == weights.getSizeY()-1);
     assert(mapCoeffs.getSizeZ() == weights.getSizeZ()-1);
-    static gridreal temp[64][64] = {
-        { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-3, 3, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 2,-2, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 9,-9,-9, 9, 0, 0, 0, 0, 6, 3,-6,-3, 0, 0, 0, 0, 6,-6, 3,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 2, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-6, 6, 6,-6, 0, 0, 0, 0,-3,-3, 3, 3, 0, 0, 0, 0,-4, 4,-2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-2,-1,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-6, 6, 6,-6, 0, 0, 0, 0,-4,-2, 4, 2, 0, 0, 0, 0,-3, 3,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 4,-4,-4, 4, 0, 0, 0, 0, 2, 2,-2,-2, 0, 0, 0, 0, 2,-2, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9,-9,-9, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 3,-6,-3, 0, 0, 0, 0, 6,-6, 3,-3, 0, 0, 0, 0, 4, 2, 2, 1, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3,-3, 3, 3, 0, 0, 0, 0,-4, 4,-2, 2, 0, 0, 0, 0,-2,-2,-1,-1, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4,-2, 4, 2, 0, 0, 0, 0,-3, 3,-3, 3, 0, 0, 0, 0,-2,-1,-2,-1, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,-4,-4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2,-2,-2, 0, 0, 0, 0, 2,-2, 2,-2, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0},
-        {-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 9,-9, 0, 0,-9, 9, 0, 0, 6, 3, 0, 0,-6,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6,-6, 0, 0, 3,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 2, 0, 0, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-6, 6, 0, 0, 6,-6, 0, 0,-3,-3, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 4, 0, 0,-2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-2, 0, 0,-1,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0, 0, 0,-1, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9,-9, 0, 0,-9, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 3, 0, 0,-6,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6,-6, 0, 0, 3,-3, 0, 0, 4, 2, 0, 0, 2, 1, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 0, 0, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3,-3, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 4, 0, 0,-2, 2, 0, 0,-2,-2, 0, 0,-1,-1, 0, 0},
-        { 9, 0,-9, 0,-9, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 3, 0,-6, 0,-3, 0, 6, 0,-6, 0, 3, 0,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 2, 0, 2, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 9, 0,-9, 0,-9, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 3, 0,-6, 0,-3, 0, 6, 0,-6, 0, 3, 0,-3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 2, 0, 2, 0, 1, 0},
-        {-27,27,27,-27,27,-27,-27,27,-18,-9,18, 9,18, 9,-18,-9,-18,18,-9, 9,18,-18, 9,-9,-18,18,18,-18,-9, 9, 9,-9,-12,-6,-6,-3,12, 6, 6, 3,-12,-6,12, 6,-6,-3, 6, 3,-12,12,-6, 6,-6, 6,-3, 3,-8,-4,-4,-2,-4,-2,-2,-1},
-        {18,-18,-18,18,-18,18,18,-18, 9, 9,-9,-9,-9,-9, 9, 9,12,-12, 6,-6,-12,12,-6, 6,12,-12,-12,12, 6,-6,-6, 6, 6, 6, 3, 3,-6,-6,-3,-3, 6, 6,-6,-6, 3, 3,-3,-3, 8,-8, 4,-4, 4,-4, 2,-2, 4, 4, 2, 2, 2, 2, 1, 1},
-        {-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0,-3, 0, 3, 0, 3, 0,-4, 0, 4, 0,-2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-2, 0,-1, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0,-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 0,-3, 0, 3, 0, 3, 0,-4, 0, 4, 0,-2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-2, 0,-1, 0,-1, 0},
-        {18,-18,-18,18,-18,18,18,-18,12, 6,-12,-6,-12,-6,12, 6, 9,-9, 9,-9,-9, 9,-9, 9,12,-12,-12,12, 6,-6,-6, 6, 6, 3, 6, 3,-6,-3,-6,-3, 8, 4,-8,-4, 4, 2,-4,-2, 6,-6, 6,-6, 3,-3, 3,-3, 4, 2, 4, 2, 2, 1, 2, 1},
-        {-12,12,12,-12,12,-12,-12,12,-6,-6, 6, 6, 6, 6,-6,-6,-6, 6,-6, 6, 6,-6, 6,-6,-8, 8, 8,-8,-4, 4, 4,-4,-3,-3,-3,-3, 3, 3, 3, 3,-4,-4, 4, 4,-2,-2, 2, 2,-4, 4,-4, 4,-2, 2,-2, 2,-2,-2,-2,-2,-1,-1,-1,-1},
-        { 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        {-6, 6, 0, 0, 6,-6, 0, 0,-4,-2, 0, 0, 4, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0,-3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2,-1, 0, 0,-2,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 4,-4, 0, 0,-4, 4, 0, 0, 2, 2, 0, 0,-2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-6, 6, 0, 0, 6,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4,-2, 0, 0, 4, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-3, 3, 0, 0,-3, 3, 0, 0,-2,-1, 0, 0,-2,-1, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,-4, 0, 0,-4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0,-2,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,-2, 0, 0, 2,-2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0},
-        {-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 0,-2, 0, 4, 0, 2, 0,-3, 0, 3, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0,-2, 0,-1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0,-6, 0, 6, 0, 6, 0,-6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,-4, 0,-2, 0, 4, 0, 2, 0,-3, 0, 3, 0,-3, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0,-2, 0,-1, 0,-2, 0,-1, 0},
-        {18,-18,-18,18,-18,18,18,-18,12, 6,-12,-6,-12,-6,12, 6,12,-12, 6,-6,-12,12,-6, 6, 9,-9,-9, 9, 9,-9,-9, 9, 8, 4, 4, 2,-8,-4,-4,-2, 6, 3,-6,-3, 6, 3,-6,-3, 6,-6, 3,-3, 6,-6, 3,-3, 4, 2, 2, 1, 4, 2, 2, 1},
-        {-12,12,12,-12,12,-12,-12,12,-6,-6, 6, 6, 6, 6,-6,-6,-8, 8,-4, 4, 8,-8, 4,-4,-6, 6, 6,-6,-6, 6, 6,-6,-4,-4,-2,-2, 4, 4, 2, 2,-3,-3, 3, 3,-3,-3, 3, 3,-4, 4,-2, 2,-4, 4,-2, 2,-2,-2,-1,-1,-2,-2,-1,-1},
-        { 4, 0,-4, 0,-4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0,-2, 0,-2, 0, 2, 0,-2, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
-        { 0, 0, 0, 0, 0, 0, 0, 0, 4, 0,-4, 0,-4, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0,-2, 0,-2, 0, 2, 0,-2, 0, 2, 0,-2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0},
-        {-12,12,12,-12,12,-12,-12,12,-8,-4, 8, 4, 8, 4,-8,-4,-6, 6,-6, 6, 6,-6, 6,-6,-6, 6, 6,-6,-6, 6, 6,-6,-4,-2,-4,-2, 4, 2, 4, 2,-4,-2, 4, 2,-4,-2, 4, 2,-3, 3,-3, 3,-3, 3,-3, 3,-2,-1,-2,-1,-2,-1,-2,-1},
-        { 8,-8,-8, 8,-8, 8, 8,-8, 4, 4,-4,-4,-4,-4, 4, 4, 4,-4, 4,-4,-4, 4,-4, 4, 4,-4,-4, 4, 4,-4,-4, 4, 2, 2, 2, 2,-2,-2,-2,-2, 2, 2,-2,-2, 2, 2,-2,-2, 2,-2, 2,-2, 2,-2, 2,-2, 1, 1, 1, 1, 1, 1, 1, 1}
-    };
-
-    static Eigen::Map<Eigen::Matrix<gridreal,64,64, Eigen::RowMajor>> C(&temp[0][0]);
-    /*for(int i=0;i<64;i++){
-        for(int j=0;j<64;j++){
-            C(i,j) = temp[i][j];
-        }
-    }*/
+    unsigned int sizeX = weights.getSizeX(), sizeY = weights.getSizeY(), sizeZ = weights.getSizeZ();
 
     // tutti i primi coefficienti delle tricubiche sono pari al valore del primo punto dei pesi. Questo valore dovrebbe essere uguale in tutto il doppio bordo dei pesi.
     // Dopo, tutti i coefficienti dei cubi "interni" verranno calcolati in base ai valori del grigliato
     // rimarranno invariati quindi solo i cofficienti dei cubi sul bordo, dove l'interpolante sarà una funzione costante
-    std::map <std::array<gridreal, 64>, int> mapping;
     std::array<gridreal, 64> arr;
-    coeffs.clear();
     arr[0] = weights(0,0,0);
     for (int i = 1; i < 64; i++) arr[i] = 0;
-    mapping[arr] = 0;
-    coeffs.push_back(arr);
-    int nCoeffs = 1;
+    mapCoeffs.fill(0);
 
-    unsigned int i = 0;
-    for (unsigned int j = 0; j < weights.getSizeY()-1; j++){
-        for (unsigned int k = 0; k < weights.getSizeZ()-1; ++k){
-            mapCoeffs(i,j,k) = 0;
-        }
-    }
-    i = weights.getSizeX()-2;
-    for (unsigned int j = 0; j < weights.getSizeY()-1; j++){
-        for (unsigned int k = 0; k < weights.getSizeZ()-1; ++k){
-            mapCoeffs(i,j,k) = 0;
-        }
-    }
-    unsigned int j = 0;
-    for (unsigned int i = 0; i < weights.getSizeX()-1; i++){
-        for (unsigned int k = 0; k < weights.getSizeZ()-1; ++k){
-            mapCoeffs(i,j,k) = 0;
-        }
-    }
-    j = weights.getSizeY()-2;
-    for (unsigned int i = 0; i < weights.getSizeX()-1; i++){
-        for (unsigned int k = 0; k < weights.getSizeZ()-1; ++k){
-            mapCoeffs(i,j,k) = 0;
-        }
-    }
-    unsigned int k = 0;
-    for (unsigned int i = 0; i < weights.getSizeX()-1; i++){
-        for (unsigned int j = 0; j < weights.getSizeY()-1; ++j){
-            mapCoeffs(i,j,k) = 0;
+    //distinct neighbourhoods of every thread; mapCoeffs has the local ids
+    unsigned int nThreads = omp_get_max_threads();
+    std::vector<CoefficientsMap> threadMaps(nThreads);
+    std::vector< std::vector<const std::array<gridreal, 64>*> > threadNeighbourhoods(nThreads);
+    std::vector<unsigned int> slabThread(sizeX, 0);
+    #pragma omp parallel for schedule(static)
+    for (unsigned int xi = 1; xi < sizeX - 2; xi++){
+        unsigned int t = omp_get_thread_num();
+        slabThread[xi] = t;
+        for (unsigned int yi = 1; yi < sizeY - 2; yi++){
+            for (unsigned int zi = 1; zi < sizeZ - 2; zi++){
+                std::array<gridreal, 64> neighbourhood;
+                getNeighbourhood(neighbourhood, weights, xi, yi, zi);
+                std::pair<CoefficientsMap::iterator, bool> r = threadMaps[t].emplace(neighbourhood, (int)threadNeighbourhoods[t].size());
+                if (r.second)
+                    threadNeighbourhoods[t].push_back(&r.first->first);
+                mapCoeffs(xi, yi, zi) = r.first->second;
+            }
         }
     }
-    k = weights.getSizeZ()-2;
-    for (unsigned int i = 0; i < weights.getSizeX()-1; i++){
-        for (unsigned int j = 0; j < weights.getSizeY()-1; ++j){
-            mapCoeffs(i,j,k) = 0;
+
+    std::vector< std::vector<int> > ids;
+    mergeNeighbourhoods(coeffs, ids, threadMaps, threadNeighbourhoods, arr);
+
+    #pragma omp parallel for
+    for (unsigned int xi = 1; xi < sizeX - 2; xi++){
+        const std::vector<int>& r = ids[slabThread[xi]];
+        for (unsigned int yi = 1; yi < sizeY - 2; yi++){
+            for (unsigned int zi = 1; zi < sizeZ - 2; zi++){
+                mapCoeffs(xi, yi, zi) = r[mapCoeffs(xi, yi, zi)];
+            }
         }
     }
+}
 
-    #pragma omp parallel for
-    for (unsigned int xi = 1; xi < weights.getSizeX() - 2; xi++){
-        for (unsigned int yi = 1; yi < weights.getSizeY() - 2; yi++){
-            for (unsigned int zi = 1; zi < weights.getSizeZ() - 2; zi++){
-                Eigen::Matrix<gridreal,64,1> x;
-                x <<
-                        // values of f(x,y,z) at each corner.
-                        weights(xi,yi,zi),weights(xi+1,yi,zi),weights(xi,yi+1,zi),
-                        weights(xi+1,yi+1,zi),weights(xi,yi,zi+1),weights(xi+1,yi,zi+1),
-                        weights(xi,yi+1,zi+1),weights(xi+1,yi+1,zi+1),
-                        // values of df/dx at each corner.
-                        0.5*(weights(xi+1,yi,zi)-weights(xi-1,yi,zi)),
-                        0.5*(weights(xi+2,yi,zi)-weights(xi,yi,zi)),
-                        0.5*(weights(xi+1,yi+1,zi)-weights(xi-1,yi+1,zi)),
-                        0.5*(weights(xi+2,yi+1,zi)-weights(xi,yi+1,zi)),
-                        0.5*(weights(xi+1,yi,zi+1)-weights(xi-1,yi,zi+1)),
-                        0.5*(weights(xi+2,yi,zi+1)-weights(xi,yi,zi+1)),
-                        0.5*(weights(xi+1,yi+1,zi+1)-weights(xi-1,yi+1,zi+1)),
-                        0.5*(weights(xi+2,yi+1,zi+1)-weights(xi,yi+1,zi+1)),
-                        // values of df/dy at each corner.
-                        0.5*(weights(xi,yi+1,zi)-weights(xi,yi-1,zi)),
-                        0.5*(weights(xi+1,yi+1,zi)-weights(xi+1,yi-1,zi)),
-                        0.5*(weights(xi,yi+2,zi)-weights(xi,yi,zi)),
-                        0.5*(weights(xi+1,yi+2,zi)-weights(xi+1,yi,zi)),
-                        0.5*(weights(xi,yi+1,zi+1)-weights(xi,yi-1,zi+1)),
-                        0.5*(weights(xi+1,yi+1,zi+1)-weights(xi+1,yi-1,zi+1)),
-                        0.5*(weights(xi,yi+2,zi+1)-weights(xi,yi,zi+1)),
-                        0.5*(weights(xi+1,yi+2,zi+1)-weights(xi+1,yi,zi+1)),
-                        // values of df/dz at each corner.
-                        0.5*(weights(xi,yi,zi+1)-weights(xi,yi,zi-1)),
-                        0.5*(weights(xi+1,yi,zi+1)-weights(xi+1,yi,zi-1)),
-                        0.5*(weights(xi,yi+1,zi+1)-weights(xi,yi+1,zi-1)),
-                        0.5*(weights(xi+1,yi+1,zi+1)-weights(xi+1,yi+1,zi-1)),
-                        0.5*(weights(xi,yi,zi+2)-weights(xi,yi,zi)),
-                        0.5*(weights(xi+1,yi,zi+2)-weights(xi+1,yi,zi)),
-                        0.5*(weights(xi,yi+1,zi+2)-weights(xi,yi+1,zi)),
-                        0.5*(weights(xi+1,yi+1,zi+2)-weights(xi+1,yi+1,zi)),
-                        // values of d2f/dxdy at each corner.
-                        0.25*(weights(xi+1,yi+1,zi)-weights(xi-1,yi+1,zi)-weights(xi+1,yi-1,zi)+weights(xi-1,yi-1,zi)),
-                        0.25*(weights(xi+2,yi+1,zi)-weights(xi,yi+1,zi)-weights(xi+2,yi-1,zi)+weights(xi,yi-1,zi)),
-                        0.25*(weights(xi+1,yi+2,zi)-weights(xi-1,yi+2,zi)-weights(xi+1,yi,zi)+weights(xi-1,yi,zi)),
-                        0.25*(weights(xi+2,yi+2,zi)-weights(xi,yi+2,zi)-weights(xi+2,yi,zi)+weights(xi,yi,zi)),
-                        0.25*(weights(xi+1,yi+1,zi+1)-weights(xi-1,yi+1,zi+1)-weights(xi+1,yi-1,zi+1)+weights(xi-1,yi-1,zi+1)),
-                        0.25*(weights(xi+2,yi+1,zi+1)-weights(xi,yi+1,zi+1)-weights(xi+2,yi-1,zi+1)+weights(xi,yi-1,zi+1)),
-                        0.25*(weights(xi+1,yi+2,zi+1)-weights(xi-1,yi+2,zi+1)-weights(xi+1,yi,zi+1)+weights(xi-1,yi,zi+1)),
-                        0.25*(weights(xi+2,yi+2,zi+1)-weights(xi,yi+2,zi+1)-weights(xi+2,yi,zi+1)+weights(xi,yi,zi+1)),
-                        // values of d2f/dxdz at each corner.
-                        0.25*(weights(xi+1,yi,zi+1)-weights(xi-1,yi,zi+1)-weights(xi+1,yi,zi-1)+weights(xi-1,yi,zi-1)),
-                        0.25*(weights(xi+2,yi,zi+1)-weights(xi,yi,zi+1)-weights(xi+2,yi,zi-1)+weights(xi,yi,zi-1)),
-                        0.25*(weights(xi+1,yi+1,zi+1)-weights(xi-1,yi+1,zi+1)-weights(xi+1,yi+1,zi-1)+weights(xi-1,yi+1,zi-1)),
-                        0.25*(weights(xi+2,yi+1,zi+1)-weights(xi,yi+1,zi+1)-weights(xi+2,yi+1,zi-1)+weights(xi,yi+1,zi-1)),
-                        0.25*(weights(xi+1,yi,zi+2)-weights(xi-1,yi,zi+2)-weights(xi+1,yi,zi)+weights(xi-1,yi,zi)),
-                        0.25*(weights(xi+2,yi,zi+2)-weights(xi,yi,zi+2)-weights(xi+2,yi,zi)+weights(xi,yi,zi)),
-                        0.25*(weights(xi+1,yi+1,zi+2)-weights(xi-1,yi+1,zi+2)-weights(xi+1,yi+1,zi)+weights(xi-1,yi+1,zi)),
-                        0.25*(weights(xi+2,yi+1,zi+2)-weights(xi,yi+1,zi+2)-weights(xi+2,yi+1,zi)+weights(xi,yi+1,zi)),
-                        // values of d2f/dydz at each corner.
-                        0.25*(weights(xi,yi+1,zi+1)-weights(xi,yi-1,zi+1)-weights(xi,yi+1,zi-1)+weights(xi,yi-1,zi-1)),
-                        0.25*(weights(xi+1,yi+1,zi+1)-weights(xi+1,yi-1,zi+1)-weights(xi+1,yi+1,zi-1)+weights(xi+1,yi-1,zi-1)),
-                        0.25*(weights(xi,yi+2,zi+1)-weights(xi,yi,zi+1)-weights(xi,yi+2,zi-1)+weights(xi,yi,zi-1)),
-                        0.25*(weights(xi+1,yi+2,zi+1)-weights(xi+1,yi,zi+1)-weights(xi+1,yi+2,zi-1)+weights(xi+1,yi,zi-1)),
-                        0.25*(weights(xi,yi+1,zi+2)-weights(xi,yi-1,zi+2)-weights(xi,yi+1,zi)+weights(xi,yi-1,zi)),
-                        0.25*(weights(xi+1,yi+1,zi+2)-weights(xi+1,yi-1,zi+2)-weights(xi+1,yi+1,zi)+weights(xi+1,yi-1,zi)),
-                        0.25*(weights(xi,yi+2,zi+2)-weights(xi,yi,zi+2)-weights(xi,yi+2,zi)+weights(xi,yi,zi)),
-                        0.25*(weights(xi+1,yi+2,zi+2)-weights(xi+1,yi,zi+2)-weights(xi+1,yi+2,zi)+weights(xi+1,yi,zi)),
-                        // values of d3f/dxdydz at each corner.
-                        0.125*(weights(xi+1,yi+1,zi+1)-weights(xi-1,yi+1,zi+1)-weights(xi+1,yi-1,zi+1)+weights(xi-1,yi-1,zi+1)-weights(xi+1,yi+1,zi-1)+weights(xi-1,yi+1,zi-1)+weights(xi+1,yi-1,zi-1)-weights(xi-1,yi-1,zi-1)),
-                        0.125*(weights(xi+2,yi+1,zi+1)-weights(xi,yi+1,zi+1)-weights(xi+2,yi-1,zi+1)+weights(xi,yi-1,zi+1)-weights(xi+2,yi+1,zi-1)+weights(xi,yi+1,zi-1)+weights(xi+2,yi-1,zi-1)-weights(xi,yi-1,zi-1)),
-                        0.125*(weights(xi+1,yi+2,zi+1)-weights(xi-1,yi+2,zi+1)-weights(xi+1,yi,zi+1)+weights(xi-1,yi,zi+1)-weights(xi+1,yi+2,zi-1)+weights(xi-1,yi+2,zi-1)+weights(xi+1,yi,zi-1)-weights(xi-1,yi,zi-1)),
-                        0.125*(weights(xi+2,yi+2,zi+1)-weights(xi,yi+2,zi+1)-weights(xi+2,yi,zi+1)+weights(xi,yi,zi+1)-weights(xi+2,yi+2,zi-1)+weights(xi,yi+2,zi-1)+weights(xi+2,yi,zi-1)-weights(xi,yi,zi-1)),
-                        0.125*(weights(xi+1,yi+1,zi+2)-weights(xi-1,yi+1,zi+2)-weights(xi+1,yi-1,zi+2)+weights(xi-1,yi-1,zi+2)-weights(xi+1,yi+1,zi)+weights(xi-1,yi+1,zi)+weights(xi+1,yi-1,zi)-weights(xi-1,yi-1,zi)),
-                        0.125*(weights(xi+2,yi+1,zi+2)-weights(xi,yi+1,zi+2)-weights(xi+2,yi-1,zi+2)+weights(xi,yi-1,zi+2)-weights(xi+2,yi+1,zi)+weights(xi,yi+1,zi)+weights(xi+2,yi-1,zi)-weights(xi,yi-1,zi)),
-                        0.125*(weights(xi+1,yi+2,zi+2)-weights(xi-1,yi+2,zi+2)-weights(xi+1,yi,zi+2)+weights(xi-1,yi,zi+2)-weights(xi+1,yi+2,zi)+weights(xi-1,yi+2,zi)+weights(xi+1,yi,zi)-weights(xi-1,yi,zi)),
-                        0.125*(weights(xi+2,yi+2,zi+2)-weights(xi,yi+2,zi+2)-weights(xi+2,yi,zi+2)+weights(xi,yi,zi+2)-weights(xi+2,yi+2,zi)+weights(xi,yi+2,zi)+weights(xi+2,yi,zi)-weights(xi,yi,zi))
-                        ;
-                Eigen::Matrix<gridreal,64,1> coefs;
-                coefs = C * x;
-                std::array<gridreal, 64> arr;
-                for (unsigned k = 0; k < 64; k++){
-                    arr[k] = coefs(k,0);
-                }
-                std::map<std::array<gridreal, 64>, int>::iterator it = mapping.find(arr);
-                if (it == mapping.end()){
-                    #pragma omp critical
-                    {
-                        coeffs.push_back(arr);
-                        mapping[arr] = nCoeffs;
+/**
+ * @brief TricubicInterpolator::getCoefficients
+ *
+ * Same of the dense getCoefficients on tiled weights, building the tiled coefficient ids tile by
+ * tile: no dense array is allocated. The neighbourhoods of the cells of a tile whose weights
+ * (with the two layers around) are all on uniform tiles with the same value are all equal,
+ * so they are collected once.
+ */
+void TricubicInterpolator::getCoefficients(std::vector< std::array<gridreal, 64> >& coeffs, TiledArray3D<int>& mapCoeffs, const TiledArray3D<gridreal>& weights) {
+    unsigned long sizeX = weights.getSizeX(), sizeY = weights.getSizeY(), sizeZ = weights.getSizeZ();
+    unsigned int tilesX = (sizeX - 1 + TILE_MASK) >> TILE_LOG2, tilesY = (sizeY - 1 + TILE_MASK) >> TILE_LOG2, tilesZ = (sizeZ - 1 + TILE_MASK) >> TILE_LOG2;
+    std::array<gridreal, 64> arr;
+    arr.fill(0);
+    arr[0] = weights(0,0,0);
+
+    //distinct neighbourhoods of every thread; local has the local ids (-1 on the border)
+    unsigned int nThreads = omp_get_max_threads();
+    std::vector<CoefficientsMap> threadMaps(nThreads);
+    std::vector< std::vector<const std::array<gridreal, 64>*> > threadNeighbourhoods(nThreads);
+    std::vector<unsigned short> tileThread(tilesX*tilesY*tilesZ, 0);
+    TiledArray3D<int> local(sizeX-1, sizeY-1, sizeZ-1, [&](unsigned long i0, unsigned long j0, unsigned long k0, std::array<int, TILE_CELLS>& d){
+        unsigned int t = omp_get_thread_num();
+        tileThread[((i0 >> TILE_LOG2)*tilesY + (j0 >> TILE_LOG2))*tilesZ + (k0 >> TILE_LOG2)] = t;
+        unsigned long i1 = std::min(i0 + TILE_SIZE, sizeX-1), j1 = std::min(j0 + TILE_SIZE, sizeY-1), k1 = std::min(k0 + TILE_SIZE, sizeZ-1);
+        bool border = i0 == 0 || j0 == 0 || k0 == 0 || i1 > sizeX-2 || j1 > sizeY-2 || k1 > sizeZ-2;
+        bool uniform = !border;
+        for (unsigned long ti = (i0-1) >> TILE_LOG2; uniform && ti <= (i1+1) >> TILE_LOG2; ti++)
+            for (unsigned long tj = (j0-1) >> TILE_LOG2; uniform && tj <= (j1+1) >> TILE_LOG2; tj++)
+                for (unsigned long tk = (k0-1) >> TILE_LOG2; uniform && tk <= (k1+1) >> TILE_LOG2; tk++)
+                    uniform = weights.getDenseTile(ti, tj, tk) < 0 && weights.getTileValue(ti, tj, tk) == weights(i0, j0, k0);
+        int id = -1;
+        for (unsigned long xi = i0; xi < i1; xi++){
+            for (unsigned long yi = j0; yi < j1; yi++){
+                for (unsigned long zi = k0; zi < k1; zi++){
+                    int& l = d[TiledArray3D<int>::getLocalIndex(xi-i0, yi-j0, zi-k0)];
+                    if (xi < 1 || yi < 1 || zi < 1 || xi >= sizeX-2 || yi >= sizeY-2 || zi >= sizeZ-2){
+                        l = -1;
+                        continue;
                     }
-                    mapCoeffs(xi, yi, zi) = nCoeffs++;
-                }
-                else {
-                    mapCoeffs(xi, yi, zi) = it->second;
+                    if (id < 0 || !uniform){
+                        std::array<gridreal, 64> neighbourhood;
+                        getNeighbourhood(neighbourhood, weights, xi, yi, zi);
+                        std::pair<CoefficientsMap::iterator, bool> r = threadMaps[t].emplace(neighbourhood, (int)threadNeighbourhoods[t].size());
+                        if (r.second)
+                            threadNeighbourhoods[t].push_back(&r.first->first);
+                        id = r.first->second;
+                    }
+                    l = id;
                 }
             }
         }
-    }
+    });
+
+    std::vector< std::vector<int> > ids;
+    mergeNeighbourhoods(coeffs, ids, threadMaps, threadNeighbourhoods, arr);
+
+    mapCoeffs = TiledArray3D<int>(sizeX-1, sizeY-1, sizeZ-1, [&](unsigned long i0, unsigned long j0, unsigned long k0, std::array<int, TILE_CELLS>& d){
+        unsigned int ti = i0 >> TILE_LOG2, tj = j0 >> TILE_LOG2, tk = k0 >> TILE_LOG2;
+        const std::vector<int>& r = ids[tileThread[(ti*tilesY + tj)*tilesZ + tk]];
+        int dense = local.getDenseTile(ti, tj, tk);
+        if (dense < 0){
+            int l = local.getTileValue(ti, tj, tk);
+            d.fill(l < 0 ? 0 : r[l]);
+            return;
+        }
+        const std::array<int, TILE_CELLS>& l = local.getDenseTileData(dense);
+        for (unsigned int c = 0; c < TILE_CELLS; c++)
+            d[c] = l[c] < 0 ? 0 : r[l[c]];
+    });
 }
 
 void TricubicInterpolator::getCoefficients(Array4D<gridreal>& coeffs, const Array3D<gridreal>& weights) {
@@ -440,3 +616,42 @@ double TricubicInterpolator::getValue(const Pointd& p, const gridreal* coeffs) {
     }
     return result;
 }
+
+/**
+ * @brief TricubicInterpolator::getValues
+ *
+ * values[p] = getValue((x[p], y[p], z[p]), coeffs) for n points of the same cell (coordinates in [0,1]),
+ * given as a structure of arrays. Every point is evaluated with a Horner scheme on x, y and z; the
+ * coefficients are the same for all the points, so the loop on the points is vectorized.
+ */
+void TricubicInterpolator::getValues(const gridreal* coeffs, const double* x, const double* y, const double* z, double* values, unsigned int n) {
+    #pragma omp simd
+    for (unsigned int p = 0; p < n; p++){
+        double px = x[p], py = y[p], pz = z[p];
+        double result = 0;
+        for (int k = 3; k >= 0; k--){
+            double rk = 0;
+            for (int j = 3; j >= 0; j--){
+                const gridreal* c = coeffs + 4*j + 16*k;
+                rk = rk*py + (c[0] + px*(c[1] + px*(c[2] + px*c[3])));
+            }
+            result = result*pz + rk;
+        }
+        values[p] = result;
+    }
+}
+
+/**
+ * @brief TricubicInterpolator::getFaceIntegrals
+ *
+ * f[n] is the coefficient of t^n of the integral of the tricubic on the unit square orthogonal
+ * to the given axis (0 = x, 1 = y, 2 = z), as a function of the coordinate t on that axis.
+ */
+void TricubicInterpolator::getFaceIntegrals(double f[4], const gridreal* coeffs, unsigned int axis) {
+    static const double m[4] = {1.0, 1.0/2, 1.0/3, 1.0/4};
+    for (unsigned int n = 0; n < 4; n++){
+        double e[4] = {0, 0, 0, 0};
+        e[n] = 1;
+        f[n] = getSeparableValue(coeffs, axis == 0 ? e : m, axis == 1 ? e : m, axis == 2 ? e : m);
+    }
+}
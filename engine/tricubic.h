@@ -4,16 +4,47 @@
 #include <Eigen/Core>
 #include "cg3/data_structures/arrays/arrays.h"
 #include "cg3/geometry/point.h"
+#include "lib/grid/tiledarray.h"
 
 typedef float gridreal;
 
 namespace TricubicInterpolator {
 
+    void getCoefficients(std::array<gridreal, 64>& coeffs, const gridreal neighbourhood[64]);
+
     void getCoefficients(std::vector<std::array<gridreal, 64> >& coeffs, cg3::Array3D<int>& mapCoeffs,  const cg3::Array3D<gridreal> &weights);
 
+    void getCoefficients(std::vector<std::array<gridreal, 64> >& coeffs, TiledArray3D<int>& mapCoeffs, const TiledArray3D<gridreal>& weights);
+
     void getCoefficients(cg3::Array4D<gridreal>& coeffs, const cg3::Array3D<gridreal> &weights);
 
     double getValue(const cg3::Pointd &p, const gridreal* coeffs);
+
+    void getValues(const gridreal* coeffs, const double* x, const double* y, const double* z, double* values, unsigned int n);
+
+    double getSeparableValue(const gridreal* coeffs, const double mx[4], const double my[4], const double mz[4]);
+
+    void getFaceIntegrals(double f[4], const gridreal* coeffs, unsigned int axis);
+}
+
+/**
+ * @brief TricubicInterpolator::getSeparableValue
+ *
+ * Contracts the coefficients (coeffs[i + 4j + 16k] multiplies x^i y^j z^k) with a separable
+ * weight mx[i]*my[j]*mz[k]. With the powers of a coordinate as weights this is the evaluation,
+ * with the 1D moments of an interval it is the integral on that interval.
+ */
+inline double TricubicInterpolator::getSeparableValue(const gridreal* coeffs, const double mx[4], const double my[4], const double mz[4]) {
+    double result = 0;
+    const gridreal* c = coeffs;
+    for (unsigned int k = 0; k < 4; k++){
+        double rk = 0;
+        for (unsigned int j = 0; j < 4; j++, c+=4){
+            rk += my[j] * (mx[0]*c[0] + mx[1]*c[1] + mx[2]*c[2] + mx[3]*c[3]);
+        }
+        result += mz[k] * rk;
+    }
+    return result;
 }
 
 #endif
@@ -0,0 +1,328 @@
+#include "bitmapset.h"
+
+#define BITMAP_SET_WORDS 1024 //64 bit words of a bitmap container
+
+/**
+ * @brief BitmapSet::const_iterator::settle
+ *
+ * Moves the iterator from its position to the first value of the set at or after it.
+ */
+void BitmapSet::const_iterator::settle() {
+    while (container < containers->size()){
+        const Container& c = (*containers)[container];
+        if (c.isBitmap()){
+            unsigned int w = position >> 6;
+            if (w < BITMAP_SET_WORDS){
+                uint64_t word = c.bits[w] & (~0ULL << (position & 63));
+                while (word == 0 && ++w < BITMAP_SET_WORDS)
+                    word = c.bits[w];
+                if (word != 0){
+                    position = (w << 6) + __builtin_ctzll(word);
+                    return;
+                }
+            }
+        }
+        else if (position < c.values.size())
+            return;
+        container++;
+        position = 0;
+    }
+    position = 0;
+}
+
+void BitmapSet::insert(unsigned int v) {
+    uint16_t key = v >> 16, low = v & 0xFFFF;
+    std::vector<Container>::iterator it = findContainer(key);
+    if (it == containers.end() || it->key != key){
+        it = containers.insert(it, Container());
+        it->key = key;
+        it->cardinality = 0;
+    }
+    if (it->isBitmap()){
+        uint64_t& word = it->bits[low >> 6];
+        uint64_t bit = 1ULL << (low & 63);
+        if (word & bit)
+            return;
+        word |= bit;
+    }
+    else {
+        std::vector<uint16_t>::iterator pos = std::lower_bound(it->values.begin(), it->values.end(), low);
+        if (pos != it->values.end() && *pos == low)
+            return;
+        it->values.insert(pos, low);
+    }
+    it->cardinality++;
+    cardinality++;
+    normalize(*it);
+}
+
+/**
+ * @brief BitmapSet::erase
+ * @return true if v was in the set
+ */
+bool BitmapSet::erase(unsigned int v) {
+    uint16_t key = v >> 16, low = v & 0xFFFF;
+    std::vector<Container>::iterator it = findContainer(key);
+    if (it == containers.end() || it->key != key || !it->contains(low))
+        return false;
+    if (it->isBitmap())
+        it->bits[low >> 6] &= ~(1ULL << (low & 63));
+    else
+        it->values.erase(std::lower_bound(it->values.begin(), it->values.end(), low));
+    it->cardinality--;
+    cardinality--;
+    if (it->cardinality == 0)
+        containers.erase(it);
+    else
+        normalize(*it);
+    return true;
+}
+
+bool BitmapSet::operator==(const BitmapSet& other) const {
+    if (cardinality != other.cardinality || containers.size() != other.containers.size())
+        return false;
+    for (unsigned int i = 0; i < containers.size(); i++){
+        const Container& a = containers[i];
+        const Container& b = other.containers[i];
+        //containers are normalized: same cardinality means same kind
+        if (a.key != b.key || a.cardinality != b.cardinality || a.values != b.values || a.bits != b.bits)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief BitmapSet::build
+ *
+ * Replaces the content of the set with the values of sorted (which is sorted and made unique here).
+ */
+void BitmapSet::build(std::vector<unsigned int>& sorted) {
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    containers.clear();
+    cardinality = sorted.size();
+    unsigned int i = 0;
+    while (i < sorted.size()){
+        uint16_t key = sorted[i] >> 16;
+        unsigned int j = i;
+        while (j < sorted.size() && (sorted[j] >> 16) == key)
+            j++;
+        containers.push_back(Container());
+        Container& c = containers.back();
+        c.key = key;
+        c.cardinality = j-i;
+        if (c.cardinality > BITMAP_SET_ARRAY_MAX){
+            c.bits.resize(BITMAP_SET_WORDS, 0);
+            for (unsigned int k = i; k < j; k++)
+                c.bits[(sorted[k] & 0xFFFF) >> 6] |= 1ULL << (sorted[k] & 63);
+        }
+        else {
+            c.values.resize(c.cardinality);
+            for (unsigned int k = i; k < j; k++)
+                c.values[k-i] = sorted[k] & 0xFFFF;
+        }
+        i = j;
+    }
+}
+
+std::vector<BitmapSet::Container>::iterator BitmapSet::findContainer(uint16_t key) {
+    return std::lower_bound(containers.begin(), containers.end(), key, [](const Container& c, uint16_t k) {
+        return c.key < k;
+    });
+}
+
+std::vector<BitmapSet::Container>::const_iterator BitmapSet::findContainer(uint16_t key) const {
+    return std::lower_bound(containers.begin(), containers.end(), key, [](const Container& c, uint16_t k) {
+        return c.key < k;
+    });
+}
+
+/**
+ * @brief BitmapSet::normalize
+ *
+ * Converts the container to an array if it has at most BITMAP_SET_ARRAY_MAX values, to a bitmap
+ * otherwise.
+ */
+void BitmapSet::normalize(Container& c) {
+    if (c.isBitmap() && c.cardinality <= BITMAP_SET_ARRAY_MAX){
+        c.values.clear();
+        c.values.reserve(c.cardinality);
+        for (unsigned int w = 0; w < BITMAP_SET_WORDS; w++){
+            uint64_t word = c.bits[w];
+            while (word != 0){
+                c.values.push_back((w << 6) + __builtin_ctzll(word));
+                word &= word-1;
+            }
+        }
+        std::vector<uint64_t>().swap(c.bits);
+    }
+    else if (!c.isBitmap() && c.cardinality > BITMAP_SET_ARRAY_MAX){
+        c.bits.assign(BITMAP_SET_WORDS, 0);
+        for (uint16_t v : c.values)
+            c.bits[v >> 6] |= 1ULL << (v & 63);
+        std::vector<uint16_t>().swap(c.values);
+    }
+}
+
+static unsigned int countBits(const std::vector<uint64_t>& bits) {
+    unsigned int n = 0;
+    for (uint64_t w : bits)
+        n += __builtin_popcountll(w);
+    return n;
+}
+
+BitmapSet union_(const BitmapSet& a, const BitmapSet& b) {
+    BitmapSet r;
+    unsigned int i = 0, j = 0;
+    while (i < a.containers.size() || j < b.containers.size()){
+        if (j == b.containers.size() || (i < a.containers.size() && a.containers[i].key < b.containers[j].key))
+            r.containers.push_back(a.containers[i++]);
+        else if (i == a.containers.size() || b.containers[j].key < a.containers[i].key)
+            r.containers.push_back(b.containers[j++]);
+        else {
+            const BitmapSet::Container& ca = a.containers[i++];
+            const BitmapSet::Container& cb = b.containers[j++];
+            BitmapSet::Container c;
+            c.key = ca.key;
+            if (ca.isBitmap() || cb.isBitmap()){
+                c.bits = ca.isBitmap() ? ca.bits : cb.bits;
+                const BitmapSet::Container& other = ca.isBitmap() ? cb : ca;
+                if (other.isBitmap()){
+                    for (unsigned int w = 0; w < BITMAP_SET_WORDS; w++)
+                        c.bits[w] |= other.bits[w];
+                }
+                else {
+                    for (uint16_t v : other.values)
+                        c.bits[v >> 6] |= 1ULL << (v & 63);
+                }
+                c.cardinality = countBits(c.bits);
+            }
+            else {
+                c.values.reserve(ca.values.size() + cb.values.size());
+                std::set_union(ca.values.begin(), ca.values.end(), cb.values.begin(), cb.values.end(), std::back_inserter(c.values));
+                c.cardinality = c.values.size();
+                BitmapSet::normalize(c);
+            }
+            r.containers.push_back(std::move(c));
+        }
+        r.cardinality += r.containers.back().cardinality;
+    }
+    return r;
+}
+
+BitmapSet intersection(const BitmapSet& a, const BitmapSet& b) {
+    BitmapSet r;
+    unsigned int i = 0, j = 0;
+    while (i < a.containers.size() && j < b.containers.size()){
+        if (a.containers[i].key < b.containers[j].key)
+            i++;
+        else if (b.containers[j].key < a.containers[i].key)
+            j++;
+        else {
+            const BitmapSet::Container& ca = a.containers[i++];
+            const BitmapSet::Container& cb = b.containers[j++];
+            BitmapSet::Container c;
+            c.key = ca.key;
+            if (ca.isBitmap() && cb.isBitmap()){
+                c.bits.resize(BITMAP_SET_WORDS);
+                for (unsigned int w = 0; w < BITMAP_SET_WORDS; w++)
+                    c.bits[w] = ca.bits[w] & cb.bits[w];
+                c.cardinality = countBits(c.bits);
+                BitmapSet::normalize(c);
+            }
+            else if (ca.isBitmap() || cb.isBitmap()){
+                const BitmapSet::Container& array = ca.isBitmap() ? cb : ca;
+                const BitmapSet::Container& bitmap = ca.isBitmap() ? ca : cb;
+                for (uint16_t v : array.values)
+                    if (bitmap.contains(v))
+                        c.values.push_back(v);
+                c.cardinality = c.values.size();
+            }
+            else {
+                std::set_intersection(ca.values.begin(), ca.values.end(), cb.values.begin(), cb.values.end(), std::back_inserter(c.values));
+                c.cardinality = c.values.size();
+            }
+            if (c.cardinality > 0){
+                r.cardinality += c.cardinality;
+                r.containers.push_back(std::move(c));
+            }
+        }
+    }
+    return r;
+}
+
+BitmapSet difference(const BitmapSet& a, const BitmapSet& b) {
+    BitmapSet r;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < a.containers.size(); i++){
+        const BitmapSet::Container& ca = a.containers[i];
+        while (j < b.containers.size() && b.containers[j].key < ca.key)
+            j++;
+        if (j == b.containers.size() || b.containers[j].key != ca.key){
+            r.containers.push_back(ca);
+            r.cardinality += ca.cardinality;
+            continue;
+        }
+        const BitmapSet::Container& cb = b.containers[j];
+        BitmapSet::Container c;
+        c.key = ca.key;
+        if (ca.isBitmap()){
+            c.bits = ca.bits;
+            if (cb.isBitmap()){
+                for (unsigned int w = 0; w < BITMAP_SET_WORDS; w++)
+                    c.bits[w] &= ~cb.bits[w];
+            }
+            else {
+                for (uint16_t v : cb.values)
+                    c.bits[v >> 6] &= ~(1ULL << (v & 63));
+            }
+            c.cardinality = countBits(c.bits);
+            BitmapSet::normalize(c);
+        }
+        else {
+            for (uint16_t v : ca.values)
+                if (!cb.contains(v))
+                    c.values.push_back(v);
+            c.cardinality = c.values.size();
+        }
+        if (c.cardinality > 0){
+            r.cardinality += c.cardinality;
+            r.containers.push_back(std::move(c));
+        }
+    }
+    return r;
+}
+
+/**
+ * @brief isSubset
+ * @return true if all the values of a are in b
+ */
+bool isSubset(const BitmapSet& a, const BitmapSet& b) {
+    if (a.cardinality > b.cardinality)
+        return false;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < a.containers.size(); i++){
+        const BitmapSet::Container& ca = a.containers[i];
+        while (j < b.containers.size() && b.containers[j].key < ca.key)
+            j++;
+        if (j == b.containers.size() || b.containers[j].key != ca.key)
+            return false;
+        const BitmapSet::Container& cb = b.containers[j];
+        if (ca.cardinality > cb.cardinality)
+            return false;
+        if (ca.isBitmap()){
+            //cb is a bitmap too, having more values
+            for (unsigned int w = 0; w < BITMAP_SET_WORDS; w++)
+                if (ca.bits[w] & ~cb.bits[w])
+                    return false;
+        }
+        else if (cb.isBitmap()){
+            for (uint16_t v : ca.values)
+                if (!cb.contains(v))
+                    return false;
+        }
+        else if (!std::includes(cb.values.begin(), cb.values.end(), ca.values.begin(), ca.values.end()))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,191 @@
+#ifndef BITMAPSET_H
+#define BITMAPSET_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+#define BITMAP_SET_ARRAY_MAX 4096 //values over which a container is stored as a bitmap
+
+/**
+ * @brief The BitmapSet class
+ *
+ * Compressed set of unsigned integers (roaring bitmap): values are grouped in containers by their
+ * 16 high bits; a container stores its 16 low bits as a sorted array if it has at most
+ * BITMAP_SET_ARRAY_MAX values, as a bitmap of 2^16 bits otherwise.
+ * Set operations (union_, intersection, difference, isSubset) work container by container, without
+ * visiting the single values of two bitmaps.
+ * Iteration is in increasing order, as for std::set.
+ */
+class BitmapSet {
+    private:
+        struct Container {
+            uint16_t key;
+            unsigned int cardinality;
+            std::vector<uint16_t> values; //sorted, if the container is an array
+            std::vector<uint64_t> bits; //1024 words, if the container is a bitmap
+
+            bool isBitmap() const;
+            bool contains(uint16_t low) const;
+        };
+
+    public:
+        class const_iterator {
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef unsigned int value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const unsigned int* pointer;
+                typedef unsigned int reference;
+
+                const_iterator();
+                unsigned int operator*() const;
+                const_iterator& operator++();
+                const_iterator operator++(int);
+                bool operator==(const const_iterator& other) const;
+                bool operator!=(const const_iterator& other) const;
+
+            private:
+                friend class BitmapSet;
+                const_iterator(const std::vector<Container>* containers, unsigned int container);
+                void settle();
+
+                const std::vector<Container>* containers;
+                unsigned int container, position; //position: index in the array or bit in the bitmap
+        };
+
+        BitmapSet();
+        template<typename InputIterator>
+        BitmapSet(InputIterator first, InputIterator last);
+
+        void insert(unsigned int v);
+        template<typename InputIterator>
+        void insert(InputIterator first, InputIterator last);
+        bool erase(unsigned int v);
+        bool contains(unsigned int v) const;
+        unsigned int size() const;
+        bool empty() const;
+        void clear();
+
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        bool operator==(const BitmapSet& other) const;
+        bool operator!=(const BitmapSet& other) const;
+
+        friend BitmapSet union_(const BitmapSet& a, const BitmapSet& b);
+        friend BitmapSet intersection(const BitmapSet& a, const BitmapSet& b);
+        friend BitmapSet difference(const BitmapSet& a, const BitmapSet& b);
+        friend bool isSubset(const BitmapSet& a, const BitmapSet& b);
+
+    private:
+        void build(std::vector<unsigned int>& sorted);
+        std::vector<Container>::iterator findContainer(uint16_t key);
+        std::vector<Container>::const_iterator findContainer(uint16_t key) const;
+        static void normalize(Container& c);
+
+        std::vector<Container> containers; //sorted by key, none empty
+        unsigned int cardinality;
+};
+
+BitmapSet union_(const BitmapSet& a, const BitmapSet& b);
+BitmapSet intersection(const BitmapSet& a, const BitmapSet& b);
+BitmapSet difference(const BitmapSet& a, const BitmapSet& b);
+bool isSubset(const BitmapSet& a, const BitmapSet& b);
+
+inline bool BitmapSet::Container::isBitmap() const {
+    return !bits.empty();
+}
+
+inline bool BitmapSet::Container::contains(uint16_t low) const {
+    if (isBitmap())
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(values.begin(), values.end(), low);
+}
+
+inline BitmapSet::const_iterator::const_iterator() : containers(nullptr), container(0), position(0) {
+}
+
+inline BitmapSet::const_iterator::const_iterator(const std::vector<Container>* containers, unsigned int container) :
+        containers(containers), container(container), position(0) {
+    settle();
+}
+
+inline unsigned int BitmapSet::const_iterator::operator*() const {
+    const Container& c = (*containers)[container];
+    return ((unsigned int)c.key << 16) | (c.isBitmap() ? position : c.values[position]);
+}
+
+inline BitmapSet::const_iterator& BitmapSet::const_iterator::operator++() {
+    position++;
+    settle();
+    return *this;
+}
+
+inline BitmapSet::const_iterator BitmapSet::const_iterator::operator++(int) {
+    const_iterator it = *this;
+    ++(*this);
+    return it;
+}
+
+inline bool BitmapSet::const_iterator::operator==(const const_iterator& other) const {
+    return container == other.container && position == other.position;
+}
+
+inline bool BitmapSet::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+inline BitmapSet::BitmapSet() : cardinality(0) {
+}
+
+template<typename InputIterator>
+inline BitmapSet::BitmapSet(InputIterator first, InputIterator last) : cardinality(0) {
+    std::vector<unsigned int> sorted(first, last);
+    build(sorted);
+}
+
+/**
+ * @brief BitmapSet::insert
+ *
+ * Inserts all the values in [first, last).
+ */
+template<typename InputIterator>
+inline void BitmapSet::insert(InputIterator first, InputIterator last) {
+    std::vector<unsigned int> sorted(first, last);
+    sorted.insert(sorted.end(), begin(), end());
+    build(sorted);
+}
+
+inline bool BitmapSet::contains(unsigned int v) const {
+    std::vector<Container>::const_iterator it = findContainer(v >> 16);
+    return it != containers.end() && it->key == (v >> 16) && it->contains(v & 0xFFFF);
+}
+
+inline unsigned int BitmapSet::size() const {
+    return cardinality;
+}
+
+inline bool BitmapSet::empty() const {
+    return cardinality == 0;
+}
+
+inline void BitmapSet::clear() {
+    containers.clear();
+    cardinality = 0;
+}
+
+inline BitmapSet::const_iterator BitmapSet::begin() const {
+    return const_iterator(&containers, 0);
+}
+
+inline BitmapSet::const_iterator BitmapSet::end() const {
+    return const_iterator(&containers, containers.size());
+}
+
+inline bool BitmapSet::operator!=(const BitmapSet& other) const {
+    return !(*this == other);
+}
+
+#endif // BITMAPSET_H
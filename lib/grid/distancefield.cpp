@@ -0,0 +1,185 @@
+#include "distancefield.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using namespace cg3;
+
+namespace DistanceField {
+
+    /**
+     * @brief ownsPoint
+     *
+     * True if the point (px,py) is in the 2D triangle a-b-c (counterclockwise).
+     * Points on the edges belong to only one of the triangles sharing the edge (top-left rule),
+     * so that a row of the grid passing on an edge of the mesh crosses it exactly once.
+     */
+    static bool ownsPoint(double ax, double ay, double bx, double by, double cx, double cy, double px, double py) {
+        double e[3][4] = {{ax, ay, bx, by}, {bx, by, cx, cy}, {cx, cy, ax, ay}};
+        for (unsigned int i = 0; i < 3; i++){
+            double w = (e[i][2] - e[i][0]) * (py - e[i][1]) - (e[i][3] - e[i][1]) * (px - e[i][0]);
+            if (w < 0)
+                return false;
+            if (w == 0){
+                bool topLeft = (e[i][3] == e[i][1] && e[i][2] < e[i][0]) || e[i][3] < e[i][1];
+                if (!topLeft)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief updateEikonal
+     *
+     * Solution of the discrete eikonal equation |grad d| = 1 in a cell with the minimum
+     * neighbour values a, b, c along the three axes, and grid spacing h.
+     * Unknown neighbours have value std::numeric_limits<double>::max().
+     */
+    static double updateEikonal(double a, double b, double c, double h) {
+        if (a > b) std::swap(a, b);
+        if (b > c) std::swap(b, c);
+        if (a > b) std::swap(a, b);
+        double x = a + h;
+        if (x > b){
+            x = (a + b + std::sqrt(2*h*h - (a-b)*(a-b))) / 2;
+            if (x > c){
+                double s = a + b + c;
+                x = (s + std::sqrt(s*s - 3*(a*a + b*b + c*c - h*h))) / 3;
+            }
+        }
+        return x;
+    }
+
+}
+
+/**
+ * @brief DistanceField::squaredPointTriangleDistance
+ *
+ * Squared distance between p and the triangle a-b-c (closest point by Voronoi regions of the triangle).
+ */
+double DistanceField::squaredPointTriangleDistance(const Eigen::RowVector3d& p, const Eigen::RowVector3d& a, const Eigen::RowVector3d& b, const Eigen::RowVector3d& c) {
+    Eigen::RowVector3d ab = b - a, ac = c - a, ap = p - a;
+    double d1 = ab.dot(ap), d2 = ac.dot(ap);
+    if (d1 <= 0 && d2 <= 0) return ap.squaredNorm();
+    Eigen::RowVector3d bp = p - b;
+    double d3 = ab.dot(bp), d4 = ac.dot(bp);
+    if (d3 >= 0 && d4 <= d3) return bp.squaredNorm();
+    double vc = d1*d4 - d3*d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return (ap - (d1 / (d1 - d3)) * ab).squaredNorm();
+    Eigen::RowVector3d cp = p - c;
+    double d5 = ab.dot(cp), d6 = ac.dot(cp);
+    if (d6 >= 0 && d5 <= d6) return cp.squaredNorm();
+    double vb = d5*d2 - d1*d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return (ap - (d2 / (d2 - d6)) * ac).squaredNorm();
+    double va = d3*d6 - d5*d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return (bp - ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b)).squaredNorm();
+    double denom = 1 / (va + vb + vc);
+    return (ap - ab * (vb * denom) - ac * (vc * denom)).squaredNorm();
+}
+
+void DistanceField::signedDistanceField(Array3D<gridreal>& distanceField, const SimpleEigenMesh& m, const Pointd& origin, double unit, unsigned int sizeX, unsigned int sizeY, unsigned int sizeZ, unsigned int band) {
+    const Eigen::MatrixXd& V = m.getVerticesMatrix();
+    const Eigen::MatrixXi& F = m.getFacesMatrix();
+    const double inf = std::numeric_limits<double>::max();
+    int size[3] = {(int)sizeX, (int)sizeY, (int)sizeZ};
+    Eigen::RowVector3d o(origin.x(), origin.y(), origin.z());
+
+    //range of cells (enlarged by the band) of every triangle, and triangles of every slab along x
+    std::vector<std::array<int, 6> > ranges(F.rows());
+    std::vector<std::vector<unsigned int> > slabs(sizeX);
+    for (unsigned int f = 0; f < F.rows(); f++){
+        Eigen::RowVector3d fmin = V.row(F(f,0)).cwiseMin(V.row(F(f,1))).cwiseMin(V.row(F(f,2)));
+        Eigen::RowVector3d fmax = V.row(F(f,0)).cwiseMax(V.row(F(f,1))).cwiseMax(V.row(F(f,2)));
+        for (unsigned int c = 0; c < 3; c++){
+            ranges[f][c] = std::max(0, (int)std::floor((fmin(c) - o(c)) / unit) - (int)band);
+            ranges[f][c+3] = std::min(size[c]-1, (int)std::ceil((fmax(c) - o(c)) / unit) + (int)band);
+        }
+        for (int i = ranges[f][0]; i <= ranges[f][3]; i++)
+            slabs[i].push_back(f);
+    }
+
+    std::vector<double> d(sizeX*sizeY*sizeZ, inf);
+    std::vector<unsigned char> fixed(sizeX*sizeY*sizeZ, 0), inside(sizeX*sizeY*sizeZ, 0);
+    auto id = [&](int i, int j, int k) { return ((size_t)i*sizeY + j)*sizeZ + k; };
+
+    //exact distances in the narrow band, and sign by parity of the crossings of the rows along z
+    const double bandDistance = band * unit;
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)sizeX; i++){
+        double px = o(0) + i*unit;
+        std::vector<std::vector<double> > crossings(sizeY);
+        for (unsigned int f : slabs[i]){
+            Eigen::RowVector3d a = V.row(F(f,0)), b = V.row(F(f,1)), c = V.row(F(f,2));
+            double area = (b(0)-a(0))*(c(1)-a(1)) - (b(1)-a(1))*(c(0)-a(0));
+            for (int j = ranges[f][1]; j <= ranges[f][4]; j++){
+                double py = o(1) + j*unit;
+                for (int k = ranges[f][2]; k <= ranges[f][5]; k++){
+                    Eigen::RowVector3d p(px, py, o(2) + k*unit);
+                    double dist = squaredPointTriangleDistance(p, a, b, c);
+                    if (dist < d[id(i,j,k)])
+                        d[id(i,j,k)] = dist;
+                }
+                //crossing of the row (i,j) with the triangle, if any
+                if (area == 0) continue;
+                bool owns = area > 0 ? ownsPoint(a(0), a(1), b(0), b(1), c(0), c(1), px, py) :
+                                       ownsPoint(a(0), a(1), c(0), c(1), b(0), b(1), px, py);
+                if (owns){
+                    double l1 = ((b(1)-c(1))*(px-c(0)) + (c(0)-b(0))*(py-c(1))) / ((b(1)-c(1))*(a(0)-c(0)) + (c(0)-b(0))*(a(1)-c(1)));
+                    double l2 = ((c(1)-a(1))*(px-c(0)) + (a(0)-c(0))*(py-c(1))) / ((b(1)-c(1))*(a(0)-c(0)) + (c(0)-b(0))*(a(1)-c(1)));
+                    crossings[j].push_back(l1*a(2) + l2*b(2) + (1-l1-l2)*c(2));
+                }
+            }
+        }
+        for (int j = 0; j < (int)sizeY; j++){
+            std::vector<double>& z = crossings[j];
+            std::sort(z.begin(), z.end());
+            unsigned int n = 0;
+            for (int k = 0; k < (int)sizeZ; k++){
+                double pz = o(2) + k*unit;
+                while (n < z.size() && z[n] < pz)
+                    n++;
+                size_t v = id(i,j,k);
+                inside[v] = n % 2;
+                if (d[v] < inf){
+                    d[v] = std::sqrt(d[v]);
+                    fixed[v] = d[v] <= bandDistance;
+                }
+            }
+        }
+    }
+
+    //fast sweeping in the eight directions; cells on a plane i+j+k = const are independent
+    for (unsigned int s = 0; s < 8; s++){
+        int dir[3] = {s & 1 ? -1 : 1, s & 2 ? -1 : 1, s & 4 ? -1 : 1};
+        for (int l = 0; l <= size[0] + size[1] + size[2] - 3; l++){
+            #pragma omp parallel for schedule(static)
+            for (int a = 0; a < size[0]; a++){
+                int i = dir[0] > 0 ? a : size[0]-1-a;
+                for (int b = std::max(0, l - a - size[2] + 1); b < size[1] && a + b <= l; b++){
+                    int i2 = dir[1] > 0 ? b : size[1]-1-b;
+                    int c = l - a - b;
+                    int k = dir[2] > 0 ? c : size[2]-1-c;
+                    size_t v = id(i,i2,k);
+                    if (fixed[v]) continue;
+                    double nx = std::min(i > 0 ? d[id(i-1,i2,k)] : inf, i < size[0]-1 ? d[id(i+1,i2,k)] : inf);
+                    double ny = std::min(i2 > 0 ? d[id(i,i2-1,k)] : inf, i2 < size[1]-1 ? d[id(i,i2+1,k)] : inf);
+                    double nz = std::min(k > 0 ? d[id(i,i2,k-1)] : inf, k < size[2]-1 ? d[id(i,i2,k+1)] : inf);
+                    double x = updateEikonal(nx, ny, nz, unit);
+                    if (x < d[v])
+                        d[v] = x;
+                }
+            }
+        }
+    }
+
+    distanceField.resize(sizeX, sizeY, sizeZ);
+    #pragma omp parallel for
+    for (int i = 0; i < (int)sizeX; i++)
+        for (unsigned int j = 0; j < sizeY; j++)
+            for (unsigned int k = 0; k < sizeZ; k++)
+                distanceField(i,j,k) = inside[id(i,j,k)] ? -d[id(i,j,k)] : d[id(i,j,k)];
+}
@@ -0,0 +1,26 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include "cg3/data_structures/arrays/arrays.h"
+#include "cg3/meshes/eigenmesh/eigenmesh.h"
+#include "engine/tricubic.h"
+
+#define DISTANCE_FIELD_BAND 2 //cells around the surface where the distances are computed exactly
+
+/**
+ * Signed distance field of a closed triangle mesh sampled on a regular grid, computed without
+ * point location queries on a tree:
+ * - exact point-triangle distances in a narrow band of cells around the surface;
+ * - propagation of the distances to the rest of the grid with fast sweeping (the eight sweeps
+ *   are done in parallel on the planes i+j+k = const);
+ * - sign given by the parity of the intersections of the rows of the grid (along z) with the mesh.
+ * Distances are negative inside the mesh.
+ */
+namespace DistanceField {
+
+    void signedDistanceField(cg3::Array3D<gridreal>& distanceField, const cg3::SimpleEigenMesh& m, const cg3::Pointd& origin, double unit, unsigned int sizeX, unsigned int sizeY, unsigned int sizeZ, unsigned int band = DISTANCE_FIELD_BAND);
+
+    double squaredPointTriangleDistance(const Eigen::RowVector3d& p, const Eigen::RowVector3d& a, const Eigen::RowVector3d& b, const Eigen::RowVector3d& c);
+}
+
+#endif // DISTANCEFIELD_H
@@ -80,7 +80,6 @@ double DrawableGrid::getHsvVFactor(double w) const {
 }
 
 void DrawableGrid::draw() const {
-    double xi, yi, zi;
     switch (drawMode){
         case DRAW_KERNEL:
             switch (slice){
@@ -145,15 +144,7 @@ void DrawableGrid::draw() const {
                             opengl::drawSphere(getPoint(sliceValue,j,k), 0.4, c);
                         }
                     }
-                    xi = getPoint(sliceValue, 0, 0).x();
-                    for (yi = bb.getMinY(); yi <= bb.getMaxY(); yi+=stepDrawGrid){
-                        for (zi = bb.getMinZ(); zi <= bb.getMaxZ(); zi+=stepDrawGrid){
-                            double w = getValue(Pointd(xi,yi,zi));
-                            QColor c;
-                            c.setHsv(getHsvHFactor(w)*240,255,getHsvVFactor(w)*255);
-                            opengl::drawSphere(Pointd(xi,yi,zi), 0.2, c);
-                        }
-                    }
+                    drawSliceValues(0);
                     break;
                 case Y_SLICE:
                     for (unsigned int i = 0; i < getResX(); ++i){
@@ -163,15 +154,7 @@ void DrawableGrid::draw() const {
                             opengl::drawSphere(getPoint(i,sliceValue,k), 0.4, c);
                         }
                     }
-                    yi = getPoint(0,sliceValue,0).y();
-                    for (xi = bb.getMinX(); xi <= bb.getMaxX(); xi+=stepDrawGrid){
-                        for (zi = bb.getMinZ(); zi <= bb.getMaxZ(); zi+=stepDrawGrid){
-                            double w = getValue(Pointd(xi,yi,zi));
-                            QColor c;
-                            c.setHsv(getHsvHFactor(w)*240,255,getHsvVFactor(w)*255);
-                            opengl::drawSphere(Pointd(xi,yi,zi), 0.2, c);
-                        }
-                    }
+                    drawSliceValues(1);
                     break;
                 case Z_SLICE:
                     for (unsigned int i = 0; i < getResX(); ++i){
@@ -181,15 +164,7 @@ void DrawableGrid::draw() const {
                             opengl::drawSphere(getPoint(i,j,sliceValue), 0.4, c);
                         }
                     }
-                    zi = getPoint(0,0,sliceValue).z();
-                    for (xi = bb.getMinX(); xi <= bb.getMaxX(); xi+=stepDrawGrid){
-                        for (yi = bb.getMinY(); yi <= bb.getMaxY(); yi+=stepDrawGrid){
-                            double w = getValue(Pointd(xi,yi,zi));
-                            QColor c;
-                            c.setHsv(getHsvHFactor(w)*240,255,getHsvVFactor(w)*255);
-                            opengl::drawSphere(Pointd(xi,yi,zi), 0.2, c);
-                        }
-                    }
+                    drawSliceValues(2);
                     break;
             }
             break;
@@ -202,6 +177,32 @@ void DrawableGrid::draw() const {
     }
 }
 
+/**
+ * @brief DrawableGrid::drawSliceValues
+ *
+ * Draws the interpolated weights sampled every stepDrawGrid on the current slice orthogonal to axis,
+ * evaluated all together with getValues.
+ */
+void DrawableGrid::drawSliceValues(unsigned int axis) const {
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    Pointd c = getPoint(axis == 0 ? sliceValue : 0, axis == 1 ? sliceValue : 0, axis == 2 ? sliceValue : 0);
+    std::vector<double> coords[3];
+    for (double a = bb.getMin()[p]; a <= bb.getMax()[p]; a+=stepDrawGrid){
+        for (double b = bb.getMin()[q]; b <= bb.getMax()[q]; b+=stepDrawGrid){
+            coords[axis].push_back(c[axis]);
+            coords[p].push_back(a);
+            coords[q].push_back(b);
+        }
+    }
+    std::vector<double> values(coords[0].size());
+    getValues(coords[0].data(), coords[1].data(), coords[2].data(), values.data(), values.size());
+    for (unsigned int i = 0; i < values.size(); i++){
+        QColor col;
+        col.setHsv(getHsvHFactor(values[i])*240,255,getHsvVFactor(values[i])*255);
+        opengl::drawSphere(Pointd(coords[0][i], coords[1][i], coords[2][i]), 0.2, col);
+    }
+}
+
 Pointd DrawableGrid::sceneCenter() const {
     return bb.center();
 }
@@ -41,6 +41,7 @@ class DrawableGrid: public Grid, public cg3::DrawableObject
 
         void drawLine(const cg3::Pointd& a, const cg3::Pointd& b) const;
         void drawCube(const cg3::BoundingBox& b) const;
+        void drawSliceValues(unsigned int axis) const;
 
         enum {
             DRAW_KERNEL, DRAW_WEIGHTS
@@ -1,20 +1,59 @@
 #include "grid.h"
+#include <algorithm>
+#include <map>
 
 //#define CUBE_CENTROID 1
 
+#define NOT_FLIPPED_CELL 1
+#define FLIPPED_CELL 2
+
 using namespace cg3;
 
-Grid::Grid() {
+#ifdef TILED_GRID
+bool Grid::tiledStorage = true;
+#else
+bool Grid::tiledStorage = false;
+#endif
+#ifdef LAZY_GRID
+bool Grid::lazyStorage = true;
+#else
+bool Grid::lazyStorage = false;
+#endif
+#ifdef OUT_OF_CORE_GRID
+bool Grid::outOfCoreStorage = true;
+#else
+bool Grid::outOfCoreStorage = false;
+#endif
+
+Grid::Grid() : surfaceTolerance(false), kernelThreshold(-1), replacedCoefficients(0), integral(nullptr) {
 }
 
 Grid::Grid(const Pointi& resolution, const Array3D<Pointd>& gridCoordinates, const Array3D<gridreal>& signedDistances, const Pointd& gMin, const Pointd& gMax) :
-    signedDistances(signedDistances), target(0,0,0) {
-    unit = gridCoordinates(1,0,0).x() - gridCoordinates(0,0,0).x();
+    Grid(resolution, gridCoordinates(1,0,0).x() - gridCoordinates(0,0,0).x(), signedDistances, gMin, gMax) {
+}
+
+/**
+ * @brief Grid::Grid
+ *
+ * Grid with the given resolution and distance between two points (unit), from gMin to gMax,
+ * without the coordinates of the points.
+ */
+Grid::Grid(const Pointi& resolution, double unit, const Array3D<gridreal>& signedDistances, const Pointd& gMin, const Pointd& gMax) :
+    signedDistances(signedDistances), target(0,0,0), unit(unit), surfaceTolerance(false), kernelThreshold(-1), replacedCoefficients(0), integral(nullptr) {
     bb.setMin(gMin);
     bb.setMax(gMax);
     resX = resolution.x();
     resY = resolution.y();
     resZ = resolution.z();
+    coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(1);
+    if (isTiledWeights()){
+        //border and standard weights on the tiles, the dense arrays are never allocated
+        TiledArray3D<int> m(resX-1, resY-1, resZ-1, [](unsigned long, unsigned long, unsigned long, std::array<int, TILE_CELLS>& d){
+            d.fill(0);
+        });
+        tiled = std::make_shared<const TiledGrid>(getTiledWeights([this](unsigned int i, unsigned int j, unsigned int k){ return getBorderWeight(i,j,k); }), m, *coeffs, std::vector<gridreal>());
+        return;
+    }
     weights = Array3D<gridreal>(resX,resY,resZ, BORDER_PAY);
     for (unsigned int i = 2; i < resX-2; i++){
         for (unsigned int j = 2; j < resY-2; j++){
@@ -23,11 +62,43 @@ Grid::Grid(const Pointi& resolution, const Array3D<Pointd>& gridCoordinates, con
             }
         }
     }
-    coeffs = std::vector<std::array<gridreal, 64> >(1);
     mapCoeffs = Array3D<int>((resX-1),(resY-1),(resZ-1), 0);
     //coeffs = Array4D<gridreal>((resX-1),(resY-1),(resZ-1),64, 0);
 }
 
+/**
+ * @brief triangleCellOverlap
+ *
+ * Separating axis test between a triangle and the closed cube [bbmin, bbmin+unit]:
+ * the cube axes, the triangle normal and the nine cross products between the edges.
+ */
+static bool triangleCellOverlap(const std::array<Pointd, 3>& t, const Pointd& bbmin, double unit) {
+    double h = unit / 2;
+    Vec3 c(bbmin.x()+h, bbmin.y()+h, bbmin.z()+h);
+    Vec3 v[3] = {t[0]-c, t[1]-c, t[2]-c};
+    Vec3 e[3] = {v[1]-v[0], v[2]-v[1], v[0]-v[2]};
+    for (unsigned int a = 0; a < 3; a++){
+        if (std::min(std::min(v[0][a], v[1][a]), v[2][a]) > h || std::max(std::max(v[0][a], v[1][a]), v[2][a]) < -h)
+            return false;
+    }
+    Vec3 n = e[0].cross(e[1]);
+    double r = h * (std::abs(n.x()) + std::abs(n.y()) + std::abs(n.z()));
+    if (std::abs(n.dot(v[0])) > r)
+        return false;
+    for (unsigned int i = 0; i < 3; i++){
+        for (unsigned int a = 0; a < 3; a++){
+            Vec3 axis(0,0,0);
+            axis[a] = 1;
+            axis = axis.cross(e[i]);
+            double p0 = axis.dot(v[0]), p1 = axis.dot(v[1]), p2 = axis.dot(v[2]);
+            r = h * (std::abs(axis.x()) + std::abs(axis.y()) + std::abs(axis.z()));
+            if (std::min(std::min(p0, p1), p2) > r || std::max(std::max(p0, p1), p2) < -r)
+                return false;
+        }
+    }
+    return true;
+}
+
 /**
  * @brief Grid::calculateWeights
  *
@@ -35,79 +106,150 @@ Grid::Grid(const Pointi& resolution, const Array3D<Pointd>& gridCoordinates, con
  * @param d
  */
 void Grid::calculateBorderWeights(const Dcel& d, bool tolerance, std::set<const Dcel::Face*>& savedFaces) {
-    cgal::AABBTree aabb(d);
-    double unit = getUnit();
-    std::vector<Pointi> flipped;
-    std::vector<Pointi> notFlipped;
-    for (unsigned int i = 0; i < resX-1; i++){
-        for (unsigned int j = 0; j < resY-1; j++){
-            for (unsigned int k = 0; k < resZ-1; k++){
-                #ifdef CUBE_CENTROID
-                CG3_SUPPRESS_WARNING(tolerance);
-                Pointd bbmin = getPoint(i,j,k) - (unit/2);
-                Pointd bbmax = getPoint(i,j,k) + (unit/2);
-                #else
-                Pointd bbmin = getPoint(i,j,k);
-                Pointd bbmax(bbmin.x()+unit, bbmin.y()+unit, bbmin.z()+unit);
-                #endif
-                BoundingBox bb(bbmin, bbmax);
-                std::list<const Dcel::Face*> l;
-                aabb.getContainedDcelFaces(l, bb);
-                if (l.size() != 0){
-                    bool b = true;
-                    for (std::list<const Dcel::Face*>::iterator it = l.begin(); it != l.end(); ++it) {
-                        const Dcel::Face* f = *it;
-                        Pointi p(i,j,k);
-                        if (f->getNormal().dot(target) < FLIP_ANGLE && f->getFlag() != 1 && savedFaces.find(f) == savedFaces.end()){
-                             flipped.push_back(p);
-                             b = false;
-                        }
-                        ///
-                        else {
-                            notFlipped.push_back(p);
-                        }
-                        ///
-                    }
-                    if (b){
-                        #ifdef CUBE_CENTROID
-                        weights(i,j,k) = MIN_PAY;
-                        #else
-                        setWeightOnCube(i,j,k, MIN_PAY);
-                        #endif
-                    }
-                    #ifdef CUBE_CENTROID
-                    else {
-                        weights(i,j,k) = MAX_PAY;
-                    }
-                    #endif
-                }
+    calculateSurface(d, tolerance, savedFaces);
+
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < resX; i++){
+        for (unsigned int j = 0; j < resY; j++){
+            for (unsigned int k = 0; k < resZ; k++){
+                gridreal w;
+                if (getSurfaceWeight(w, getCornerFlags(surfaceCellFlags, i, j, k), tolerance))
+                    weights(i,j,k) = w;
             }
         }
     }
-    #ifndef CUBE_CENTROID
-    if (tolerance){
-        for (unsigned int i = 0; i < flipped.size(); ++i){
-            setWeightOnCube(flipped[i].x(),flipped[i].y(),flipped[i].z(), MAX_PAY);
-        }
-        ///
-        for (unsigned int i = 0; i < notFlipped.size(); ++i){
-            setWeightOnCube(notFlipped[i].x(),notFlipped[i].y(),notFlipped[i].z(), MIN_PAY);
-        }
-        ///
+}
+
+/**
+ * @brief Grid::calculateSurface
+ *
+ * Resident face flags and surface cells of the target (see calculateWeight).
+ */
+void Grid::calculateSurface(const Dcel& d, bool tolerance, const std::set<const Dcel::Face*>& savedFaces) {
+    surfaceFaceFlags.clear();
+    for (const Dcel::Face* f : d.faceIterator())
+        surfaceFaceFlags.push_back(getFaceFlag(f, target, savedFaces));
+    calculateSurfaceCells(surfaceCellFlags, d, surfaceFaceFlags);
+    surfaceTolerance = tolerance;
+}
+
+/**
+ * @brief Grid::getFaceFlag
+ *
+ * FLIPPED_CELL if the face is flipped with respect to the target and it is not saved,
+ * NOT_FLIPPED_CELL otherwise.
+ */
+unsigned short Grid::getFaceFlag(const Dcel::Face* f, const Vec3& target, const std::set<const Dcel::Face*>& savedFaces) {
+    if (f->getNormal().dot(target) < FLIP_ANGLE && f->getFlag() != 1 && savedFaces.find(f) == savedFaces.end())
+        return FLIPPED_CELL;
+    return NOT_FLIPPED_CELL;
+}
+
+/**
+ * @brief Grid::calculateSurfaceCells
+ *
+ * Every cell of the grid gets the OR of the flags (faceFlags, in the order of d.faceIterator())
+ * of the triangles touching it.
+ * Every triangle marks only the cells in its bounding box that pass an exact triangle/cube test.
+ * Triangles are processed in parallel on a single buffer of flags (one unsigned short per cell,
+ * GridFamily packs the flags of all the targets), updated with atomic ORs.
+ */
+void Grid::calculateSurfaceCells(std::vector<unsigned short>& cellFlags, const Dcel& d, const std::vector<unsigned short>& faceFlags) const {
+    double unit = getUnit();
+    std::vector<std::array<Pointd, 3> > triangles;
+    for (const Dcel::Face* f : d.faceIterator()){
+        triangles.push_back({f->getOuterHalfEdge()->getFromVertex()->getCoordinate(),
+                             f->getOuterHalfEdge()->getToVertex()->getCoordinate(),
+                             f->getOuterHalfEdge()->getNext()->getToVertex()->getCoordinate()});
     }
-    else {
-        ///
-        for (unsigned int i = 0; i < notFlipped.size(); ++i){
-            setWeightOnCube(notFlipped[i].x(),notFlipped[i].y(),notFlipped[i].z(), MIN_PAY);
+    assert(triangles.size() == faceFlags.size());
+
+    #ifdef CUBE_CENTROID
+    Pointd cellOrigin = bb.getMin() - (unit/2);
+    #else
+    Pointd cellOrigin = bb.getMin();
+    #endif
+    int maxCell[3] = {(int)resX-2, (int)resY-2, (int)resZ-2};
+    unsigned int nCells = (resX-1)*(resY-1)*(resZ-1);
+
+    cellFlags.assign(nCells, 0);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (unsigned int t = 0; t < triangles.size(); t++){
+        const std::array<Pointd, 3>& tr = triangles[t];
+        Pointd tmin = tr[0].min(tr[1]).min(tr[2]);
+        Pointd tmax = tr[0].max(tr[1]).max(tr[2]);
+        int lo[3], hi[3];
+        bool empty = false;
+        for (unsigned int a = 0; a < 3; a++){
+            lo[a] = std::max((int)std::ceil((tmin[a] - cellOrigin[a]) / unit - 1), 0);
+            hi[a] = std::min((int)std::floor((tmax[a] - cellOrigin[a]) / unit), maxCell[a]);
+            if (lo[a] > hi[a])
+                empty = true;
         }
-        ///
-        for (unsigned int i = 0; i < flipped.size(); ++i){
-            setWeightOnCube(flipped[i].x(),flipped[i].y(),flipped[i].z(), MAX_PAY);
+        if (empty) continue;
+        unsigned short flag = faceFlags[t];
+        for (int i = lo[0]; i <= hi[0]; i++){
+            for (int j = lo[1]; j <= hi[1]; j++){
+                for (int k = lo[2]; k <= hi[2]; k++){
+                    Pointd bbmin(cellOrigin.x() + i*unit, cellOrigin.y() + j*unit, cellOrigin.z() + k*unit);
+                    if (triangleCellOverlap(tr, bbmin, unit)){
+                        unsigned short& f = cellFlags[(i*(resY-1) + j)*(resZ-1) + k];
+                        unsigned short old;
+                        #pragma omp atomic read
+                        old = f;
+                        if ((old & flag) != flag){ //most cells are touched by several triangles with the same flags
+                            #pragma omp atomic
+                            f |= flag;
+                        }
+                    }
+                }
+            }
         }
     }
+}
+
+/**
+ * @brief Grid::getCornerFlags
+ *
+ * Flags of the cubes (up to eight) the grid point (i,j,k) is a corner of.
+ * With CUBE_CENTROID the weights are on the cubes, so only the flags of the cube (i,j,k).
+ */
+unsigned short Grid::getCornerFlags(const std::vector<unsigned short>& cellFlags, unsigned int i, unsigned int j, unsigned int k) const {
+    #ifdef CUBE_CENTROID
+    if (i < resX-1 && j < resY-1 && k < resZ-1)
+        return cellFlags[(i*(resY-1) + j)*(resZ-1) + k];
+    return 0;
+    #else
+    unsigned short f = 0;
+    for (unsigned int ci = (i > 0 ? i-1 : 0); ci <= i && ci < resX-1; ci++)
+        for (unsigned int cj = (j > 0 ? j-1 : 0); cj <= j && cj < resY-1; cj++)
+            for (unsigned int ck = (k > 0 ? k-1 : 0); ck <= k && ck < resZ-1; ck++)
+                f |= cellFlags[(ci*(resY-1) + cj)*(resZ-1) + ck];
+    return f;
     #endif
 }
 
+/**
+ * @brief Grid::getSurfaceWeight
+ *
+ * Weight of a grid point touched by the surface, given the flags of its cubes.
+ * With tolerance a cube with a non flipped triangle wins over the cubes with flipped
+ * triangles (MIN_PAY), without tolerance the cubes with flipped triangles win (MAX_PAY).
+ * @return false if the point is not touched by the surface
+ */
+bool Grid::getSurfaceWeight(gridreal& w, unsigned short flags, bool tolerance) {
+    #ifdef CUBE_CENTROID
+    tolerance = false;
+    #endif
+    if (!flags)
+        return false;
+    if (tolerance)
+        w = (flags & NOT_FLIPPED_CELL) ? MIN_PAY : MAX_PAY;
+    else
+        w = (flags & FLIPPED_CELL) ? MAX_PAY : MIN_PAY;
+    return true;
+}
+
 /**
  * @brief Grid::freezeKernel
  *
@@ -116,6 +258,42 @@ void Grid::calculateBorderWeights(const Dcel& d, bool tolerance, std::set<const
  */
 void Grid::calculateWeightsAndFreezeKernel(const Dcel& d, double value, bool tolerance, std::set<const Dcel::Face*>& savedFaces) {
     assert(value >= 0 && value <= 1);
+    if (isTiledWeights()){
+        //weights and coefficient ids computed directly on the tiles, point by point (see calculateWeight)
+        weights = Array3D<gridreal>();
+        mapCoeffs = Array3D<int>();
+        lazy.reset();
+        outOfCore.reset();
+        calculateSurface(d, tolerance, savedFaces);
+        kernelThreshold = std::abs((1 - value) * signedDistances.min());
+        TiledArray3D<gridreal> w = getTiledWeights([this](unsigned int i, unsigned int j, unsigned int k){ return calculateWeight(i,j,k); });
+        TiledArray3D<int> m;
+        if (outOfCoreStorage){
+            //only the weights, the coefficients are derived by the bricks (see calculateFullBoxValues)
+            m = TiledArray3D<int>(resX-1, resY-1, resZ-1, [](unsigned long, unsigned long, unsigned long, std::array<int, TILE_CELLS>& d){
+                d.fill(0);
+            });
+            coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(1);
+            (*coeffs)[0].fill(0);
+            (*coeffs)[0][0] = w(0,0,0);
+        }
+        else {
+            coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
+            TricubicInterpolator::getCoefficients(*coeffs, m, w);
+        }
+        tiled = std::make_shared<const TiledGrid>(w, m, *coeffs, std::vector<gridreal>());
+        return;
+    }
+    if (tiled){
+        weights = Array3D<gridreal>(resX, resY, resZ);
+        mapCoeffs = Array3D<int>(resX-1, resY-1, resZ-1, 0);
+        tiled.reset();
+    }
+    if (lazy || outOfCore){
+        weights = Array3D<gridreal>(resX, resY, resZ);
+        lazy.reset();
+        outOfCore.reset();
+    }
     // grid border and rest
     weights.fill(BORDER_PAY);
     for (unsigned int i = 2; i < resX-2; i++){
@@ -144,64 +322,726 @@ void Grid::calculateWeightsAndFreezeKernel(const Dcel& d, double value, bool tol
             }
         }
     }
-    TricubicInterpolator::getCoefficients(coeffs, mapCoeffs, weights);
+    kernelThreshold = value;
+    if (lazyStorage){
+        //computed on demand (see calculateFullBoxValues)
+        setBorderCoefficients();
+        mapCoeffs = Array3D<int>();
+        return;
+    }
+    if (mapCoeffs.getSizeX() == 0)
+        mapCoeffs = Array3D<int>(resX-1, resY-1, resZ-1, 0);
+    coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
+    TricubicInterpolator::getCoefficients(*coeffs, mapCoeffs, weights);
+}
+
+/**
+ * @brief Grid::setBorderCoefficients
+ *
+ * Only the constant coefficients of the cells on the border (id 0), used with lazy and out-of-core storage.
+ */
+void Grid::setBorderCoefficients() {
+    coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(1);
+    (*coeffs)[0].fill(0);
+    (*coeffs)[0][0] = weights(0,0,0);
+}
+
+/**
+ * @brief Grid::updateWeightsAndFreezeKernel
+ *
+ * Same result of calculateWeightsAndFreezeKernel followed by calculateFullBoxValues, computed only
+ * on the points whose weight changes. The face flags, the surface cells and the kernel threshold of
+ * the last weights are kept: if the surface is unchanged only the shell of points between the old
+ * and the new kernel is visited, otherwise the surface cells are recomputed and every point is
+ * compared. Then only the coefficients and the full box values of the cells around the changed
+ * points are recomputed (see updateCoefficients).
+ * Grids with tiled, lazy or out-of-core storage, without distance field or never frozen are computed from scratch.
+ * @return false if the full box values still have to be computed (calculateFullBoxValues never called)
+ */
+bool Grid::updateWeightsAndFreezeKernel(const Dcel& d, double value, bool tolerance, std::set<const Dcel::Face*>& savedFaces) {
+    assert(value >= 0 && value <= 1);
+    if (tiled || lazy || outOfCore || integral == nullptr || !isKernelFrozen() || signedDistances.getSizeX() == 0 ||
+            mapCoeffs.getSizeX() == 0 || surfaceFaceFlags.size() != d.getNumberFaces()){
+        calculateWeightsAndFreezeKernel(d, value, tolerance, savedFaces);
+        if (integral == nullptr)
+            return false;
+        calculateFullBoxValues(integral);
+        return true;
+    }
+    double threshold = std::abs((1 - value) * signedDistances.min());
+    bool surfaceChanged = tolerance != surfaceTolerance;
+    std::vector<unsigned short> faceFlags;
+    for (const Dcel::Face* f : d.faceIterator())
+        faceFlags.push_back(getFaceFlag(f, target, savedFaces));
+    if (faceFlags != surfaceFaceFlags){
+        surfaceFaceFlags.swap(faceFlags);
+        calculateSurfaceCells(surfaceCellFlags, d, surfaceFaceFlags);
+        surfaceChanged = true;
+    }
+    surfaceTolerance = tolerance;
+    double lo = std::min(threshold, kernelThreshold), hi = std::max(threshold, kernelThreshold);
+    kernelThreshold = threshold;
+
+    std::vector< std::vector<unsigned int> > slabs(resX);
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < resX; i++){
+        for (unsigned int j = 0; j < resY; j++){
+            for (unsigned int k = 0; k < resZ; k++){
+                if (!surfaceChanged){ //only the points entering or leaving the kernel
+                    double sd = getSignedDistance(i,j,k);
+                    if (sd >= -lo || sd < -hi)
+                        continue;
+                }
+                gridreal w = calculateWeight(i,j,k);
+                if (w != weights(i,j,k)){
+                    weights(i,j,k) = w;
+                    slabs[i].push_back(getIndex(i,j,k));
+                }
+            }
+        }
+    }
+    std::vector<unsigned int> points;
+    for (unsigned int i = 0; i < resX; i++)
+        points.insert(points.end(), slabs[i].begin(), slabs[i].end());
+    if (points.size() > 0)
+        updateCoefficients(points);
+    return true;
+}
+
+/**
+ * @brief Grid::calculateWeight
+ *
+ * Weight of the point (i,j,k) given by calculateWeightsAndFreezeKernel with the resident surface cells
+ * and kernel threshold: kernel, then surface, then border or standard weight.
+ */
+gridreal Grid::calculateWeight(unsigned int i, unsigned int j, unsigned int k) const {
+    if (getSignedDistance(i,j,k) < -kernelThreshold)
+        return MAX_PAY;
+    gridreal w;
+    if (getSurfaceWeight(w, getCornerFlags(surfaceCellFlags, i, j, k), surfaceTolerance))
+        return w;
+    return getBorderWeight(i,j,k);
+}
+
+/**
+ * @brief Grid::updateCoefficients
+ *
+ * Recomputes coefficients and full box values of the cells having a point of points (indices of
+ * changed weights) in their 4x4x4 neighbourhood, the summed volume table, and the summed area tables
+ * of the slices containing these cells. New coefficients are appended to the pool (copied first if
+ * shared with other grids); the ones no longer used are dropped by compactCoefficients when the
+ * cells replaced since the last compaction exceed UNUSED_COEFFICIENTS_FRACTION of the pool.
+ */
+void Grid::updateCoefficients(const std::vector<unsigned int>& points) {
+    std::vector<unsigned int> cells;
+    for (unsigned int p : points){
+        int i = p / (resY*resZ), j = (p / resZ) % resY, k = p % resZ;
+        for (int ci = std::max(i-2, 1); ci <= std::min(i+1, (int)resX-3); ci++)
+            for (int cj = std::max(j-2, 1); cj <= std::min(j+1, (int)resY-3); cj++)
+                for (int ck = std::max(k-2, 1); ck <= std::min(k+1, (int)resZ-3); ck++)
+                    cells.push_back((ci*(resY-1) + cj)*(resZ-1) + ck);
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    std::vector<std::array<gridreal, 64> > cellCoeffs(cells.size());
+    #pragma omp parallel for
+    for (unsigned int c = 0; c < cells.size(); c++){
+        int xi = cells[c] / ((resY-1)*(resZ-1)), yi = (cells[c] / (resZ-1)) % (resY-1), zi = cells[c] % (resZ-1);
+        gridreal neighbourhood[64];
+        for (int cc = 0; cc < 4; cc++)
+            for (int b = 0; b < 4; b++)
+                for (int a = 0; a < 4; a++)
+                    neighbourhood[a + 4*b + 16*cc] = weights(xi+a-1, yi+b-1, zi+cc-1);
+        TricubicInterpolator::getCoefficients(cellCoeffs[c], neighbourhood);
+    }
+
+    if (coeffs.use_count() > 1){
+        coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(*coeffs);
+        replacedCoefficients = coeffs->size(); //the copy also holds the coefficients of the other grids
+    }
+    std::vector<std::array<gridreal, 64> >& pool = *coeffs;
+    std::map<std::array<gridreal, 64>, int> mapping;
+    std::vector<bool> slices[3] = {std::vector<bool>(resX-1, false), std::vector<bool>(resY-1, false), std::vector<bool>(resZ-1, false)};
+    for (unsigned int c = 0; c < cells.size(); c++){
+        int xi = cells[c] / ((resY-1)*(resZ-1)), yi = (cells[c] / (resZ-1)) % (resY-1), zi = cells[c] % (resZ-1);
+        std::map<std::array<gridreal, 64>, int>::iterator it = mapping.find(cellCoeffs[c]);
+        int id;
+        if (it == mapping.end()){
+            id = pool.size();
+            pool.push_back(cellCoeffs[c]);
+            mapping[cellCoeffs[c]] = id;
+        }
+        else
+            id = it->second;
+        mapCoeffs(xi,yi,zi) = id;
+        const gridreal* coefficients = pool[id].data();
+        fullBoxValues(xi,yi,zi) = integral(coefficients, 0,0,0,1,1,1);
+        slices[0][xi] = slices[1][yi] = slices[2][zi] = true;
+    }
+    replacedCoefficients += cells.size();
+    if (replacedCoefficients > UNUSED_COEFFICIENTS_FRACTION * pool.size())
+        compactCoefficients();
+    calculateFullBoxSums();
+    std::vector<std::array<double, 4> > faceIntegrals[3];
+    calculateFaceIntegrals(faceIntegrals);
+    for (unsigned int axis = 0; axis < 3; axis++)
+        calculateFaceSums(axis, slices[axis], faceIntegrals[axis]);
+}
+
+/**
+ * @brief Grid::compactCoefficients
+ *
+ * Removes from the pool the coefficients not referenced by mapCoeffs (the id 0, the coefficients
+ * of the border, is always kept), preserving the order of the others, and remaps mapCoeffs.
+ * The pool must not be shared with other grids.
+ */
+void Grid::compactCoefficients() {
+    assert(coeffs.use_count() == 1);
+    std::vector<std::array<gridreal, 64> >& pool = *coeffs;
+    std::vector<int> ids(pool.size(), -1);
+    ids[0] = 0;
+    for (unsigned int xi = 0; xi < resX-1; xi++)
+        for (unsigned int yi = 0; yi < resY-1; yi++)
+            for (unsigned int zi = 0; zi < resZ-1; zi++)
+                ids[mapCoeffs(xi,yi,zi)] = 0;
+    int n = 0;
+    for (unsigned int id = 0; id < pool.size(); id++){
+        if (ids[id] >= 0){
+            if (n != (int)id)
+                pool[n] = pool[id];
+            ids[id] = n++;
+        }
+    }
+    pool.resize(n);
+    pool.shrink_to_fit();
+    #pragma omp parallel for
+    for (unsigned int xi = 0; xi < resX-1; xi++)
+        for (unsigned int yi = 0; yi < resY-1; yi++)
+            for (unsigned int zi = 0; zi < resZ-1; zi++)
+                mapCoeffs(xi,yi,zi) = ids[mapCoeffs(xi,yi,zi)];
+    replacedCoefficients = 0;
 }
 
 void Grid::calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) {
+    integral = integralTricubicInterpolation;
+    replacedCoefficients = 0;
+    if (tiled && isTiledBuild()){
+        //weights and coefficient ids already on the tiles (see calculateWeightsAndFreezeKernel)
+        std::vector<gridreal> values;
+        calculateFullBoxIntegrals(values, integralTricubicInterpolation);
+        calculateTiledGrid(values);
+        return;
+    }
+    if (outOfCore){
+        outOfCore->getWeights(weights);
+        outOfCore.reset();
+    }
+    if (outOfCoreStorage){
+        //the bricks are streamed from the weights, on the tiles if computed there (see calculateWeightsAndFreezeKernel)
+        std::shared_ptr<const OutOfCoreGrid> grid;
+        if (tiled){
+            const TiledArray3D<gridreal>& w = tiled->getTiledWeights();
+            grid = std::make_shared<const OutOfCoreGrid>(resX, resY, resZ, [&w](unsigned int i, unsigned int j, unsigned int k){ return w(i,j,k); }, (*coeffs)[0], integralTricubicInterpolation);
+        }
+        else {
+            const Array3D<gridreal>& w = lazy ? lazy->getWeights() : weights;
+            grid = std::make_shared<const OutOfCoreGrid>(resX, resY, resZ, [&w](unsigned int i, unsigned int j, unsigned int k){ return w(i,j,k); }, (*coeffs)[0], integralTricubicInterpolation);
+        }
+        if (grid->isValid()){
+            outOfCore = grid;
+            tiled.reset();
+            lazy.reset();
+            weights = Array3D<gridreal>();
+            mapCoeffs = Array3D<int>();
+            fullBoxValues = Array3D<gridreal>();
+            fullBoxSums = Array3D<double>();
+            for (unsigned int axis = 0; axis < 3; axis++)
+                faceSums[axis] = Array3D<std::array<double, 4> >();
+            return;
+        }
+        std::cerr << "WARNING: out-of-core storage not available, grid kept in memory.\n";
+        if (tiled){
+            //weights only, the coefficients are computed below
+            tiled->getWeights(weights);
+            tiled.reset();
+            mapCoeffs = Array3D<int>();
+        }
+    }
+    if (tiled){
+        tiled->getWeights(weights);
+        tiled->getMapCoeffs(mapCoeffs);
+        tiled.reset();
+    }
+    if (lazy){
+        weights = lazy->getWeights();
+        lazy.reset();
+    }
+    if (lazyStorage){
+        lazy = std::make_shared<const LazyGrid>(weights, (*coeffs)[0], integralTricubicInterpolation);
+        weights = Array3D<gridreal>();
+        mapCoeffs = Array3D<int>();
+        fullBoxValues = Array3D<gridreal>();
+        fullBoxSums = Array3D<double>();
+        for (unsigned int axis = 0; axis < 3; axis++)
+            faceSums[axis] = Array3D<std::array<double, 4> >();
+        return;
+    }
+    if (mapCoeffs.getSizeX() == 0){
+        //coefficients not computed (lazy storage when the weights were computed)
+        mapCoeffs = Array3D<int>(resX-1, resY-1, resZ-1, 0);
+        coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
+        TricubicInterpolator::getCoefficients(*coeffs, mapCoeffs, weights);
+    }
+    //the integral is computed once for every distinct set of coefficients
+    std::vector<gridreal> values;
+    calculateFullBoxIntegrals(values, integralTricubicInterpolation);
+    if (tiledStorage){
+        calculateTiledGrid(values);
+        return;
+    }
+    std::vector<std::array<double, 4> > faceIntegrals[3];
+    calculateFaceIntegrals(faceIntegrals);
+    calculateFullBoxValues(integralTricubicInterpolation, values, faceIntegrals);
+}
+
+/**
+ * @brief Grid::calculateFullBoxValues
+ *
+ * Full box values and summed tables (or the TiledGrid, with tiled storage) of a grid having dense
+ * weights and coefficients, from the full box values and the face integrals of every set of
+ * coefficients of the pool (see calculateFullBoxIntegrals and calculateFaceIntegrals).
+ * Lazy and out-of-core storage are not used.
+ */
+void Grid::calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double), const std::vector<gridreal>& values, const std::vector<std::array<double, 4> > faceIntegrals[3]) {
+    integral = integralTricubicInterpolation;
+    lazy.reset();
+    outOfCore.reset();
+    if (tiledStorage){
+        calculateTiledGrid(values);
+        return;
+    }
+    if (tiled){
+        tiled->getWeights(weights);
+        tiled->getMapCoeffs(mapCoeffs);
+        tiled.reset();
+    }
     fullBoxValues = Array3D<gridreal>(getResX()-1, getResY()-1, getResZ()-1);
     #pragma omp parallel for
     for (unsigned int i = 0; i < fullBoxValues.getSizeX(); ++i){
         for (unsigned int j = 0; j < fullBoxValues.getSizeY(); ++j){
             for (unsigned int k = 0; k < fullBoxValues.getSizeZ(); ++k){
-                const gridreal * coeffs;
-                getCoefficients(coeffs, i, j, k);
-                fullBoxValues(i,j,k) = integralTricubicInterpolation(coeffs, 0,0,0,1,1,1);
+                fullBoxValues(i,j,k) = values[mapCoeffs(i,j,k)];
+            }
+        }
+    }
+    calculateFullBoxSums();
+    calculateFaceSums(faceIntegrals);
+}
+
+/**
+ * @brief Grid::updateFullBoxValues
+ *
+ * Updates the full box values of cells (indices of cells whose coefficient id has been changed)
+ * from the values of every set of coefficients, the summed volume table, and the summed area
+ * tables of the slices containing these cells. Only for grids with dense summed tables.
+ */
+void Grid::updateFullBoxValues(const std::vector<unsigned int>& cells, const std::vector<gridreal>& values, const std::vector<std::array<double, 4> > faceIntegrals[3]) {
+    std::vector<bool> slices[3] = {std::vector<bool>(resX-1, false), std::vector<bool>(resY-1, false), std::vector<bool>(resZ-1, false)};
+    for (unsigned int c : cells){
+        int xi = c / ((resY-1)*(resZ-1)), yi = (c / (resZ-1)) % (resY-1), zi = c % (resZ-1);
+        fullBoxValues(xi,yi,zi) = values[mapCoeffs(xi,yi,zi)];
+        slices[0][xi] = slices[1][yi] = slices[2][zi] = true;
+    }
+    calculateFullBoxSums();
+    for (unsigned int axis = 0; axis < 3; axis++)
+        calculateFaceSums(axis, slices[axis], faceIntegrals[axis]);
+}
+
+/**
+ * @brief Grid::calculateFullBoxIntegrals
+ *
+ * values[id] is the full box value of the cells having the coefficients id of the pool.
+ */
+void Grid::calculateFullBoxIntegrals(std::vector<gridreal>& values, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) const {
+    values.resize(coeffs->size());
+    #pragma omp parallel for
+    for (unsigned int id = 0; id < values.size(); id++){
+        const gridreal * c = (*coeffs)[id].data();
+        values[id] = integralTricubicInterpolation(c, 0,0,0,1,1,1);
+    }
+}
+
+/**
+ * @brief Grid::calculateFaceIntegrals
+ *
+ * For every axis, faceIntegrals[axis][id] are the face integrals (see
+ * TricubicInterpolator::getFaceIntegrals) of the cells having the coefficients id of the pool.
+ */
+void Grid::calculateFaceIntegrals(std::vector<std::array<double, 4> > faceIntegrals[3]) const {
+    for (unsigned int axis = 0; axis < 3; axis++){
+        faceIntegrals[axis].resize(coeffs->size());
+        #pragma omp parallel for
+        for (unsigned int id = 0; id < faceIntegrals[axis].size(); id++)
+            TricubicInterpolator::getFaceIntegrals(faceIntegrals[axis][id].data(), (*coeffs)[id].data(), axis);
+    }
+}
+
+/**
+ * @brief Grid::calculateTiledGrid
+ *
+ * Moves weights, coefficient ids and full box values (values, for every set of coefficients)
+ * in a TiledGrid, and releases the dense arrays and the summed tables. If the weights and the
+ * coefficient ids are already on the tiles, the tiles are reused.
+ */
+void Grid::calculateTiledGrid(const std::vector<gridreal>& values) {
+    if (tiled)
+        tiled = std::make_shared<const TiledGrid>(tiled->getTiledWeights(), tiled->getTiledMapCoeffs(), *coeffs, values);
+    else
+        tiled = std::make_shared<const TiledGrid>(weights, mapCoeffs, *coeffs, values);
+    weights = Array3D<gridreal>();
+    mapCoeffs = Array3D<int>();
+    fullBoxValues = Array3D<gridreal>();
+    fullBoxSums = Array3D<double>();
+    for (unsigned int axis = 0; axis < 3; axis++)
+        faceSums[axis] = Array3D<std::array<double, 4> >();
+}
+
+/**
+ * @brief Grid::getFullBoxesValue
+ *
+ * Sum of the full box values of the cells in [i1,i2]x[j1,j2]x[k1,k2] (extremes included),
+ * with 8 lookups on the summed volume table. Cells outside the grid have the value of the
+ * cells on the border.
+ */
+double Grid::getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const {
+    if (i1 > i2 || j1 > j2 || k1 > k2)
+        return 0;
+    int ci1 = std::max(i1, 0), cj1 = std::max(j1, 0), ck1 = std::max(k1, 0);
+    int ci2 = std::min(i2, (int)resX-2), cj2 = std::min(j2, (int)resY-2), ck2 = std::min(k2, (int)resZ-2);
+    double nTotal = (double)(i2-i1+1)*(j2-j1+1)*(k2-k1+1);
+    double nInside = 0;
+    double sum = 0;
+    if (ci1 <= ci2 && cj1 <= cj2 && ck1 <= ck2){
+        nInside = (double)(ci2-ci1+1)*(cj2-cj1+1)*(ck2-ck1+1);
+        if (outOfCore)
+            sum = outOfCore->getFullBoxesValue(ci1, cj1, ck1, ci2, cj2, ck2);
+        else if (lazy)
+            sum = lazy->getFullBoxesValue(ci1, cj1, ck1, ci2, cj2, ck2);
+        else if (tiled)
+            sum = tiled->getFullBoxesValue(ci1, cj1, ck1, ci2, cj2, ck2);
+        else {
+            ci2++; cj2++; ck2++;
+            sum = getFullBoxSum(ci2,cj2,ck2) - getFullBoxSum(ci1,cj2,ck2) - getFullBoxSum(ci2,cj1,ck2) - getFullBoxSum(ci2,cj2,ck1)
+                    + getFullBoxSum(ci1,cj1,ck2) + getFullBoxSum(ci1,cj2,ck1) + getFullBoxSum(ci2,cj1,ck1) - getFullBoxSum(ci1,cj1,ck1);
+        }
+    }
+    if (nTotal > nInside)
+        sum += (nTotal - nInside) * getBorderFullBoxValue();
+    return sum;
+}
+
+/**
+ * @brief Grid::calculateFullBoxSums
+ *
+ * fullBoxSums(i,j,k) is the sum of the full box values of the cells in [0,i)x[0,j)x[0,k).
+ * The table is built with three prefix-sum passes, one for every axis.
+ */
+void Grid::calculateFullBoxSums() {
+    unsigned int sx = fullBoxValues.getSizeX(), sy = fullBoxValues.getSizeY(), sz = fullBoxValues.getSizeZ();
+    fullBoxSums = Array3D<double>(sx+1, sy+1, sz+1, 0);
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < sx; ++i){
+        for (unsigned int j = 0; j < sy; ++j){
+            for (unsigned int k = 0; k < sz; ++k){
+                fullBoxSums(i+1,j+1,k+1) = fullBoxSums(i+1,j+1,k) + fullBoxValues(i,j,k);
+            }
+        }
+    }
+    #pragma omp parallel for
+    for (unsigned int i = 1; i <= sx; ++i){
+        for (unsigned int j = 1; j < sy; ++j){
+            for (unsigned int k = 1; k <= sz; ++k){
+                fullBoxSums(i,j+1,k) += fullBoxSums(i,j,k);
+            }
+        }
+    }
+    #pragma omp parallel for
+    for (unsigned int j = 1; j <= sy; ++j){
+        for (unsigned int i = 1; i < sx; ++i){
+            for (unsigned int k = 1; k <= sz; ++k){
+                fullBoxSums(i+1,j,k) += fullBoxSums(i,j,k);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Grid::calculateFaceSums
+ *
+ * For every axis and every slice of cells orthogonal to that axis, builds the summed
+ * area table of the face integrals of the cells, given for every set of coefficients
+ * (see calculateFaceIntegrals).
+ * faceSums[axis](c, p, q) is the sum on the cells of the slice c in [0,p)x[0,q), where p and q
+ * are the other two axes in order.
+ */
+void Grid::calculateFaceSums(const std::vector<std::array<double, 4> > faceIntegrals[3]) {
+    unsigned int n[3] = {(unsigned int)fullBoxValues.getSizeX(), (unsigned int)fullBoxValues.getSizeY(), (unsigned int)fullBoxValues.getSizeZ()};
+    for (unsigned int axis = 0; axis < 3; axis++){
+        unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+        faceSums[axis] = Array3D<std::array<double, 4> >(n[axis], n[p]+1, n[q]+1, {0, 0, 0, 0});
+        calculateFaceSums(axis, std::vector<bool>(), faceIntegrals[axis]);
+    }
+}
+
+/**
+ * @brief Grid::calculateFaceSums
+ *
+ * Summed area tables of the face integrals (integrals, for every set of coefficients) of the slices c orthogonal
+ * to axis with slices[c] true, or of all the slices if slices is empty.
+ */
+void Grid::calculateFaceSums(unsigned int axis, const std::vector<bool>& slices, const std::vector<std::array<double, 4> >& integrals) {
+    unsigned int n[3] = {(unsigned int)fullBoxValues.getSizeX(), (unsigned int)fullBoxValues.getSizeY(), (unsigned int)fullBoxValues.getSizeZ()};
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    Array3D<std::array<double, 4> >& s = faceSums[axis];
+    #pragma omp parallel for
+    for (unsigned int c = 0; c < n[axis]; c++){
+        if (slices.size() > 0 && !slices[c])
+            continue;
+        for (unsigned int ip = 0; ip < n[p]; ip++){
+            for (unsigned int iq = 0; iq < n[q]; iq++){
+                unsigned int id[3];
+                id[axis] = c; id[p] = ip; id[q] = iq;
+                const std::array<double, 4>& f = integrals[mapCoeffs(id[0], id[1], id[2])];
+                for (unsigned int i = 0; i < 4; i++)
+                    s(c,ip+1,iq+1)[i] = f[i] + s(c,ip,iq+1)[i] + s(c,ip+1,iq)[i] - s(c,ip,iq)[i];
             }
         }
     }
 }
 
+/**
+ * @brief Grid::getFullFacesValue
+ *
+ * Sum of the face integrals (orthogonal to axis) of the cells in the slice c, in [p1,p2]x[q1,q2]
+ * (extremes included), with 4 lookups on the summed area tables.
+ * Cells outside the grid have the value of the cells on the border.
+ */
+void Grid::getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const {
+    for (unsigned int i = 0; i < 4; i++)
+        f[i] = 0;
+    if (p1 > p2 || q1 > q2)
+        return;
+    const Array3D<std::array<double, 4> >& s = faceSums[axis];
+    int n[3] = {(int)resX-1, (int)resY-1, (int)resZ-1};
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    int cp1 = std::max(p1, 0), cq1 = std::max(q1, 0);
+    int cp2 = std::min(p2, n[p]-1), cq2 = std::min(q2, n[q]-1);
+    double nTotal = (double)(p2-p1+1)*(q2-q1+1);
+    double nInside = 0;
+    if (c >= 0 && c < n[axis] && cp1 <= cp2 && cq1 <= cq2){
+        nInside = (double)(cp2-cp1+1)*(cq2-cq1+1);
+        if (outOfCore)
+            outOfCore->getFullFacesValue(f, axis, c, cp1, cq1, cp2, cq2);
+        else if (lazy)
+            lazy->getFullFacesValue(f, axis, c, cp1, cq1, cp2, cq2);
+        else if (tiled)
+            tiled->getFullFacesValue(f, axis, c, cp1, cq1, cp2, cq2);
+        else {
+            cp2++; cq2++;
+            for (unsigned int i = 0; i < 4; i++)
+                f[i] = s(c,cp2,cq2)[i] - s(c,cp1,cq2)[i] - s(c,cp2,cq1)[i] + s(c,cp1,cq1)[i];
+        }
+    }
+    if (nTotal > nInside){
+        double b[4];
+        TricubicInterpolator::getFaceIntegrals(b, (*coeffs)[0].data(), axis);
+        for (unsigned int i = 0; i < 4; i++)
+            f[i] += (nTotal - nInside) * b[i];
+    }
+}
+
 double Grid::getValue(const Pointd& p) const {
     if (! bb.isStrictlyIntern(p)) return BORDER_PAY;
     unsigned int xi = getIndexOfCoordinateX(p.x()), yi = getIndexOfCoordinateY(p.y()), zi = getIndexOfCoordinateZ(p.z());
     Pointd n = getPoint(xi, yi, zi);
     if (n == p)
-        return weights(xi,yi,zi);
+        return getWeight(xi,yi,zi);
     else{
         n = (p - n) / getUnit(); // n ora è un punto nell'intervallo 0 - 1
-        int id = mapCoeffs(xi, yi, zi);
-        const gridreal* coef = coeffs[id].data();
+        const gridreal* coef;
+        getCoefficients(coef, xi, yi, zi);
         return TricubicInterpolator::getValue(n, coef);
     }
 }
 
+/**
+ * @brief Grid::getValues
+ *
+ * values[p] = getValue(Pointd(x[p], y[p], z[p])) for n points given as a structure of arrays.
+ * The points are grouped by cell, so the coefficients of every cell are loaded once and evaluated
+ * on all the points of the cell together (see TricubicInterpolator::getValues).
+ */
+void Grid::getValues(const double* x, const double* y, const double* z, double* values, unsigned int n) const {
+    std::vector<std::pair<unsigned int, unsigned int> > cells; //(index of the cell, point)
+    cells.reserve(n);
+    for (unsigned int p = 0; p < n; p++){
+        Pointd q(x[p], y[p], z[p]);
+        if (! bb.isStrictlyIntern(q)){
+            values[p] = BORDER_PAY;
+            continue;
+        }
+        unsigned int xi = getIndexOfCoordinateX(q.x()), yi = getIndexOfCoordinateY(q.y()), zi = getIndexOfCoordinateZ(q.z());
+        if (getPoint(xi, yi, zi) == q)
+            values[p] = getWeight(xi,yi,zi);
+        else
+            cells.push_back(std::make_pair(getIndex(xi, yi, zi), p));
+    }
+    std::sort(cells.begin(), cells.end());
+
+    std::vector<double> u, v, w, r;
+    for (size_t first = 0, last; first < cells.size(); first = last){
+        for (last = first+1; last < cells.size() && cells[last].first == cells[first].first; last++);
+        unsigned int m = last - first;
+        unsigned int id = cells[first].first;
+        unsigned int xi = id / (resY*resZ), yi = (id / resZ) % resY, zi = id % resZ;
+        Pointd o = getPoint(xi, yi, zi);
+        u.resize(m); v.resize(m); w.resize(m); r.resize(m);
+        for (unsigned int s = 0; s < m; s++){
+            unsigned int p = cells[first+s].second;
+            u[s] = (x[p] - o.x()) / unit;
+            v[s] = (y[p] - o.y()) / unit;
+            w[s] = (z[p] - o.z()) / unit;
+        }
+        const gridreal* coef;
+        getCoefficients(coef, xi, yi, zi);
+        TricubicInterpolator::getValues(coef, u.data(), v.data(), w.data(), r.data(), m);
+        for (unsigned int s = 0; s < m; s++)
+            values[cells[first+s].second] = r[s];
+    }
+}
+
+/**
+ * @brief Grid::getMinAndMax
+ *
+ * Minimum and maximum of the interpolated weights sampled every 0.5 in the bounding box
+ * (at least MIN_PAY and MAX_PAY). Every slice orthogonal to x is evaluated with getValues.
+ */
 void Grid::getMinAndMax(double& min, double& max) {
-    min = MIN_PAY; max = MAX_PAY;
-    for (double xi = bb.getMinX(); xi <= bb.getMaxX(); xi+=0.5){
-        for (double yi = bb.getMinY(); yi <= bb.getMaxY(); yi+=0.5){
-            for (double zi = bb.getMinZ(); zi <= bb.getMaxZ(); zi+=0.5){
-                double w = getValue(Pointd(xi,yi,zi));
-                if (w < min){
-                    min = w;
-                }
-                if (w > max){
-                    max = w;
-                }
+    const double step = 0.5;
+    unsigned int nx = std::floor((bb.getMaxX() - bb.getMinX()) / step) + 1;
+    unsigned int ny = std::floor((bb.getMaxY() - bb.getMinY()) / step) + 1;
+    unsigned int nz = std::floor((bb.getMaxZ() - bb.getMinZ()) / step) + 1;
+    double localMin = MIN_PAY, localMax = MAX_PAY;
+    #pragma omp parallel
+    {
+        std::vector<double> x(ny*nz), y(ny*nz), z(ny*nz), values(ny*nz);
+        for (unsigned int b = 0; b < ny; b++){
+            for (unsigned int c = 0; c < nz; c++){
+                y[b*nz + c] = bb.getMinY() + b*step;
+                z[b*nz + c] = bb.getMinZ() + c*step;
+            }
+        }
+        #pragma omp for reduction(min:localMin) reduction(max:localMax)
+        for (unsigned int a = 0; a < nx; a++){
+            std::fill(x.begin(), x.end(), bb.getMinX() + a*step);
+            getValues(x.data(), y.data(), z.data(), values.data(), ny*nz);
+            for (double w : values){
+                localMin = std::min(localMin, w);
+                localMax = std::max(localMax, w);
             }
         }
     }
+    min = localMin;
+    max = localMax;
+}
+
+/**
+ * @brief Grid::getDenseData
+ *
+ * Weights, coefficients, coefficient ids and full box values of a grid with tiled, lazy or out-of-core
+ * storage, in the format of the dense grid (with lazy and out-of-core storage all the coefficients are computed).
+ */
+void Grid::getDenseData(Array3D<gridreal>& w, std::vector<std::array<gridreal, 64> >& c, Array3D<int>& m, Array3D<gridreal>& v) const {
+    if (lazy || outOfCore){
+        if (lazy)
+            w = lazy->getWeights();
+        else
+            outOfCore->getWeights(w);
+        m = Array3D<int>(resX-1, resY-1, resZ-1, 0);
+        c.clear();
+        TricubicInterpolator::getCoefficients(c, m, w);
+        std::vector<gridreal> values(c.size());
+        #pragma omp parallel for
+        for (unsigned int id = 0; id < values.size(); id++)
+            values[id] = lazy ? lazy->integrate(c[id].data()) : outOfCore->integrate(c[id].data());
+        v = Array3D<gridreal>(resX-1, resY-1, resZ-1);
+        for (unsigned int i = 0; i < v.getSizeX(); ++i)
+            for (unsigned int j = 0; j < v.getSizeY(); ++j)
+                for (unsigned int k = 0; k < v.getSizeZ(); ++k)
+                    v(i,j,k) = values[m(i,j,k)];
+    }
+    else if (tiled){
+        tiled->getWeights(w);
+        tiled->getMapCoeffs(m);
+        tiled->getFullBoxValues(v);
+        c = *coeffs;
+    }
+    else {
+        w = weights;
+        c = *coeffs;
+        m = mapCoeffs;
+        v = fullBoxValues;
+    }
 }
 
 void Grid::serialize(std::ofstream& binaryFile) const {
+    if (lazy || tiled || outOfCore){
+        //same format of the dense grid
+        Array3D<gridreal> w, v;
+        Array3D<int> m;
+        std::vector<std::array<gridreal, 64> > c;
+        getDenseData(w, c, m, v);
+        serializeObjectAttributes("Grid", binaryFile, bb, resX, resY, resZ,
+                                              signedDistances, w, c, m,
+                                              v, target, unit);
+        return;
+    }
     serializeObjectAttributes("Grid", binaryFile, bb, resX, resY, resZ,
-                                          signedDistances, weights, coeffs, mapCoeffs,
+                                          signedDistances, weights, *coeffs, mapCoeffs,
                                           fullBoxValues, target, unit);
 }
 
 void Grid::deserialize(std::ifstream& binaryFile) {
+    coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
     deserializeObjectAttributes("Grid", binaryFile, bb, resX, resY, resZ,
-                                          signedDistances, weights, coeffs, mapCoeffs,
+                                          signedDistances, weights, *coeffs, mapCoeffs,
                                           fullBoxValues, target, unit);
+    calculateSummedTables();
 }
 
-
+/**
+ * @brief Grid::calculateSummedTables
+ *
+ * Summed tables (or the TiledGrid, with tiled storage) of a grid whose dense weights, coefficients
+ * and full box values have been read from a file. Grids with lazy and out-of-core storage are
+ * read from the GridCache in their own storage (see GridCache::load).
+ */
+void Grid::calculateSummedTables() {
+    tiled.reset();
+    lazy.reset();
+    outOfCore.reset();
+    if (tiledStorage){
+        std::vector<gridreal> values(coeffs->size());
+        for (unsigned int i = 0; i < fullBoxValues.getSizeX(); ++i)
+            for (unsigned int j = 0; j < fullBoxValues.getSizeY(); ++j)
+                for (unsigned int k = 0; k < fullBoxValues.getSizeZ(); ++k)
+                    values[mapCoeffs(i,j,k)] = fullBoxValues(i,j,k);
+        calculateTiledGrid(values);
+        return;
+    }
+    calculateFullBoxSums();
+    std::vector<std::array<double, 4> > faceIntegrals[3];
+    calculateFaceIntegrals(faceIntegrals);
+    calculateFaceSums(faceIntegrals);
+}
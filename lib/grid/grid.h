@@ -6,14 +6,24 @@
 #include "cg3/meshes/dcel/dcel.h"
 #include "engine/tricubic.h"
 #include "common.h"
+#include "tiledgrid.h"
+#include "lazygrid.h"
+#include "outofcoregrid.h"
 
 #include "cg3/cgal/aabbtree.h"
+#include <memory>
+
+#define UNUSED_COEFFICIENTS_FRACTION 0.25 //updateCoefficients compacts the pool when the coefficients possibly unused exceed this fraction of it
 
 class Grid : cg3::SerializableObject{
+        friend class GridFamily;
+        friend class GridCache;
+        friend class GridPyramid;
     public:
 
         Grid();
         Grid(const cg3::Pointi& resolution, const cg3::Array3D<cg3::Pointd>& gridCoordinates, const cg3::Array3D<gridreal>& signedDistances, const cg3::Pointd& gMin, const cg3::Pointd& gMax);
+        Grid(const cg3::Pointi& resolution, double unit, const cg3::Array3D<gridreal>& signedDistances, const cg3::Pointd& gMin, const cg3::Pointd& gMax);
 
         unsigned int getResX() const;
         unsigned int getResY() const;
@@ -28,14 +38,20 @@ class Grid : cg3::SerializableObject{
         void calculateBorderWeights(const cg3::Dcel &d, bool tolerance = false, std::set<const cg3::Dcel::Face*>& savedFaces = Grid::dummy);
         void calculateWeightsAndFreezeKernel(const cg3::Dcel& d, double value, bool tolerance = false, std::set<const cg3::Dcel::Face*>& savedFaces = Grid::dummy);
         void calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+        bool updateWeightsAndFreezeKernel(const cg3::Dcel& d, double value, bool tolerance = false, std::set<const cg3::Dcel::Face*>& savedFaces = Grid::dummy);
+        bool isKernelFrozen() const;
 
         double getValue(const cg3::Pointd &p) const;
+        void getValues(const double* x, const double* y, const double* z, double* values, unsigned int n) const;
         double getUnit() const;
         void getMinAndMax(double &min, double &max);
 
         cg3::Pointd getNearestGridPoint(const cg3::Pointd& p) const;
         void getCoefficients(const gridreal*& coeffs, const cg3::Pointd& p) const;
         double getFullBoxValue(const cg3::Pointd&p) const;
+        void getCellCoefficients(const gridreal*& coeffs, int i, int j, int k) const;
+        double getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const;
+        void getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const;
 
         // SerializableObject interface
         void serialize(std::ofstream& binaryFile) const;
@@ -43,6 +59,21 @@ class Grid : cg3::SerializableObject{
 
         void resetSignedDistances();
 
+        unsigned int getNumberTiles() const;
+        unsigned int getNumberDenseTiles() const;
+
+        double getTouchedFraction() const;
+        bool hasReadError() const;
+
+        static void setTiledStorage(bool b);
+        static bool isTiledStorage();
+        static void setLazyStorage(bool b);
+        static bool isLazyStorage();
+        static void setOutOfCoreStorage(bool b);
+        static bool isOutOfCoreStorage();
+
+        void prefetch(const cg3::Pointd& min, const cg3::Pointd& max) const;
+
 
     protected:
         cg3::Pointd getPoint(unsigned int i, unsigned int j, unsigned int k) const;
@@ -54,20 +85,65 @@ class Grid : cg3::SerializableObject{
         int getIndexOfCoordinateZ(double z) const;
 
         void getCoefficients(const gridreal*& coeffs, unsigned int i, unsigned int j, unsigned int k) const;
+        int getCoefficientsId(unsigned int i, unsigned int j, unsigned int k) const;
 
         void setWeightOnCube(unsigned int i, unsigned int j, unsigned int k, double w);
 
+        void calculateSurface(const cg3::Dcel& d, bool tolerance, const std::set<const cg3::Dcel::Face*>& savedFaces);
+        static unsigned short getFaceFlag(const cg3::Dcel::Face* f, const cg3::Vec3& target, const std::set<const cg3::Dcel::Face*>& savedFaces);
+        void calculateSurfaceCells(std::vector<unsigned short>& cellFlags, const cg3::Dcel& d, const std::vector<unsigned short>& faceFlags) const;
+        unsigned short getCornerFlags(const std::vector<unsigned short>& cellFlags, unsigned int i, unsigned int j, unsigned int k) const;
+        static bool getSurfaceWeight(gridreal& w, unsigned short flags, bool tolerance);
+        gridreal calculateWeight(unsigned int i, unsigned int j, unsigned int k) const;
+        gridreal getBorderWeight(unsigned int i, unsigned int j, unsigned int k) const;
+        template <class F>
+        TiledArray3D<gridreal> getTiledWeights(F weight) const;
+        static bool isTiledBuild();
+        static bool isTiledWeights();
+        void updateCoefficients(const std::vector<unsigned int>& points);
+        void compactCoefficients();
+
+        void calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double), const std::vector<gridreal>& values, const std::vector<std::array<double, 4> > faceIntegrals[3]);
+        void updateFullBoxValues(const std::vector<unsigned int>& cells, const std::vector<gridreal>& values, const std::vector<std::array<double, 4> > faceIntegrals[3]);
+        void calculateFullBoxIntegrals(std::vector<gridreal>& values, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) const;
+        void calculateFaceIntegrals(std::vector<std::array<double, 4> > faceIntegrals[3]) const;
+        void calculateFullBoxSums();
+        double getFullBoxSum(int i, int j, int k) const;
+        void calculateFaceSums(const std::vector<std::array<double, 4> > faceIntegrals[3]);
+        void calculateFaceSums(unsigned int axis, const std::vector<bool>& slices, const std::vector<std::array<double, 4> >& integrals);
+        void calculateTiledGrid(const std::vector<gridreal>& values);
+        void calculateSummedTables();
+        void getDenseData(cg3::Array3D<gridreal>& w, std::vector<std::array<gridreal, 64> >& c, cg3::Array3D<int>& m, cg3::Array3D<gridreal>& v) const;
+        double getBorderFullBoxValue() const;
+        void setBorderCoefficients();
+
         cg3::BoundingBox bb;
         unsigned int resX, resY, resZ;
         cg3::Array3D<gridreal> signedDistances;
         cg3::Array3D<gridreal> weights;
-        std::vector< std::array<gridreal, 64> > coeffs;
+        std::shared_ptr<std::vector< std::array<gridreal, 64> > > coeffs; //shared by the grids of a GridFamily
         cg3::Array3D<int> mapCoeffs;
         cg3::Array3D<gridreal> fullBoxValues;
+        cg3::Array3D<double> fullBoxSums; //summed volume table of fullBoxValues
+        cg3::Array3D<std::array<double, 4> > faceSums[3]; //for every axis, summed area tables of the face integrals on every slice
+        std::shared_ptr<const TiledGrid> tiled; //with tiled storage replaces weights, mapCoeffs, fullBoxValues and the summed tables
+        std::shared_ptr<const LazyGrid> lazy; //with lazy storage replaces weights, coefficients, fullBoxValues and the summed tables
+        std::shared_ptr<const OutOfCoreGrid> outOfCore; //with out-of-core storage replaces weights, coefficients, fullBoxValues and the summed tables
         cg3::Vec3 target;
         double unit;
 
+        //resident data of the last weights, for updateWeightsAndFreezeKernel
+        std::vector<unsigned short> surfaceFaceFlags; //for every triangle of the mesh (see getFaceFlag)
+        std::vector<unsigned short> surfaceCellFlags; //for every cell (see calculateSurfaceCells)
+        bool surfaceTolerance;
+        double kernelThreshold; //points with signed distance lower than -kernelThreshold are in the kernel, negative if not frozen
+        unsigned int replacedCoefficients; //cells whose coefficients have been replaced since the pool was last compacted (upper bound of the unused ones)
+        double (*integral)(const gridreal *&, double, double, double, double, double, double); //of the last calculateFullBoxValues
+
         static std::set<const cg3::Dcel::Face*> dummy;
+        static bool tiledStorage;
+        static bool lazyStorage;
+        static bool outOfCoreStorage;
 };
 
 inline unsigned int Grid::getResZ() const {
@@ -103,8 +179,19 @@ inline cg3::Pointd Grid::getNearestGridPoint(const cg3::Pointd& p) const{
 }
 
 inline void Grid::getCoefficients(const gridreal* &coeffs, unsigned int i, unsigned int j, unsigned int k) const {
-    int id = mapCoeffs(i,j,k);
-    coeffs = this->coeffs[id].data();
+    if (outOfCore){
+        coeffs = outOfCore->getCoefficients(i,j,k);
+        return;
+    }
+    if (lazy){
+        coeffs = lazy->getCoefficients(i,j,k);
+        return;
+    }
+    coeffs = (*this->coeffs)[getCoefficientsId(i,j,k)].data();
+}
+
+inline int Grid::getCoefficientsId(unsigned int i, unsigned int j, unsigned int k) const {
+    return tiled ? tiled->getCoefficientsId(i,j,k) : mapCoeffs(i,j,k);
 }
 
 inline void Grid::setWeightOnCube(unsigned int i, unsigned int j, unsigned int k, double w) {
@@ -123,20 +210,153 @@ inline void Grid::setWeightOnCube(unsigned int i, unsigned int j, unsigned int k
 
 inline void Grid::getCoefficients(const gridreal*& coeffs, const cg3::Pointd& p) const {
     if(bb.isStrictlyIntern(p)){
-        int id = mapCoeffs(getIndexOfCoordinateX(p.x()), getIndexOfCoordinateY(p.y()), getIndexOfCoordinateZ(p.z()));
-        coeffs = this->coeffs[id].data();
+        getCoefficients(coeffs, getIndexOfCoordinateX(p.x()), getIndexOfCoordinateY(p.y()), getIndexOfCoordinateZ(p.z()));
     }
-    else coeffs = this->coeffs[0].data();
+    else coeffs = (*this->coeffs)[0].data();
 }
 
 inline double Grid::getFullBoxValue(const cg3::Pointd& p) const {
-    if(bb.isStrictlyIntern(p))
-        return fullBoxValues(getIndexOfCoordinateX(p.x()), getIndexOfCoordinateY(p.y()), getIndexOfCoordinateZ(p.z()));
-    else return fullBoxValues(0,0,0);
+    if(bb.isStrictlyIntern(p)){
+        int i = getIndexOfCoordinateX(p.x()), j = getIndexOfCoordinateY(p.y()), k = getIndexOfCoordinateZ(p.z());
+        if (outOfCore)
+            return outOfCore->getFullBoxValue(i,j,k);
+        if (lazy)
+            return lazy->getFullBoxValue(i,j,k);
+        return tiled ? tiled->getFullBoxValue(i,j,k) : fullBoxValues(i,j,k);
+    }
+    else return getBorderFullBoxValue();
+}
+
+/**
+ * @brief Grid::getCellCoefficients
+ *
+ * Coefficients of the cell (i,j,k), which may also be outside the grid
+ * (cells outside the grid have constant BORDER_PAY coefficients)
+ */
+inline void Grid::getCellCoefficients(const gridreal*& coeffs, int i, int j, int k) const {
+    if (i >= 0 && j >= 0 && k >= 0 && i < (int)resX-1 && j < (int)resY-1 && k < (int)resZ-1)
+        getCoefficients(coeffs, i, j, k);
+    else coeffs = (*this->coeffs)[0].data();
+}
+
+inline double Grid::getBorderFullBoxValue() const {
+    if (outOfCore)
+        return outOfCore->getBorderFullBoxValue();
+    if (lazy)
+        return lazy->getBorderFullBoxValue();
+    return tiled ? tiled->getFullBoxValue(0,0,0) : fullBoxValues(0,0,0);
+}
+
+inline double Grid::getFullBoxSum(int i, int j, int k) const {
+    return fullBoxSums(i,j,k);
 }
 
 inline void Grid::resetSignedDistances() {
     signedDistances.resize(0,0,0);
+    std::vector<unsigned short>().swap(surfaceFaceFlags);
+    std::vector<unsigned short>().swap(surfaceCellFlags);
+    kernelThreshold = -1;
+}
+
+inline bool Grid::isKernelFrozen() const {
+    return kernelThreshold >= 0;
+}
+
+inline unsigned int Grid::getNumberTiles() const {
+    return tiled ? tiled->getNumberTiles() : 0;
+}
+
+inline unsigned int Grid::getNumberDenseTiles() const {
+    return tiled ? tiled->getNumberDenseTiles() : 0;
+}
+
+/**
+ * @brief Grid::getTouchedFraction
+ * @return with lazy storage, the fraction of the grid whose coefficients have been computed so far
+ */
+inline double Grid::getTouchedFraction() const {
+    return lazy ? lazy->getTouchedFraction() : 1;
+}
+
+/**
+ * @brief Grid::hasReadError
+ * @return with out-of-core storage, true if some data of the grid could not be read from its file
+ */
+inline bool Grid::hasReadError() const {
+    return outOfCore && outOfCore->hasReadError();
+}
+
+/**
+ * @brief Grid::setTiledStorage
+ *
+ * If true, the grids built from now on keep weights, coefficients and summed tables in a TiledGrid
+ * (sparse, for large models) instead of dense arrays.
+ */
+inline void Grid::setTiledStorage(bool b) {
+    tiledStorage = b;
+}
+
+inline bool Grid::isTiledStorage() {
+    return tiledStorage;
+}
+
+/**
+ * @brief Grid::setLazyStorage
+ *
+ * If true, the grids built from now on compute coefficients, full box values and summed tables
+ * only on the parts of the grid accessed by the Energy (see LazyGrid). Overrides the tiled storage.
+ */
+inline void Grid::setLazyStorage(bool b) {
+    lazyStorage = b;
+}
+
+inline bool Grid::isLazyStorage() {
+    return lazyStorage;
+}
+
+/**
+ * @brief Grid::setOutOfCoreStorage
+ *
+ * If true, the grids built from now on keep weights, coefficients and summed tables on disk, in bricks
+ * read on demand with a memory budget (see OutOfCoreGrid). Overrides the lazy and the tiled storage.
+ */
+inline void Grid::setOutOfCoreStorage(bool b) {
+    outOfCoreStorage = b;
+}
+
+inline bool Grid::isOutOfCoreStorage() {
+    return outOfCoreStorage;
+}
+
+/**
+ * @brief Grid::isTiledBuild
+ * @return true if the grids are built directly on the tiles (tiled storage, not overridden by
+ * the lazy or the out-of-core storage): the dense weights and coefficient ids are never allocated
+ */
+inline bool Grid::isTiledBuild() {
+    return tiledStorage && !lazyStorage && !outOfCoreStorage;
+}
+
+/**
+ * @brief Grid::isTiledWeights
+ * @return true if the weights are computed directly on the tiles: with the tiled build, and with the
+ * out-of-core storage, whose bricks are then streamed from the tiles (see calculateFullBoxValues)
+ */
+inline bool Grid::isTiledWeights() {
+    return isTiledBuild() || outOfCoreStorage;
+}
+
+/**
+ * @brief Grid::prefetch
+ *
+ * Hint that a box with the given extent is going to be evaluated; with out-of-core storage the
+ * bricks around the border of the box are read in background, otherwise nothing is done.
+ */
+inline void Grid::prefetch(const cg3::Pointd& min, const cg3::Pointd& max) const {
+    if (outOfCore){
+        outOfCore->prefetch((min.x() - bb.getMinX()) / unit, (min.y() - bb.getMinY()) / unit, (min.z() - bb.getMinZ()) / unit,
+                            (max.x() - bb.getMinX()) / unit, (max.y() - bb.getMinY()) / unit, (max.z() - bb.getMinZ()) / unit);
+    }
 }
 
 inline cg3::Pointd Grid::getPoint(unsigned int i, unsigned int j, unsigned int k) const {
@@ -155,7 +375,37 @@ inline double Grid::getSignedDistance(unsigned int i, unsigned int j, unsigned i
 }
 
 inline double Grid::getWeight(unsigned int i, unsigned int j, unsigned int k) const {
-    return weights(i,j,k);
+    if (outOfCore)
+        return outOfCore->getWeight(i,j,k);
+    if (lazy)
+        return lazy->getWeight(i,j,k);
+    return tiled ? tiled->getWeight(i,j,k) : weights(i,j,k);
+}
+
+/**
+ * @brief Grid::getBorderWeight
+ *
+ * Weight of the point (i,j,k) not in the kernel and not touched by the surface.
+ */
+inline gridreal Grid::getBorderWeight(unsigned int i, unsigned int j, unsigned int k) const {
+    if (i < 2 || j < 2 || k < 2 || i >= resX-2 || j >= resY-2 || k >= resZ-2)
+        return BORDER_PAY;
+    return STD_PAY;
+}
+
+/**
+ * @brief Grid::getTiledWeights
+ *
+ * Tiled weights of the grid computed tile by tile, in parallel, with weight(i,j,k).
+ */
+template <class F>
+TiledArray3D<gridreal> Grid::getTiledWeights(F weight) const {
+    return TiledArray3D<gridreal>(resX, resY, resZ, [&](unsigned long i0, unsigned long j0, unsigned long k0, std::array<gridreal, TILE_CELLS>& d){
+        for (unsigned int i = i0; i < std::min(i0 + TILE_SIZE, (unsigned long)resX); i++)
+            for (unsigned int j = j0; j < std::min(j0 + TILE_SIZE, (unsigned long)resY); j++)
+                for (unsigned int k = k0; k < std::min(k0 + TILE_SIZE, (unsigned long)resZ); k++)
+                    d[TiledArray3D<gridreal>::getLocalIndex(i-i0, j-j0, k-k0)] = weight(i,j,k);
+    });
 }
 
 inline int Grid::getIndexOfCoordinateX(double x) const {
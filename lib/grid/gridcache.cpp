@@ -0,0 +1,526 @@
+#include "gridcache.h"
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define GRID_CACHE_VERSION 4
+#define GRID_CACHE_ALIGNMENT 64
+#define GRID_CACHE_SECTIONS 8
+
+using namespace cg3;
+
+std::string GridCache::directory = "";
+uint64_t GridCache::maxSize = 0;
+time_t GridCache::startTime = std::time(nullptr);
+
+namespace {
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t gridrealSize;
+    uint64_t key;
+    uint32_t resX, resY, resZ, storage;
+    double bbMin[3], bbMax[3], target[3], unit;
+    uint64_t nCoefficients;
+    uint64_t nDenseTiles[2]; //tiled storage: dense tiles of the weights and of the coefficient ids; out-of-core storage: bricks not constant, unused
+    uint64_t offsets[GRID_CACHE_SECTIONS]; //see getSectionSizes
+    uint64_t size; //of the whole file
+} Header;
+
+//storage of the grid in a file
+enum {
+    DENSE = 0, //weights, coefficients, coefficient ids, full box values, summed volume table, summed area tables of the three axes
+    WEIGHTS = 1, //weights, border coefficients (lazy storage)
+    BRICKS = 2, //bricks of the OutOfCoreGrid not constant, border coefficients, summed volume table of the bricks, positions of the bricks, constants (out-of-core storage)
+    TILED = 3 //tiled weights, coefficients, tiled coefficient ids, full box value of every coefficients id (tiled storage)
+};
+
+const char MAGIC[8] = {'H', 'F', 'D', 'G', 'R', 'I', 'D', '\0'};
+
+/**
+ * @brief hash
+ *
+ * FNV-1a on the bytes of v, starting from h
+ */
+template <class T>
+void hash(uint64_t& h, const T& v) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(&v);
+    for (unsigned int i = 0; i < sizeof(T); i++){
+        h ^= b[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+uint64_t align(uint64_t offset) {
+    return (offset + GRID_CACHE_ALIGNMENT - 1) / GRID_CACHE_ALIGNMENT * GRID_CACHE_ALIGNMENT;
+}
+
+/**
+ * @brief getTilesSize
+ *
+ * Bytes of a TiledArray3D with nDense dense tiles: root table, values of the tiles, dense tiles.
+ */
+template <class T>
+uint64_t getTilesSize(uint64_t sizeX, uint64_t sizeY, uint64_t sizeZ, uint64_t nDense) {
+    uint64_t nTiles = ((sizeX + TILE_MASK) >> TILE_LOG2) * ((sizeY + TILE_MASK) >> TILE_LOG2) * ((sizeZ + TILE_MASK) >> TILE_LOG2);
+    return nTiles * (sizeof(int) + sizeof(T)) + nDense * sizeof(std::array<T, TILE_CELLS>);
+}
+
+/**
+ * @brief getSectionSizes
+ *
+ * Bytes of the arrays stored after the header, in the order of the offsets (unused sections are empty)
+ */
+void getSectionSizes(uint64_t sizes[GRID_CACHE_SECTIONS], const Header& h) {
+    uint64_t nPoints = (uint64_t)h.resX*h.resY*h.resZ, nCells = (uint64_t)(h.resX-1)*(h.resY-1)*(h.resZ-1);
+    for (unsigned int s = 0; s < GRID_CACHE_SECTIONS; s++)
+        sizes[s] = 0;
+    switch (h.storage){
+        case BRICKS:
+            sizes[0] = OutOfCoreGrid::getBricksSize(h.nDenseTiles[0]);
+            sizes[1] = sizeof(std::array<gridreal, 64>);
+            sizes[2] = OutOfCoreGrid::getBrickSumsSize(h.resX, h.resY, h.resZ);
+            sizes[3] = (uint64_t)OutOfCoreGrid::getNumberBricks(h.resX, h.resY, h.resZ) * sizeof(int);
+            sizes[4] = (uint64_t)OutOfCoreGrid::getNumberBricks(h.resX, h.resY, h.resZ) * sizeof(gridreal);
+            break;
+        case WEIGHTS:
+            sizes[0] = nPoints * sizeof(gridreal);
+            sizes[1] = sizeof(std::array<gridreal, 64>);
+            break;
+        case TILED:
+            sizes[0] = getTilesSize<gridreal>(h.resX, h.resY, h.resZ, h.nDenseTiles[0]);
+            sizes[1] = h.nCoefficients * sizeof(std::array<gridreal, 64>);
+            sizes[2] = getTilesSize<int>(h.resX-1, h.resY-1, h.resZ-1, h.nDenseTiles[1]);
+            sizes[3] = h.nCoefficients * sizeof(gridreal);
+            break;
+        default: {
+            uint64_t n[3] = {h.resX-1, h.resY-1, h.resZ-1};
+            sizes[0] = nPoints * sizeof(gridreal);
+            sizes[1] = h.nCoefficients * sizeof(std::array<gridreal, 64>);
+            sizes[2] = nCells * sizeof(int);
+            sizes[3] = nCells * sizeof(gridreal);
+            sizes[4] = nPoints * sizeof(double);
+            for (unsigned int axis = 0; axis < 3; axis++){
+                unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+                sizes[5+axis] = n[axis] * (n[p]+1) * (n[q]+1) * sizeof(std::array<double, 4>);
+            }
+        }
+    }
+}
+
+bool isValid(const Header& h, uint64_t key, uint64_t size) {
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != GRID_CACHE_VERSION || h.gridrealSize != sizeof(gridreal) || h.key != key || h.size != size)
+        return false;
+    if (h.resX < 2 || h.resY < 2 || h.resZ < 2 || h.storage > TILED || h.nCoefficients == 0 || (h.storage != DENSE && h.storage != TILED && h.nCoefficients != 1))
+        return false;
+    uint64_t sizes[GRID_CACHE_SECTIONS];
+    getSectionSizes(sizes, h);
+    for (unsigned int s = 0; s < GRID_CACHE_SECTIONS; s++){
+        if (h.offsets[s] < sizeof(Header) || h.offsets[s] % GRID_CACHE_ALIGNMENT != 0 || h.offsets[s] + sizes[s] > size)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief read
+ *
+ * Reads size bytes of the file from offset in data.
+ */
+bool read(int fd, void* data, uint64_t size, uint64_t offset) {
+    char* d = static_cast<char*>(data);
+    uint64_t done = 0;
+    while (done < size){
+        ssize_t r = pread(fd, d + done, size - done, (off_t)(offset + done));
+        if (r <= 0)
+            return false;
+        done += r;
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief GridCache::writeTiles
+ *
+ * Writes the root table, the values of the tiles and the dense tiles of a (see getTilesSize).
+ */
+template <class T>
+void GridCache::writeTiles(std::ofstream& file, const TiledArray3D<T>& a) {
+    file.write(reinterpret_cast<const char*>(a.root.data()), a.root.size() * sizeof(int));
+    file.write(reinterpret_cast<const char*>(a.values.data()), a.values.size() * sizeof(T));
+    file.write(reinterpret_cast<const char*>(a.data.data()), a.data.size() * sizeof(std::array<T, TILE_CELLS>));
+}
+
+/**
+ * @brief GridCache::readTiles
+ *
+ * Reads in a the tiled array of the given size with nDense dense tiles written by writeTiles at offset.
+ * @return false if the file cannot be read or the root table is not valid
+ */
+template <class T>
+bool GridCache::readTiles(int fd, TiledArray3D<T>& a, unsigned long sizeX, unsigned long sizeY, unsigned long sizeZ, uint64_t nDense, uint64_t offset) {
+    a.sizeX = sizeX; a.sizeY = sizeY; a.sizeZ = sizeZ;
+    a.tilesX = (sizeX + TILE_MASK) >> TILE_LOG2;
+    a.tilesY = (sizeY + TILE_MASK) >> TILE_LOG2;
+    a.tilesZ = (sizeZ + TILE_MASK) >> TILE_LOG2;
+    unsigned int n = a.tilesX*a.tilesY*a.tilesZ;
+    a.root.resize(n);
+    a.values.resize(n);
+    a.data.resize(nDense);
+    if (!read(fd, a.root.data(), n * sizeof(int), offset) ||
+            !read(fd, a.values.data(), n * sizeof(T), offset + n * sizeof(int)) ||
+            !read(fd, a.data.data(), nDense * sizeof(std::array<T, TILE_CELLS>), offset + n * (sizeof(int) + sizeof(T))))
+        return false;
+    for (int r : a.root){
+        if (r < -1 || r >= (int)nDense)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief GridCache::getMeshHash
+ *
+ * Hash of the coordinates of the vertices, of the vertices of the triangles and of the flags of
+ * the triangles of the mesh.
+ */
+uint64_t GridCache::getMeshHash(const Dcel& d) {
+    uint64_t h = 14695981039346656037ULL;
+    hash(h, d.getNumberVertices());
+    hash(h, d.getNumberFaces());
+    for (const Dcel::Vertex* v : d.vertexIterator()){
+        Pointd p = v->getCoordinate();
+        hash(h, p.x()); hash(h, p.y()); hash(h, p.z());
+    }
+    for (const Dcel::Face* f : d.faceIterator()){
+        for (const Dcel::Vertex* v : f->incidentVertexIterator())
+            hash(h, v->getId());
+        hash(h, f->getFlag());
+    }
+    return h;
+}
+
+/**
+ * @brief GridCache::getKey
+ *
+ * Key of the grid of the mesh with hash meshHash, rotated with the given orientation, for the
+ * target and the weights parameters. The constants of the weights and the storage of the grids
+ * (out-of-core, lazy, tiled or dense, which sets the format of the file) are part of the key.
+ */
+uint64_t GridCache::getKey(uint64_t meshHash, unsigned int orientation, const Vec3& target, double kernelDistance, bool tolerance, double areaTolerance, double angleTolerance) {
+    uint64_t h = meshHash;
+    hash(h, (uint32_t)GRID_CACHE_VERSION);
+    hash(h, orientation);
+    hash(h, target.x()); hash(h, target.y()); hash(h, target.z());
+    hash(h, kernelDistance);
+    hash(h, tolerance);
+    hash(h, areaTolerance);
+    hash(h, angleTolerance);
+    double pays[5] = {BORDER_PAY, STD_PAY, MIN_PAY, MAX_PAY, FLIP_ANGLE};
+    hash(h, pays);
+    hash(h, (uint32_t)(Grid::isOutOfCoreStorage() ? BRICKS : Grid::isLazyStorage() ? WEIGHTS : Grid::isTiledStorage() ? TILED : DENSE));
+    #ifdef AABB_DISTANCE_FIELD
+    hash(h, true);
+    #else
+    hash(h, false);
+    #endif
+    return h;
+}
+
+std::string GridCache::getFilename(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "grid_%016llx.bin", (unsigned long long)key);
+    return directory + name;
+}
+
+/**
+ * @brief GridCache::contains
+ * @return true if the cache has a valid file for the key (only the header is read)
+ */
+bool GridCache::contains(uint64_t key) {
+    std::ifstream file(getFilename(key), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    uint64_t size = file.tellg();
+    Header h;
+    file.seekg(0);
+    if (size < sizeof(Header) || !file.read(reinterpret_cast<char*>(&h), sizeof(Header)))
+        return false;
+    return isValid(h, key, size);
+}
+
+/**
+ * @brief GridCache::save
+ *
+ * Writes the grid on a temporary file (unique, in the directory of the cache), renamed as the
+ * cache file of the key when complete, so a file of the cache is never partially written.
+ * Every grid is saved in its storage, so it is never built in memory in another one: grids with
+ * out-of-core storage as their bricks, copied from the file of the grid, grids with lazy storage
+ * as their weights, grids with tiled storage as their tiles, dense grids with their summed tables.
+ * Then the cache is brought back within its maximum size (see evict).
+ */
+bool GridCache::save(const Grid& g, uint64_t key) {
+    Header h;
+    std::memset(&h, 0, sizeof(Header));
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = GRID_CACHE_VERSION;
+    h.gridrealSize = sizeof(gridreal);
+    h.key = key;
+    h.resX = g.resX; h.resY = g.resY; h.resZ = g.resZ;
+    h.storage = g.outOfCore ? BRICKS : g.lazy ? WEIGHTS : g.tiled ? TILED : DENSE;
+    for (unsigned int a = 0; a < 3; a++){
+        h.bbMin[a] = g.bb.getMin()[a];
+        h.bbMax[a] = g.bb.getMax()[a];
+        h.target[a] = g.target[a];
+    }
+    h.unit = g.unit;
+    h.nCoefficients = h.storage == DENSE || h.storage == TILED ? g.coeffs->size() : 1; //the border coefficients are the first ones
+    if (h.storage == TILED){
+        h.nDenseTiles[0] = g.tiled->weights.getNumberDenseTiles();
+        h.nDenseTiles[1] = g.tiled->mapCoeffs.getNumberDenseTiles();
+    }
+    else if (h.storage == BRICKS)
+        h.nDenseTiles[0] = g.outOfCore->getNumberStoredBricks();
+    if ((h.storage == TILED && g.tiled->fullBoxValues.size() != h.nCoefficients) || (h.storage == DENSE && g.fullBoxSums.getSizeX() != g.resX)){
+        std::cerr << "ERROR: grid without full box values, not saved in the cache.\n";
+        return false;
+    }
+    uint64_t sizes[GRID_CACHE_SECTIONS];
+    getSectionSizes(sizes, h);
+    uint64_t offset = sizeof(Header);
+    for (unsigned int s = 0; s < GRID_CACHE_SECTIONS; s++){
+        h.offsets[s] = align(offset);
+        offset = h.offsets[s] + sizes[s];
+    }
+    h.size = offset;
+
+    //cg3 arrays are contiguous, in the order (i,j,k); bricks and tiles are written section by section
+    const char* sections[GRID_CACHE_SECTIONS] = {nullptr, reinterpret_cast<const char*>(g.coeffs->data()), nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    switch (h.storage){
+        case BRICKS:
+            sections[2] = reinterpret_cast<const char*>(&g.outOfCore->getBrickSums()(0,0,0));
+            sections[3] = reinterpret_cast<const char*>(g.outOfCore->getSlots().data());
+            sections[4] = reinterpret_cast<const char*>(g.outOfCore->getConstants().data());
+            break;
+        case WEIGHTS:
+            sections[0] = reinterpret_cast<const char*>(&g.lazy->getWeights()(0,0,0));
+            break;
+        case TILED:
+            sections[3] = reinterpret_cast<const char*>(g.tiled->fullBoxValues.data());
+            break;
+        default:
+            sections[0] = reinterpret_cast<const char*>(&g.weights(0,0,0));
+            sections[2] = reinterpret_cast<const char*>(&g.mapCoeffs(0,0,0));
+            sections[3] = reinterpret_cast<const char*>(&g.fullBoxValues(0,0,0));
+            sections[4] = reinterpret_cast<const char*>(&g.fullBoxSums(0,0,0));
+            for (unsigned int axis = 0; axis < 3; axis++)
+                sections[5+axis] = reinterpret_cast<const char*>(&g.faceSums[axis](0,0,0));
+    }
+    std::string filename = getFilename(key);
+    std::vector<char> tmpName(filename.begin(), filename.end());
+    const char suffix[] = ".XXXXXX";
+    tmpName.insert(tmpName.end(), suffix, suffix + sizeof(suffix));
+    int fd = mkstemp(tmpName.data());
+    if (fd < 0){
+        std::cerr << "ERROR: cannot write a temporary file for " << filename << "\n";
+        return false;
+    }
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    close(fd);
+    std::string tmpFilename(tmpName.data());
+    std::ofstream file(tmpFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()){
+        std::cerr << "ERROR: cannot write " << tmpFilename << "\n";
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+    const char zeros[GRID_CACHE_ALIGNMENT] = {0};
+    bool written = true;
+    offset = sizeof(Header);
+    for (unsigned int s = 0; s < GRID_CACHE_SECTIONS; s++){
+        file.write(zeros, h.offsets[s] - offset);
+        if (s == 0 && h.storage == BRICKS)
+            written = g.outOfCore->writeBricks(file);
+        else if (s == 0 && h.storage == TILED)
+            writeTiles(file, g.tiled->weights);
+        else if (s == 2 && h.storage == TILED)
+            writeTiles(file, g.tiled->mapCoeffs);
+        else if (sizes[s] > 0)
+            file.write(sections[s], sizes[s]);
+        offset = h.offsets[s] + sizes[s];
+    }
+    file.close();
+    if (!written || !file || std::rename(tmpFilename.c_str(), filename.c_str()) != 0){
+        std::cerr << "ERROR: cannot write " << filename << "\n";
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+    evict();
+    return true;
+}
+
+/**
+ * @brief GridCache::load
+ *
+ * Loads the grid in the storage of its file, reading every array directly from the file
+ * (computing the full box values with integralTricubicInterpolation where needed):
+ * - dense: all the arrays, summed tables included, so nothing is recomputed;
+ * - weights: builds a LazyGrid on the weights;
+ * - tiled: builds the TiledGrid on the tiles and on the full box value of every coefficients id;
+ * - bricks: reads only the summed volume table, the positions and the constants of the bricks, and
+ *   builds an OutOfCoreGrid reading its bricks on demand from the file, which stays open until the
+ *   grid is destroyed.
+ * The modification time of the file is updated, as its last use (see evict).
+ * @return false (and g unchanged) if there is no valid file for the key
+ */
+bool GridCache::load(Grid& g, uint64_t key, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) {
+    std::string filename = getFilename(key);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    Header h;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(Header) || !read(fd, &h, sizeof(Header), 0)){
+        close(fd);
+        return false;
+    }
+    uint64_t size = st.st_size;
+    if (!isValid(h, key, size)){
+        close(fd);
+        std::cerr << "WARNING: " << filename << " is not a valid grid, ignored.\n";
+        return false;
+    }
+    uint64_t sizes[GRID_CACHE_SECTIONS];
+    getSectionSizes(sizes, h);
+
+    std::shared_ptr<std::vector<std::array<gridreal, 64> > > coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(h.nCoefficients);
+    bool ok = read(fd, coeffs->data(), sizes[1], h.offsets[1]);
+    std::shared_ptr<const OutOfCoreGrid> outOfCore;
+    std::shared_ptr<const TiledGrid> tiled;
+    Array3D<gridreal> weights;
+    Array3D<int> mapCoeffs;
+    Array3D<gridreal> fullBoxValues;
+    Array3D<double> fullBoxSums;
+    Array3D<std::array<double, 4> > faceSums[3];
+    if (h.storage == BRICKS){
+        Array3D<double> brickSums(((h.resX + TILE_MASK) >> TILE_LOG2) + 1, ((h.resY + TILE_MASK) >> TILE_LOG2) + 1, ((h.resZ + TILE_MASK) >> TILE_LOG2) + 1);
+        std::vector<int> slots(OutOfCoreGrid::getNumberBricks(h.resX, h.resY, h.resZ));
+        std::vector<gridreal> constants(slots.size());
+        ok = ok && read(fd, &brickSums(0,0,0), sizes[2], h.offsets[2]) &&
+                read(fd, slots.data(), sizes[3], h.offsets[3]) &&
+                read(fd, constants.data(), sizes[4], h.offsets[4]);
+        for (unsigned int b = 0; b < slots.size() && ok; b++)
+            ok = slots[b] >= -1 && slots[b] < (int64_t)h.nDenseTiles[0];
+        if (ok){
+            futimens(fd, nullptr);
+            posix_fadvise(fd, h.offsets[0], sizes[0], POSIX_FADV_RANDOM);
+            outOfCore = std::make_shared<const OutOfCoreGrid>(fd, h.offsets[0], h.resX, h.resY, h.resZ, brickSums, slots, constants, (*coeffs)[0], integralTricubicInterpolation);
+        }
+    }
+    else if (h.storage == TILED){
+        TiledArray3D<gridreal> w;
+        TiledArray3D<int> m;
+        std::vector<gridreal> values(h.nCoefficients);
+        ok = ok && readTiles(fd, w, h.resX, h.resY, h.resZ, h.nDenseTiles[0], h.offsets[0]) &&
+                readTiles(fd, m, h.resX-1, h.resY-1, h.resZ-1, h.nDenseTiles[1], h.offsets[2]) &&
+                read(fd, values.data(), sizes[3], h.offsets[3]);
+        if (ok)
+            tiled = std::make_shared<const TiledGrid>(w, m, *coeffs, values);
+    }
+    else {
+        weights = Array3D<gridreal>(h.resX, h.resY, h.resZ);
+        ok = ok && read(fd, &weights(0,0,0), sizes[0], h.offsets[0]);
+        if (h.storage == DENSE){
+            mapCoeffs = Array3D<int>(h.resX-1, h.resY-1, h.resZ-1);
+            fullBoxValues = Array3D<gridreal>(h.resX-1, h.resY-1, h.resZ-1);
+            fullBoxSums = Array3D<double>(h.resX, h.resY, h.resZ);
+            ok = ok && read(fd, &mapCoeffs(0,0,0), sizes[2], h.offsets[2]) &&
+                    read(fd, &fullBoxValues(0,0,0), sizes[3], h.offsets[3]) &&
+                    read(fd, &fullBoxSums(0,0,0), sizes[4], h.offsets[4]);
+            unsigned int n[3] = {h.resX-1, h.resY-1, h.resZ-1};
+            for (unsigned int axis = 0; axis < 3; axis++){
+                unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+                faceSums[axis] = Array3D<std::array<double, 4> >(n[axis], n[p]+1, n[q]+1);
+                ok = ok && read(fd, &faceSums[axis](0,0,0), sizes[5+axis], h.offsets[5+axis]);
+            }
+        }
+    }
+    if (!ok){
+        close(fd);
+        std::cerr << "WARNING: " << filename << " cannot be read, ignored.\n";
+        return false;
+    }
+    if (h.storage != BRICKS){
+        futimens(fd, nullptr);
+        close(fd);
+    }
+
+    g.bb.setMin(Pointd(h.bbMin[0], h.bbMin[1], h.bbMin[2]));
+    g.bb.setMax(Pointd(h.bbMax[0], h.bbMax[1], h.bbMax[2]));
+    g.resX = h.resX; g.resY = h.resY; g.resZ = h.resZ;
+    g.target = Vec3(h.target[0], h.target[1], h.target[2]);
+    g.unit = h.unit;
+    g.resetSignedDistances();
+    g.integral = integralTricubicInterpolation;
+    g.coeffs = coeffs;
+    g.mapCoeffs = std::move(mapCoeffs);
+    g.fullBoxValues = std::move(fullBoxValues);
+    g.fullBoxSums = std::move(fullBoxSums);
+    for (unsigned int axis = 0; axis < 3; axis++)
+        g.faceSums[axis] = std::move(faceSums[axis]);
+    g.tiled = tiled;
+    g.lazy.reset();
+    g.outOfCore = outOfCore;
+    if (h.storage == WEIGHTS){
+        g.lazy = std::make_shared<const LazyGrid>(weights, (*coeffs)[0], integralTricubicInterpolation);
+        weights = Array3D<gridreal>();
+    }
+    g.weights = std::move(weights);
+    return true;
+}
+
+/**
+ * @brief GridCache::evict
+ *
+ * With a maximum size, removes the least recently used files of the cache (by modification time,
+ * updated by save and load) until the cache is within the maximum size. The files written or read
+ * since the start of the process are never removed, since they may still be loaded by this run.
+ */
+void GridCache::evict() {
+    if (maxSize == 0)
+        return;
+    DIR* dir = opendir(directory.empty() ? "." : directory.c_str());
+    if (dir == nullptr)
+        return;
+    std::vector<std::pair<time_t, std::string> > files;
+    uint64_t total = 0;
+    const std::string prefix = "grid_", extension = ".bin";
+    for (struct dirent* e = readdir(dir); e != nullptr; e = readdir(dir)){
+        std::string name(e->d_name);
+        if (name.size() != prefix.size() + 16 + extension.size() || name.compare(0, prefix.size(), prefix) != 0 || name.compare(prefix.size() + 16, extension.size(), extension) != 0)
+            continue;
+        struct stat st;
+        if (stat((directory + name).c_str(), &st) != 0)
+            continue;
+        total += st.st_size;
+        if (st.st_mtime < startTime)
+            files.push_back(std::make_pair(st.st_mtime, name));
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    for (unsigned int f = 0; f < files.size() && total > maxSize; f++){
+        std::string filename = directory + files[f].second;
+        struct stat st;
+        if (stat(filename.c_str(), &st) == 0 && std::remove(filename.c_str()) == 0)
+            total -= st.st_size;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef GRIDCACHE_H
+#define GRIDCACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include "grid.h"
+
+/**
+ * Persistent cache of the grids on disk, in a directory shared by all the runs.
+ * A grid is identified by a key computed from the mesh (coordinates, triangles and flags, hence
+ * also the precision the mesh has been scaled with), the orientation, the target and the parameters
+ * used to compute the weights (kernel distance, tolerance, area and angle tolerance).
+ *
+ * Every file has a versioned header followed by raw arrays aligned to 64 bytes, in the storage of
+ * the grid: the arrays of the dense grid (weights, coefficients, coefficient ids, full box values
+ * and summed tables), the tiles with tiled storage, the weights only with lazy storage, the bricks
+ * and their summed volume table with out-of-core storage (read on demand from the file of the
+ * cache, see OutOfCoreGrid).
+ * Grids with a wrong version, key or size are ignored.
+ * The size of the directory can be limited, removing the least recently used grids (see evict).
+ */
+class GridCache {
+    public:
+        static void setDirectory(const std::string& dir);
+        static const std::string& getDirectory();
+        static void setMaxSize(uint64_t bytes);
+        static uint64_t getMaxSize();
+
+        static uint64_t getMeshHash(const cg3::Dcel& d);
+        static uint64_t getKey(uint64_t meshHash, unsigned int orientation, const cg3::Vec3& target, double kernelDistance, bool tolerance, double areaTolerance, double angleTolerance);
+        static std::string getFilename(uint64_t key);
+
+        static bool contains(uint64_t key);
+        static bool save(const Grid& g, uint64_t key);
+        static bool load(Grid& g, uint64_t key, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+
+    private:
+        template <class T>
+        static void writeTiles(std::ofstream& file, const TiledArray3D<T>& a);
+        template <class T>
+        static bool readTiles(int fd, TiledArray3D<T>& a, unsigned long sizeX, unsigned long sizeY, unsigned long sizeZ, uint64_t nDense, uint64_t offset);
+        static void evict();
+
+        static std::string directory;
+        static uint64_t maxSize; //of the files of the cache, 0 for no limit
+        static time_t startTime; //of the process, files used since then are never evicted
+};
+
+/**
+ * @brief GridCache::setDirectory
+ *
+ * Directory of the cache files (must exist), empty for the working directory.
+ */
+inline void GridCache::setDirectory(const std::string& dir) {
+    directory = dir;
+    if (directory.size() > 0 && directory[directory.size()-1] != '/')
+        directory += "/";
+}
+
+inline const std::string& GridCache::getDirectory() {
+    return directory;
+}
+
+/**
+ * @brief GridCache::setMaxSize
+ *
+ * Maximum size in bytes of the files of the cache, 0 (default) for no limit.
+ */
+inline void GridCache::setMaxSize(uint64_t bytes) {
+    maxSize = bytes;
+}
+
+inline uint64_t GridCache::getMaxSize() {
+    return maxSize;
+}
+
+#endif // GRIDCACHE_H
@@ -0,0 +1,368 @@
+#include "gridfamily.h"
+
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <omp.h>
+
+using namespace cg3;
+
+GridFamily::GridFamily() : integral(nullptr), currentTarget(-1) {
+}
+
+GridFamily::GridFamily(const Array3D<Pointd>& gridCoordinates, const Array3D<gridreal>& signedDistances) : integral(nullptr), currentTarget(-1) {
+    Pointi res(gridCoordinates.getSizeX(), gridCoordinates.getSizeY(), gridCoordinates.getSizeZ());
+    Pointd gMin(gridCoordinates(0,0,0));
+    Pointd gMax(gridCoordinates(res.x()-1, res.y()-1, res.z()-1));
+    base = Grid(res, gridCoordinates, signedDistances, gMin, gMax);
+}
+
+/**
+ * @brief GridFamily::GridFamily
+ *
+ * Family on the grid with a point for every value of signedDistances, from gMin with distance unit
+ * between two points, without the coordinates of the points.
+ */
+GridFamily::GridFamily(const Pointd& gMin, double unit, const Array3D<gridreal>& signedDistances) : integral(nullptr), currentTarget(-1) {
+    Pointi res(signedDistances.getSizeX(), signedDistances.getSizeY(), signedDistances.getSizeZ());
+    Pointd gMax(gMin.x() + (res.x()-1)*unit, gMin.y() + (res.y()-1)*unit, gMin.z() + (res.z()-1)*unit);
+    base = Grid(res, unit, signedDistances, gMin, gMax);
+}
+
+/**
+ * @brief getOverriddenTiles
+ *
+ * Copy of the tiled array a where the elements of overrides (index (i*sizeY + j)*sizeZ + k, value)
+ * are replaced, built tile by tile.
+ */
+template <class T>
+static TiledArray3D<T> getOverriddenTiles(const TiledArray3D<T>& a, const std::vector<std::pair<unsigned int, T> >& overrides) {
+    unsigned long sizeY = a.getSizeY(), sizeZ = a.getSizeZ();
+    unsigned int tilesY = a.getTilesY(), tilesZ = a.getTilesZ();
+    std::vector<std::tuple<unsigned int, unsigned int, T> > tiles; //tile, local index, value
+    for (const std::pair<unsigned int, T>& o : overrides){
+        unsigned long i = o.first / (sizeY*sizeZ), j = (o.first / sizeZ) % sizeY, k = o.first % sizeZ;
+        tiles.emplace_back(((i >> TILE_LOG2)*tilesY + (j >> TILE_LOG2))*tilesZ + (k >> TILE_LOG2), TiledArray3D<T>::getLocalIndex(i & TILE_MASK, j & TILE_MASK, k & TILE_MASK), o.second);
+    }
+    std::sort(tiles.begin(), tiles.end());
+    return TiledArray3D<T>(a.getSizeX(), sizeY, sizeZ, [&](unsigned long i0, unsigned long j0, unsigned long k0, std::array<T, TILE_CELLS>& d){
+        unsigned int ti = i0 >> TILE_LOG2, tj = j0 >> TILE_LOG2, tk = k0 >> TILE_LOG2;
+        int dense = a.getDenseTile(ti, tj, tk);
+        if (dense < 0)
+            d.fill(a.getTileValue(ti, tj, tk));
+        else
+            d = a.getDenseTileData(dense);
+        unsigned int t = (ti*tilesY + tj)*tilesZ + tk;
+        typename std::vector<std::tuple<unsigned int, unsigned int, T> >::const_iterator it = std::lower_bound(tiles.begin(), tiles.end(), t,
+                [](const std::tuple<unsigned int, unsigned int, T>& e, unsigned int t){ return std::get<0>(e) < t; });
+        for (; it != tiles.end() && std::get<0>(*it) == t; ++it)
+            d[std::get<1>(*it)] = std::get<2>(*it);
+    });
+}
+
+/**
+ * @brief GridFamily::calculateWeightsAndFreezeKernel
+ *
+ * Same weights of Grid::calculateWeightsAndFreezeKernel for every target, computed with a single
+ * rasterization of the surface (two flags for every target on every cell).
+ * The common weight of a point touched by the surface is the one of the majority of the targets,
+ * the other targets store it as an override (see calculateCommonWeight). With tiled storage the
+ * common weights and coefficient ids are computed directly on the tiles, without dense arrays;
+ * with out-of-core storage only the weights, from which the grids of the targets stream their bricks.
+ * Then the coefficients of the cells having an overridden point in their 4x4x4 neighbourhood are
+ * recomputed for every target.
+ */
+void GridFamily::calculateWeightsAndFreezeKernel(const Dcel& d, double value, bool tolerance, const std::vector<Vec3>& targets, const std::vector<std::set<const Dcel::Face*> >& savedFaces) {
+    assert(value >= 0 && value <= 1);
+    assert(targets.size() == savedFaces.size());
+    assert(targets.size() <= 8);
+    releaseGrid();
+    this->targets = targets;
+    unsigned int nTargets = targets.size();
+    unsigned int resX = base.resX, resY = base.resY, resZ = base.resZ;
+
+    //mesh border
+    std::vector<unsigned short> faceFlags;
+    for (const Dcel::Face* f : d.faceIterator()){
+        unsigned short flags = 0;
+        for (unsigned int t = 0; t < nTargets; t++)
+            flags |= Grid::getFaceFlag(f, targets[t], savedFaces[t]) << (2*t);
+        faceFlags.push_back(flags);
+    }
+    std::vector<unsigned short> cellFlags;
+    base.calculateSurfaceCells(cellFlags, d, faceFlags);
+
+    double minValue = base.signedDistances.min();
+    value = 1 - value;
+    value *= minValue;
+    value = std::abs(value);
+
+    //common weights and overrides (kernel points are MAX_PAY for every target)
+    weightOverrides.assign(nTargets, std::vector<std::pair<unsigned int, gridreal> >());
+    if (Grid::isTiledWeights()){
+        std::vector< std::vector< std::vector<std::pair<unsigned int, gridreal> > > > threadOverrides(omp_get_max_threads(), std::vector< std::vector<std::pair<unsigned int, gridreal> > >(nTargets));
+        TiledArray3D<gridreal> weights = base.getTiledWeights([&](unsigned int i, unsigned int j, unsigned int k){
+            return calculateCommonWeight(cellFlags, value, tolerance, i, j, k, threadOverrides[omp_get_thread_num()].data());
+        });
+        for (unsigned int t = 0; t < nTargets; t++){
+            for (std::vector< std::vector<std::pair<unsigned int, gridreal> > >& o : threadOverrides)
+                weightOverrides[t].insert(weightOverrides[t].end(), o[t].begin(), o[t].end());
+            std::sort(weightOverrides[t].begin(), weightOverrides[t].end());
+        }
+        threadOverrides.clear();
+
+        TiledArray3D<int> mapCoeffs;
+        if (Grid::isOutOfCoreStorage()){
+            //coefficients derived by the bricks of the grids of the targets
+            mapCoeffs = TiledArray3D<int>(resX-1, resY-1, resZ-1, [](unsigned long, unsigned long, unsigned long, std::array<int, TILE_CELLS>& d){
+                d.fill(0);
+            });
+            base.coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >(1);
+            (*base.coeffs)[0].fill(0);
+            (*base.coeffs)[0][0] = weights(0,0,0);
+            base.weights = Array3D<gridreal>();
+            base.mapCoeffs = Array3D<int>();
+            base.tiled = std::make_shared<const TiledGrid>(weights, mapCoeffs, *base.coeffs, std::vector<gridreal>());
+            coeffOverrides.assign(nTargets, std::vector<std::pair<unsigned int, int> >());
+            return;
+        }
+        base.coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
+        TricubicInterpolator::getCoefficients(*base.coeffs, mapCoeffs, weights);
+        base.weights = Array3D<gridreal>();
+        base.mapCoeffs = Array3D<int>();
+        base.tiled = std::make_shared<const TiledGrid>(weights, mapCoeffs, *base.coeffs, std::vector<gridreal>());
+    }
+    else {
+        base.tiled.reset();
+        if (base.weights.getSizeX() == 0)
+            base.weights = Array3D<gridreal>(resX, resY, resZ);
+        std::vector< std::vector< std::vector<std::pair<unsigned int, gridreal> > > > slabs(resX, std::vector< std::vector<std::pair<unsigned int, gridreal> > >(nTargets));
+        #pragma omp parallel for
+        for (unsigned int i = 0; i < resX; i++){
+            for (unsigned int j = 0; j < resY; j++){
+                for (unsigned int k = 0; k < resZ; k++){
+                    base.weights(i,j,k) = calculateCommonWeight(cellFlags, value, tolerance, i, j, k, slabs[i].data());
+                }
+            }
+        }
+        for (unsigned int t = 0; t < nTargets; t++){
+            for (unsigned int i = 0; i < resX; i++)
+                weightOverrides[t].insert(weightOverrides[t].end(), slabs[i][t].begin(), slabs[i][t].end());
+        }
+        slabs.clear();
+
+        //common coefficients (with lazy storage computed by the grids of the targets)
+        if (Grid::isLazyStorage()){
+            base.setBorderCoefficients();
+            base.mapCoeffs = Array3D<int>();
+            coeffOverrides.assign(nTargets, std::vector<std::pair<unsigned int, int> >());
+            return;
+        }
+        if (base.mapCoeffs.getSizeX() == 0)
+            base.mapCoeffs = Array3D<int>(resX-1, resY-1, resZ-1, 0);
+        base.coeffs = std::make_shared<std::vector<std::array<gridreal, 64> > >();
+        TricubicInterpolator::getCoefficients(*base.coeffs, base.mapCoeffs, base.weights);
+    }
+    std::vector<std::array<gridreal, 64> >& pool = *base.coeffs;
+    std::map<std::array<gridreal, 64>, int> mapping;
+    for (unsigned int id = 0; id < pool.size(); id++)
+        mapping[pool[id]] = id;
+
+    //coefficients of the cells around the overridden points
+    coeffOverrides.assign(nTargets, std::vector<std::pair<unsigned int, int> >());
+    for (unsigned int t = 0; t < nTargets; t++){
+        std::vector<unsigned int> cells;
+        for (const std::pair<unsigned int, gridreal>& o : weightOverrides[t]){
+            int i = o.first / (resY*resZ), j = (o.first / resZ) % resY, k = o.first % resZ;
+            for (int ci = std::max(i-2, 1); ci <= std::min(i+1, (int)resX-3); ci++)
+                for (int cj = std::max(j-2, 1); cj <= std::min(j+1, (int)resY-3); cj++)
+                    for (int ck = std::max(k-2, 1); ck <= std::min(k+1, (int)resZ-3); ck++)
+                        cells.push_back((ci*(resY-1) + cj)*(resZ-1) + ck);
+        }
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+        std::vector<std::array<gridreal, 64> > cellCoeffs(cells.size());
+        #pragma omp parallel for
+        for (unsigned int c = 0; c < cells.size(); c++){
+            int xi = cells[c] / ((resY-1)*(resZ-1)), yi = (cells[c] / (resZ-1)) % (resY-1), zi = cells[c] % (resZ-1);
+            gridreal neighbourhood[64];
+            for (int cc = 0; cc < 4; cc++)
+                for (int b = 0; b < 4; b++)
+                    for (int a = 0; a < 4; a++)
+                        neighbourhood[a + 4*b + 16*cc] = getWeight(t, xi+a-1, yi+b-1, zi+cc-1);
+            TricubicInterpolator::getCoefficients(cellCoeffs[c], neighbourhood);
+        }
+        for (unsigned int c = 0; c < cells.size(); c++){
+            int xi = cells[c] / ((resY-1)*(resZ-1)), yi = (cells[c] / (resZ-1)) % (resY-1), zi = cells[c] % (resZ-1);
+            int id;
+            std::map<std::array<gridreal, 64>, int>::iterator it = mapping.find(cellCoeffs[c]);
+            if (it == mapping.end()){
+                id = pool.size();
+                pool.push_back(cellCoeffs[c]);
+                mapping[cellCoeffs[c]] = id;
+            }
+            else
+                id = it->second;
+            if (id != base.getCoefficientsId(xi, yi, zi))
+                coeffOverrides[t].push_back(std::make_pair(cells[c], id));
+        }
+    }
+}
+
+/**
+ * @brief GridFamily::calculateCommonWeight
+ *
+ * Common weight of the point (i,j,k): MAX_PAY in the kernel, the weight of the majority of the
+ * targets if touched by the surface (the weights of the other targets are appended to
+ * overrides[t]), otherwise the border or standard weight.
+ */
+gridreal GridFamily::calculateCommonWeight(const std::vector<unsigned short>& cellFlags, double threshold, bool tolerance, unsigned int i, unsigned int j, unsigned int k, std::vector<std::pair<unsigned int, gridreal> > overrides[]) const {
+    if (base.getSignedDistance(i,j,k) < -threshold)
+        return MAX_PAY;
+    unsigned short corner = base.getCornerFlags(cellFlags, i, j, k);
+    if (!corner)
+        return base.getBorderWeight(i,j,k);
+    unsigned int nTargets = targets.size();
+    gridreal w[8];
+    unsigned int nMax = 0;
+    for (unsigned int t = 0; t < nTargets; t++){
+        Grid::getSurfaceWeight(w[t], (corner >> (2*t)) & 3, tolerance);
+        if (w[t] == MAX_PAY)
+            nMax++;
+    }
+    gridreal common = 2*nMax > nTargets ? MAX_PAY : MIN_PAY;
+    for (unsigned int t = 0; t < nTargets; t++){
+        if (w[t] != common)
+            overrides[t].push_back(std::make_pair(base.getIndex(i,j,k), w[t]));
+    }
+    return common;
+}
+
+/**
+ * @brief GridFamily::getWeight
+ *
+ * Weight of the point (i,j,k) for the target t: its override, if any, or the common weight.
+ */
+gridreal GridFamily::getWeight(unsigned int t, unsigned int i, unsigned int j, unsigned int k) const {
+    unsigned int index = base.getIndex(i,j,k);
+    std::vector<std::pair<unsigned int, gridreal> >::const_iterator it = std::lower_bound(weightOverrides[t].begin(), weightOverrides[t].end(), std::make_pair(index, (gridreal)MIN_PAY),
+            [](const std::pair<unsigned int, gridreal>& a, const std::pair<unsigned int, gridreal>& b){ return a.first < b.first; });
+    if (it != weightOverrides[t].end() && it->first == index)
+        return it->second;
+    return base.getWeight(i,j,k);
+}
+
+/**
+ * @brief GridFamily::calculateFullBoxValues
+ *
+ * With dense or tiled coefficients, computes the full box value and the face integrals of every coefficients
+ * id of the pool, shared by the grids of all the targets (not with out-of-core storage, whose bricks
+ * derive their own coefficients).
+ */
+void GridFamily::calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) {
+    releaseGrid();
+    integral = integralTricubicInterpolation;
+    values.clear();
+    for (unsigned int axis = 0; axis < 3; axis++)
+        faceIntegrals[axis].clear();
+    if ((base.mapCoeffs.getSizeX() > 0 || base.tiled) && !Grid::isOutOfCoreStorage()){
+        base.calculateFullBoxIntegrals(values, integral);
+        base.calculateFaceIntegrals(faceIntegrals);
+    }
+}
+
+/**
+ * @brief GridFamily::getGrid
+ *
+ * Grid of the target t, with its full box values and summed tables.
+ * With dense storage only the last requested grid is kept: requesting another target restores the
+ * common data on the cells overridden by the previous target and applies the overrides of t,
+ * updating the summed volume table and the summed area tables of the slices of these cells.
+ * With the other storages, every grid is built the first time it is requested.
+ */
+const Grid& GridFamily::getGrid(unsigned int t) {
+    assert(t < targets.size());
+    if (Grid::isTiledStorage() || Grid::isLazyStorage() || Grid::isOutOfCoreStorage() || values.empty()){
+        if (grids.size() != targets.size()){
+            grids.assign(targets.size(), Grid());
+            built.assign(targets.size(), false);
+        }
+        if (!built[t]){
+            getGrid(grids[t], t);
+            built[t] = true;
+        }
+        return grids[t];
+    }
+    if (currentTarget < 0){
+        std::vector<unsigned int> cells;
+        current = base;
+        setTarget(current, t, cells);
+        current.calculateFullBoxValues(integral, values, faceIntegrals);
+    }
+    else if (currentTarget != (int)t){
+        unsigned int resY = base.resY, resZ = base.resZ;
+        std::vector<unsigned int> cells;
+        for (const std::pair<unsigned int, gridreal>& o : weightOverrides[currentTarget]){
+            unsigned int i = o.first / (resY*resZ), j = (o.first / resZ) % resY, k = o.first % resZ;
+            current.weights(i,j,k) = base.weights(i,j,k);
+        }
+        for (const std::pair<unsigned int, int>& o : coeffOverrides[currentTarget]){
+            unsigned int i = o.first / ((resY-1)*(resZ-1)), j = (o.first / (resZ-1)) % (resY-1), k = o.first % (resZ-1);
+            current.mapCoeffs(i,j,k) = base.mapCoeffs(i,j,k);
+            cells.push_back(o.first);
+        }
+        setTarget(current, t, cells);
+        current.updateFullBoxValues(cells, values, faceIntegrals);
+    }
+    currentTarget = t;
+    return current;
+}
+
+/**
+ * @brief GridFamily::getGrid
+ *
+ * Builds in g the grid of the target t: the common data plus the overrides of t.
+ * The coefficients are shared with the family.
+ */
+void GridFamily::getGrid(Grid& g, unsigned int t) const {
+    assert(t < targets.size());
+    assert(integral != nullptr);
+    std::vector<unsigned int> cells;
+    g = base;
+    setTarget(g, t, cells);
+    if (values.empty())
+        g.calculateFullBoxValues(integral);
+    else
+        g.calculateFullBoxValues(integral, values, faceIntegrals);
+}
+
+void GridFamily::releaseGrid() {
+    current = Grid();
+    currentTarget = -1;
+    grids.clear();
+    built.clear();
+}
+
+/**
+ * @brief GridFamily::setTarget
+ *
+ * Applies to g (having the common data) the target t and its overrides, and appends to cells the
+ * indices of the cells whose coefficients id has been overridden.
+ */
+void GridFamily::setTarget(Grid& g, unsigned int t, std::vector<unsigned int>& cells) const {
+    unsigned int resY = base.resY, resZ = base.resZ;
+    g.target = targets[t];
+    if (g.tiled){
+        g.tiled = std::make_shared<const TiledGrid>(getOverriddenTiles(g.tiled->getTiledWeights(), weightOverrides[t]), getOverriddenTiles(g.tiled->getTiledMapCoeffs(), coeffOverrides[t]), *g.coeffs, std::vector<gridreal>());
+        for (const std::pair<unsigned int, int>& o : coeffOverrides[t])
+            cells.push_back(o.first);
+        return;
+    }
+    for (const std::pair<unsigned int, gridreal>& o : weightOverrides[t])
+        g.weights(o.first / (resY*resZ), (o.first / resZ) % resY, o.first % resZ) = o.second;
+    for (const std::pair<unsigned int, int>& o : coeffOverrides[t]){
+        g.mapCoeffs(o.first / ((resY-1)*(resZ-1)), (o.first / (resZ-1)) % (resY-1), o.first % (resZ-1)) = o.second;
+        cells.push_back(o.first);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef GRIDFAMILY_H
+#define GRIDFAMILY_H
+
+#include "grid.h"
+
+/**
+ * Grids of the same mesh for several targets.
+ * The distance field, the border and kernel weights and the tricubic coefficients are stored once:
+ * the grids differ only on the grid points touched by the surface, where the weight depends on
+ * which triangles are flipped with respect to the target. Every target stores only the weights
+ * of these points that differ from the common ones, and the coefficients of the cells around them.
+ * The coefficients of all the targets are in the same deduplicated pool.
+ *
+ * With dense storage, the summed tables used by the Energy are kept only for the grid of one target
+ * at a time: when another target is requested, only the cells overridden by the two targets are
+ * patched, using the full box values and face integrals cached for every coefficients id (see
+ * getGrid). With tiled, lazy and out-of-core storage the grid of every target is built once and kept;
+ * with tiled storage the common data are on the tiles, and so the grids of the targets.
+ */
+class GridFamily {
+    public:
+        GridFamily();
+        GridFamily(const cg3::Array3D<cg3::Pointd>& gridCoordinates, const cg3::Array3D<gridreal>& signedDistances);
+        GridFamily(const cg3::Pointd& gMin, double unit, const cg3::Array3D<gridreal>& signedDistances);
+
+        void calculateWeightsAndFreezeKernel(const cg3::Dcel& d, double value, bool tolerance, const std::vector<cg3::Vec3>& targets, const std::vector<std::set<const cg3::Dcel::Face*> >& savedFaces);
+        void calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+
+        unsigned int getNumberTargets() const;
+        cg3::Vec3 getTarget(unsigned int t) const;
+        unsigned int getNumberOverriddenPoints(unsigned int t) const;
+        unsigned int getNumberOverriddenCells(unsigned int t) const;
+        unsigned int getNumberCoefficients() const;
+
+        const Grid& getGrid(unsigned int t);
+        void getGrid(Grid& g, unsigned int t) const;
+        void releaseGrid();
+
+        void resetSignedDistances();
+
+    private:
+        Grid base; //common weights, coefficients and distance field
+        std::vector<cg3::Vec3> targets;
+        std::vector< std::vector<std::pair<unsigned int, gridreal> > > weightOverrides; //for every target, grid point index -> weight, sorted by index
+        std::vector< std::vector<std::pair<unsigned int, int> > > coeffOverrides; //for every target, cell index -> coefficients id
+        double (*integral)(const gridreal *&, double, double, double, double, double, double);
+
+        gridreal calculateCommonWeight(const std::vector<unsigned short>& cellFlags, double threshold, bool tolerance, unsigned int i, unsigned int j, unsigned int k, std::vector<std::pair<unsigned int, gridreal> > overrides[]) const;
+        gridreal getWeight(unsigned int t, unsigned int i, unsigned int j, unsigned int k) const;
+        void setTarget(Grid& g, unsigned int t, std::vector<unsigned int>& cells) const;
+
+        std::vector<gridreal> values; //for every coefficients id, the full box value
+        std::vector<std::array<double, 4> > faceIntegrals[3]; //for every axis and coefficients id, the face integrals
+
+        Grid current; //with dense storage, grid of the target currentTarget, with its summed tables
+        int currentTarget;
+        std::vector<Grid> grids; //with tiled, lazy or out-of-core storage, grid of every target (if built)
+        std::vector<bool> built;
+};
+
+inline unsigned int GridFamily::getNumberTargets() const {
+    return (unsigned int)targets.size();
+}
+
+inline cg3::Vec3 GridFamily::getTarget(unsigned int t) const {
+    return targets[t];
+}
+
+inline unsigned int GridFamily::getNumberOverriddenPoints(unsigned int t) const {
+    return (unsigned int)weightOverrides[t].size();
+}
+
+inline unsigned int GridFamily::getNumberOverriddenCells(unsigned int t) const {
+    return (unsigned int)coeffOverrides[t].size();
+}
+
+inline unsigned int GridFamily::getNumberCoefficients() const {
+    return (unsigned int)base.coeffs->size();
+}
+
+inline void GridFamily::resetSignedDistances() {
+    base.resetSignedDistances();
+}
+
+#endif // GRIDFAMILY_H
@@ -0,0 +1,73 @@
+#include "gridpyramid.h"
+
+using namespace cg3;
+
+GridPyramid::GridPyramid() : finest(nullptr) {
+}
+
+GridPyramid::GridPyramid(const Grid& g, unsigned int nLevels) : finest(&g) {
+    unsigned int n = 0;
+    unsigned int res[3] = {g.getResX(), g.getResY(), g.getResZ()};
+    while (n+1 < nLevels){
+        for (unsigned int a = 0; a < 3; a++)
+            res[a] = res[a]/2 + 1;
+        if (res[0] < GRID_PYRAMID_MIN_RESOLUTION || res[1] < GRID_PYRAMID_MIN_RESOLUTION || res[2] < GRID_PYRAMID_MIN_RESOLUTION)
+            break;
+        n++;
+    }
+    coarse.resize(n);
+    for (unsigned int l = 0; l < n; l++)
+        calculateCoarseGrid(coarse[l], l == 0 ? g : coarse[l-1]);
+}
+
+void GridPyramid::calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) {
+    for (Grid& c : coarse)
+        c.calculateFullBoxValues(integralTricubicInterpolation);
+}
+
+/**
+ * @brief GridPyramid::calculateCoarseGrid
+ *
+ * The point (i,j,k) of the coarse grid is the point (2i,2j,2k) of the fine grid; its weight is the
+ * full weighting of the 27 fine points around it (clamped on the border of the fine grid).
+ * The resolution is rounded up, so that the last fine point is always covered: when the fine grid
+ * has an even number of points the coarse grid ends one fine unit past it, and its last points
+ * restrict the clamped border of the fine grid.
+ * Only the weights and the border coefficients are set, the other coefficients are computed
+ * by Grid::calculateFullBoxValues.
+ */
+void GridPyramid::calculateCoarseGrid(Grid& coarse, const Grid& fine) {
+    coarse.resX = fine.resX/2 + 1;
+    coarse.resY = fine.resY/2 + 1;
+    coarse.resZ = fine.resZ/2 + 1;
+    coarse.unit = fine.unit*2;
+    coarse.target = fine.target;
+    Pointd min = fine.bb.getMin();
+    coarse.bb.setMin(min);
+    coarse.bb.setMax(Pointd(min.x() + (coarse.resX-1)*coarse.unit, min.y() + (coarse.resY-1)*coarse.unit, min.z() + (coarse.resZ-1)*coarse.unit));
+
+    const double stencil[3] = {0.25, 0.5, 0.25};
+    int n[3] = {(int)fine.resX, (int)fine.resY, (int)fine.resZ};
+    coarse.weights = Array3D<gridreal>(coarse.resX, coarse.resY, coarse.resZ);
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < coarse.resX; i++){
+        for (unsigned int j = 0; j < coarse.resY; j++){
+            for (unsigned int k = 0; k < coarse.resZ; k++){
+                double w = 0;
+                for (int di = -1; di <= 1; di++){
+                    int fi = std::min(std::max((int)(2*i) + di, 0), n[0]-1);
+                    for (int dj = -1; dj <= 1; dj++){
+                        int fj = std::min(std::max((int)(2*j) + dj, 0), n[1]-1);
+                        for (int dk = -1; dk <= 1; dk++){
+                            int fk = std::min(std::max((int)(2*k) + dk, 0), n[2]-1);
+                            w += stencil[di+1]*stencil[dj+1]*stencil[dk+1]*fine.getWeight(fi, fj, fk);
+                        }
+                    }
+                }
+                coarse.weights(i,j,k) = w;
+            }
+        }
+    }
+    coarse.setBorderCoefficients();
+    coarse.mapCoeffs = Array3D<int>();
+}
@@ -0,0 +1,57 @@
+#ifndef GRIDPYRAMID_H
+#define GRIDPYRAMID_H
+
+#include "grid.h"
+
+#define GRID_PYRAMID_MIN_RESOLUTION 8 //coarse levels are built only while every axis has at least this number of points
+
+/**
+ * Coarse to fine pyramid of a Grid: the level 0 is the grid itself (not owned by the pyramid,
+ * it must outlive it), every other level halves the resolution of the level below (rounded up, so
+ * that the coarse level covers the whole level below).
+ * The weights of a coarse level are restricted from the weights of the finer level with the full
+ * weighting stencil (1/4, 1/2, 1/4 on every axis).
+ * The integrals of the Energy are measured in cells, so on the level l the volume integral is
+ * 8^l times smaller than on the level 0, and the face integrals (the gradient) 4^l times smaller:
+ * getVolumeScale and getFaceScale give the factors that bring them back to the scale of the level 0,
+ * where the barriers are defined.
+ * Coefficients, full box values and summed tables of the coarse levels are computed by
+ * calculateFullBoxValues, with the storage of the grids (dense, tiled or lazy).
+ */
+class GridPyramid {
+    public:
+        GridPyramid();
+        GridPyramid(const Grid& g, unsigned int nLevels);
+
+        void calculateFullBoxValues(double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+
+        unsigned int getNumberLevels() const;
+        const Grid& getLevel(unsigned int l) const;
+        double getVolumeScale(unsigned int l) const;
+        double getFaceScale(unsigned int l) const;
+
+    private:
+        static void calculateCoarseGrid(Grid& coarse, const Grid& fine);
+
+        const Grid* finest;
+        std::vector<Grid> coarse; //level l is coarse[l-1]
+};
+
+inline unsigned int GridPyramid::getNumberLevels() const {
+    return finest == nullptr ? 0 : (unsigned int)coarse.size() + 1;
+}
+
+inline const Grid& GridPyramid::getLevel(unsigned int l) const {
+    assert(l < getNumberLevels());
+    return l == 0 ? *finest : coarse[l-1];
+}
+
+inline double GridPyramid::getVolumeScale(unsigned int l) const {
+    return (double)(1 << (3*l));
+}
+
+inline double GridPyramid::getFaceScale(unsigned int l) const {
+    return (double)(1 << (2*l));
+}
+
+#endif // GRIDPYRAMID_H
@@ -0,0 +1,166 @@
+#include "lazygrid.h"
+
+using namespace cg3;
+
+LazyGrid::LazyGrid(const Array3D<gridreal>& weights, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) :
+    weights(weights), borderCoeffs(borderCoeffs), integral(integralTricubicInterpolation), nComputedTiles(0) {
+    nCells[0] = weights.getSizeX()-1; nCells[1] = weights.getSizeY()-1; nCells[2] = weights.getSizeZ()-1;
+    for (unsigned int a = 0; a < 3; a++)
+        nTiles[a] = (nCells[a] + TILE_MASK) >> TILE_LOG2;
+    unsigned int n = nTiles[0]*nTiles[1]*nTiles[2];
+    tiles.reset(new std::atomic<const Tile*>[n]);
+    for (unsigned int t = 0; t < n; t++)
+        tiles[t].store(nullptr, std::memory_order_relaxed);
+    const gridreal* c = this->borderCoeffs.data();
+    borderFullBoxValue = integral(c, 0,0,0,1,1,1);
+}
+
+LazyGrid::~LazyGrid() {
+    unsigned int n = nTiles[0]*nTiles[1]*nTiles[2];
+    for (unsigned int t = 0; t < n; t++)
+        delete tiles[t].load();
+}
+
+/**
+ * @brief LazyGrid::getFullBoxesValue
+ *
+ * Sum of the full box values of the cells in [i1,i2]x[j1,j2]x[k1,k2] (extremes included, inside the grid),
+ * with 8 lookups on the local summed table of every tile intersected by the box.
+ */
+double LazyGrid::getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const {
+    double sum = 0;
+    for (int ti = i1 >> TILE_LOG2; ti <= i2 >> TILE_LOG2; ti++){
+        unsigned int a1 = std::max(i1 - (ti << TILE_LOG2), 0), a2 = std::min(i2 - (ti << TILE_LOG2), TILE_MASK) + 1;
+        for (int tj = j1 >> TILE_LOG2; tj <= j2 >> TILE_LOG2; tj++){
+            unsigned int b1 = std::max(j1 - (tj << TILE_LOG2), 0), b2 = std::min(j2 - (tj << TILE_LOG2), TILE_MASK) + 1;
+            for (int tk = k1 >> TILE_LOG2; tk <= k2 >> TILE_LOG2; tk++){
+                unsigned int c1 = std::max(k1 - (tk << TILE_LOG2), 0), c2 = std::min(k2 - (tk << TILE_LOG2), TILE_MASK) + 1;
+                const std::array<double, (TILE_SIZE+1)*(TILE_SIZE+1)*(TILE_SIZE+1)>& s = getTile(ti, tj, tk).boxSums;
+                sum += s[getSumIndex(a2,b2,c2)] - s[getSumIndex(a1,b2,c2)] - s[getSumIndex(a2,b1,c2)] - s[getSumIndex(a2,b2,c1)]
+                        + s[getSumIndex(a1,b1,c2)] + s[getSumIndex(a1,b2,c1)] + s[getSumIndex(a2,b1,c1)] - s[getSumIndex(a1,b1,c1)];
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief LazyGrid::getFullFacesValue
+ *
+ * Sum of the face integrals (orthogonal to axis) of the cells in the slice c, in [p1,p2]x[q1,q2]
+ * (extremes included, inside the grid), with 4 lookups on the local tables of every tile intersected.
+ */
+void LazyGrid::getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const {
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    for (unsigned int i = 0; i < 4; i++)
+        f[i] = 0;
+    unsigned int t[3];
+    unsigned int layer = c & TILE_MASK;
+    t[axis] = c >> TILE_LOG2;
+    for (int tp = p1 >> TILE_LOG2; tp <= p2 >> TILE_LOG2; tp++){
+        unsigned int a1 = std::max(p1 - (tp << TILE_LOG2), 0), a2 = std::min(p2 - (tp << TILE_LOG2), TILE_MASK) + 1;
+        t[p] = tp;
+        for (int tq = q1 >> TILE_LOG2; tq <= q2 >> TILE_LOG2; tq++){
+            unsigned int b1 = std::max(q1 - (tq << TILE_LOG2), 0), b2 = std::min(q2 - (tq << TILE_LOG2), TILE_MASK) + 1;
+            t[q] = tq;
+            const std::array<std::array<double, 4>, TILE_SIZE*(TILE_SIZE+1)*(TILE_SIZE+1)>& s = getTile(t[0], t[1], t[2]).faceSums[axis];
+            for (unsigned int i = 0; i < 4; i++)
+                f[i] += s[getSumIndex(layer,a2,b2)][i] - s[getSumIndex(layer,a1,b2)][i] - s[getSumIndex(layer,a2,b1)][i] + s[getSumIndex(layer,a1,b1)][i];
+        }
+    }
+}
+
+/**
+ * @brief LazyGrid::calculateTile
+ *
+ * Computes the tile and publishes it in the cache. If another thread published the same tile
+ * first, its copy is returned and this one is discarded.
+ */
+const LazyGrid::Tile* LazyGrid::calculateTile(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    Tile* tile = new Tile();
+    Apron apron;
+    unsigned int nPoints[3] = {nCells[0]+1, nCells[1]+1, nCells[2]+1};
+    getApron(apron, [this](unsigned int i, unsigned int j, unsigned int k){ return weights(i,j,k); }, nPoints, ti, tj, tk);
+    calculateTile(*tile, apron, nCells, borderCoeffs, integral, ti, tj, tk);
+    const Tile* expected = nullptr;
+    if (tiles[(ti*nTiles[1] + tj)*nTiles[2] + tk].compare_exchange_strong(expected, tile, std::memory_order_acq_rel)){
+        nComputedTiles++;
+        return tile;
+    }
+    delete tile;
+    return expected;
+}
+
+/**
+ * @brief LazyGrid::calculateTile
+ *
+ * Computes coefficients, full box values and face integrals of the cells of the tile (ti,tj,tk)
+ * of a grid with nCells cells, from the weights of the points around the tile (see getApron;
+ * cells on the border of the grid have the constant border coefficients, cells outside the grid
+ * count zero), and the local summed tables of the tile.
+ */
+void LazyGrid::calculateTile(Tile& tile, const Apron& weights, const unsigned int nCells[3], const std::array<gridreal, 64>& borderCoeffs, double (*integral)(const gridreal *&, double, double, double, double, double, double), unsigned int ti, unsigned int tj, unsigned int tk) {
+    unsigned int t[3] = {ti, tj, tk}, first[3], n[3];
+    for (unsigned int a = 0; a < 3; a++){
+        first[a] = t[a] << TILE_LOG2;
+        n[a] = first[a] < nCells[a] ? std::min((unsigned int)TILE_SIZE, nCells[a] - first[a]) : 0;
+    }
+    std::array<double, TILE_CELLS> values;
+    std::array<std::array<double, 4>, TILE_CELLS> faces[3];
+    for (unsigned int a = 0; a < TILE_SIZE; a++){
+        for (unsigned int b = 0; b < TILE_SIZE; b++){
+            for (unsigned int c = 0; c < TILE_SIZE; c++){
+                unsigned int l = TiledArray3D<gridreal>::getLocalIndex(a, b, c);
+                if (a >= n[0] || b >= n[1] || c >= n[2]){
+                    tile.coeffs[l] = borderCoeffs;
+                    values[l] = 0;
+                    for (unsigned int axis = 0; axis < 3; axis++)
+                        faces[axis][l].fill(0);
+                    continue;
+                }
+                unsigned int xi = first[0]+a, yi = first[1]+b, zi = first[2]+c;
+                if (xi == 0 || yi == 0 || zi == 0 || xi == nCells[0]-1 || yi == nCells[1]-1 || zi == nCells[2]-1)
+                    tile.coeffs[l] = borderCoeffs;
+                else {
+                    gridreal neighbourhood[64];
+                    for (int cc = 0; cc < 4; cc++)
+                        for (int bb = 0; bb < 4; bb++)
+                            for (int aa = 0; aa < 4; aa++)
+                                neighbourhood[aa + 4*bb + 16*cc] = weights[getApronIndex(a+aa, b+bb, c+cc)];
+                    TricubicInterpolator::getCoefficients(tile.coeffs[l], neighbourhood);
+                }
+                const gridreal* coeffs = tile.coeffs[l].data();
+                values[l] = integral(coeffs, 0,0,0,1,1,1);
+                for (unsigned int axis = 0; axis < 3; axis++)
+                    TricubicInterpolator::getFaceIntegrals(faces[axis][l].data(), coeffs, axis);
+            }
+        }
+    }
+
+    std::array<double, (TILE_SIZE+1)*(TILE_SIZE+1)*(TILE_SIZE+1)>& s = tile.boxSums;
+    s.fill(0);
+    for (unsigned int a = 0; a < TILE_SIZE; a++)
+        for (unsigned int b = 0; b < TILE_SIZE; b++)
+            for (unsigned int c = 0; c < TILE_SIZE; c++)
+                s[getSumIndex(a+1,b+1,c+1)] = values[TiledArray3D<gridreal>::getLocalIndex(a, b, c)]
+                        + s[getSumIndex(a,b+1,c+1)] + s[getSumIndex(a+1,b,c+1)] + s[getSumIndex(a+1,b+1,c)]
+                        - s[getSumIndex(a,b,c+1)] - s[getSumIndex(a,b+1,c)] - s[getSumIndex(a+1,b,c)] + s[getSumIndex(a,b,c)];
+
+    for (unsigned int axis = 0; axis < 3; axis++){
+        unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+        std::array<std::array<double, 4>, TILE_SIZE*(TILE_SIZE+1)*(TILE_SIZE+1)>& fs = tile.faceSums[axis];
+        for (std::array<double, 4>& f : fs)
+            f.fill(0);
+        unsigned int o[3];
+        for (o[axis] = 0; o[axis] < TILE_SIZE; o[axis]++){
+            for (o[p] = 0; o[p] < TILE_SIZE; o[p]++){
+                for (o[q] = 0; o[q] < TILE_SIZE; o[q]++){
+                    const std::array<double, 4>& f = faces[axis][TiledArray3D<gridreal>::getLocalIndex(o[0], o[1], o[2])];
+                    unsigned int layer = o[axis], a = o[p], b = o[q];
+                    for (unsigned int i = 0; i < 4; i++)
+                        fs[getSumIndex(layer,a+1,b+1)][i] = f[i] + fs[getSumIndex(layer,a,b+1)][i] + fs[getSumIndex(layer,a+1,b)][i] - fs[getSumIndex(layer,a,b)][i];
+                }
+            }
+        }
+    }
+}
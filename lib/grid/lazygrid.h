@@ -0,0 +1,145 @@
+#ifndef LAZYGRID_H
+#define LAZYGRID_H
+
+#include <atomic>
+#include <memory>
+#include "tiledarray.h"
+#include "engine/tricubic.h"
+
+#define TILE_APRON (TILE_SIZE+3) //points on every axis whose weights give the coefficients of the cells of a tile (one before, two after)
+
+/**
+ * Coefficients, full box values and face integrals of a Grid computed on demand, on tiles of 8x8x8 cells.
+ * A tile is computed the first time a cell of it is accessed, and stored in a lock-free cache
+ * (an atomic pointer for every tile, set with a compare and swap): concurrent accesses to a missing
+ * tile may compute it twice, but only one copy is kept and the others are discarded.
+ * Every tile has local summed tables, so box and face sums visit only the tiles they intersect.
+ *
+ * Only the weights of the grid are stored for all the cells.
+ */
+class LazyGrid {
+    public:
+        //coefficients and local summed tables of 8x8x8 cells (also the bricks of an OutOfCoreGrid)
+        typedef struct {
+            std::array<std::array<gridreal, 64>, TILE_CELLS> coeffs;
+            std::array<double, (TILE_SIZE+1)*(TILE_SIZE+1)*(TILE_SIZE+1)> boxSums; //(a,b,c) -> sum of the full box values on [0,a)x[0,b)x[0,c)
+            std::array<std::array<double, 4>, TILE_SIZE*(TILE_SIZE+1)*(TILE_SIZE+1)> faceSums[3]; //for every axis: (layer, a, b) -> sum of the face integrals on [0,a)x[0,b)
+        } Tile;
+
+        typedef std::array<gridreal, TILE_APRON*TILE_APRON*TILE_APRON> Apron; //weights of the points around a tile (see getApron)
+
+        LazyGrid(const cg3::Array3D<gridreal>& weights, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+        ~LazyGrid();
+
+        const cg3::Array3D<gridreal>& getWeights() const;
+        gridreal getWeight(unsigned int i, unsigned int j, unsigned int k) const;
+        const gridreal* getCoefficients(unsigned int i, unsigned int j, unsigned int k) const;
+        double getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const;
+        double getBorderFullBoxValue() const;
+        double getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const;
+        void getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const;
+
+        double getTouchedFraction() const;
+        double integrate(const gridreal* coeffs) const;
+
+        static void calculateTile(Tile& tile, const Apron& weights, const unsigned int nCells[3], const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double), unsigned int ti, unsigned int tj, unsigned int tk);
+        template <class F>
+        static void getApron(Apron& apron, F weight, const unsigned int nPoints[3], unsigned int ti, unsigned int tj, unsigned int tk);
+        static unsigned int getSumIndex(unsigned int a, unsigned int b, unsigned int c);
+        static unsigned int getApronIndex(unsigned int a, unsigned int b, unsigned int c);
+
+    private:
+        LazyGrid(const LazyGrid&);
+        LazyGrid& operator=(const LazyGrid&);
+
+        const Tile& getTile(unsigned int ti, unsigned int tj, unsigned int tk) const;
+        const Tile* calculateTile(unsigned int ti, unsigned int tj, unsigned int tk) const;
+
+        cg3::Array3D<gridreal> weights;
+        std::array<gridreal, 64> borderCoeffs;
+        double (*integral)(const gridreal *&, double, double, double, double, double, double);
+        double borderFullBoxValue;
+        unsigned int nCells[3], nTiles[3];
+        std::unique_ptr<std::atomic<const Tile*>[]> tiles;
+        mutable std::atomic<unsigned int> nComputedTiles;
+};
+
+inline const cg3::Array3D<gridreal>& LazyGrid::getWeights() const {
+    return weights;
+}
+
+inline gridreal LazyGrid::getWeight(unsigned int i, unsigned int j, unsigned int k) const {
+    return weights(i,j,k);
+}
+
+inline const gridreal* LazyGrid::getCoefficients(unsigned int i, unsigned int j, unsigned int k) const {
+    const Tile& t = getTile(i >> TILE_LOG2, j >> TILE_LOG2, k >> TILE_LOG2);
+    return t.coeffs[TiledArray3D<gridreal>::getLocalIndex(i & TILE_MASK, j & TILE_MASK, k & TILE_MASK)].data();
+}
+
+inline double LazyGrid::getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const {
+    return getFullBoxesValue(i, j, k, i, j, k);
+}
+
+inline double LazyGrid::getBorderFullBoxValue() const {
+    return borderFullBoxValue;
+}
+
+/**
+ * @brief LazyGrid::getTouchedFraction
+ * @return the fraction of the tiles of the grid computed so far
+ */
+inline double LazyGrid::getTouchedFraction() const {
+    return (double)nComputedTiles / (nTiles[0]*nTiles[1]*nTiles[2]);
+}
+
+/**
+ * @brief LazyGrid::integrate
+ * @return the full box value of a cell with the given coefficients
+ */
+inline double LazyGrid::integrate(const gridreal* coeffs) const {
+    return integral(coeffs, 0,0,0,1,1,1);
+}
+
+inline const LazyGrid::Tile& LazyGrid::getTile(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    std::atomic<const Tile*>& t = tiles[(ti*nTiles[1] + tj)*nTiles[2] + tk];
+    const Tile* p = t.load(std::memory_order_acquire);
+    if (p == nullptr)
+        p = calculateTile(ti, tj, tk);
+    return *p;
+}
+
+/**
+ * @brief LazyGrid::getApron
+ *
+ * Weights (given by weight(i,j,k)) of the points from (first-1) to (first+TILE_SIZE+1) on every axis,
+ * where first is the first point of the tile (ti,tj,tk): all the points read by the coefficients of
+ * its cells. Points outside a grid with nPoints points have weight zero.
+ */
+template <class F>
+inline void LazyGrid::getApron(Apron& apron, F weight, const unsigned int nPoints[3], unsigned int ti, unsigned int tj, unsigned int tk) {
+    int i0 = (int)(ti << TILE_LOG2) - 1, j0 = (int)(tj << TILE_LOG2) - 1, k0 = (int)(tk << TILE_LOG2) - 1;
+    for (int a = 0; a < TILE_APRON; a++){
+        for (int b = 0; b < TILE_APRON; b++){
+            for (int c = 0; c < TILE_APRON; c++){
+                int i = i0+a, j = j0+b, k = k0+c;
+                bool inside = i >= 0 && j >= 0 && k >= 0 && i < (int)nPoints[0] && j < (int)nPoints[1] && k < (int)nPoints[2];
+                apron[getApronIndex(a,b,c)] = inside ? weight(i,j,k) : 0;
+            }
+        }
+    }
+}
+
+inline unsigned int LazyGrid::getSumIndex(unsigned int a, unsigned int b, unsigned int c) {
+    return (a*(TILE_SIZE+1) + b)*(TILE_SIZE+1) + c;
+}
+
+/**
+ * @brief LazyGrid::getApronIndex
+ * @return the index in an Apron of the point (first-1+a, first-1+b, first-1+c)
+ */
+inline unsigned int LazyGrid::getApronIndex(unsigned int a, unsigned int b, unsigned int c) {
+    return (a*TILE_APRON + b)*TILE_APRON + c;
+}
+
+#endif // LAZYGRID_H
@@ -0,0 +1,539 @@
+#include "outofcoregrid.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace cg3;
+
+std::string OutOfCoreGrid::directory = "";
+std::atomic<unsigned long> OutOfCoreGrid::budget((unsigned long)OUT_OF_CORE_DEFAULT_BUDGET << 20);
+OutOfCoreGrid::CacheShard OutOfCoreGrid::cache[OUT_OF_CORE_SHARDS] = {};
+std::atomic<unsigned long> OutOfCoreGrid::nReads(0);
+std::atomic<uint64_t> OutOfCoreGrid::nGrids(0);
+
+/**
+ * @brief OutOfCoreGrid::OutOfCoreGrid
+ *
+ * Grid with resX x resY x resZ points whose bricks, as written by writeBricks, are in file starting
+ * from offset, with the given summed volume table of the bricks (see getBrickSums), positions of the
+ * bricks in the file and values of the constant bricks (see getSlots and getConstants).
+ * The grid takes the ownership of file, which is closed when the grid is destroyed.
+ */
+OutOfCoreGrid::OutOfCoreGrid(int file, uint64_t offset, unsigned int resX, unsigned int resY, unsigned int resZ, const Array3D<double>& brickSums, const std::vector<int>& slots, const std::vector<gridreal>& constants, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) :
+    file(file), offset(offset), readError(false), borderCoeffs(borderCoeffs), integral(integralTricubicInterpolation), brickSums(brickSums), nStoredBricks(0) {
+    initialize(resX, resY, resZ);
+    assert(slots.size() == this->slots.size() && constants.size() == this->constants.size());
+    this->slots = slots;
+    this->constants = constants;
+    for (int slot : slots)
+        nStoredBricks = std::max(nStoredBricks, (unsigned int)(slot + 1));
+    calculateConstantBricks();
+}
+
+/**
+ * @brief OutOfCoreGrid::~OutOfCoreGrid
+ *
+ * Releases the bricks of the grid in the cache (not the ones still pinned by the threads) and the file.
+ */
+OutOfCoreGrid::~OutOfCoreGrid() {
+    for (CacheShard& shard : cache){
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (BrickList::iterator it = shard.bricks.begin(); it != shard.bricks.end(); ){
+            if ((it->first >> 32) == id){
+                shard.index.erase(it->first);
+                it = shard.bricks.erase(it);
+                shard.bytes -= sizeof(Brick);
+            }
+            else
+                ++it;
+        }
+    }
+    if (file >= 0)
+        close(file);
+}
+
+/**
+ * @brief OutOfCoreGrid::getFullBoxesValue
+ *
+ * Sum of the full box values of the cells in [i1,i2]x[j1,j2]x[k1,k2] (extremes included, inside the grid).
+ * The bricks completely contained in the box are summed with 8 lookups on the summed volume table
+ * of the bricks, the bricks crossed by the border of the box with 8 lookups on their local table.
+ */
+double OutOfCoreGrid::getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const {
+    //t1-t2: bricks intersected by the box, w1-w2: bricks completely contained
+    int lo[3] = {i1, j1, k1}, hi[3] = {i2, j2, k2};
+    int t1[3], t2[3], w1[3], w2[3];
+    for (unsigned int a = 0; a < 3; a++){
+        t1[a] = lo[a] >> TILE_LOG2;
+        t2[a] = hi[a] >> TILE_LOG2;
+        w1[a] = (lo[a] & TILE_MASK) == 0 ? t1[a] : t1[a]+1;
+        w2[a] = hi[a]+1 == std::min((t2[a]+1) << TILE_LOG2, (int)nCells[a]) ? t2[a] : t2[a]-1;
+    }
+    double sum = 0;
+    if (w1[0] <= w2[0] && w1[1] <= w2[1] && w1[2] <= w2[2]){
+        const Array3D<double>& s = brickSums;
+        int a1 = w1[0], b1 = w1[1], d1 = w1[2], a2 = w2[0]+1, b2 = w2[1]+1, d2 = w2[2]+1;
+        sum = s(a2,b2,d2) - s(a1,b2,d2) - s(a2,b1,d2) - s(a2,b2,d1) + s(a1,b1,d2) + s(a1,b2,d1) + s(a2,b1,d1) - s(a1,b1,d1);
+    }
+    for (int ti = t1[0]; ti <= t2[0]; ti++){
+        unsigned int a1 = std::max(i1 - (ti << TILE_LOG2), 0), a2 = std::min(i2 - (ti << TILE_LOG2), TILE_MASK) + 1;
+        for (int tj = t1[1]; tj <= t2[1]; tj++){
+            unsigned int b1 = std::max(j1 - (tj << TILE_LOG2), 0), b2 = std::min(j2 - (tj << TILE_LOG2), TILE_MASK) + 1;
+            bool whole = ti >= w1[0] && ti <= w2[0] && tj >= w1[1] && tj <= w2[1];
+            for (int tk = t1[2]; tk <= t2[2]; tk++){
+                if (whole && tk >= w1[2] && tk <= w2[2]){ //already summed
+                    tk = w2[2];
+                    continue;
+                }
+                unsigned int c1 = std::max(k1 - (tk << TILE_LOG2), 0), c2 = std::min(k2 - (tk << TILE_LOG2), TILE_MASK) + 1;
+                const std::array<double, (TILE_SIZE+1)*(TILE_SIZE+1)*(TILE_SIZE+1)>& s = getBrick(ti, tj, tk).tile.boxSums;
+                sum += s[LazyGrid::getSumIndex(a2,b2,c2)] - s[LazyGrid::getSumIndex(a1,b2,c2)] - s[LazyGrid::getSumIndex(a2,b1,c2)] - s[LazyGrid::getSumIndex(a2,b2,c1)]
+                        + s[LazyGrid::getSumIndex(a1,b1,c2)] + s[LazyGrid::getSumIndex(a1,b2,c1)] + s[LazyGrid::getSumIndex(a2,b1,c1)] - s[LazyGrid::getSumIndex(a1,b1,c1)];
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief OutOfCoreGrid::getFullFacesValue
+ *
+ * Sum of the face integrals (orthogonal to axis) of the cells in the slice c, in [p1,p2]x[q1,q2]
+ * (extremes included, inside the grid), with 4 lookups on the local tables of every brick intersected.
+ */
+void OutOfCoreGrid::getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const {
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    for (unsigned int i = 0; i < 4; i++)
+        f[i] = 0;
+    unsigned int t[3];
+    unsigned int layer = c & TILE_MASK;
+    t[axis] = c >> TILE_LOG2;
+    for (int tp = p1 >> TILE_LOG2; tp <= p2 >> TILE_LOG2; tp++){
+        unsigned int a1 = std::max(p1 - (tp << TILE_LOG2), 0), a2 = std::min(p2 - (tp << TILE_LOG2), TILE_MASK) + 1;
+        t[p] = tp;
+        for (int tq = q1 >> TILE_LOG2; tq <= q2 >> TILE_LOG2; tq++){
+            unsigned int b1 = std::max(q1 - (tq << TILE_LOG2), 0), b2 = std::min(q2 - (tq << TILE_LOG2), TILE_MASK) + 1;
+            t[q] = tq;
+            const std::array<std::array<double, 4>, TILE_SIZE*(TILE_SIZE+1)*(TILE_SIZE+1)>& s = getBrick(t[0], t[1], t[2]).tile.faceSums[axis];
+            for (unsigned int i = 0; i < 4; i++)
+                f[i] += s[LazyGrid::getSumIndex(layer,a2,b2)][i] - s[LazyGrid::getSumIndex(layer,a1,b2)][i] - s[LazyGrid::getSumIndex(layer,a2,b1)][i] + s[LazyGrid::getSumIndex(layer,a1,b1)][i];
+        }
+    }
+}
+
+/**
+ * @brief OutOfCoreGrid::prefetch
+ *
+ * Hint that a box on the cells [i1,i2]x[j1,j2]x[k1,k2] is going to be evaluated: the bricks within
+ * one brick from the border of the box (the ones read by getFullBoxesValue, getFullFacesValue and
+ * by the cells partially covered while the box moves) that are neither constant nor in the cache
+ * are requested to the operating system in background.
+ */
+void OutOfCoreGrid::prefetch(int i1, int j1, int k1, int i2, int j2, int k2) const {
+    if (file < 0)
+        return;
+    int c1[3] = {i1, j1, k1}, c2[3] = {i2, j2, k2}, t1[3], t2[3];
+    for (unsigned int a = 0; a < 3; a++){
+        t1[a] = std::max((std::max(c1[a], 0) >> TILE_LOG2) - 1, 0);
+        t2[a] = std::min((std::min(c2[a], (int)nCells[a]-1) >> TILE_LOG2) + 1, (int)nBricks[a]-1);
+        if (t1[a] > t2[a])
+            return;
+    }
+    for (int ti = t1[0]; ti <= t2[0]; ti++){
+        bool borderI = ti <= t1[0]+2 || ti >= t2[0]-2;
+        for (int tj = t1[1]; tj <= t2[1]; tj++){
+            bool border = borderI || tj <= t1[1]+2 || tj >= t2[1]-2;
+            for (int tk = t1[2]; tk <= t2[2]; tk++){
+                if (!border && tk > t1[2]+2 && tk < t2[2]-2){ //inside the box
+                    tk = t2[2]-3;
+                    continue;
+                }
+                unsigned int b = getBrickIndex(ti, tj, tk);
+                if (slots[b] < 0)
+                    continue;
+                uint64_t key = getKey(b);
+                CacheShard& shard = getShard(key);
+                bool cached;
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    cached = shard.index.find(key) != shard.index.end();
+                }
+                if (!cached)
+                    posix_fadvise(file, (off_t)(offset + (uint64_t)slots[b]*sizeof(LazyGrid::Apron)), sizeof(LazyGrid::Apron), POSIX_FADV_WILLNEED);
+            }
+        }
+    }
+}
+
+/**
+ * @brief OutOfCoreGrid::getWeights
+ *
+ * Dense array of the weights of the grid (the weights of all the bricks are read, without passing
+ * through the cache and without deriving their tiles)
+ */
+void OutOfCoreGrid::getWeights(Array3D<gridreal>& w) const {
+    w = Array3D<gridreal>(nPoints[0], nPoints[1], nPoints[2]);
+    unsigned int n = nBricks[0]*nBricks[1]*nBricks[2];
+    #pragma omp parallel
+    {
+        std::unique_ptr<LazyGrid::Apron> weights(new LazyGrid::Apron());
+        #pragma omp for
+        for (unsigned int b = 0; b < n; b++){
+            unsigned int ti = b / (nBricks[1]*nBricks[2]), tj = (b / nBricks[2]) % nBricks[1], tk = b % nBricks[2];
+            unsigned int i0 = ti << TILE_LOG2, j0 = tj << TILE_LOG2, k0 = tk << TILE_LOG2;
+            readWeights(*weights, b);
+            for (unsigned int i = i0; i < std::min(i0 + TILE_SIZE, nPoints[0]); i++)
+                for (unsigned int j = j0; j < std::min(j0 + TILE_SIZE, nPoints[1]); j++)
+                    for (unsigned int k = k0; k < std::min(k0 + TILE_SIZE, nPoints[2]); k++)
+                        w(i,j,k) = (*weights)[LazyGrid::getApronIndex(i-i0+1, j-j0+1, k-k0+1)];
+        }
+    }
+}
+
+/**
+ * @brief OutOfCoreGrid::writeBricks
+ *
+ * Copies the bricks written in the file of the grid (the ones not constant) to out, in the order
+ * of their positions (see getSlots) and in chunks of OUT_OF_CORE_COPY_BRICKS bricks, without
+ * passing through the cache.
+ * @return false if the bricks cannot be read or out cannot be written
+ */
+bool OutOfCoreGrid::writeBricks(std::ostream& out) const {
+    if (file < 0)
+        return false;
+    uint64_t size = getBricksSize(nStoredBricks);
+    std::vector<char> buffer(OUT_OF_CORE_COPY_BRICKS*sizeof(LazyGrid::Apron));
+    for (uint64_t done = 0; done < size; ){
+        size_t chunk = std::min((uint64_t)buffer.size(), size - done);
+        if (!readSection(buffer.data(), chunk, offset + done))
+            return false;
+        out.write(buffer.data(), chunk);
+        if (!out)
+            return false;
+        done += chunk;
+    }
+    return true;
+}
+
+/**
+ * @brief OutOfCoreGrid::getBricksSize
+ * @return the bytes of nStoredBricks bricks (not constant), as written by writeBricks
+ */
+uint64_t OutOfCoreGrid::getBricksSize(uint64_t nStoredBricks) {
+    return nStoredBricks * sizeof(LazyGrid::Apron);
+}
+
+/**
+ * @brief OutOfCoreGrid::getNumberBricks
+ * @return the number of bricks of a grid with resX x resY x resZ points
+ */
+unsigned int OutOfCoreGrid::getNumberBricks(unsigned int resX, unsigned int resY, unsigned int resZ) {
+    return ((resX + TILE_MASK) >> TILE_LOG2) * ((resY + TILE_MASK) >> TILE_LOG2) * ((resZ + TILE_MASK) >> TILE_LOG2);
+}
+
+/**
+ * @brief OutOfCoreGrid::getBrickSumsSize
+ * @return the bytes of the summed volume table of the bricks of a grid with resX x resY x resZ points
+ */
+uint64_t OutOfCoreGrid::getBrickSumsSize(unsigned int resX, unsigned int resY, unsigned int resZ) {
+    return (uint64_t)(((resX + TILE_MASK) >> TILE_LOG2) + 1) * (((resY + TILE_MASK) >> TILE_LOG2) + 1) * (((resZ + TILE_MASK) >> TILE_LOG2) + 1) * sizeof(double);
+}
+
+/**
+ * @brief OutOfCoreGrid::getCachedBytes
+ * @return the bytes of the bricks in the cache, of all the grids
+ */
+unsigned long OutOfCoreGrid::getCachedBytes() {
+    unsigned long bytes = 0;
+    for (CacheShard& shard : cache){
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.bytes;
+    }
+    return bytes;
+}
+
+/**
+ * @brief OutOfCoreGrid::getNumberReads
+ * @return the number of bricks read from the files, of all the grids
+ */
+unsigned long OutOfCoreGrid::getNumberReads() {
+    return nReads;
+}
+
+/**
+ * @brief OutOfCoreGrid::getBrick
+ *
+ * Looks for the brick in the bricks pinned by the thread, then among the constant bricks inside the
+ * grid (see calculateConstantBricks), then in its shard of the cache, and reads it if missing (outside the lock: if two threads read the same brick, the first
+ * inserted is kept). Inserting a brick releases the least recently used bricks of the shard beyond
+ * its part of the memory budget.
+ */
+const OutOfCoreGrid::Brick& OutOfCoreGrid::getBrick(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    static thread_local std::pair<uint64_t, std::shared_ptr<const Brick> > pins[OUT_OF_CORE_PINS];
+    static thread_local unsigned int lastPin = 0;
+    unsigned int b = getBrickIndex(ti, tj, tk);
+    uint64_t key = getKey(b);
+    for (unsigned int p = 0; p < OUT_OF_CORE_PINS; p++){
+        if (pins[p].second != nullptr && pins[p].first == key)
+            return *pins[p].second;
+    }
+
+    CacheShard& shard = getShard(key);
+    std::shared_ptr<const Brick> brick;
+    if (slots[b] < 0){
+        std::map<gridreal, std::shared_ptr<const Brick> >::const_iterator it = constantBricks.find(constants[b]);
+        if (it != constantBricks.end() && isInterior(b))
+            brick = it->second;
+    }
+    if (brick == nullptr){
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<uint64_t, BrickList::iterator>::iterator it = shard.index.find(key);
+        if (it != shard.index.end()){
+            shard.bricks.splice(shard.bricks.begin(), shard.bricks, it->second);
+            brick = it->second->second;
+        }
+    }
+    if (brick == nullptr){
+        bool read;
+        brick = readBrick(b, read);
+        if (slots[b] >= 0)
+            nReads++;
+        unsigned long shardBudget = budget / OUT_OF_CORE_SHARDS;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::unordered_map<uint64_t, BrickList::iterator>::iterator it = shard.index.find(key);
+        if (it != shard.index.end()){
+            shard.bricks.splice(shard.bricks.begin(), shard.bricks, it->second);
+            brick = it->second->second;
+        }
+        else if (read){ //the bricks of zeros of readBrick are only pinned
+            shard.bricks.push_front(std::make_pair(key, brick));
+            shard.index[key] = shard.bricks.begin();
+            shard.bytes += sizeof(Brick);
+            while (shard.bytes > shardBudget && shard.bricks.size() > 1){
+                shard.index.erase(shard.bricks.back().first);
+                shard.bricks.pop_back();
+                shard.bytes -= sizeof(Brick);
+            }
+        }
+    }
+    lastPin = (lastPin + 1) % OUT_OF_CORE_PINS;
+    pins[lastPin] = std::make_pair(key, brick);
+    return *brick;
+}
+
+/**
+ * @brief OutOfCoreGrid::createFile
+ *
+ * Creates the temporary file of the bricks in the directory (see setDirectory), already unlinked.
+ * @return false if the file cannot be created
+ */
+bool OutOfCoreGrid::createFile() {
+    std::string dir = directory;
+    if (dir.empty()){
+        const char* tmp = std::getenv("TMPDIR");
+        dir = tmp != nullptr ? std::string(tmp) + "/" : "/tmp/";
+    }
+    std::string filename = dir + "grid_bricks_XXXXXX";
+    std::vector<char> name(filename.begin(), filename.end());
+    name.push_back('\0');
+    file = mkstemp(name.data());
+    if (file < 0){
+        std::cerr << "ERROR: cannot create " << filename << "\n";
+        return false;
+    }
+    unlink(name.data());
+    return true;
+}
+
+/**
+ * @brief OutOfCoreGrid::storeBrick
+ *
+ * Stores the brick b with the given weights: if they are all equal the brick is constant and only
+ * their value is kept, otherwise they are written in the next free position of the file (nStored).
+ * Sets sum to the sum of the full box values of the cells of the brick (brick is used as buffer).
+ * @return false if the weights cannot be written
+ */
+bool OutOfCoreGrid::storeBrick(Brick& brick, const LazyGrid::Apron& weights, unsigned int b, std::atomic<unsigned int>& nStored, double& sum) {
+    calculateBrick(brick, weights, b);
+    sum = brick.tile.boxSums[LazyGrid::getSumIndex(TILE_SIZE, TILE_SIZE, TILE_SIZE)];
+    if (isUniform(weights, b)){
+        slots[b] = -1;
+        constants[b] = brick.weights[0];
+        return true;
+    }
+    unsigned int slot = nStored++;
+    slots[b] = slot;
+    return writeSection(reinterpret_cast<const char*>(weights.data()), sizeof(LazyGrid::Apron), (uint64_t)slot*sizeof(LazyGrid::Apron));
+}
+
+/**
+ * @brief OutOfCoreGrid::finalize
+ *
+ * After all the bricks have been stored (see storeBrick): closes the file if they have not been all
+ * written (the grid is not valid), otherwise builds the summed volume table of the bricks from the
+ * sums of the bricks, and the tiles of the constant bricks.
+ */
+void OutOfCoreGrid::finalize(bool written, const std::vector<double>& sums) {
+    if (!written){
+        std::cerr << "ERROR: cannot write the bricks of the grid on " << (directory.empty() ? "the temporary directory" : directory) << "\n";
+        close(file);
+        file = -1;
+        return;
+    }
+    brickSums = Array3D<double>(nBricks[0]+1, nBricks[1]+1, nBricks[2]+1, 0);
+    for (unsigned int ti = 0; ti < nBricks[0]; ti++)
+        for (unsigned int tj = 0; tj < nBricks[1]; tj++)
+            for (unsigned int tk = 0; tk < nBricks[2]; tk++)
+                brickSums(ti+1,tj+1,tk+1) = sums[getBrickIndex(ti,tj,tk)]
+                        + brickSums(ti,tj+1,tk+1) + brickSums(ti+1,tj,tk+1) + brickSums(ti+1,tj+1,tk)
+                        - brickSums(ti,tj,tk+1) - brickSums(ti,tj+1,tk) - brickSums(ti+1,tj,tk) + brickSums(ti,tj,tk);
+    calculateConstantBricks();
+}
+
+/**
+ * @brief OutOfCoreGrid::calculateConstantBricks
+ *
+ * The tile of the constant bricks inside the grid depends only on their constant: it is computed
+ * once for every constant, and shared by all these bricks (see getBrick).
+ */
+void OutOfCoreGrid::calculateConstantBricks() {
+    constantBricks.clear();
+    for (unsigned int b = 0; b < slots.size(); b++){
+        if (slots[b] < 0 && isInterior(b) && constantBricks.find(constants[b]) == constantBricks.end()){
+            std::shared_ptr<Brick> brick = std::make_shared<Brick>();
+            LazyGrid::Apron weights;
+            weights.fill(constants[b]);
+            calculateBrick(*brick, weights, b);
+            constantBricks[constants[b]] = brick;
+        }
+    }
+}
+
+/**
+ * @brief OutOfCoreGrid::initialize
+ *
+ * Sets the sizes of a grid with resX x resY x resZ points, its id in the cache and the full box value
+ * of the cells outside the grid.
+ */
+void OutOfCoreGrid::initialize(unsigned int resX, unsigned int resY, unsigned int resZ) {
+    id = nGrids++;
+    nPoints[0] = resX; nPoints[1] = resY; nPoints[2] = resZ;
+    for (unsigned int a = 0; a < 3; a++){
+        nCells[a] = nPoints[a]-1;
+        nBricks[a] = (nPoints[a] + TILE_MASK) >> TILE_LOG2;
+    }
+    slots.assign(nBricks[0]*nBricks[1]*nBricks[2], -1);
+    constants.assign(slots.size(), 0);
+    const gridreal* c = borderCoeffs.data();
+    borderFullBoxValue = integral(c, 0,0,0,1,1,1);
+}
+
+/**
+ * @brief OutOfCoreGrid::readBrick
+ *
+ * Reads the weights of the brick b from the file (or takes its constant) and derives its tile.
+ * Called inside parallel regions, so it does not throw: if the brick cannot be read the error is
+ * reported once, hasReadError becomes true and a brick of zeros is returned (read is false, so
+ * that it is not inserted in the cache).
+ */
+std::shared_ptr<const OutOfCoreGrid::Brick> OutOfCoreGrid::readBrick(unsigned int b, bool& read) const {
+    std::shared_ptr<Brick> brick = std::make_shared<Brick>();
+    std::unique_ptr<LazyGrid::Apron> weights(new LazyGrid::Apron());
+    read = readWeights(*weights, b);
+    if (!read){
+        if (!readError.exchange(true))
+            std::cerr << "ERROR: cannot read the bricks of an out-of-core grid.\n";
+        std::memset(reinterpret_cast<char*>(brick.get()), 0, sizeof(Brick));
+        return brick;
+    }
+    calculateBrick(*brick, *weights, b);
+    return brick;
+}
+
+/**
+ * @brief OutOfCoreGrid::readWeights
+ *
+ * Weights of the brick b: read from the file, or set to its constant (zero outside the grid, see LazyGrid::getApron).
+ * @return false if the weights cannot be read
+ */
+bool OutOfCoreGrid::readWeights(LazyGrid::Apron& weights, unsigned int b) const {
+    if (slots[b] >= 0)
+        return readSection(reinterpret_cast<char*>(weights.data()), sizeof(LazyGrid::Apron), offset + (uint64_t)slots[b]*sizeof(LazyGrid::Apron));
+    gridreal c = constants[b];
+    unsigned int ti = b / (nBricks[1]*nBricks[2]), tj = (b / nBricks[2]) % nBricks[1], tk = b % nBricks[2];
+    LazyGrid::getApron(weights, [c](unsigned int, unsigned int, unsigned int){ return c; }, nPoints, ti, tj, tk);
+    return true;
+}
+
+/**
+ * @brief OutOfCoreGrid::calculateBrick
+ *
+ * Derives from the weights of the brick b its tile (coefficients and local summed tables of its
+ * cells) and the weights of its points.
+ */
+void OutOfCoreGrid::calculateBrick(Brick& brick, const LazyGrid::Apron& weights, unsigned int b) const {
+    unsigned int ti = b / (nBricks[1]*nBricks[2]), tj = (b / nBricks[2]) % nBricks[1], tk = b % nBricks[2];
+    LazyGrid::calculateTile(brick.tile, weights, nCells, borderCoeffs, integral, ti, tj, tk);
+    for (unsigned int oi = 0; oi < TILE_SIZE; oi++)
+        for (unsigned int oj = 0; oj < TILE_SIZE; oj++)
+            for (unsigned int ok = 0; ok < TILE_SIZE; ok++)
+                brick.weights[TiledArray3D<gridreal>::getLocalIndex(oi, oj, ok)] = weights[LazyGrid::getApronIndex(oi+1, oj+1, ok+1)];
+}
+
+/**
+ * @brief OutOfCoreGrid::isUniform
+ * @return true if the weights of the brick b are all equal on the points inside the grid
+ */
+bool OutOfCoreGrid::isUniform(const LazyGrid::Apron& weights, unsigned int b) const {
+    unsigned int t[3] = {b / (nBricks[1]*nBricks[2]), (b / nBricks[2]) % nBricks[1], b % nBricks[2]}, lo[3], hi[3];
+    for (unsigned int a = 0; a < 3; a++){
+        int first = (int)(t[a] << TILE_LOG2) - 1;
+        lo[a] = first < 0 ? 1 : 0;
+        hi[a] = std::min((int)TILE_APRON, (int)nPoints[a] - first);
+    }
+    gridreal w = weights[LazyGrid::getApronIndex(lo[0], lo[1], lo[2])];
+    for (unsigned int a = lo[0]; a < hi[0]; a++)
+        for (unsigned int bb = lo[1]; bb < hi[1]; bb++)
+            for (unsigned int c = lo[2]; c < hi[2]; c++)
+                if (weights[LazyGrid::getApronIndex(a, bb, c)] != w)
+                    return false;
+    return true;
+}
+
+/**
+ * @brief OutOfCoreGrid::isInterior
+ * @return true if all the cells of the brick b are inside the grid and not on its border
+ */
+bool OutOfCoreGrid::isInterior(unsigned int b) const {
+    unsigned int t[3] = {b / (nBricks[1]*nBricks[2]), (b / nBricks[2]) % nBricks[1], b % nBricks[2]};
+    for (unsigned int a = 0; a < 3; a++){
+        unsigned int first = t[a] << TILE_LOG2;
+        if (first == 0 || first + TILE_SIZE > nCells[a] - 1)
+            return false;
+    }
+    return true;
+}
+
+bool OutOfCoreGrid::readSection(char* data, size_t size, uint64_t position) const {
+    size_t done = 0;
+    while (done < size){
+        ssize_t r = pread(file, data + done, size - done, (off_t)(position + done));
+        if (r <= 0)
+            return false;
+        done += r;
+    }
+    return true;
+}
+
+bool OutOfCoreGrid::writeSection(const char* data, size_t size, uint64_t position) const {
+    size_t done = 0;
+    while (done < size){
+        ssize_t w = pwrite(file, data + done, size - done, (off_t)(position + done));
+        if (w <= 0)
+            return false;
+        done += w;
+    }
+    return true;
+}
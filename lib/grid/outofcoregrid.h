@@ -0,0 +1,267 @@
+#ifndef OUTOFCOREGRID_H
+#define OUTOFCOREGRID_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <ostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "lazygrid.h"
+
+#define OUT_OF_CORE_DEFAULT_BUDGET 1024 //megabytes of bricks kept in memory by all the out-of-core grids
+#define OUT_OF_CORE_PINS 4 //bricks pinned by every thread (see getBrick)
+#define OUT_OF_CORE_COPY_BRICKS 64 //bricks copied at a time by writeBricks
+#define OUT_OF_CORE_SHARDS 16 //independent parts of the cache of the bricks, each with its own lock and LRU list (power of 2)
+
+/**
+ * Grid data stored on disk, for grids that do not fit in memory.
+ * The grid is split in bricks of 8x8x8 cells. Only the weights are stored: every brick is the
+ * LazyGrid::Apron of its tile (the weights of the points read by the coefficients of its cells),
+ * written once on a temporary file (removed when the grid is destroyed). Bricks whose weights are
+ * all equal are not written, they are kept in memory as their constant value.
+ * Bricks are read on demand in a LRU cache shared by all the out-of-core grids, with a global memory
+ * budget: when the budget is exceeded the least recently used bricks are released. When a brick is
+ * read its coefficients and local summed tables (a LazyGrid::Tile) are derived from the weights;
+ * the constant bricks inside the grid share one tile for every constant value, outside the cache.
+ * The cache is split in OUT_OF_CORE_SHARDS shards by brick key, each with its own lock, LRU list and
+ * an equal part of the budget, so that threads missing their pinned bricks rarely wait for each other.
+ * Only a summed volume table of the full box values of the whole bricks is kept in memory, so the
+ * sum on a box reads only the bricks crossed by the border of the box.
+ *
+ * Every thread pins the last OUT_OF_CORE_PINS bricks it used: coefficients returned by
+ * getCoefficients are valid until the same thread reads other OUT_OF_CORE_PINS bricks.
+ *
+ * The bricks can also be read from a section of another file (e.g. a file of the GridCache, see
+ * writeBricks). A brick that cannot be read is replaced by a brick of zeros, and hasReadError
+ * becomes true: the accesses are made inside parallel regions, so they cannot throw.
+ */
+class OutOfCoreGrid {
+    public:
+        template <class F>
+        OutOfCoreGrid(unsigned int resX, unsigned int resY, unsigned int resZ, F weight, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+        OutOfCoreGrid(int file, uint64_t offset, unsigned int resX, unsigned int resY, unsigned int resZ, const cg3::Array3D<double>& brickSums, const std::vector<int>& slots, const std::vector<gridreal>& constants, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double));
+        ~OutOfCoreGrid();
+
+        bool isValid() const;
+        bool hasReadError() const;
+        gridreal getWeight(unsigned int i, unsigned int j, unsigned int k) const;
+        const gridreal* getCoefficients(unsigned int i, unsigned int j, unsigned int k) const;
+        double getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const;
+        double getBorderFullBoxValue() const;
+        double getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const;
+        void getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const;
+        void prefetch(int i1, int j1, int k1, int i2, int j2, int k2) const;
+
+        void getWeights(cg3::Array3D<gridreal>& w) const;
+        double integrate(const gridreal* coeffs) const;
+        const cg3::Array3D<double>& getBrickSums() const;
+        const std::vector<int>& getSlots() const;
+        const std::vector<gridreal>& getConstants() const;
+        unsigned int getNumberStoredBricks() const;
+        bool writeBricks(std::ostream& out) const;
+
+        static uint64_t getBricksSize(uint64_t nStoredBricks);
+        static uint64_t getBrickSumsSize(unsigned int resX, unsigned int resY, unsigned int resZ);
+        static unsigned int getNumberBricks(unsigned int resX, unsigned int resY, unsigned int resZ);
+
+        static void setMemoryBudget(unsigned long megabytes);
+        static unsigned long getMemoryBudget();
+        static void setDirectory(const std::string& dir);
+        static const std::string& getDirectory();
+        static unsigned long getCachedBytes();
+        static unsigned long getNumberReads();
+
+    private:
+        //a brick in memory, derived from its weights (see calculateBrick)
+        typedef struct {
+            LazyGrid::Tile tile;
+            std::array<gridreal, TILE_CELLS> weights; //of the points of the brick
+        } Brick;
+
+        typedef std::list<std::pair<uint64_t, std::shared_ptr<const Brick> > > BrickList;
+
+        typedef struct {
+            std::mutex mutex;
+            BrickList bricks; //most recently used first
+            std::unordered_map<uint64_t, BrickList::iterator> index;
+            unsigned long bytes;
+        } CacheShard;
+
+        OutOfCoreGrid(const OutOfCoreGrid&);
+        OutOfCoreGrid& operator=(const OutOfCoreGrid&);
+
+        void initialize(unsigned int resX, unsigned int resY, unsigned int resZ);
+        bool createFile();
+        bool storeBrick(Brick& brick, const LazyGrid::Apron& weights, unsigned int b, std::atomic<unsigned int>& nStored, double& sum);
+        void finalize(bool written, const std::vector<double>& sums);
+        void calculateConstantBricks();
+
+        const Brick& getBrick(unsigned int ti, unsigned int tj, unsigned int tk) const;
+        std::shared_ptr<const Brick> readBrick(unsigned int b, bool& read) const;
+        bool readWeights(LazyGrid::Apron& weights, unsigned int b) const;
+        void calculateBrick(Brick& brick, const LazyGrid::Apron& weights, unsigned int b) const;
+        bool readSection(char* data, size_t size, uint64_t position) const;
+        bool writeSection(const char* data, size_t size, uint64_t position) const;
+        bool isUniform(const LazyGrid::Apron& weights, unsigned int b) const;
+        bool isInterior(unsigned int b) const;
+        unsigned int getBrickIndex(unsigned int ti, unsigned int tj, unsigned int tk) const;
+        uint64_t getKey(unsigned int b) const;
+        static CacheShard& getShard(uint64_t key);
+
+        int file;
+        uint64_t offset; //of the first brick in file
+        uint64_t id; //of the grid in the cache
+        mutable std::atomic<bool> readError;
+        std::array<gridreal, 64> borderCoeffs;
+        double (*integral)(const gridreal *&, double, double, double, double, double, double);
+        double borderFullBoxValue;
+        unsigned int nCells[3], nPoints[3], nBricks[3];
+        cg3::Array3D<double> brickSums; //summed volume table of the sums of the full box values of the bricks
+        std::vector<int> slots; //for every brick, its position among the bricks written in file, -1 if constant
+        std::vector<gridreal> constants; //for every constant brick, the weight of all its points
+        unsigned int nStoredBricks;
+        std::map<gridreal, std::shared_ptr<const Brick> > constantBricks; //shared by the constant bricks inside the grid, for every constant
+
+        static std::string directory;
+        static std::atomic<unsigned long> budget; //bytes
+        static CacheShard cache[OUT_OF_CORE_SHARDS];
+        static std::atomic<unsigned long> nReads;
+        static std::atomic<uint64_t> nGrids;
+};
+
+/**
+ * @brief OutOfCoreGrid::OutOfCoreGrid
+ *
+ * Builds the bricks of the grid with resX x resY x resZ points and the weights given by weight(i,j,k),
+ * streaming them to a temporary file (in parallel, one brick at a time for every thread), so the
+ * weights are never needed as a dense array. The file is already unlinked, so it is removed also
+ * if the program is killed. If the file cannot be created or written the grid is not valid.
+ */
+template <class F>
+OutOfCoreGrid::OutOfCoreGrid(unsigned int resX, unsigned int resY, unsigned int resZ, F weight, const std::array<gridreal, 64>& borderCoeffs, double (*integralTricubicInterpolation)(const gridreal *&, double, double, double, double, double, double)) :
+    file(-1), offset(0), readError(false), borderCoeffs(borderCoeffs), integral(integralTricubicInterpolation), nStoredBricks(0) {
+    initialize(resX, resY, resZ);
+    if (!createFile())
+        return;
+    unsigned int n = nBricks[0]*nBricks[1]*nBricks[2];
+    std::vector<double> sums(n);
+    std::atomic<unsigned int> nStored(0);
+    bool written = true;
+    #pragma omp parallel
+    {
+        std::unique_ptr<Brick> brick(new Brick());
+        std::unique_ptr<LazyGrid::Apron> apron(new LazyGrid::Apron());
+        #pragma omp for
+        for (unsigned int b = 0; b < n; b++){
+            unsigned int ti = b / (nBricks[1]*nBricks[2]), tj = (b / nBricks[2]) % nBricks[1], tk = b % nBricks[2];
+            LazyGrid::getApron(*apron, weight, nPoints, ti, tj, tk);
+            if (!storeBrick(*brick, *apron, b, nStored, sums[b])){
+                #pragma omp atomic write
+                written = false;
+            }
+        }
+    }
+    nStoredBricks = nStored;
+    finalize(written, sums);
+}
+
+inline bool OutOfCoreGrid::isValid() const {
+    return file >= 0;
+}
+
+/**
+ * @brief OutOfCoreGrid::hasReadError
+ * @return true if a brick could not be read from the file (and has been replaced by zeros)
+ */
+inline bool OutOfCoreGrid::hasReadError() const {
+    return readError;
+}
+
+inline gridreal OutOfCoreGrid::getWeight(unsigned int i, unsigned int j, unsigned int k) const {
+    return getBrick(i >> TILE_LOG2, j >> TILE_LOG2, k >> TILE_LOG2).weights[TiledArray3D<gridreal>::getLocalIndex(i & TILE_MASK, j & TILE_MASK, k & TILE_MASK)];
+}
+
+inline const gridreal* OutOfCoreGrid::getCoefficients(unsigned int i, unsigned int j, unsigned int k) const {
+    const Brick& b = getBrick(i >> TILE_LOG2, j >> TILE_LOG2, k >> TILE_LOG2);
+    return b.tile.coeffs[TiledArray3D<gridreal>::getLocalIndex(i & TILE_MASK, j & TILE_MASK, k & TILE_MASK)].data();
+}
+
+inline double OutOfCoreGrid::getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const {
+    return getFullBoxesValue(i, j, k, i, j, k);
+}
+
+inline double OutOfCoreGrid::getBorderFullBoxValue() const {
+    return borderFullBoxValue;
+}
+
+/**
+ * @brief OutOfCoreGrid::integrate
+ * @return the full box value of a cell with the given coefficients
+ */
+inline double OutOfCoreGrid::integrate(const gridreal* coeffs) const {
+    return integral(coeffs, 0,0,0,1,1,1);
+}
+
+/**
+ * @brief OutOfCoreGrid::setMemoryBudget
+ *
+ * Megabytes of bricks kept in memory by all the out-of-core grids (bricks pinned by the threads excluded).
+ */
+inline void OutOfCoreGrid::setMemoryBudget(unsigned long megabytes) {
+    budget = megabytes << 20;
+}
+
+inline unsigned long OutOfCoreGrid::getMemoryBudget() {
+    return budget >> 20;
+}
+
+/**
+ * @brief OutOfCoreGrid::setDirectory
+ *
+ * Directory of the temporary files of the bricks (must exist), empty for the system temporary directory.
+ */
+inline void OutOfCoreGrid::setDirectory(const std::string& dir) {
+    directory = dir;
+    if (directory.size() > 0 && directory[directory.size()-1] != '/')
+        directory += "/";
+}
+
+inline const std::string& OutOfCoreGrid::getDirectory() {
+    return directory;
+}
+
+inline const cg3::Array3D<double>& OutOfCoreGrid::getBrickSums() const {
+    return brickSums;
+}
+
+inline const std::vector<int>& OutOfCoreGrid::getSlots() const {
+    return slots;
+}
+
+inline const std::vector<gridreal>& OutOfCoreGrid::getConstants() const {
+    return constants;
+}
+
+/**
+ * @brief OutOfCoreGrid::getNumberStoredBricks
+ * @return the number of bricks written in the file (the ones not constant)
+ */
+inline unsigned int OutOfCoreGrid::getNumberStoredBricks() const {
+    return nStoredBricks;
+}
+
+inline unsigned int OutOfCoreGrid::getBrickIndex(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    return (ti*nBricks[1] + tj)*nBricks[2] + tk;
+}
+
+inline uint64_t OutOfCoreGrid::getKey(unsigned int b) const {
+    return (id << 32) | b;
+}
+
+inline OutOfCoreGrid::CacheShard& OutOfCoreGrid::getShard(uint64_t key) {
+    return cache[(key ^ (key >> 32)) & (OUT_OF_CORE_SHARDS-1)];
+}
+
+#endif // OUTOFCOREGRID_H
@@ -0,0 +1,227 @@
+#ifndef TILEDARRAY_H
+#define TILEDARRAY_H
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <omp.h>
+#include "cg3/data_structures/arrays/arrays.h"
+
+#define TILE_LOG2 3
+#define TILE_SIZE (1 << TILE_LOG2)
+#define TILE_MASK (TILE_SIZE - 1)
+#define TILE_CELLS (TILE_SIZE * TILE_SIZE * TILE_SIZE)
+
+/**
+ * Read only 3D array split in tiles of 8x8x8 elements, on two levels: a root table with an entry
+ * for every tile, where uniform tiles are stored as a single value, and the explicit data of the
+ * non uniform (dense) tiles only.
+ * Elements of a tile outside the array (last tiles on every axis) are not considered for the
+ * uniformity of the tile.
+ * The array can be built from a dense Array3D or directly tile by tile, without any dense copy.
+ */
+template <class T>
+class TiledArray3D {
+        friend class GridCache;
+    public:
+        TiledArray3D();
+        TiledArray3D(const cg3::Array3D<T>& a);
+        template <class F>
+        TiledArray3D(unsigned long sizeX, unsigned long sizeY, unsigned long sizeZ, F getTile);
+
+        unsigned long getSizeX() const;
+        unsigned long getSizeY() const;
+        unsigned long getSizeZ() const;
+        unsigned int getTilesX() const;
+        unsigned int getTilesY() const;
+        unsigned int getTilesZ() const;
+        unsigned int getNumberTiles() const;
+        unsigned int getNumberDenseTiles() const;
+
+        const T& operator()(unsigned long i, unsigned long j, unsigned long k) const;
+        int getDenseTile(unsigned int ti, unsigned int tj, unsigned int tk) const;
+        const T& getTileValue(unsigned int ti, unsigned int tj, unsigned int tk) const;
+        const std::array<T, TILE_CELLS>& getDenseTileData(int id) const;
+        void toArray3D(cg3::Array3D<T>& a) const;
+
+        static unsigned int getLocalIndex(unsigned int oi, unsigned int oj, unsigned int ok);
+
+    private:
+        unsigned int getTileIndex(unsigned int ti, unsigned int tj, unsigned int tk) const;
+
+        unsigned long sizeX, sizeY, sizeZ;
+        unsigned int tilesX, tilesY, tilesZ;
+        std::vector<int> root; //for every tile, index of its dense data or -1 if uniform
+        std::vector<T> values; //for every tile, the value of the tile if it is uniform
+        std::vector<std::array<T, TILE_CELLS> > data;
+};
+
+template <class T>
+TiledArray3D<T>::TiledArray3D() : sizeX(0), sizeY(0), sizeZ(0), tilesX(0), tilesY(0), tilesZ(0) {
+}
+
+template <class T>
+TiledArray3D<T>::TiledArray3D(const cg3::Array3D<T>& a) :
+    TiledArray3D(a.getSizeX(), a.getSizeY(), a.getSizeZ(), [&a](unsigned long i0, unsigned long j0, unsigned long k0, std::array<T, TILE_CELLS>& d){
+        unsigned long i1 = std::min(i0 + TILE_SIZE, a.getSizeX()), j1 = std::min(j0 + TILE_SIZE, a.getSizeY()), k1 = std::min(k0 + TILE_SIZE, a.getSizeZ());
+        for (unsigned long i = i0; i < i1; i++)
+            for (unsigned long j = j0; j < j1; j++)
+                for (unsigned long k = k0; k < k1; k++)
+                    d[getLocalIndex(i-i0, j-j0, k-k0)] = a(i,j,k);
+    }) {
+}
+
+/**
+ * @brief TiledArray3D::TiledArray3D
+ *
+ * Builds the array tile by tile: getTile(i0, j0, k0, d) fills d (see getLocalIndex) with the
+ * elements of the tile starting at (i0, j0, k0); the elements outside the array are ignored.
+ * Tiles are computed in parallel, so getTile must be thread safe; only the dense tiles are kept.
+ */
+template <class T>
+template <class F>
+TiledArray3D<T>::TiledArray3D(unsigned long sizeX, unsigned long sizeY, unsigned long sizeZ, F getTile) : sizeX(sizeX), sizeY(sizeY), sizeZ(sizeZ) {
+    tilesX = (sizeX + TILE_MASK) >> TILE_LOG2;
+    tilesY = (sizeY + TILE_MASK) >> TILE_LOG2;
+    tilesZ = (sizeZ + TILE_MASK) >> TILE_LOG2;
+    unsigned int n = tilesX*tilesY*tilesZ;
+    root.resize(n);
+    values.resize(n);
+
+    //dense tiles of every thread, root has the local index
+    std::vector< std::vector<std::array<T, TILE_CELLS> > > threadData(omp_get_max_threads());
+    std::vector<unsigned short> tileThread(n, 0);
+    #pragma omp parallel for schedule(static)
+    for (unsigned int t = 0; t < n; t++){
+        unsigned long i0 = (t / (tilesY*tilesZ)) << TILE_LOG2, j0 = ((t / tilesZ) % tilesY) << TILE_LOG2, k0 = (t % tilesZ) << TILE_LOG2;
+        unsigned long ni = std::min((unsigned long)TILE_SIZE, sizeX - i0), nj = std::min((unsigned long)TILE_SIZE, sizeY - j0), nk = std::min((unsigned long)TILE_SIZE, sizeZ - k0);
+        std::array<T, TILE_CELLS> d;
+        getTile(i0, j0, k0, d);
+        const T& v = d[0];
+        bool uniform = true;
+        for (unsigned int oi = 0; oi < TILE_SIZE; oi++)
+            for (unsigned int oj = 0; oj < TILE_SIZE; oj++)
+                for (unsigned int ok = 0; ok < TILE_SIZE; ok++){
+                    T& e = d[getLocalIndex(oi, oj, ok)];
+                    if (oi >= ni || oj >= nj || ok >= nk)
+                        e = v;
+                    else if (uniform)
+                        uniform = e == v;
+                }
+        values[t] = v;
+        if (uniform)
+            root[t] = -1;
+        else {
+            unsigned int thread = omp_get_thread_num();
+            tileThread[t] = thread;
+            root[t] = threadData[thread].size();
+            threadData[thread].push_back(d);
+        }
+    }
+
+    std::vector<int> offsets(threadData.size(), 0);
+    unsigned int nDense = 0;
+    for (const std::vector<std::array<T, TILE_CELLS> >& d : threadData)
+        nDense += d.size();
+    data.reserve(nDense);
+    for (unsigned int thread = 0; thread < threadData.size(); thread++){
+        offsets[thread] = data.size();
+        data.insert(data.end(), threadData[thread].begin(), threadData[thread].end());
+        std::vector<std::array<T, TILE_CELLS> >().swap(threadData[thread]);
+    }
+    #pragma omp parallel for
+    for (unsigned int t = 0; t < n; t++){
+        if (root[t] >= 0)
+            root[t] += offsets[tileThread[t]];
+    }
+}
+
+template <class T>
+inline unsigned long TiledArray3D<T>::getSizeX() const {
+    return sizeX;
+}
+
+template <class T>
+inline unsigned long TiledArray3D<T>::getSizeY() const {
+    return sizeY;
+}
+
+template <class T>
+inline unsigned long TiledArray3D<T>::getSizeZ() const {
+    return sizeZ;
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getTilesX() const {
+    return tilesX;
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getTilesY() const {
+    return tilesY;
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getTilesZ() const {
+    return tilesZ;
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getNumberTiles() const {
+    return (unsigned int)root.size();
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getNumberDenseTiles() const {
+    return (unsigned int)data.size();
+}
+
+template <class T>
+inline const T& TiledArray3D<T>::operator()(unsigned long i, unsigned long j, unsigned long k) const {
+    unsigned int t = getTileIndex(i >> TILE_LOG2, j >> TILE_LOG2, k >> TILE_LOG2);
+    int d = root[t];
+    if (d < 0)
+        return values[t];
+    return data[d][getLocalIndex(i & TILE_MASK, j & TILE_MASK, k & TILE_MASK)];
+}
+
+/**
+ * @brief TiledArray3D::getDenseTile
+ * @return the index of the data of the tile, -1 if the tile is uniform
+ */
+template <class T>
+inline int TiledArray3D<T>::getDenseTile(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    return root[getTileIndex(ti, tj, tk)];
+}
+
+template <class T>
+inline const T& TiledArray3D<T>::getTileValue(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    return values[getTileIndex(ti, tj, tk)];
+}
+
+template <class T>
+inline const std::array<T, TILE_CELLS>& TiledArray3D<T>::getDenseTileData(int id) const {
+    return data[id];
+}
+
+template <class T>
+void TiledArray3D<T>::toArray3D(cg3::Array3D<T>& a) const {
+    a = cg3::Array3D<T>(sizeX, sizeY, sizeZ);
+    #pragma omp parallel for
+    for (unsigned long i = 0; i < sizeX; i++)
+        for (unsigned long j = 0; j < sizeY; j++)
+            for (unsigned long k = 0; k < sizeZ; k++)
+                a(i,j,k) = (*this)(i,j,k);
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getLocalIndex(unsigned int oi, unsigned int oj, unsigned int ok) {
+    return (oi << (2*TILE_LOG2)) | (oj << TILE_LOG2) | ok;
+}
+
+template <class T>
+inline unsigned int TiledArray3D<T>::getTileIndex(unsigned int ti, unsigned int tj, unsigned int tk) const {
+    return (ti*tilesY + tj)*tilesZ + tk;
+}
+
+#endif // TILEDARRAY_H
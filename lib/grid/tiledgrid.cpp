@@ -0,0 +1,374 @@
+#include "tiledgrid.h"
+
+using namespace cg3;
+
+#define TILE_INDEX(oi, oj, ok) TiledArray3D<int>::getLocalIndex(oi, oj, ok)
+
+TiledGrid::TiledGrid() {
+    for (unsigned int a = 0; a < 3; a++)
+        nCells[a] = nTiles[a] = 0;
+}
+
+TiledGrid::TiledGrid(const Array3D<gridreal>& weights, const Array3D<int>& mapCoeffs, const std::vector<std::array<gridreal, 64> >& coeffs, const std::vector<gridreal>& fullBoxValues) :
+    weights(weights), mapCoeffs(mapCoeffs), fullBoxValues(fullBoxValues) {
+    calculateSummedTables(coeffs);
+}
+
+TiledGrid::TiledGrid(const TiledArray3D<gridreal>& weights, const TiledArray3D<int>& mapCoeffs, const std::vector<std::array<gridreal, 64> >& coeffs, const std::vector<gridreal>& fullBoxValues) :
+    weights(weights), mapCoeffs(mapCoeffs), fullBoxValues(fullBoxValues) {
+    calculateSummedTables(coeffs);
+}
+
+/**
+ * @brief TiledGrid::calculateSummedTables
+ *
+ * Face integrals of every set of coefficients and summed tables on the tiles, if the full box values are given.
+ */
+void TiledGrid::calculateSummedTables(const std::vector<std::array<gridreal, 64> >& coeffs) {
+    nCells[0] = mapCoeffs.getSizeX(); nCells[1] = mapCoeffs.getSizeY(); nCells[2] = mapCoeffs.getSizeZ();
+    nTiles[0] = mapCoeffs.getTilesX(); nTiles[1] = mapCoeffs.getTilesY(); nTiles[2] = mapCoeffs.getTilesZ();
+    if (fullBoxValues.empty())
+        return;
+    for (unsigned int axis = 0; axis < 3; axis++){
+        faceIntegrals[axis].resize(coeffs.size());
+        #pragma omp parallel for
+        for (unsigned int id = 0; id < coeffs.size(); id++)
+            TricubicInterpolator::getFaceIntegrals(faceIntegrals[axis][id].data(), coeffs[id].data(), axis);
+    }
+    calculateSuffixSums();
+    calculateTileSums();
+    calculateFaceSuffixSums();
+    calculateLayerSums();
+}
+
+/**
+ * @brief TiledGrid::getFullBoxesValue
+ *
+ * Sum of the full box values of the cells in [i1,i2]x[j1,j2]x[k1,k2] (extremes included, inside the grid):
+ * at most 3 tile ranges for every axis, so at most 27 sums on the tiles.
+ */
+double TiledGrid::getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const {
+    TileRange rx[3], ry[3], rz[3];
+    unsigned int nx = getTileRanges(rx, i1, i2), ny = getTileRanges(ry, j1, j2), nz = getTileRanges(rz, k1, k2);
+    double sum = 0;
+    for (unsigned int a = 0; a < nx; a++){
+        for (unsigned int b = 0; b < ny; b++){
+            for (unsigned int c = 0; c < nz; c++){
+                const TileRange* r[3] = {&rx[a], &ry[b], &rz[c]};
+                sum += rx[a].sign * ry[b].sign * rz[c].sign * getTilesSum(r);
+            }
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief TiledGrid::getFullFacesValue
+ *
+ * Sum of the face integrals (orthogonal to axis) of the cells in the slice c, in [p1,p2]x[q1,q2]
+ * (extremes included, inside the grid).
+ */
+void TiledGrid::getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const {
+    TileRange rp[3], rq[3];
+    unsigned int np = getTileRanges(rp, p1, p2), nq = getTileRanges(rq, q1, q2);
+    for (unsigned int i = 0; i < 4; i++)
+        f[i] = 0;
+    for (unsigned int a = 0; a < np; a++){
+        for (unsigned int b = 0; b < nq; b++){
+            double g[4];
+            getFaceTilesSum(g, axis, c, rp[a], rq[b]);
+            for (unsigned int i = 0; i < 4; i++)
+                f[i] += rp[a].sign * rq[b].sign * g[i];
+        }
+    }
+}
+
+void TiledGrid::getFullBoxValues(Array3D<gridreal>& v) const {
+    v = Array3D<gridreal>(nCells[0], nCells[1], nCells[2]);
+    #pragma omp parallel for
+    for (unsigned int i = 0; i < nCells[0]; i++)
+        for (unsigned int j = 0; j < nCells[1]; j++)
+            for (unsigned int k = 0; k < nCells[2]; k++)
+                v(i,j,k) = getFullBoxValue(i,j,k);
+}
+
+/**
+ * @brief TiledGrid::getTileRanges
+ *
+ * Splits the cells [c1,c2] of an axis in signed tile ranges: the cells from c1 to the end of its tile,
+ * the whole tiles up to the tile of c2, minus the cells after c2 in its tile.
+ * @return the number of ranges
+ */
+unsigned int TiledGrid::getTileRanges(TileRange ranges[3], int c1, int c2) {
+    unsigned int t1 = c1 >> TILE_LOG2, o1 = c1 & TILE_MASK, t2 = c2 >> TILE_LOG2, o2 = c2 & TILE_MASK;
+    unsigned int n = 0;
+    if (o1 == 0)
+        ranges[n++] = {1, t1, t2, 0};
+    else {
+        ranges[n++] = {1, t1, t1, o1};
+        if (t1 < t2)
+            ranges[n++] = {1, t1+1, t2, 0};
+    }
+    if (o2 < TILE_MASK)
+        ranges[n++] = {-1, t2, t2, o2+1};
+    return n;
+}
+
+/**
+ * @brief TiledGrid::getSuffixSum
+ *
+ * Sum of the full box values of the cells of the tile t with local coordinates in [offset, 8) on every axis
+ */
+double TiledGrid::getSuffixSum(const unsigned int t[3], const unsigned int offset[3]) const {
+    int d = mapCoeffs.getDenseTile(t[0], t[1], t[2]);
+    if (d >= 0)
+        return suffixSums[d][TILE_INDEX(offset[0], offset[1], offset[2])];
+    double n = (double)getNumberCells(0, t[0], offset[0]) * getNumberCells(1, t[1], offset[1]) * getNumberCells(2, t[2], offset[2]);
+    return n * fullBoxValues[mapCoeffs.getTileValue(t[0], t[1], t[2])];
+}
+
+/**
+ * @brief TiledGrid::getFaceSuffixSum
+ *
+ * Sum of the face integrals of the cells of the tile t with local coordinate c on axis and
+ * local coordinates in [offsetP, 8)x[offsetQ, 8) on the other two axes
+ */
+void TiledGrid::getFaceSuffixSum(double f[4], unsigned int axis, const unsigned int t[3], unsigned int c, unsigned int offsetP, unsigned int offsetQ) const {
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    int d = mapCoeffs.getDenseTile(t[0], t[1], t[2]);
+    if (d >= 0){
+        const std::array<double, 4>& s = faceSuffixSums[axis][d][TILE_INDEX(c, offsetP, offsetQ)];
+        for (unsigned int i = 0; i < 4; i++)
+            f[i] = s[i];
+    }
+    else {
+        double n = (double)getNumberCells(p, t[p], offsetP) * getNumberCells(q, t[q], offsetQ);
+        const std::array<double, 4>& s = faceIntegrals[axis][mapCoeffs.getTileValue(t[0], t[1], t[2])];
+        for (unsigned int i = 0; i < 4; i++)
+            f[i] = n * s[i];
+    }
+}
+
+/**
+ * @brief TiledGrid::getTilesSum
+ *
+ * Sum of the full box values on the product of three tile ranges.
+ * Whole ranges on every axis are 8 lookups on tileSums, a partial range on a single axis is
+ * 4 lookups on partialTileSums; otherwise the tiles (a line or a single tile) are summed one by one.
+ */
+double TiledGrid::getTilesSum(const TileRange* r[3]) const {
+    unsigned int nPartial = 0, partial = 0;
+    for (unsigned int a = 0; a < 3; a++){
+        if (r[a]->offset > 0){
+            nPartial++;
+            partial = a;
+        }
+    }
+    if (nPartial == 0){
+        unsigned int x1 = r[0]->first, y1 = r[1]->first, z1 = r[2]->first;
+        unsigned int x2 = r[0]->last+1, y2 = r[1]->last+1, z2 = r[2]->last+1;
+        return tileSums(x2,y2,z2) - tileSums(x1,y2,z2) - tileSums(x2,y1,z2) - tileSums(x2,y2,z1)
+                + tileSums(x1,y1,z2) + tileSums(x1,y2,z1) + tileSums(x2,y1,z1) - tileSums(x1,y1,z1);
+    }
+    if (nPartial == 1){
+        unsigned int p = partial == 0 ? 1 : 0, q = partial == 2 ? 1 : 2;
+        const Array3D<std::array<double, TILE_SIZE-1> >& s = partialTileSums[partial];
+        unsigned int t = r[partial]->first, o = r[partial]->offset - 1;
+        unsigned int p1 = r[p]->first, q1 = r[q]->first, p2 = r[p]->last+1, q2 = r[q]->last+1;
+        return s(t,p2,q2)[o] - s(t,p1,q2)[o] - s(t,p2,q1)[o] + s(t,p1,q1)[o];
+    }
+    unsigned int t[3], offset[3] = {r[0]->offset, r[1]->offset, r[2]->offset};
+    double sum = 0;
+    for (t[0] = r[0]->first; t[0] <= r[0]->last; t[0]++)
+        for (t[1] = r[1]->first; t[1] <= r[1]->last; t[1]++)
+            for (t[2] = r[2]->first; t[2] <= r[2]->last; t[2]++)
+                sum += getSuffixSum(t, offset);
+    return sum;
+}
+
+/**
+ * @brief TiledGrid::getFaceTilesSum
+ *
+ * Sum of the face integrals of the layer c on the product of two tile ranges:
+ * 4 lookups on layerSums if both the ranges are whole, otherwise the tiles are summed one by one.
+ */
+void TiledGrid::getFaceTilesSum(double f[4], unsigned int axis, unsigned int c, const TileRange& rp, const TileRange& rq) const {
+    unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+    if (rp.offset == 0 && rq.offset == 0){
+        const Array3D<std::array<double, 4> >& s = layerSums[axis];
+        unsigned int p1 = rp.first, q1 = rq.first, p2 = rp.last+1, q2 = rq.last+1;
+        for (unsigned int i = 0; i < 4; i++)
+            f[i] = s(c,p2,q2)[i] - s(c,p1,q2)[i] - s(c,p2,q1)[i] + s(c,p1,q1)[i];
+        return;
+    }
+    for (unsigned int i = 0; i < 4; i++)
+        f[i] = 0;
+    unsigned int t[3];
+    t[axis] = c >> TILE_LOG2;
+    for (t[p] = rp.first; t[p] <= rp.last; t[p]++){
+        for (t[q] = rq.first; t[q] <= rq.last; t[q]++){
+            double g[4];
+            getFaceSuffixSum(g, axis, t, c & TILE_MASK, rp.offset, rq.offset);
+            for (unsigned int i = 0; i < 4; i++)
+                f[i] += g[i];
+        }
+    }
+}
+
+/**
+ * @brief TiledGrid::calculateSuffixSums
+ *
+ * Local suffix sums of the full box values of every dense tile, with three passes
+ * (one for every axis). Cells outside the grid count zero.
+ */
+void TiledGrid::calculateSuffixSums() {
+    suffixSums.resize(mapCoeffs.getNumberDenseTiles());
+    #pragma omp parallel for
+    for (unsigned int ti = 0; ti < nTiles[0]; ti++){
+        for (unsigned int tj = 0; tj < nTiles[1]; tj++){
+            for (unsigned int tk = 0; tk < nTiles[2]; tk++){
+                int d = mapCoeffs.getDenseTile(ti, tj, tk);
+                if (d < 0) continue;
+                const std::array<int, TILE_CELLS>& ids = mapCoeffs.getDenseTileData(d);
+                std::array<double, TILE_CELLS>& s = suffixSums[d];
+                for (unsigned int oi = 0; oi < TILE_SIZE; oi++)
+                    for (unsigned int oj = 0; oj < TILE_SIZE; oj++)
+                        for (unsigned int ok = 0; ok < TILE_SIZE; ok++){
+                            bool inside = oi < getNumberCells(0, ti, 0) && oj < getNumberCells(1, tj, 0) && ok < getNumberCells(2, tk, 0);
+                            s[TILE_INDEX(oi,oj,ok)] = inside ? fullBoxValues[ids[TILE_INDEX(oi,oj,ok)]] : 0;
+                        }
+                for (int oi = TILE_SIZE-2; oi >= 0; oi--)
+                    for (unsigned int oj = 0; oj < TILE_SIZE; oj++)
+                        for (unsigned int ok = 0; ok < TILE_SIZE; ok++)
+                            s[TILE_INDEX(oi,oj,ok)] += s[TILE_INDEX(oi+1,oj,ok)];
+                for (unsigned int oi = 0; oi < TILE_SIZE; oi++)
+                    for (int oj = TILE_SIZE-2; oj >= 0; oj--)
+                        for (unsigned int ok = 0; ok < TILE_SIZE; ok++)
+                            s[TILE_INDEX(oi,oj,ok)] += s[TILE_INDEX(oi,oj+1,ok)];
+                for (unsigned int oi = 0; oi < TILE_SIZE; oi++)
+                    for (unsigned int oj = 0; oj < TILE_SIZE; oj++)
+                        for (int ok = TILE_SIZE-2; ok >= 0; ok--)
+                            s[TILE_INDEX(oi,oj,ok)] += s[TILE_INDEX(oi,oj,ok+1)];
+            }
+        }
+    }
+}
+
+/**
+ * @brief TiledGrid::calculateTileSums
+ *
+ * Summed volume table of the sums of the tiles, and for every axis and every offset along it,
+ * summed area tables (on the other two axes) of the sums of the tiles restricted to [offset, 8).
+ */
+void TiledGrid::calculateTileSums() {
+    tileSums = Array3D<double>(nTiles[0]+1, nTiles[1]+1, nTiles[2]+1, 0);
+    std::array<double, TILE_SIZE-1> zero;
+    zero.fill(0);
+    for (unsigned int a = 0; a < 3; a++){
+        unsigned int p = a == 0 ? 1 : 0, q = a == 2 ? 1 : 2;
+        partialTileSums[a] = Array3D<std::array<double, TILE_SIZE-1> >(nTiles[a], nTiles[p]+1, nTiles[q]+1, zero);
+    }
+    #pragma omp parallel for
+    for (unsigned int ti = 0; ti < nTiles[0]; ti++){
+        for (unsigned int tj = 0; tj < nTiles[1]; tj++){
+            for (unsigned int tk = 0; tk < nTiles[2]; tk++){
+                unsigned int t[3] = {ti, tj, tk}, offset[3] = {0, 0, 0};
+                tileSums(ti+1,tj+1,tk+1) = getSuffixSum(t, offset);
+                for (unsigned int a = 0; a < 3; a++){
+                    unsigned int p = a == 0 ? 1 : 0, q = a == 2 ? 1 : 2;
+                    for (unsigned int o = 1; o < TILE_SIZE; o++){
+                        offset[a] = o;
+                        partialTileSums[a](t[a], t[p]+1, t[q]+1)[o-1] = getSuffixSum(t, offset);
+                    }
+                    offset[a] = 0;
+                }
+            }
+        }
+    }
+    for (unsigned int i = 1; i <= nTiles[0]; i++)
+        for (unsigned int j = 1; j <= nTiles[1]; j++)
+            for (unsigned int k = 1; k <= nTiles[2]; k++)
+                tileSums(i,j,k) += tileSums(i-1,j,k) + tileSums(i,j-1,k) + tileSums(i,j,k-1)
+                        - tileSums(i-1,j-1,k) - tileSums(i-1,j,k-1) - tileSums(i,j-1,k-1) + tileSums(i-1,j-1,k-1);
+    for (unsigned int a = 0; a < 3; a++){
+        Array3D<std::array<double, TILE_SIZE-1> >& s = partialTileSums[a];
+        for (unsigned int t = 0; t < s.getSizeX(); t++)
+            for (unsigned int ip = 1; ip < s.getSizeY(); ip++)
+                for (unsigned int iq = 1; iq < s.getSizeZ(); iq++)
+                    for (unsigned int o = 0; o < TILE_SIZE-1; o++)
+                        s(t,ip,iq)[o] += s(t,ip-1,iq)[o] + s(t,ip,iq-1)[o] - s(t,ip-1,iq-1)[o];
+    }
+}
+
+/**
+ * @brief TiledGrid::calculateFaceSuffixSums
+ *
+ * For every axis and every dense tile, local 2D suffix sums of the face integrals on every layer
+ * of the tile. Cells outside the grid count zero.
+ */
+void TiledGrid::calculateFaceSuffixSums() {
+    for (unsigned int axis = 0; axis < 3; axis++){
+        unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+        std::vector<std::array<std::array<double, 4>, TILE_CELLS> >& sums = faceSuffixSums[axis];
+        sums.resize(mapCoeffs.getNumberDenseTiles());
+        #pragma omp parallel for
+        for (unsigned int ti = 0; ti < nTiles[0]; ti++){
+            for (unsigned int tj = 0; tj < nTiles[1]; tj++){
+                for (unsigned int tk = 0; tk < nTiles[2]; tk++){
+                    int d = mapCoeffs.getDenseTile(ti, tj, tk);
+                    if (d < 0) continue;
+                    const std::array<int, TILE_CELLS>& ids = mapCoeffs.getDenseTileData(d);
+                    std::array<std::array<double, 4>, TILE_CELLS>& s = sums[d];
+                    unsigned int t[3] = {ti, tj, tk}, o[3];
+                    for (o[0] = 0; o[0] < TILE_SIZE; o[0]++)
+                        for (o[1] = 0; o[1] < TILE_SIZE; o[1]++)
+                            for (o[2] = 0; o[2] < TILE_SIZE; o[2]++){
+                                bool inside = o[0] < getNumberCells(0, t[0], 0) && o[1] < getNumberCells(1, t[1], 0) && o[2] < getNumberCells(2, t[2], 0);
+                                std::array<double, 4>& f = s[TILE_INDEX(o[axis], o[p], o[q])];
+                                if (inside)
+                                    f = faceIntegrals[axis][ids[TILE_INDEX(o[0], o[1], o[2])]];
+                                else
+                                    f.fill(0);
+                            }
+                    for (unsigned int c = 0; c < TILE_SIZE; c++){
+                        for (int op = TILE_SIZE-2; op >= 0; op--)
+                            for (unsigned int oq = 0; oq < TILE_SIZE; oq++)
+                                for (unsigned int i = 0; i < 4; i++)
+                                    s[TILE_INDEX(c,op,oq)][i] += s[TILE_INDEX(c,op+1,oq)][i];
+                        for (unsigned int op = 0; op < TILE_SIZE; op++)
+                            for (int oq = TILE_SIZE-2; oq >= 0; oq--)
+                                for (unsigned int i = 0; i < 4; i++)
+                                    s[TILE_INDEX(c,op,oq)][i] += s[TILE_INDEX(c,op,oq+1)][i];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief TiledGrid::calculateLayerSums
+ *
+ * For every axis and every layer of cells orthogonal to it, summed area table (on the tiles)
+ * of the face integrals of the cells of the layer.
+ */
+void TiledGrid::calculateLayerSums() {
+    for (unsigned int axis = 0; axis < 3; axis++){
+        unsigned int p = axis == 0 ? 1 : 0, q = axis == 2 ? 1 : 2;
+        Array3D<std::array<double, 4> >& s = layerSums[axis];
+        s = Array3D<std::array<double, 4> >(nCells[axis], nTiles[p]+1, nTiles[q]+1, {0, 0, 0, 0});
+        #pragma omp parallel for
+        for (unsigned int c = 0; c < nCells[axis]; c++){
+            unsigned int t[3];
+            t[axis] = c >> TILE_LOG2;
+            for (t[p] = 0; t[p] < nTiles[p]; t[p]++){
+                for (t[q] = 0; t[q] < nTiles[q]; t[q]++){
+                    double f[4];
+                    getFaceSuffixSum(f, axis, t, c & TILE_MASK, 0, 0);
+                    for (unsigned int i = 0; i < 4; i++)
+                        s(c,t[p]+1,t[q]+1)[i] = f[i] + s(c,t[p],t[q]+1)[i] + s(c,t[p]+1,t[q])[i] - s(c,t[p],t[q])[i];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef TILEDGRID_H
+#define TILEDGRID_H
+
+#include "tiledarray.h"
+#include "engine/tricubic.h"
+
+/**
+ * Sparse storage of the data of a Grid used by the Energy, on tiles of 8x8x8 cells (or points).
+ * Far from the surface the weights and the coefficients are constant on whole tiles, so only the
+ * tiles crossed by the surface or by the kernel border are stored explicitly.
+ *
+ * The full box values and the face integrals are stored once for every set of coefficients.
+ * The summed tables are built on the tiles: a box is split on every axis in a partial first tile,
+ * a range of whole tiles and a partial last tile, and every product of these parts is answered by
+ * a table on the tiles (whole parts) or by the suffix sums inside a tile (partial parts).
+ * Dense tiles have local suffix tables, uniform tiles are the value of the tile times the number
+ * of cells.
+ * Without full box values only weights and coefficient ids are stored (grid whose weights have
+ * been computed directly on the tiles, before the full box values).
+ */
+class TiledGrid {
+        friend class GridCache;
+    public:
+        TiledGrid();
+        TiledGrid(const cg3::Array3D<gridreal>& weights, const cg3::Array3D<int>& mapCoeffs, const std::vector<std::array<gridreal, 64> >& coeffs, const std::vector<gridreal>& fullBoxValues);
+        TiledGrid(const TiledArray3D<gridreal>& weights, const TiledArray3D<int>& mapCoeffs, const std::vector<std::array<gridreal, 64> >& coeffs, const std::vector<gridreal>& fullBoxValues);
+
+        gridreal getWeight(unsigned int i, unsigned int j, unsigned int k) const;
+        int getCoefficientsId(unsigned int i, unsigned int j, unsigned int k) const;
+        double getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const;
+        double getFullBoxesValue(int i1, int j1, int k1, int i2, int j2, int k2) const;
+        void getFullFacesValue(double f[4], unsigned int axis, int c, int p1, int q1, int p2, int q2) const;
+
+        unsigned int getNumberTiles() const;
+        unsigned int getNumberDenseTiles() const;
+
+        void getWeights(cg3::Array3D<gridreal>& w) const;
+        void getMapCoeffs(cg3::Array3D<int>& m) const;
+        void getFullBoxValues(cg3::Array3D<gridreal>& v) const;
+        const TiledArray3D<gridreal>& getTiledWeights() const;
+        const TiledArray3D<int>& getTiledMapCoeffs() const;
+
+    private:
+        void calculateSummedTables(const std::vector<std::array<gridreal, 64> >& coeffs);
+
+        typedef struct {
+            int sign;
+            unsigned int first, last; //range of tiles
+            unsigned int offset; //cells of the tiles before offset are excluded
+        } TileRange;
+
+        static unsigned int getTileRanges(TileRange ranges[3], int c1, int c2);
+        unsigned int getNumberCells(unsigned int axis, unsigned int t, unsigned int offset) const;
+        double getSuffixSum(const unsigned int t[3], const unsigned int offset[3]) const;
+        void getFaceSuffixSum(double f[4], unsigned int axis, const unsigned int t[3], unsigned int c, unsigned int offsetP, unsigned int offsetQ) const;
+        double getTilesSum(const TileRange* r[3]) const;
+        void getFaceTilesSum(double f[4], unsigned int axis, unsigned int c, const TileRange& rp, const TileRange& rq) const;
+
+        void calculateSuffixSums();
+        void calculateTileSums();
+        void calculateFaceSuffixSums();
+        void calculateLayerSums();
+
+        TiledArray3D<gridreal> weights;
+        TiledArray3D<int> mapCoeffs;
+        unsigned int nCells[3], nTiles[3];
+        std::vector<gridreal> fullBoxValues; //for every set of coefficients
+        std::vector<std::array<double, 4> > faceIntegrals[3]; //for every axis and every set of coefficients
+
+        std::vector<std::array<double, TILE_CELLS> > suffixSums; //for every dense tile of mapCoeffs, sums on [oi,8)x[oj,8)x[ok,8)
+        cg3::Array3D<double> tileSums; //summed volume table of the sums of the tiles
+        cg3::Array3D<std::array<double, TILE_SIZE-1> > partialTileSums[3]; //for every axis a: (ta, tp, tq) -> summed area table on the tiles of the layer ta, sums on the cells [o,8) along a
+        std::vector<std::array<std::array<double, 4>, TILE_CELLS> > faceSuffixSums[3]; //for every axis and every dense tile: (c, op, oq) -> face sums on [op,8)x[oq,8) of the local layer c
+        cg3::Array3D<std::array<double, 4> > layerSums[3]; //for every axis and every layer of cells: summed area table of the face sums of the tiles
+};
+
+inline gridreal TiledGrid::getWeight(unsigned int i, unsigned int j, unsigned int k) const {
+    return weights(i,j,k);
+}
+
+inline int TiledGrid::getCoefficientsId(unsigned int i, unsigned int j, unsigned int k) const {
+    return mapCoeffs(i,j,k);
+}
+
+inline double TiledGrid::getFullBoxValue(unsigned int i, unsigned int j, unsigned int k) const {
+    return fullBoxValues[mapCoeffs(i,j,k)];
+}
+
+inline unsigned int TiledGrid::getNumberTiles() const {
+    return weights.getNumberTiles() + mapCoeffs.getNumberTiles();
+}
+
+inline unsigned int TiledGrid::getNumberDenseTiles() const {
+    return weights.getNumberDenseTiles() + mapCoeffs.getNumberDenseTiles();
+}
+
+inline void TiledGrid::getWeights(cg3::Array3D<gridreal>& w) const {
+    weights.toArray3D(w);
+}
+
+inline void TiledGrid::getMapCoeffs(cg3::Array3D<int>& m) const {
+    mapCoeffs.toArray3D(m);
+}
+
+inline const TiledArray3D<gridreal>& TiledGrid::getTiledWeights() const {
+    return weights;
+}
+
+inline const TiledArray3D<int>& TiledGrid::getTiledMapCoeffs() const {
+    return mapCoeffs;
+}
+
+/**
+ * @brief TiledGrid::getNumberCells
+ *
+ * Number of cells of the tile t (along axis) with local coordinate in [offset, 8) that are inside the grid
+ */
+inline unsigned int TiledGrid::getNumberCells(unsigned int axis, unsigned int t, unsigned int offset) const {
+    int n = std::min((int)TILE_SIZE, (int)nCells[axis] - (int)(t << TILE_LOG2)) - (int)offset;
+    return n > 0 ? n : 0;
+}
+
+#endif // TILEDGRID_H
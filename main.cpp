@@ -34,7 +34,7 @@ void deserializeAfterBooleans(const std::string& filename, Dcel& d, EigenMesh& o
 int main(int argc, char *argv[]) {
     #ifdef SERVER_MODE
     //usage
-    // ./HeightFieldDecomposition filename.obj precision kernel snapping orientation (t/f) conservative (f/t)
+    // ./HeightFieldDecomposition filename.obj precision kernel snapping orientation (t/f) conservative (f/t) gridcachesize (MB, 0 for no limit) bricksbudget (MB, with OUT_OF_CORE_GRID)
     if (argc > 3){
         bool smoothed = true;
         std::string filename(argv[1]);
@@ -72,7 +72,7 @@ int main(int argc, char *argv[]) {
             foldername += "noo_";
             optimal = false;
         }
-        if (argc == 7 && std::string(argv[6]) == "t"){ // if conservative optimization required, there will be different foldername
+        if (argc >= 7 && std::string(argv[6]) == "t"){ // if conservative optimization required, there will be different foldername
             foldername += "cons_";
             conservative = true;
         }
@@ -127,8 +127,18 @@ int main(int argc, char *argv[]) {
         //solutions
         BoxList solutions;
 
+        //grids cache, shared by all the runs on the same model
+        std::string gridsFoldername = rawname + "_grids/";
+        executeCommand("mkdir " + gridsFoldername);
+        GridCache::setDirectory(gridsFoldername);
+        if (argc >= 8)
+            GridCache::setMaxSize((uint64_t)(std::stod(argv[7]) * 1024 * 1024));
+        OutOfCoreGrid::setDirectory(gridsFoldername); //temporary bricks of the grids, with OUT_OF_CORE_GRID
+        if (argc >= 9)
+            OutOfCoreGrid::setMemoryBudget(std::stoul(argv[8]));
+
         //grow boxes                              //boxes    mesh  kernel       limit  limit     toler           only  areatol  angletol  fileus  decim
-        double timerBoxGrowing = Engine::optimize(solutions, d, kernelDistance, false, Pointd(), !conservative,  true, 0,       0,        false,  true);
+        double timerBoxGrowing = Engine::optimize(solutions, d, kernelDistance, false, Pointd(), !conservative,  true, 0,       0,        true,   true);
 
         logFile << timerBoxGrowing << ": Box Growing\n";
 